@@ -0,0 +1,122 @@
+/*!
+    \file batch.c Example client of libvideoplayer: decodes several videos at once, one thread and one VP_Player per video, without the player.
+
+    For every video the properties are printed, every frame is decoded in order and its mean brightness taken, and the frame numbers returned are checked to follow each other. With <em>-t MS</em> the frame shown at that time is looked up with vp_seek_time() first and decoded from there.
+    \code
+    g++ -shared -fPIC videoplayer.c -o libvideoplayer.so `pkg-config --cflags --libs opencv`
+    gcc batch.c -o batch -L. -lvideoplayer -lpthread
+    LD_LIBRARY_PATH=. ./batch -t 2000 first.avi second.avi
+    \endcode
+    The exit status is 0 when every video was decoded without error.
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<pthread.h>
+#include "videoplayer.h"
+
+//! The work of one thread.
+typedef struct{
+	const char* path;//!< The video.
+	double at_ms;//!< Time to start at, negative to start with the first frame.
+	pthread_t thread;//!< The thread decoding the video.
+	VP_Properties props;//!< Properties of the video.
+	int first;//!< Number of the first frame decoded.
+	int frames;//!< Number of frames decoded.
+	double brightness;//!< Mean brightness of the frames decoded, 0 to 255.
+	double decode_ms;//!< Time spent decoding, as counted by the library.
+	int error;//!< Result code of the call which failed, #VP_OK when none did.
+	const char* failed;//!< Name of the call which failed.
+} Batch_Job;
+
+//Function to decode a whole video
+/*!
+ * \param arg : The Batch_Job.
+ * */
+void* batch_worker( void* arg ){
+	Batch_Job* job = ( Batch_Job* )arg;
+	VP_Player* p = vp_open( job->path );
+	if( !p ){
+		job->error = VP_ERR_ARG;
+		job->failed = "vp_open";
+		return( NULL );
+	}
+	vp_get_properties( p, &job->props );
+	int stride = job->props.width*job->props.channels;
+	unsigned char* buf = ( unsigned char* )malloc( job->props.frame_bytes );
+	if( job->at_ms>=0 ){
+		int code = vp_seek_time( p, job->at_ms );
+		if( code<0 ){
+			job->error = code;
+			job->failed = "vp_seek_time";
+		}
+	}
+	double sum = 0;
+	int expected = -1;
+	for( int f; !job->error && ( f = vp_next_frame( p, buf, stride ) )!=VP_END; ){
+		if( f<0 || ( expected>0 && f!=expected ) ){
+			job->error = ( f<0 ) ? f : VP_ERR_RANGE;
+			job->failed = "vp_next_frame";
+			break;
+		}
+		if( !job->frames ){
+			job->first = f;
+		}
+		long total = 0;
+		for( int i=0; i<job->props.frame_bytes; i++ ){
+			total += buf[i];
+		}
+		sum += ( double )total/job->props.frame_bytes;
+		job->frames++;
+		expected = f + 1;
+	}
+	VP_Stats stats;
+	vp_get_stats( p, &stats );
+	job->decode_ms = stats.decode_ms;
+	job->brightness = job->frames ? sum/job->frames : 0;
+	free( buf );
+	vp_close( p );
+	return( NULL );
+}
+
+//Main function
+/*! Starts one thread per video given, then prints what every thread found, in the order of the arguments.
+ */
+int main( int argc, char** argv ){
+	if( vp_api_version()!=VP_API_VERSION ){
+		printf( "libvideoplayer has interface %d, this program was built for %d\n", vp_api_version(), VP_API_VERSION );
+		return( 1 );
+	}
+	double at_ms = -1;
+	int first = 1;
+	if( argc>2 && !strcmp( argv[1], "-t" ) ){
+		at_ms = atof( argv[2] );
+		first = 3;
+	}
+	if( first>=argc ){
+		printf( "Usage : %s [-t MS] video-file...\n", argv[0] );
+		return( 1 );
+	}
+	int count = argc - first;
+	Batch_Job* jobs = ( Batch_Job* )calloc( count, sizeof( Batch_Job ) );
+	//every handle holds its own state, the videos are decoded in parallel
+	for( int i=0; i<count; i++ ){
+		jobs[i].path = argv[ first + i ];
+		jobs[i].at_ms = at_ms;
+		pthread_create( &jobs[i].thread, NULL, batch_worker, &jobs[i] );
+	}
+	int failures = 0;
+	for( int i=0; i<count; i++ ){
+		Batch_Job* job = &jobs[i];
+		pthread_join( job->thread, NULL );
+		if( job->error ){
+			printf( "%s : %s failed, %s\n", job->path, job->failed, vp_strerror( job->error ) );
+			failures++;
+			continue;
+		}
+		printf( "%s : %dx%d %s, %.2f fps, frames %d to %d, brightness %.1f, %.2f ms per frame\n", job->path, job->props.width, job->props.height,
+			job->props.fourcc, job->props.fps, job->first, job->first + job->frames - 1, job->brightness, job->frames ? job->decode_ms/job->frames : 0.0 );
+	}
+	free( jobs );
+	return( failures ? 1 : 0 );
+}
@@ -0,0 +1,473 @@
+/*!
+    \file test_player.c Checks of the player, built from its own source.
+
+    The player is included whole, its main() renamed, so that the checks call the very functions the player runs:
+    - the LEB128 numbers and the markers file, written, read back, and read truncated or malformed ( marker_write(), marker_read() );
+    - the timecodes and the times typed in the step field ( format_timecode(), parse_time() );
+    - the similar-frames search at the radius where it stops using the multi-index tables ( phash_search() );
+    - the PSNR and the SSIM against reference values ( quality_frame() );
+    - the frame reached by <em>seek</em>, <em>step</em>, <em>next-marker</em> and <em>seek-time</em> in a video file, a Y4M stream and a live input, through the command socket of a player started by the checks.
+    \code
+    g++ test_player.c videoplayer.c -o test_player `pkg-config --cflags --libs opencv` -lpthread
+    ./test_player [video-file]
+    \endcode
+    Without a video file, a short MJPG video is written with cvCreateVideoWriter(); its checks are skipped when OpenCV cannot write it. The exit status is 0 when every check passed.
+ */
+#include<sys/wait.h>
+#include<fcntl.h>
+
+#define main video_player_main
+#include "video_player.c"
+#undef main
+
+int checks = 0;		//!< Number of checks made.
+int failures = 0;	//!< Number of checks failed.
+
+//! Macro to count a check and report it when it fails.
+#define CHECK( cond, ... )	do{ checks++; if( !( cond ) ){ failures++; printf( "%s:%d : ", __FILE__, __LINE__ ); printf( __VA_ARGS__ ); printf( "\n" ); } }while( 0 )
+
+//Function to check the LEB128 numbers and the markers file
+/*!
+ * Every prefix of a valid file, and a file announcing 2^32 - 1 labels, must be refused without leaving any marker or label behind.
+ * */
+void test_markers( const char* dir ){
+	FILE* fp = tmpfile();
+	unsigned int values[] = { 0, 1, 127, 128, 16383, 16384, 2097152, 0x7fffffff, 0xffffffff };
+	int nvalues = sizeof( values )/sizeof( values[0] );
+	for( int i=0; i<nvalues; i++ ){
+		put_varint( fp, values[i] );
+	}
+	rewind( fp );
+	for( int i=0; i<nvalues; i++ ){
+		unsigned int v;
+		CHECK( get_varint( fp, &v ) && v==values[i], "varint %u read back as %u", values[i], v );
+	}
+	unsigned int v;
+	CHECK( !get_varint( fp, &v ), "varint read past the end" );
+	fclose( fp );
+	//more than 32 bits, and a number cut short
+	const char* bad[] = { "\xff\xff\xff\xff\x1f", "\xff\xff\xff\xff\xff\x01", "\x80" };
+	for( int i=0; i<3; i++ ){
+		fp = tmpfile();
+		fputs( bad[i], fp );
+		rewind( fp );
+		CHECK( !get_varint( fp, &v ), "malformed varint %d accepted as %u", i, v );
+		fclose( fp );
+	}
+
+	char path[ 1024 ], cut[ 1024 ];
+	snprintf( path, sizeof( path ), "%s/test.markers", dir );
+	snprintf( cut, sizeof( cut ), "%s/cut.markers", dir );
+	markers_close();
+	int cut_label = marker_label( "cut" ), fade = marker_label( "fade" );
+	marker_add( 300000, 300100, fade );
+	marker_add( 10, 20, cut_label );
+	marker_add( 5, 5, 0 );
+	marker_add( 7, 7, cut_label );
+	CHECK( marker_write( path ), "cannot write %s", path );
+	markers.modified = false;
+	markers_close();
+	CHECK( marker_read( path )==4, "markers not read back" );
+	marker_sort();
+	int expected[ 4 ][ 3 ] = { { 5, 5, 0 }, { 7, 7, cut_label }, { 10, 20, cut_label }, { 300000, 300100, fade } };
+	for( int i=0; i<4 && i<markers.count; i++ ){
+		const Marker* m = &markers.items[i];
+		CHECK( m->first==expected[i][0] && m->last==expected[i][1] && m->label==expected[i][2], "marker %d read back as %d-%d:%d", i, m->first, m->last, m->label );
+	}
+	CHECK( markers.nlabels==3 && !strcmp( markers.labels[ cut_label ], "cut" ) && !strcmp( markers.labels[ fade ], "fade" ), "labels not read back" );
+	markers.modified = false;
+	markers_close();
+
+	//every prefix of the file is refused
+	fp = fopen( path, "rb" );
+	char data[ 256 ];
+	int size = ( int )fread( data, 1, sizeof( data ), fp );
+	fclose( fp );
+	for( int len=0; len<size; len++ ){
+		fp = fopen( cut, "wb" );
+		fwrite( data, 1, len, fp );
+		fclose( fp );
+		CHECK( marker_read( cut )<0 && markers.count==0 && markers.nlabels==0, "file cut to %d bytes of %d accepted", len, size );
+		markers_close();
+	}
+	//a bad file leaves the markers already set alone
+	const char* malformed[] = { "VPMARKS1\xff\xff\xff\xff\x0f", "VPMARKS1\x01\x01x\x01\x00\x00\x05", "VPMARKS2\x00\x00" };
+	int lengths[] = { 13, 15, 10 };
+	for( int i=0; i<3; i++ ){
+		marker_add( 1, 2, marker_label( "kept" ) );
+		fp = fopen( cut, "wb" );
+		fwrite( malformed[i], 1, lengths[i], fp );
+		fclose( fp );
+		CHECK( marker_read( cut )<0 && markers.count==1 && markers.nlabels==2, "malformed file %d changed the markers : %d markers, %d labels", i, markers.count, markers.nlabels );
+		markers.modified = false;
+		markers_close();
+	}
+	unlink( path );
+	unlink( cut );
+}
+
+//Function to check the timecodes and the times typed
+void test_times(){
+	fps = 25;
+	struct{ double ms; const char* timecode; } codes[] = { { 0, "00:00:00:00" }, { 999.99, "00:00:00:24" }, { 1000, "00:00:01:00" }, { 3723040, "01:02:03:01" }, { -5, "00:00:00:00" } };
+	for( int i=0; i<5; i++ ){
+		char text[ 32 ];
+		format_timecode( codes[i].ms, text, sizeof( text ) );
+		CHECK( !strcmp( text, codes[i].timecode ), "%.2f ms as %s instead of %s", codes[i].ms, text, codes[i].timecode );
+	}
+	struct{ const char* text; double ms; } times[] = { { "01:02:03:01", 3723040 }, { "00:00:01;12", 1480 }, { "1:30", 90000 }, { "90.5", 90500 }, { "1:02:03.5", 3723500 }, { "0", 0 } };
+	for( int i=0; i<6; i++ ){
+		double ms = -1;
+		CHECK( parse_time( times[i].text, &ms ) && fabs( ms - times[i].ms )<1e-6, "%s read as %.3f ms instead of %.3f", times[i].text, ms, times[i].ms );
+	}
+	const char* invalid[] = { "", "abc", "-1", "00:00:00:25", "1:60:00:00", "1.5:00", "1:2:3:4:5", "10s" };
+	for( int i=0; i<8; i++ ){
+		double ms;
+		CHECK( !parse_time( invalid[i], &ms ), "%s accepted", invalid[i] );
+	}
+	//every frame goes back to its own time
+	fps = 29.97;
+	for( int f=0; f<1000; f++ ){
+		char text[ 32 ];
+		double ms = f*1e3/30, back = -1;
+		format_timecode( ms, text, sizeof( text ) );
+		CHECK( parse_time( text, &back ) && fabs( back - ms )<1e-6, "frame %d : %s read back as %.3f ms", f, text, back );
+	}
+}
+
+//Function to check the similar-frames search against a linear scan
+/*!
+ * Below a radius of 8 the search only looks at the frames matching one 16-bit chunk within radius / 4 bits; the frames are placed at every distance up to 12 from the hash searched, with the differing bits spread over the chunks in every way.
+ * */
+void test_phash(){
+	const int frames = 2000;
+	uint64 h = 0x0123456789abcdefULL;
+	phash.size = frames + 1;
+	phash.hashes = ( uint64* )calloc( phash.size, sizeof( uint64 ) );
+	phash.done = ( uchar* )calloc( phash.size, 1 );
+	unsigned int seed = 1;
+	for( int f=1; f<phash.size; f++ ){
+		int distance = f%13;
+		uint64 flips = 0;
+		//the first frames put all the bits in one chunk, the others anywhere
+		for( int k=0; k<distance; ){
+			seed = seed*1103515245 + 12345;
+			int bit = ( f<100 ) ? ( f%4 )*16 + ( seed>>16 )%16 : ( seed>>16 )%64;
+			if( !( flips>>bit & 1 ) ){
+				flips |= 1ULL<<bit;
+				k++;
+			}
+		}
+		phash.hashes[f] = h ^ flips;
+		phash.done[f] = 1;
+	}
+	phash_build_tables();
+	int* out = ( int* )malloc( phash.size*sizeof( int ) );
+	for( int radius=0; radius<=12; radius++ ){
+		int expected = 0;
+		for( int f=1; f<phash.size; f++ ){
+			expected += ( __builtin_popcountll( phash.hashes[f] ^ h )<=radius );
+		}
+		phash.complete = true;
+		int n = phash_search( h, radius, out );
+		bool exact = ( n==expected );
+		for( int i=0; i<n && exact; i++ ){
+			exact = ( __builtin_popcountll( phash.hashes[ out[i] ] ^ h )<=radius && ( i==0 || out[i]>out[ i - 1 ] ) );
+		}
+		CHECK( exact, "radius %d : %d frames found with the tables, %d expected", radius, n, expected );
+		phash.complete = false;
+		CHECK( phash_search( h, radius, out )==expected, "radius %d : wrong number of frames found by the scan", radius );
+	}
+	free( out );
+	for( int c=0; c<PHASH_CHUNKS; c++ ){
+		free( phash.offsets[c] );
+		free( phash.ids[c] );
+		phash.offsets[c] = NULL;
+		phash.ids[c] = NULL;
+	}
+	free( phash.hashes );
+	free( phash.done );
+	phash.hashes = NULL;
+	phash.done = NULL;
+	phash.size = 0;
+}
+
+//Function to compare two frames as the quality engine does
+/*!
+ * Runs quality_frame() with one band thread.
+ *
+ * \param psnr : Receives the PSNR of the luma, blue, green and red planes.
+ * \param ssim : Receives their SSIM.
+ * */
+void quality_pair( const IplImage* a, const IplImage* b, double* psnr, double* ssim ){
+	pthread_mutex_init( &quality.lock, NULL );
+	pthread_cond_init( &quality.work, NULL );
+	pthread_cond_init( &quality.done_cond, NULL );
+	quality.quit = false;
+	quality.size = 2;
+	for( int k=0; k<2*QUALITY_PLANES; k++ ){
+		quality.values[k] = ( float* )calloc( quality.size, sizeof( float ) );
+	}
+	pthread_t worker;
+	pthread_create( &worker, NULL, quality_band_worker, NULL );
+	quality_frame( a, b, 1 );
+	pthread_mutex_lock( &quality.lock );
+	quality.quit = true;
+	pthread_cond_broadcast( &quality.work );
+	pthread_mutex_unlock( &quality.lock );
+	pthread_join( worker, NULL );
+	for( int c=0; c<QUALITY_PLANES; c++ ){
+		psnr[c] = quality.values[c][1];
+		ssim[c] = quality.values[ QUALITY_PLANES + c ][1];
+	}
+	for( int k=0; k<2*QUALITY_PLANES; k++ ){
+		free( quality.values[k] );
+		quality.values[k] = NULL;
+	}
+	free( quality.sums );
+	quality.sums = NULL;
+	quality.nbands = 0;
+	quality.size = 0;
+}
+
+//Function to get a plane of a BGR frame, the luma being weighted as split_bgr_u8() does
+int plane_sample( const IplImage* img, int x, int y, int c ){
+	const uchar* p = ( const uchar* )img->imageData + y*img->widthStep + 3*x;
+	return( c ? p[ c - 1 ] : ( 29*p[0] + 150*p[1] + 77*p[2] + 128 )>>8 );
+}
+
+//Function to check the PSNR and the SSIM against reference values
+/*!
+ * Two flat frames 10 levels apart give \f$ 10 \log_{10}( 255^2/100 ) \f$ dB and an SSIM of \f$ ( 2 \cdot 100 \cdot 110 + C_1 )/( 100^2 + 110^2 + C_1 ) \f$. Two noisy frames, of a size which is not a multiple of 8, are checked against a direct computation over the 8x8 blocks, with the sample variances.
+ * */
+void test_quality(){
+	double psnr[ QUALITY_PLANES ], ssim[ QUALITY_PLANES ];
+	const double c1 = 0.01*0.01*255*255, c2 = 0.03*0.03*255*255;
+	IplImage* a = cvCreateImage( cvSize( 64, 48 ), IPL_DEPTH_8U, 3 );
+	IplImage* b = cvCreateImage( cvSize( 64, 48 ), IPL_DEPTH_8U, 3 );
+	cvSet( a, cvScalarAll( 100 ) );
+	cvSet( b, cvScalarAll( 110 ) );
+	quality_pair( a, a, psnr, ssim );
+	for( int c=0; c<QUALITY_PLANES; c++ ){
+		CHECK( psnr[c]==100 && fabs( ssim[c] - 1 )<1e-6, "identical frames, plane %d : PSNR %.3f, SSIM %.5f", c, psnr[c], ssim[c] );
+	}
+	quality_pair( a, b, psnr, ssim );
+	double flat_psnr = 10*log10( 255.0*255.0/100 ), flat_ssim = ( 2*100*110 + c1 )/( 100*100 + 110*110 + c1 );
+	for( int c=0; c<QUALITY_PLANES; c++ ){
+		CHECK( fabs( psnr[c] - flat_psnr )<1e-3 && fabs( ssim[c] - flat_ssim )<1e-5, "flat frames, plane %d : PSNR %.4f, SSIM %.6f instead of %.4f, %.6f", c, psnr[c], ssim[c], flat_psnr, flat_ssim );
+	}
+	cvReleaseImage( &a );
+	cvReleaseImage( &b );
+
+	a = cvCreateImage( cvSize( 70, 45 ), IPL_DEPTH_8U, 3 );
+	b = cvCreateImage( cvSize( 70, 45 ), IPL_DEPTH_8U, 3 );
+	unsigned int seed = 7;
+	for( int y=0; y<a->height; y++ ){
+		for( int x=0; x<3*a->width; x++ ){
+			seed = seed*1103515245 + 12345;
+			int v = 40 + x + 2*y;
+			( ( uchar* )a->imageData )[ y*a->widthStep + x ] = ( uchar )v;
+			( ( uchar* )b->imageData )[ y*b->widthStep + x ] = ( uchar )MIN( MAX( v + ( int )( ( seed>>16 )%21 ) - 10, 0 ), 255 );
+		}
+	}
+	quality_pair( a, b, psnr, ssim );
+	for( int c=0; c<QUALITY_PLANES; c++ ){
+		double ssd = 0, sum = 0;
+		int blocks = 0;
+		for( int y=0; y<a->height; y++ ){
+			for( int x=0; x<a->width; x++ ){
+				double d = plane_sample( a, x, y, c ) - plane_sample( b, x, y, c );
+				ssd += d*d;
+			}
+		}
+		for( int y0=0; y0 + 8<=a->height; y0 += 8 ){
+			for( int x0=0; x0 + 8<=a->width; x0 += 8 ){
+				double ma = 0, mb = 0, va = 0, vb = 0, cov = 0;
+				for( int y=y0; y<y0 + 8; y++ ){
+					for( int x=x0; x<x0 + 8; x++ ){
+						ma += plane_sample( a, x, y, c )/64.0;
+						mb += plane_sample( b, x, y, c )/64.0;
+					}
+				}
+				for( int y=y0; y<y0 + 8; y++ ){
+					for( int x=x0; x<x0 + 8; x++ ){
+						double da = plane_sample( a, x, y, c ) - ma, db = plane_sample( b, x, y, c ) - mb;
+						va += da*da/63;
+						vb += db*db/63;
+						cov += da*db/63;
+					}
+				}
+				sum += ( 2*ma*mb + c1 )*( 2*cov + c2 )/( ( ma*ma + mb*mb + c1 )*( va + vb + c2 ) );
+				blocks++;
+			}
+		}
+		double ref_psnr = 10*log10( 255.0*255.0*a->width*a->height/ssd ), ref_ssim = sum/blocks;
+		CHECK( fabs( psnr[c] - ref_psnr )<1e-3 && fabs( ssim[c] - ref_ssim )<1e-5, "noisy frames, plane %d : PSNR %.4f, SSIM %.6f instead of %.4f, %.6f", c, psnr[c], ssim[c], ref_psnr, ref_ssim );
+	}
+	cvReleaseImage( &a );
+	cvReleaseImage( &b );
+}
+
+//Function to send a command to a player and get the frame of its reply
+/*!
+ * \return the frame reported, -1 when the command failed or reported no frame.
+ * */
+int player_command( FILE* sock, const char* command ){
+	char reply[ 4096 ];
+	fprintf( sock, "%s\n", command );
+	fflush( sock );
+	if( !fgets( reply, sizeof( reply ), sock ) || !strstr( reply, "\"ok\":true" ) ){
+		return( -1 );
+	}
+	const char* frame = strstr( reply, "\"frame\":" );
+	return( frame ? atoi( frame + 8 ) : -1 );
+}
+
+//Function to check the frames reached in a player started on an input
+/*!
+ * The player runs in a child process, headless, driven through a command socket. Every command which lands on a frame must land on the frame asked for, numbered as get_frame_pos() does: from 1 in a video file, from 0 in a stream or a live input. A live input is first given the time to buffer the frames used.
+ *
+ * \param name : Name of the input in the messages.
+ * \param args : Arguments of the player, without the socket.
+ * \param input : File given to the player as stdin, NULL for none.
+ * \param first : Number of the first frame.
+ * */
+void test_seeks( const char* name, const char** args, const char* input, int first ){
+	char sock_path[ 108 ];
+	snprintf( sock_path, sizeof( sock_path ), "/tmp/test_player.%d.sock", ( int )getpid() );
+	unlink( sock_path );
+	const char* argv[ 16 ] = { "video_player", "--headless", "--socket", sock_path };
+	int argc = 4;
+	for( ; args[ argc - 4 ]; argc++ ){
+		argv[ argc ] = args[ argc - 4 ];
+	}
+	fflush( stdout );
+	pid_t child = fork();
+	if( child==0 ){
+		int null_fd = open( "/dev/null", O_WRONLY );
+		dup2( null_fd, 1 );
+		if( input ){
+			dup2( open( input, O_RDONLY ), 0 );
+		}
+		_exit( video_player_main( argc, ( char** )argv ) );
+	}
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	struct sockaddr_un addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sun_family = AF_UNIX;
+	snprintf( addr.sun_path, sizeof( addr.sun_path ), "%s", sock_path );
+	bool connected = false;
+	for( int i=0; i<100 && !connected; i++ ){
+		connected = ( connect( fd, ( struct sockaddr* )&addr, sizeof( addr ) )==0 );
+		if( !connected ){
+			usleep( 50000 );
+		}
+	}
+	CHECK( connected, "%s : the player did not start", name );
+	if( connected ){
+		FILE* sock = fdopen( fd, "r+" );
+		int f = -1;
+		for( int i=0; i<200 && f!=first + 30; i++ ){
+			f = player_command( sock, "seek 30" );
+			if( f!=first + 30 ){
+				usleep( 50000 );
+			}
+		}
+		struct{ const char* command; int frame; } steps[] = { { "seek 10", 10 }, { "step -1", 9 }, { "step 3", 12 }, { "seek 1", 1 }, { "get-frame 25", 25 }, { "mark 20", -1 }, { "seek 0", first }, { "next-marker", 20 }, { "seek-time 0.4", first + 10 }, { "seek-time 00:00:00:05", first + 5 } };
+		for( int i=0; i<10; i++ ){
+			int expected = steps[i].frame;
+			if( expected<0 ){
+				player_command( sock, steps[i].command );
+				continue;
+			}
+			f = player_command( sock, steps[i].command );
+			CHECK( f==expected, "%s : %s reached frame %d instead of %d", name, steps[i].command, f, expected );
+		}
+		player_command( sock, "quit" );
+		fclose( sock );
+	}
+	else{
+		close( fd );
+		kill( child, SIGTERM );
+	}
+	int status;
+	waitpid( child, &status, 0 );
+	unlink( sock_path );
+}
+
+//Function to write a Y4M stream of gray frames
+bool write_y4m( const char* path, int frames ){
+	FILE* fp = fopen( path, "wb" );
+	if( !fp ){
+		return( false );
+	}
+	fprintf( fp, "YUV4MPEG2 W64 H48 F25:1 C420jpeg\n" );
+	static uchar plane[ 64*48 ];
+	for( int f=0; f<frames; f++ ){
+		fprintf( fp, "FRAME\n" );
+		memset( plane, 16 + 3*f, sizeof( plane ) );
+		fwrite( plane, 1, 64*48, fp );
+		memset( plane, 128, sizeof( plane ) );
+		fwrite( plane, 1, 64*48/2, fp );
+	}
+	return( fclose( fp )==0 );
+}
+
+//Function to write a short video with OpenCV
+bool write_video( const char* path, int frames ){
+	CvVideoWriter* writer = cvCreateVideoWriter( path, CV_FOURCC( 'M', 'J', 'P', 'G' ), 25, cvSize( 64, 48 ), 1 );
+	if( !writer ){
+		return( false );
+	}
+	IplImage* img = cvCreateImage( cvSize( 64, 48 ), IPL_DEPTH_8U, 3 );
+	for( int f=0; f<frames; f++ ){
+		cvSet( img, cvScalarAll( 16 + 3*f ) );
+		cvWriteFrame( writer, img );
+	}
+	cvReleaseImage( &img );
+	cvReleaseVideoWriter( &writer );
+	return( true );
+}
+
+//Main function
+/*!
+ * \param argv : An optional video file for the checks of a video file, written here when missing.
+ * */
+int main( int argc, char** argv ){
+	char dir[] = "/tmp/test_player.XXXXXX";
+	if( !mkdtemp( dir ) ){
+		printf( "Cannot create a temporary directory\n" );
+		return( 1 );
+	}
+	test_markers( dir );
+	test_times();
+	test_phash();
+	test_quality();
+
+	char y4m[ 1024 ], avi[ 1024 ], side[ 1100 ];
+	snprintf( y4m, sizeof( y4m ), "%s/test.y4m", dir );
+	snprintf( avi, sizeof( avi ), "%s/test.avi", dir );
+	CHECK( write_y4m( y4m, 60 ), "cannot write %s", y4m );
+	const char* video = ( argc>1 ) ? argv[1] : ( write_video( avi, 60 ) ? avi : NULL );
+	if( video ){
+		const char* args[] = { video, NULL };
+		test_seeks( "video", args, NULL, 1 );
+		snprintf( side, sizeof( side ), "%s.markers", video );
+		unlink( side );
+		snprintf( side, sizeof( side ), "%s.phash", video );
+		unlink( side );
+	}
+	else{
+		printf( "Cannot write %s, the video file is not checked\n", avi );
+	}
+	const char* stream_args[] = { "-", NULL };
+	test_seeks( "stream", stream_args, y4m, 0 );
+	const char* live_args[] = { "--live", y4m, NULL };
+	test_seeks( "live", live_args, NULL, 0 );
+	unlink( y4m );
+	unlink( avi );
+	rmdir( dir );
+
+	printf( "%d checks, %d failed\n", checks, failures );
+	return( failures ? 1 : 0 );
+}
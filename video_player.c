@@ -27,7 +27,21 @@
 #include<highgui.h>
 #include<cv.h>
 #include<stdio.h>
+#include<stdlib.h>
 #include<string.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<signal.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<dirent.h>
+#include<limits.h>
+#include<time.h>
+#include "videoplayer.h"
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
 
 //dimensions of vairous sub-images
 //! Default value for the Slider Button's width.
@@ -68,6 +82,331 @@
  */
 #define p_height 	( scrn_height + sldr_height + ctrl_pnl_height )
 
+//! Default length of the history window kept for streamed input.
+/*!
+  A pipe (or stdin) cannot be seeked. Therefore the last few decoded frames of a streamed input are kept in a ring of reusable buffers, so that the step-down button and the slider can still go back within this window. The value can be changed with the <em>--history</em> option.
+  \sa Y4M_Stream, Frame_Ring.
+ */
+#define STREAM_HISTORY	64
+
+//! Alias for a 4:2:0 ( I420 ) streamed input.
+#define STREAM_I420	0
+
+//! Alias for a luma-only ( Y4M <em>Cmono</em> ) streamed input.
+#define STREAM_MONO	1
+
+//alias for frame-difference display modes
+//! Alias for the normal display, the frame difference is not shown.
+#define DIFF_OFF	0
+
+//! Alias for showing the frame difference in place of the frame.
+#define DIFF_REPLACE	1
+
+//! Alias for showing the frame difference blended over the frame.
+#define DIFF_BLEND	2
+
+//! Calls the specialization of a pixel kernel for the format of an image.
+/*!
+  The kernels visiting the pixels one by one are function templates on the type \a T of a sample ( uchar or ushort ) and the number of channels \a CN ( 1, 3 or 4 ). With both known at compile time, the channel loops are unrolled and the pixels are addressed with constant strides instead of the \a nChannels of the image. This macro switches on the \a depth and \a nChannels of \a image and calls kernel< T, CN > with the parenthesised \a args; images of any other format are left untouched.
+  \sa fill_image(), window_level().
+ */
+#define PIXEL_DISPATCH( image, kernel, args ) \
+	switch( ( image )->depth*8 + ( image )->nChannels ){ \
+		case IPL_DEPTH_8U*8 + 1 : kernel< uchar, 1 > args; break; \
+		case IPL_DEPTH_8U*8 + 3 : kernel< uchar, 3 > args; break; \
+		case IPL_DEPTH_8U*8 + 4 : kernel< uchar, 4 > args; break; \
+		case IPL_DEPTH_16U*8 + 1 : kernel< ushort, 1 > args; break; \
+		case IPL_DEPTH_16U*8 + 3 : kernel< ushort, 3 > args; break; \
+		case IPL_DEPTH_16U*8 + 4 : kernel< ushort, 4 > args; break; \
+	}
+
+//! Number of frames whose histograms are cached.
+/*!
+  The histograms and statistics of a frame are kept in slot \f$ frame\_no \bmod HIST\_CACHE\_SIZE \f$ of the cache, so that stepping back and forth over recently seen frames does not compute them again.
+  \sa Hist_Entry, update_histogram().
+ */
+#define HIST_CACHE_SIZE	512
+
+//! Maximum number of pixels sampled to compute the histograms of a frame.
+/*!
+  Frames are subsampled with a regular stride so that at most this many pixels are used. The shape of a histogram is not affected noticeably, while the cost no longer depends on the resolution of the video.
+ */
+#define HIST_SAMPLES	65536
+
+//! Capacity of the command queue.
+/*!
+  Commands received over the command socket ( or stdin ) wait in a queue of this size until the main loop executes them. When the queue is full, the reading threads block, which in turn blocks the clients once the socket buffers are full ( back-pressure ).
+  \sa Cmd_Queue, push_command().
+ */
+#define CMD_QUEUE_SIZE	64
+
+//alias for the scripted commands
+#define CMD_SEEK	0	//!< <em>seek N</em> : go to frame N.
+#define CMD_STEP	1	//!< <em>step K</em> : step K frames forward ( or back, for a negative K ).
+#define CMD_PLAY	2	//!< <em>play</em> : start playing.
+#define CMD_PAUSE	3	//!< <em>pause</em> : pause.
+#define CMD_GET_FRAME	4	//!< <em>get-frame N [path]</em> : go to frame N, report it and optionally save it.
+#define CMD_METRICS	5	//!< <em>metrics</em> : report the state and counters of the player.
+#define CMD_QUIT	6	//!< <em>quit</em> : exit the player.
+#define CMD_SIMILAR	7	//!< <em>similar [R]</em> : find the frames whose perceptual hash is within R bits of the current frame's.
+#define CMD_WORST	8	//!< <em>worst [K]</em> : go to the frame with the K-th lowest luma PSNR of the quality comparison.
+#define CMD_NEXT	9	//!< <em>next</em> : switch to the next video of the playlist.
+#define CMD_PREV	10	//!< <em>prev</em> : switch to the previous video of the playlist.
+#define CMD_MARK	11	//!< <em>mark FIRST [LAST] [LABEL]</em> : mark a frame, or a range of frames, with an optional label.
+#define CMD_UNMARK	12	//!< <em>unmark N</em> : remove the markers over frame N.
+#define CMD_NEXT_MARKER	13	//!< <em>next-marker</em> : go to the next marker.
+#define CMD_PREV_MARKER	14	//!< <em>prev-marker</em> : go to the previous marker.
+#define CMD_EXPORT_MARKERS	15	//!< <em>export-markers PATH</em> : write the markers to a file.
+#define CMD_IMPORT_MARKERS	16	//!< <em>import-markers PATH</em> : add the markers of a file.
+#define CMD_FILTER	17	//!< <em>filter SPEC|off</em> : set the filter pipeline, see parse_filters().
+#define CMD_SEEK_TIME	18	//!< <em>seek-time T</em> : go to the frame shown at time T, see parse_time().
+#define CMD_INVALID	19	//!< A line that could not be parsed; answered with an error.
+
+//! Capacity of the UI event queue.
+/*!
+  The mouse callback only queues the actions of the user; the main loop executes them. If the main loop falls this far behind, further events are dropped ( and counted ) rather than blocking the callback.
+  \sa UI_Queue, ui_push().
+ */
+#define UI_QUEUE_SIZE	256
+
+//alias for the UI events
+#define UI_MOVE		0	//!< The mouse moved to ( x, y ).
+#define UI_PRESS	1	//!< The left button was pressed at ( x, y ).
+#define UI_RELEASE	2	//!< The left button was released.
+#define UI_SLIDER	3	//!< The slider was clicked at x.
+#define UI_PLAY_PAUSE	4	//!< The play / pause button was pressed.
+#define UI_STOP		5	//!< The stop button was pressed.
+#define UI_STEP_UP	6	//!< The step-up button was pressed.
+#define UI_STEP_DOWN	7	//!< The step-down button was pressed.
+#define UI_EXPORT	8	//!< The export button was pressed.
+#define UI_EDIT_STEP	9	//!< The step textbox was clicked.
+#define UI_WHEEL	10	//!< The mouse wheel was turned at ( x, y ), by \a arg.
+#define UI_KEY		11	//!< The key \a arg was pressed ( only used when recording or replaying a session ).
+
+//! Default ceiling of the frame pool in MB.
+/*!
+  The frame pool does not keep more than this many bytes of frame buffers ( <em>--pool-mb</em> ). Buffers which are needed anyway ( e.g. the frame being displayed ) are allocated beyond the ceiling, but optional ones ( e.g. cached frames ) are then refused.
+  \sa Frame_Pool, pool_get().
+ */
+#define POOL_CEILING_MB	1024
+
+//! Maximum number of different frame geometries in the frame pool.
+#define POOL_CLASSES	16
+
+//! Alignment ( in bytes ) of the rows of the frame buffers of the pool.
+#define POOL_ALIGN	64
+
+//! Maximum number of subsystems registered with the memory governor.
+#define MEM_CLIENTS	16
+
+//alias for the eviction priorities of the memory governor, lowest first
+#define MEM_PRIO_IDLE		0	//!< Idle buffers of the frame pool, freed first.
+#define MEM_PRIO_PREFETCH	1	//!< Frames decoded ahead of the playhead.
+#define MEM_PRIO_CACHE		2	//!< Cached frames, farthest from the playhead first.
+#define MEM_PRIO_THUMBS		3	//!< Thumbnails.
+#define MEM_PRIO_FIXED		4	//!< Memory which is needed and never evicted, only reported.
+
+//! Maximum number of frames in the frame cache.
+/*!
+  The frames of a CvCapture which were displayed or prefetched are kept in the frame cache, so that stepping back or revisiting a frame does not seek and decode again. The cache is also bounded by the frame pool ceiling and the memory budget.
+  \sa Frame_Cache.
+ */
+#define FRAME_CACHE_SIZE	128
+
+//alias for the kinds of cached frames, see cache_farthest()
+#define CACHE_ANY		0	//!< Any cached frame.
+#define CACHE_SPECULATIVE	1	//!< Frames prefetched but not displayed yet.
+#define CACHE_KEPT		2	//!< Frames displayed at least once.
+
+//! Default number of frames decoded ahead by the prefetcher.
+/*!
+  Changed with <em>--prefetch</em>; 0 disables the prefetcher.
+  \sa Prefetcher.
+ */
+#define PREFETCH_DEPTH	16
+
+//! Time after which a playhead which has not moved is taken to rest, in milliseconds.
+/*!
+  The stride of the playhead is then forgotten, and the neighbours on both sides of the frame are prefetched.
+  \sa prefetch_note().
+ */
+#define PREFETCH_REST_MS	500
+
+//! Time the prefetcher plans ahead along a stride, in milliseconds.
+/*!
+  As many frames are planned as the playhead is expected to reach in this time at the measured rate of its moves, between 2 and the depth of the prefetcher: slow stepping plans a few frames, playing or fast stepping the full depth.
+  \sa prefetch_note().
+ */
+#define PREFETCH_AHEAD_MS	2000
+
+//! Number of 16-bit chunks a perceptual hash is split into for the multi-index search.
+/*!
+  \sa Phash_Index, phash_search().
+ */
+#define PHASH_CHUNKS	4
+
+//! Default Hamming radius of the "similar frames" search.
+/*!
+  Two frames whose 64-bit perceptual hashes differ in at most this many bits are taken as near-duplicates.
+ */
+#define PHASH_RADIUS	6
+
+//! Maximum number of threads hashing the frames.
+#define PHASH_JOBS	8
+
+//! Size of the images the activity of a frame is computed from.
+/*!
+  \sa Activity.
+ */
+#define ACT_WIDTH	64
+#define ACT_HEIGHT	36	//!< See #ACT_WIDTH.
+
+//alias for the activity signals, see Activity
+#define ACT_DIFF	0	//!< Mean absolute luma difference to the previous frame.
+#define ACT_LUMA	1	//!< Mean luma.
+#define ACT_CUT		2	//!< Likelihood of a cut: distance between the luma histograms of the frame and the previous frame.
+#define ACT_SIGNALS	3	//!< Number of signals.
+
+//! Value of the ACT_CUT signal from which a frame is taken as the first of a new shot.
+#define ACT_CUT_LEVEL	128
+
+//! Default number of seconds after which a shot gets another tile on the storyboard.
+/*!
+  \sa Storyboard.
+ */
+#define BOARD_INTERVAL	10
+
+//! Minimum number of frames the zoomed timeline spans.
+/*!
+  \sa tl_zoom().
+ */
+#define TL_MIN_SPAN	32
+
+//! Width of a thumbnail, the height following the aspect ratio of the video.
+/*!
+  \sa Thumb_Cache, draw_thumb_strip().
+ */
+#define THUMB_WIDTH	120
+
+//! Maximum number of thumbnails kept.
+#define THUMB_CACHE_SIZE	256
+
+//! Maximum number of thumbnails asked for at once.
+#define THUMB_WANTED	64
+
+//! Time the thumbnail thread waits after the memory budget refused a thumbnail, in milliseconds.
+/*!
+  The frames asked for are kept meanwhile, so that they are decoded once memory has been freed rather than decoded and thrown away every iteration.
+  \sa thumb_worker().
+ */
+#define THUMB_RETRY_MS	500
+
+//! Maximum number of inputs of the compare mode, the main video included.
+/*!
+  \sa Compare.
+ */
+#define COMPARE_MAX	4
+
+//alias for the layouts of the compare mode
+#define COMPARE_SIDE	0	//!< The inputs side by side.
+#define COMPARE_GRID	1	//!< The inputs in a grid of two columns ( one above the other for two inputs ).
+#define COMPARE_WIPE	2	//!< The main video left of the wipe and another input right of it.
+
+//! Number of planes compared by the quality engine: luma, blue, green and red.
+/*!
+  \sa Quality.
+ */
+#define QUALITY_PLANES	4
+
+//! Number of decoded frames queued per input of the quality engine.
+#define QUALITY_QUEUE	8
+
+//! Maximum number of threads comparing the bands of a frame.
+#define QUALITY_JOBS	16
+
+//! Number of worst frames the <em>j</em> key cycles through.
+#define QUALITY_WORST	16
+
+//! Number of captured frames which may wait for the buffer thread of a live input.
+/*!
+  The capture thread never waits for the buffer thread: a frame arriving while this many are waiting is dropped and counted.
+  \sa Live_Input.
+ */
+#define LIVE_QUEUE	32
+
+//! Default length of the timeshift buffer of a live input, in minutes ( <em>--live-minutes</em> ).
+#define LIVE_MINUTES	5
+
+//! Default memory of the timeshift buffer of a live input, in MB ( <em>--live-mb</em> ).
+#define LIVE_MB	512
+
+//! Number of frames the display may fall behind a live input it follows, before it skips to the newest frame.
+#define LIVE_MAX_LAG	2
+
+//! Number of files of a playlist kept open ahead of the current one, and as many behind it.
+/*!
+  \sa Playlist.
+ */
+#define PLAYLIST_AHEAD	1
+
+//! Number of frames decoded from the start of a file opened in advance.
+#define PLAYLIST_FRAMES	4
+
+//! Maximum number of captures opened for a file in advance, one for each of the prefetcher, the activity timeline and the thumbnails; the main loop has a VP_Player of its own.
+#define PLAYLIST_CAPTURES	3
+
+//! Maximum number of distinct labels of the frame markers, label 0 ( no label ) included.
+#define MARKER_LABELS	65536
+
+//! Maximum length of a marker label, including the terminating null.
+#define MARKER_LABEL_LEN	64
+
+//! Maximum number of stages of the filter pipeline.
+#define FILTER_STAGES	8
+
+//! Maximum number of threads running the stages of the filter pipeline.
+#define FILTER_JOBS	16
+
+//! Number of rows of a tile of the filter pipeline.
+/*!
+  Every stage is split into tiles of this many rows, which the filter threads take one at a time; a neighbourhood filter also reads the rows around its tile. The tiles are small enough to balance the threads and to keep a tile in the cache from one row to the next.
+  \sa Filter_Pipeline.
+ */
+#define FILTER_TILE	32
+
+//! Number of filtered frames kept by the filter pipeline.
+#define FILTER_CACHE	8
+
+//alias for the stages of the filter pipeline
+#define FILTER_GRAY	0	//!< <em>gray</em> : the luma.
+#define FILTER_EDGES	1	//!< <em>edges</em> : the magnitude of the Sobel gradient of the luma.
+#define FILTER_BLUR	2	//!< <em>blur[:K]</em> : a K x K Gaussian blur, 5 x 5 by default.
+#define FILTER_THRESHOLD	3	//!< <em>threshold[:T]</em> : every channel set to 255 above T and to 0 otherwise, T being 128 by default.
+#define FILTER_CHANNEL	4	//!< <em>bgr:N</em>, <em>hsv:N</em> or <em>ycrcb:N</em> : the channel N of the frame in that colour space, shown gray.
+
+//! Number of frames decoded by the main loop between two adjustments of the decoder mode.
+#define DECODE_TUNE_FRAMES	50
+
+//! Frame size, in pixels, from which a video starts with the prefetcher running, before its decoding time is measured.
+#define DECODE_AHEAD_PIXELS	( 1280*720 )
+
+//! Decoding load under which the prefetcher is stopped, the main loop decoding every frame in time on its own.
+#define DECODE_LOAD_LOW	0.25
+
+//! Decoding load from which the prefetcher is started again.
+#define DECODE_LOAD_HIGH	0.5
+
+//alias for the prefetch modes of the decoder
+#define DECODE_AHEAD	0	//!< <em>ahead</em> : the frames predicted next are decoded ahead by the prefetcher, on a thread of its own, while the main loop shows the current one.
+#define DECODE_DEMAND	1	//!< <em>demand</em> : the frames are only decoded when shown, by the main loop; the prefetcher idles and gives its thread back.
+
+//! Size of one video pixel on the screen at the maximum zoom.
+/*!
+  The zoom is limited so that a pixel of the video is shown at most as a block of this many screen pixels, which is enough to read individual pixel values.
+  \sa zoom_at().
+ */
+#define ZOOM_PIXEL_MAX	32
+
 
 //alias for source of callbacks
 //! Alias for <em>function call made by the MOUSE's callback.</em>
@@ -132,6 +471,12 @@
   */
 #define STEPDOWN_BTN	4
 
+//! Alias for <em>export</em> button.
+/*!
+  If this value is passed, then the button under consideration is export button. Accordingly operations are to be carried out on the button area.
+  */
+#define EXPORT_BTN	5
+
 //alies for button state
 //! Alias for an <em>active</em> button.
 /*!
@@ -156,153 +501,827 @@ typedef struct{
         int y2;//!< y coordinate of the bottom-right corrner.
 } Field_Area;
 
-
-//Global Variables
-//! Pointer to CvCapture structure.
+//! A reference-counted frame buffer of the frame pool.
 /*!
-  A global pointer to the CvCapture structure is created so that the capture properties can be extracted and edited seamlessly from any of the related functions. CvCapture is basically used to capture the video into the program using the functions <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#capturefromfile" target="_blank"><b>cvCaptureFromFile()</b></a> (for capturing from file) or <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#capturefromcam" target="_blank"><b>cvCaptureFromCAM()</b></a> (for capturing directly from the attached camera). The details of CvCapture structure can be found <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#cvcapture" target="_blank"><b>here</b></a>.
-  \sa <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#releasecapture" target="_blank"><b>cvReleaseCapture()</b></a>.
+  A buffer is shared by all the parts of the player holding it ( the decoder, the display, the histogram thread, ... ); every holder owns one reference. The buffer goes back to the pool, not to the system, when the last reference is dropped.
+  \sa pool_get(), frame_ref(), frame_unref().
   */
-CvCapture *vid;
+typedef struct Frame_Buf{
+	IplImage* img;//!< The image; its pixel data belongs to the pool.
+	int refs;//!< Number of references, updated atomically.
+	int cls;//!< Index of the geometry class of the buffer in the pool, -1 for a buffer not kept by the pool.
+	int frame_no;//!< Number of the frame held, -1 when not known.
+	double pts_ms;//!< Timestamp of the frame in milliseconds, negative when not known.
+	size_t bytes;//!< Size of the pixel data.
+	struct Frame_Buf* next;//!< Next idle buffer of the same class.
+} Frame_Buf;
 
-//! Pointer to the main image.
-/*!
-  Pointer to the main image shown on the screen. The various buttons, screen-area etc are sub-images of this image. Initially this image is created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. Later, every sub-image's data part is assigned the desired part of this main image. Now, any further operation on the sub-images reflects the change in this image as well.
+//! Idle buffers of one frame geometry.
+typedef struct{
+	CvSize size;//!< Frame size.
+	int depth;//!< Depth of the frames.
+	int channels;//!< Number of channels of the frames.
+	Frame_Buf* idle;//!< Stack of idle buffers.
+	int nidle;//!< Number of idle buffers.
+	int nlive;//!< Number of buffers of this class handed out.
+} Pool_Class;
 
-  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+//! Pool of frame buffers.
+/*!
+  Buffers are allocated once, with rows aligned to #POOL_ALIGN bytes, and recycled per geometry: once the player has run for a few frames, fetching, displaying and analysing frames no longer allocates any memory. The total size of the buffers is kept under \a ceiling by freeing idle buffers of other geometries and refusing optional buffers.
+  \sa Frame_Buf, POOL_CEILING_MB.
   */
-IplImage *player;
+typedef struct{
+	Pool_Class classes[ POOL_CLASSES ];//!< The geometry classes.
+	size_t bytes;//!< Total size of all the buffers, idle or handed out.
+	size_t idle_bytes;//!< Total size of the idle buffers.
+	size_t ceiling;//!< Maximum of \a bytes.
+	long gets;//!< Number of buffers handed out.
+	long allocs;//!< Number of buffers allocated.
+	long frees;//!< Number of buffers freed.
+	long refused;//!< Number of optional buffers refused because of the ceiling.
+	pthread_mutex_t lock;//!< Protects the pool.
+} Frame_Pool;
 
-//! Pointer to the control-pannel sub-image.
+//! Ring of reusable frame buffers indexed by frame number.
 /*!
-  The control-pannel sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
-  <ul>
-  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
-  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
-  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
-</ul>
-  Once this assignment is done, any change in this Control-Pannel sub-image, will be reflected directly on the screen.
+  The ring holds the last \a size frames of a sequence. Frame \a n is stored in slot \a n % \a size and is available as long as \a head - \a size <= \a n < \a head. All the slots are allocated once, therefore filling the ring does not allocate any memory per frame.
+  \sa ring_create(), ring_slot(), ring_next_slot(), ring_commit().
+  */
+typedef struct{
+	Frame_Buf** slots;//!< The preallocated frame buffers, taken from the frame pool.
+	int size;//!< Number of slots in the ring.
+	int head;//!< Frame number of the next frame to be written ( i.e. number of frames written so far ).
+} Frame_Ring;
 
-   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
- */
-IplImage *pnl;
+//! A subsystem registered with the memory governor.
+/*!
+  \sa mem_register().
+  */
+typedef struct{
+	const char* name;//!< Name shown in the statistics.
+	int priority;//!< One of the MEM_PRIO_ aliases.
+	size_t ( *usage )();//!< Returns the number of bytes used by the subsystem.
+	size_t ( *evict )( size_t bytes );//!< Frees about \a bytes ( more or less ), returns the number of bytes released; NULL for MEM_PRIO_FIXED.
+} Mem_Client;
 
-//! Pointer to the slider-strip sub-image.
+//! The memory governor.
 /*!
-  The slider-strip sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
-  <ul>
-  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
-  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
-  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
-</ul>
-  Once this assignment is done, any change in this Slider-strip sub-image, will be reflected directly on the screen.
+  Every subsystem holding a significant amount of memory registers a Mem_Client. The governor keeps the total under \a budget ( <em>--mem-budget</em> ) by asking the subsystems to evict, lowest priority first: idle buffers, prefetched frames, cached frames far from the playhead, then thumbnails.
+  \sa mem_enforce().
+  */
+typedef struct{
+	Mem_Client clients[ MEM_CLIENTS ];//!< The registered subsystems.
+	int nclients;//!< Number of registered subsystems.
+	size_t budget;//!< Budget in bytes, 0 when unlimited.
+	long evictions;//!< Number of evictions requested.
+	size_t evicted;//!< Number of bytes released by evictions.
+	pthread_mutex_t lock;//!< Serialises the evictions.
+} Mem_Governor;
 
-   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
- */
-IplImage *slider;
+//! A frame of the frame cache.
+typedef struct{
+	Frame_Buf* buf;//!< The frame, its \a frame_no is the key; NULL for a free entry.
+	bool prefetched;//!< True when decoded by the prefetcher.
+	bool used;//!< True once the frame was displayed.
+} Cache_Entry;
 
-//! Pointer to the slider-button sub-image.
+//! Cache of decoded frames of a CvCapture.
 /*!
-  The slider-button sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
-  <ul>
-  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
-  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
-  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
-</ul>
-  Once this assignment is done, any change in this Slider-Button sub-image, will be reflected directly on the screen.
-
-   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
- */
-IplImage *sldr_btn;
+  The frames are kept in pool buffers and looked up by frame number. A frame found in the cache is displayed without touching the decoder; when the cache is full, the frame farthest from the playhead is evicted. Prefetched frames which are evicted before being displayed are counted as wasted decodes.
+  \sa cache_lookup(), cache_store(), FRAME_CACHE_SIZE.
+  */
+typedef struct{
+	Cache_Entry entries[ FRAME_CACHE_SIZE ];//!< The cached frames, in no particular order.
+	int count;//!< Number of frames cached.
+	long hits;//!< Number of frames found in the cache.
+	long misses;//!< Number of frames which had to be decoded by the main loop.
+	long prefetched;//!< Number of frames decoded by the prefetcher.
+	long prefetch_hits;//!< Number of prefetched frames displayed.
+	long wasted;//!< Number of prefetched frames evicted without being displayed.
+	long cancelled;//!< Number of planned prefetches dropped because the navigation pattern changed.
+	pthread_mutex_t lock;//!< Protects the cache.
+} Frame_Cache;
 
-//! Pointer to the slider-value static-text sub-image.
+//! The predictive prefetcher.
 /*!
-  The slider-value static-text sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
-  <ul>
-  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
-  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
-  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
-</ul>
-  Once this assignment is done, any change in this Slider-value Static-Text sub-image, will be reflected directly on the screen.
+  The main loop reports the displayed frame every iteration ( prefetch_note() ). From the last moves of the playhead the prefetcher predicts a stride: the step while playing, the repeated delta while stepping forward or back, or 0 while the playhead rests ( has not moved for #PREFETCH_REST_MS ), in which case the neighbours on both sides are prefetched. The rate of the moves sets how far ahead the stride is followed ( #PREFETCH_AHEAD_MS ). The prefetch thread decodes the predicted frames into the frame cache, using its own CvCapture so that the main decoder is never moved under the main loop. When the stride changes the remaining frames of the old plan are cancelled.
+  \sa prefetch_worker(), Frame_Cache.
+  */
+typedef struct{
+	CvCapture* vid;//!< Capture of the prefetch thread, opened on the same file.
+	int depth;//!< Number of frames decoded ahead, 0 when the prefetcher is disabled.
+	int base;//!< Frame the plan starts from.
+	int stride;//!< Predicted step between the requested frames, 0 while the playhead rests.
+	int ahead;//!< Number of frames planned along the stride.
+	int generation;//!< Incremented whenever the stride changes.
+	int last_pos;//!< Frame reported last ( main loop only ).
+	int deltas[ 2 ];//!< Last two moves of the playhead ( main loop only ).
+	int64 moved_at;//!< Tick count of the last move of the playhead ( main loop only ).
+	double interval_ms;//!< Average time between two moves, 0 when unknown ( main loop only ).
+	bool quit;//!< Set to stop the prefetch thread.
+	pthread_t thread;//!< The prefetch thread.
+	pthread_mutex_t lock;//!< Protects the plan.
+	pthread_cond_t cond;//!< Signalled when the plan changes.
+} Prefetcher;
 
-   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</a></b>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
- */
-IplImage *sldr_val;
+//! Perceptual hash index of a video.
+/*!
+  Every frame of a CvCapture is reduced to a 64-bit DCT hash ( phash_image() ) by several threads, each decoding its own range of the video with its own CvCapture. The hashes are saved to a sidecar file next to the video ( <em>video.phash</em> ) and loaded from it the next time. Once all the frames are hashed, multi-index tables are built: for every 16-bit chunk of the hash, the frames sorted by the value of that chunk. A search within a radius \f$ r \f$ only has to look at the frames matching one chunk within \f$ \lfloor r/4 \rfloor \f$ bits, instead of all the frames.
+  \sa phash_start(), phash_search(), phash_find().
+  */
+typedef struct{
+	const char* video;//!< Path of the video.
+	char path[ 1024 ];//!< Path of the sidecar file.
+	int size;//!< Number of entries, the frames being numbered from 1 as get_frame_pos() reports them; 0 until the index is started.
+	uint64* hashes;//!< Hash of every frame.
+	uchar* done;//!< 1 once the hash of a frame is computed, set atomically.
+	int indexed;//!< Number of frames hashed, updated atomically.
+	bool complete;//!< True once all the frames are hashed and the tables are built.
+	bool quit;//!< Set to stop the hashing threads.
+	int* offsets[ PHASH_CHUNKS ];//!< For every chunk, the start in \a ids of the frames having each of the 65536 values.
+	int* ids[ PHASH_CHUNKS ];//!< For every chunk, the frames sorted by the value of the chunk.
+	pthread_t* workers;//!< The hashing threads.
+	int nworkers;//!< Number of hashing threads.
+	int running;//!< Number of hashing threads still running, updated atomically.
+	int* matches;//!< Frames found by the last search, in ascending order.
+	int nmatches;//!< Number of frames found by the last search.
+	long queries;//!< Number of searches.
+	double query_ms;//!< Duration of the last search.
+} Phash_Index;
 
-//! Pointer to temporary slider-value static-text sub-image.
+//! Activity timeline of a video.
 /*!
-  The temporary slider-value static-text sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. This is used to temporarily store the original slider-value. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
-  <ul>
-  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
-  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
-  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
-</ul>
-  Once this assignment is done, any change in this temporary slider-value static-text sub-image, will be reflected directly on the screen.
+  A thread decodes the video with its own CvCapture and computes three signals for every frame ( ACT_DIFF, ACT_LUMA and ACT_CUT, scaled to 0-255 ). Each signal is kept in a min/max pyramid: level 0 holds the values of the frames, and node \a i of level \a L the minimum and maximum of the frames \f$ i 2^L \f$ to \f$ ( i + 1 )2^L - 1 \f$. The pyramid is updated as the frames are analysed, so the timeline fills in progressively; a node without any analysed frame has \a lo > \a hi. A range of frames is covered by O( log n ) nodes, therefore drawing the timeline over the #p_width columns of the slider costs the same for any length of video.
+  \sa activity_worker(), activity_range(), draw_timeline().
+  */
+typedef struct{
+	int size;//!< Number of frames + 1, the frames being numbered from 1 as get_frame_pos() reports them; 0 when there is no timeline.
+	int levels;//!< Number of levels of the pyramid.
+	int offsets[ 33 ];//!< Index of the first node of every level, and the number of nodes after the last level.
+	uchar* lo[ ACT_SIGNALS ];//!< Minimum of every node, for every signal.
+	uchar* hi[ ACT_SIGNALS ];//!< Maximum of every node, for every signal.
+	int analysed;//!< Number of frames analysed, updated atomically.
+	CvCapture* vid;//!< Capture of the activity thread.
+	pthread_t thread;//!< The activity thread.
+	bool quit;//!< Set to stop the activity thread.
+	int shown;//!< Signal drawn on the slider, -1 for none.
+	int drawn;//!< Value of \a analysed when the timeline was drawn last.
+	int64 drawn_at;//!< Tick count when the timeline was drawn last.
+} Activity;
 
-   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
- */
-IplImage *oslider;
+//! Thumbnails of a CvCapture.
+/*!
+  Frames reduced to #THUMB_WIDTH pixels wide, decoded on request by a thread with its own CvCapture. Every iteration the main loop asks for the thumbnails it is about to draw ( thumb_want() ); the thread decodes the missing ones in the order asked, and the main loop draws those which are ready ( thumb_get() ) and a placeholder for the others. When the cache is full, or under the memory budget, the thumbnails drawn least recently make room first.
+  \sa thumb_worker(), draw_thumb_strip().
+  */
+typedef struct{
+	Frame_Buf* bufs[ THUMB_CACHE_SIZE ];//!< The thumbnails, their \a frame_no is the key; NULL for a free entry.
+	int64 used[ THUMB_CACHE_SIZE ];//!< Tick count when every thumbnail was decoded or drawn last.
+	int count;//!< Number of thumbnails.
+	CvSize size;//!< Size of a thumbnail.
+	int wanted[ THUMB_WANTED ];//!< The frames asked for, most needed first.
+	int nwanted;//!< Number of frames asked for.
+	long decoded;//!< Number of thumbnails decoded.
+	long hits;//!< Number of thumbnails drawn.
+	long misses;//!< Number of placeholders drawn.
+	long refused;//!< Number of thumbnails refused by the memory budget.
+	int64 retry_at;//!< Tick count before which no thumbnail is decoded, after the memory budget refused one.
+	CvCapture* vid;//!< Capture of the thumbnail thread, NULL when there are no thumbnails.
+	bool quit;//!< Set to stop the thumbnail thread.
+	pthread_t thread;//!< The thumbnail thread.
+	pthread_mutex_t lock;//!< Protects the thumbnails and the frames asked for.
+	pthread_cond_t cond;//!< Signalled when the frames asked for change.
+} Thumb_Cache;
 
-//! Pointer to the frame-area sub-image.
+//! The storyboard, a grid of thumbnails replacing the frame.
 /*!
-  The frame-area sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. Here the currently fetched frame will be displayed. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
-  <ul>
-  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
-  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
-  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
-</ul>
-  Once this assignment is done, any change in this Frame-area sub-image, will be reflected directly on the screen.
+  Every tile stands for the frames from its own frame to the frame of the next tile: a tile starts at every cut found by the activity timeline ( ACT_CUT of at least #ACT_CUT_LEVEL ), and within a shot every \a interval frames, so that long shots get several tiles and a video without a timeline still gets one tile every few seconds. The tiles are added as the timeline is analysed. Only the rows on the screen are asked for to the thumbnail thread, so a long video costs no more decoding than a short one.
+  \sa draw_storyboard(), board_update().
+  */
+typedef struct{
+	bool shown;//!< True while the storyboard replaces the frame.
+	int* frames;//!< First frame of every tile, in ascending order.
+	int count;//!< Number of tiles.
+	int capacity;//!< Number of tiles \a frames has room for.
+	int scanned;//!< Last frame added to the tiles.
+	int interval;//!< Maximum number of frames of a tile.
+	int top;//!< First row on the screen.
+} Storyboard;
 
-   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
- */
-IplImage *frame_area;
+//! An input of the compare mode.
+typedef struct{
+	const char* path;//!< Path of the input.
+	CvCapture* vid;//!< Capture of the input; NULL for the main video, which is decoded by the main loop.
+	Frame_Buf* frame;//!< Copy of the frame decoded last, taken from the frame pool; NULL until one is decoded.
+	int frame_no;//!< Number of the frame in \a frame, -1 for none.
+	bool ended;//!< True when the input has no frame \a frame_no.
+	long decode_us;//!< Running average of the time to decode a frame in microseconds, updated atomically.
+} Compare_Input;
 
-//! Pointer to the fetched frame sub-image.
+//! The compare mode.
 /*!
-  This will point to frame fetched using <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a>. Therefore, this pointer is only declared and not defined. The allocation and deallocation of memory pointed by this pointer is handled by <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a>.
-
-   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
- */
-IplImage *frame;
+  The inputs given with <em>--compare</em> follow the main video: every tick, as the main loop starts decoding its frame, the same frame of every other input is handed to a pool of threads ( one per input, as many as the thread budget allows, see Thread_Budget ) so that all the decodes overlap, and the main loop waits for all of them before drawing, so the frames shown always belong together. The copies are held in buffers of the frame pool, so the memory budget counts them. The slider, the step and all the navigation stay those of the main video. Every input keeps the average time it takes to decode a frame, which is shown with its name so that the slowest input stands out.
+  \sa compare_start(), compare_dispatch(), compare_sync(), draw_compare().
+  */
+typedef struct{
+	Compare_Input inputs[ COMPARE_MAX ];//!< The inputs, the main video first.
+	int count;//!< Number of inputs, the main video included; 0 when not comparing.
+	int layout;//!< One of the COMPARE_ aliases.
+	int wipe_x;//!< Column of the wipe.
+	int wiped;//!< Input shown right of the wipe.
+	IplImage* canvas;//!< The wiped input at the size of the frame area.
+	int target;//!< Frame the workers decode.
+	int next;//!< Next input to decode.
+	int pending;//!< Number of inputs not decoded yet.
+	bool quit;//!< Set to stop the workers.
+	pthread_t workers[ COMPARE_MAX ];//!< The decoding threads.
+	int nworkers;//!< Number of decoding threads.
+	pthread_mutex_t lock;//!< Protects \a target, \a next, \a pending, \a quit and the \a frame of every input.
+	pthread_cond_t work;//!< Signalled when there are inputs to decode.
+	pthread_cond_t done;//!< Signalled when all the inputs are decoded.
+} Compare;
 
-//! Pointer to the previously fetched frame.
+//! A thread decoding a video into a bounded queue.
 /*!
-  The current fetched frame using <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a> is cloned to \a old_frame before fetching the next frame. Thus, this pointer points to an <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a> structure holding the previously fetched frame.
+  \sa Quality.
+  */
+typedef struct{
+	VP_Player* vid;//!< Player of the thread.
+	Frame_Buf* bufs[ QUALITY_QUEUE ];//!< The decoded frames, oldest first from \a head.
+	int head;//!< Index of the oldest frame.
+	int count;//!< Number of frames queued.
+	bool ended;//!< True once the video has no more frames.
+	pthread_t thread;//!< The decoding thread.
+	pthread_mutex_t lock;//!< Protects the queue.
+	pthread_cond_t cond;//!< Signalled when a frame is queued or taken.
+} Decode_Queue;
 
-   \sa <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
- */
-IplImage *old_frame;
+//! Sums over a band of 8 rows of a frame, for every plane.
+typedef struct{
+	uint64 ssd[ QUALITY_PLANES ];//!< Sum of the squared differences.
+	double ssim[ QUALITY_PLANES ];//!< Sum of the SSIM of the 8x8 blocks.
+	int blocks;//!< Number of 8x8 blocks.
+} Quality_Sums;
 
-//! Pointer to current frame number static-text.
+//! The quality engine, comparing the main video and the first <em>--compare</em> input frame by frame.
 /*!
-  Points to the sub-image showing the current frame number.
-  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl(), moveSlider().
+  Both videos are decoded by their own threads into queues of #QUALITY_QUEUE frames, so decoding runs ahead of the comparison. Every pair of frames is split into bands of 8 rows, which a pool of threads compares with SSE2 kernels: the sum of the squared differences of the luma and of each channel gives the PSNR, and the SSIM is the mean of the SSIM of the 8x8 blocks ( without overlap ). The results are drawn as a curve on the slider and written to a CSV file, one column per metric.
+  \sa quality_start(), quality_frame(), quality_band().
   */
-IplImage *cur_frame_no;
+typedef struct{
+	const char* out_path;//!< Path of the CSV file, NULL when there is no comparison.
+	int size;//!< Number of frames + 1, the frames being numbered from 1 as get_frame_pos() reports them.
+	float* values[ 2*QUALITY_PLANES ];//!< PSNR of the luma, blue, green and red planes, then their SSIM, for every frame.
+	int done;//!< Last frame compared, the frames being compared in order; updated atomically.
+	bool finished;//!< True once the comparison stopped.
+	bool mismatch;//!< True when the videos cannot be compared ( size or format ).
+	bool quit;//!< Set to stop all the threads, read atomically.
+	Decode_Queue inputs[ 2 ];//!< The main video and the compared one.
+	pthread_t thread;//!< The thread comparing the frames.
+	const IplImage* pair[ 2 ];//!< The frames being compared.
+	Quality_Sums* sums;//!< The sums of every band of the frames being compared.
+	int nbands;//!< Number of bands of a frame.
+	int next_band;//!< Next band to compare.
+	int pending;//!< Number of bands not compared yet.
+	pthread_t workers[ QUALITY_JOBS ];//!< The threads comparing the bands.
+	int nworkers;//!< Number of threads comparing the bands.
+	pthread_mutex_t lock;//!< Protects the bands.
+	pthread_cond_t work;//!< Signalled when there are bands to compare.
+	pthread_cond_t done_cond;//!< Signalled when all the bands are compared.
+	double secs;//!< Time spent comparing.
+	bool shown;//!< True to draw the luma PSNR on the slider instead of the activity timeline.
+	int rank;//!< Rank of the worst frame shown last with the <em>j</em> key, -1 for none.
+	int tallied;//!< Last frame added to \a worst and to the sums, by the main loop only.
+	int worst[ QUALITY_WORST ];//!< The frames with the lowest luma PSNR so far, worst first.
+	int nworst;//!< Number of frames in \a worst.
+	double psnr_sum;//!< Sum of the luma PSNR of the frames tallied.
+	double ssim_sum;//!< Sum of the luma SSIM of the frames tallied.
+} Quality;
 
-//! Pointer to FPS (Frames Per Second) static-text.
+//! Structure describing a streamed ( Y4M or raw I420 ) input.
 /*!
-  Points to the sub-image showing the FPS. This is currently a static-text field and its value is to be loaded from the video initially. Later, the functionality to edit this field can be added, therefore the pointer has "edit" in its name. It hold the value of #fps.
+  Frames arriving over a pipe or stdin are parsed from the YUV4MPEG2 container ( or taken as raw planes of a known size ), converted to BGR and stored in a Frame_Ring. Luma-only input is kept gray, and samples of more than 8 bits are kept at 16 bits, so neither loses anything before the display ( see window_level() ). Since the input cannot be seeked, only the frames in the ring can be revisited.
+  \sa stream_open(), stream_query(), stream_set_pos().
+  */
+typedef struct{
+	FILE* fp;//!< The input file, pipe or stdin.
+	bool is_y4m;//!< True when the input has YUV4MPEG2 headers, false for raw I420 planes.
+	int chroma;//!< Either STREAM_I420 or STREAM_MONO.
+	int bits;//!< Significant bits of a sample, 8 to 16; deeper samples take two bytes and give 16-bit frames.
+	int width;//!< Frame width.
+	int height;//!< Frame height.
+	double fps;//!< Frame rate from the Y4M header ( or the <em>--fps</em> option ).
+	uchar* planes;//!< Reusable buffer holding the raw planes of one frame.
+	int plane_bytes;//!< Size of one raw frame in bytes.
+	Frame_Ring ring;//!< The history window of converted frames.
+	int next;//!< Index of the frame to be returned next.
+	bool eof;//!< True once the end of the stream is reached.
+} Y4M_Stream;
 
-  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl().
+//! Structure describing a live input with its timeshift buffer.
+/*!
+  A camera ( <em>cvCaptureFromCAM()</em> ), a pipe or any video replayed at its frame rate is captured by a thread of its own, which only copies every frame and hands it over through a queue of #LIVE_QUEUE frames. A second thread converts the frames to I420 ( raw BGR for odd sizes ) and stores them in a ring holding the last minutes of the input. The display, i.e. the main loop, reads the ring: it follows the newest frame, or plays, steps and scrubs the frames held while the capture goes on. The frames are numbered from 0 as they arrive.
+  \sa live_open(), live_query(), live_set_pos().
   */
-IplImage *fps_edit;
+typedef struct{
+	CvCapture* cap;//!< The camera or video, NULL for a streamed source.
+	Y4M_Stream* stream;//!< The streamed source ( pipe, stdin or Y4M file ), NULL otherwise.
+	bool paced;//!< True for a file, which is read at its frame rate as if it were captured.
+	double fps;//!< Frame rate of the input.
+	CvSize size;//!< Frame size.
+	bool i420;//!< True when the frames are stored as I420, false when stored as BGR.
+	Frame_Buf* queue[ LIVE_QUEUE ];//!< Captured frames waiting for the buffer thread, oldest first from \a q_head.
+	int q_head;//!< Index of the oldest captured frame.
+	int q_count;//!< Number of captured frames waiting.
+	bool captured_all;//!< True once the input has no more frames.
+	Frame_Buf** slots;//!< The timeshift buffer, frame \a n is in slot \a n % \a nslots.
+	int nslots;//!< Number of frames held by the timeshift buffer.
+	int head;//!< Number of frames buffered so far, read atomically.
+	bool ended;//!< True once every captured frame is buffered, read atomically.
+	bool quit;//!< Set to stop both threads.
+	int next;//!< Frame to be displayed next, used by the main loop only.
+	bool following;//!< True while the display follows the newest frame, used by the main loop only.
+	long captured;//!< Number of frames captured.
+	long dropped;//!< Number of captured frames dropped because the queue was full ( or no buffer was left ).
+	long evicted;//!< Number of frames which fell out of the timeshift buffer.
+	long skipped;//!< Number of frames the display skipped to keep up with the input while following it.
+	long missed;//!< Number of frames which fell out of the timeshift buffer before a timeshifted playback reached them.
+	pthread_t capture_thread;//!< The capture thread.
+	pthread_t buffer_thread;//!< The buffer thread.
+	pthread_mutex_t lock;//!< Protects the queue, the slots and the counters written by the threads.
+	pthread_cond_t cond;//!< Signalled when a frame is queued or buffered, or the capture ends.
+} Live_Input;
 
-//! Pointer to FOUR_CC static-text.
+//! A file of a playlist opened in advance.
 /*!
-  Points to the sub-image showing FOUR_CC static text.
+  \sa Playlist, playlist_open().
+  */
+typedef struct{
+	int index;//!< Index of the file in the playlist, -1 for a free entry.
+	bool ready;//!< False while the file is being opened.
+	VP_Player* player;//!< The player of the main loop, NULL when the file cannot be played.
+	CvCapture* caps[ PLAYLIST_CAPTURES ];//!< The captures of the background threads.
+	int ncaps;//!< Number of captures.
+	double fps;//!< Frame rate.
+	int frames;//!< Number of frames.
+	int start;//!< Position of the capture when opened.
+	char fourcc[ 5 ];//!< FOURCC of the codec.
+	Frame_Buf* first[ PLAYLIST_FRAMES ];//!< The first frames, numbered as get_frame_pos() reports them.
+	int nfirst;//!< Number of frames in \a first.
+	double open_ms;//!< Time taken to open the file, probe it and decode its first frames.
+} Preopen;
 
-  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl().
+//! List of files played one after the other.
+/*!
+  Several files, or a directory, given on the command line make a playlist, gone through with the <em>n</em> and <em>p</em> keys. A background thread opens the #PLAYLIST_AHEAD files around the current one in advance: it opens their captures, probes their properties and decodes their first frames. Switching to such a file then only hands these over to the main loop, the frame cache and the background threads, see playlist_switch().
+  \sa Preopen, playlist_worker().
   */
-IplImage *four_cc_edit;
+typedef struct{
+	char** paths;//!< The files.
+	int count;//!< Number of files.
+	bool* bad;//!< True for the files found not playable, which are passed over.
+	int cur;//!< Index of the current file.
+	Preopen slots[ 2*PLAYLIST_AHEAD ];//!< The files opened in advance.
+	CvCapture* spares[ PLAYLIST_CAPTURES ];//!< Captures of the current file not taken yet by a background thread, see open_capture().
+	int nspares;//!< Number of captures in \a spares.
+	bool quit;//!< Set to stop the thread.
+	pthread_t thread;//!< The thread opening the files.
+	pthread_mutex_t lock;//!< Protects \a bad, \a cur, \a slots and \a quit.
+	pthread_cond_t cond;//!< Signalled when the current file changes or a file is opened.
+	long opened;//!< Number of files opened in advance.
+	double open_ms;//!< Total time taken to open them.
+	long switches;//!< Number of switches to another file.
+	long hits;//!< Number of switches to a file opened in advance.
+	double switch_ms;//!< Duration of the last switch.
+	double switch_max_ms;//!< Longest switch.
+} Playlist;
 
-//! Pointer to "Status" static-text.
+//! A marked frame, or range of frames.
+typedef struct{
+	int first;//!< First frame, numbered as get_frame_pos() reports them.
+	int last;//!< Last frame, \a first for a single frame.
+	unsigned short label;//!< Index of the label in \a Marker_Store.labels, 0 for none.
+} Marker;
+
+//! Frame markers of a video.
 /*!
-  Points to the sub-image showing the status static-text. Holds the string in #status_line.
+  Frames and ranges of frames tagged while reviewing ( <em>m</em>, <em>M</em> ), by the <em>mark</em> command or imported from a file. They are kept sorted by first frame, so that the next or the previous marker is found by a binary search. New markers are appended after the sorted ones and merged with them only before the next lookup: adding many markers one by one costs a sort and a merge, not an insertion each. The markers over a frame are those starting at most \a max_len frames before it.
 
-  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl().
+  For the slider, the markers are counted per column; the counts are rebuilt only when the markers or the part of the video spanned by the slider change, so that redrawing the slider costs O( width ) whatever the number of markers. The markers are saved next to the video ( <em>video.markers</em> ), see marker_write().
+  \sa marker_add(), marker_find(), marker_bins().
   */
-IplImage *status_edit;
+typedef struct{
+	char path[ 1024 ];//!< Path of the sidecar file, empty for a streamed or live input.
+	Marker* items;//!< The markers, the first \a sorted of them in order.
+	int count;//!< Number of markers.
+	int capacity;//!< Number of markers \a items can hold.
+	int sorted;//!< Number of markers in order at the start of \a items.
+	int max_len;//!< Largest \a last - \a first of the markers.
+	char** labels;//!< The distinct labels, label 0 being the empty one.
+	int nlabels;//!< Number of labels.
+	long version;//!< Incremented on every change of the markers.
+	bool modified;//!< True when the markers differ from the sidecar file.
+	int* bins;//!< Number of markers over every column of the slider, NULL until drawn.
+	long bins_version;//!< \a version the bins were counted for.
+	int bins_first;//!< First frame spanned by the slider when the bins were counted.
+	int bins_span;//!< Number of frames spanned by the slider when the bins were counted.
+	long lookups;//!< Number of searches of the next or the previous marker.
+	double bins_ms;//!< Time taken to count the bins last.
+} Marker_Store;
+
+//! A stage of the filter pipeline.
+typedef struct{
+	char name[ 16 ];//!< The stage as given, e.g. <em>blur:7</em>.
+	int type;//!< One of the FILTER_ aliases.
+	int param;//!< Kernel size of a blur, threshold, or channel of a channel view.
+	int code;//!< Colour conversion of a channel view, -1 for the BGR channels.
+	long us;//!< Running average of the time taken by the stage in microseconds, see note_decode().
+} Filter_Stage;
+
+//! A filtered frame kept by the filter pipeline.
+typedef struct{
+	Frame_Buf* buf;//!< The filtered frame at display resolution, NULL for a free entry.
+	int frame_no;//!< Number of the frame.
+	CvRect view;//!< Region of the frame shown, see get_view_rect().
+	long epoch;//!< Value of \a epoch of the pipeline when the frame was filtered.
+	long used;//!< Value of \a uses of the pipeline when the frame was last shown.
+} Filter_Entry;
+
+//! The filter pipeline applied to the displayed frame.
+/*!
+  The stages given with <em>--filter</em> ( or the <em>filter</em> command ) are chained between the resize of the visible region and the frame area, i.e. at display resolution, so their cost does not depend on the resolution of the video; with <em>--filter-full</em> they run on the visible region at the resolution of the frame instead, before it is resized. Every stage is split into tiles of #FILTER_TILE rows which a pool of threads ( taken from the thread budget, see Thread_Budget ) filters, the main loop waiting for the last tile before the next stage starts. A stage reads the output of the previous one and writes into a second buffer, so a neighbourhood filter sees the rows of the tiles next to its own unfiltered by it.
+
+  The last #FILTER_CACHE filtered frames are kept with the frame number and the region shown, so stepping back or redrawing a paused frame does not filter it again. Anything else changing the result ( the stages, the window / level, another video ) increments \a epoch, which invalidates them.
+  \sa parse_filters(), filter_frame(), filter_tile().
+  */
+typedef struct{
+	char spec[ 128 ];//!< The stages as given, e.g. <em>gray,blur:7,edges</em>.
+	Filter_Stage stages[ FILTER_STAGES ];//!< The stages, in order.
+	int count;//!< Number of stages, 0 for none.
+	bool enabled;//!< False while the pipeline is switched off ( <em>e</em> key ).
+	bool full;//!< True to filter at the resolution of the frame ( <em>--filter-full</em> ).
+	long epoch;//!< Incremented whenever the frames kept become stale.
+	Filter_Entry cache[ FILTER_CACHE ];//!< The filtered frames kept.
+	long uses;//!< Number of frames shown through the pipeline.
+	long hits;//!< Number of frames found among the frames kept.
+	double last_ms;//!< Time taken by the last frame filtered.
+	size_t bytes;//!< Size of the frames kept, read by the memory governor from any thread.
+	const Filter_Stage* stage;//!< Stage being run.
+	CvMat src;//!< Input of the stage being run.
+	CvMat dst;//!< Output of the stage being run.
+	int ntiles;//!< Number of tiles of the stage being run.
+	int next_tile;//!< Next tile to filter.
+	int pending;//!< Number of tiles not filtered yet.
+	bool quit;//!< Set to stop the threads.
+	pthread_t workers[ FILTER_JOBS ];//!< The filter threads.
+	int nworkers;//!< Number of filter threads, 0 until the first frame is filtered.
+	pthread_mutex_t lock;//!< Protects the tiles and \a quit.
+	pthread_cond_t work;//!< Signalled when there are tiles to filter.
+	pthread_cond_t done;//!< Signalled when all the tiles are filtered.
+} Filter_Pipeline;
+
+//! The threads of the player.
+/*!
+  The player keeps at most \a total threads busy ( <em>--threads</em>, one per CPU by default ), so that several players, or a player and other analysis jobs, share the CPUs predictably when each is given a part of them. The worker pools ( hashing, comparison, quality, filters ) take their threads from the budget with threads_take() and give them back when they stop; a pool always gets at least one thread, the others getting what is left.
+
+  The OpenCV 2.x capture interface has no setting for the threads of the codec, and cvSetNumThreads() only sizes the threads of OpenCV's own parallel functions, not those of FFmpeg. The only decoding thread the budget accounts for is therefore the prefetcher, which decodes the frames predicted next on a thread of its own: with #DECODE_AHEAD it runs and holds a thread of the budget, trading memory and wasted decoding for throughput; with #DECODE_DEMAND it idles, gives its thread back, and every frame is decoded when needed. The threads nobody holds are given to OpenCV with cvSetNumThreads().
+
+  Unless set with <em>--prefetch-mode</em>, the mode is tuned by decode_tune() from the frame size and the measured decoding time: a video starts with the prefetcher running when its frames are large, the prefetcher is stopped when the main loop decodes the frames well within the frame period, when most of what it decodes is wasted ( random access ) or when it would leave no thread to the main loop, and resumed once decoding takes a large part of the frame period while the playhead moves with a regular stride.
+  \sa threads_take(), decode_tune().
+  */
+typedef struct{
+	int total;//!< Threads the player may keep busy.
+	int held;//!< Threads held by the worker pools and the prefetcher.
+	bool prefetcher;//!< True while the prefetcher holds a thread, i.e. in #DECODE_AHEAD mode.
+	int opencv;//!< Threads last given to OpenCV with cvSetNumThreads(), 0 before ( main loop only ).
+	int mode;//!< #DECODE_AHEAD or #DECODE_DEMAND.
+	int mode_set;//!< Mode set with <em>--prefetch-mode</em>, -1 to tune it.
+	double load;//!< Measured time to decode a frame, as a fraction of the frame period.
+	long tunes;//!< Number of mode changes made by decode_tune().
+	long decoded;//!< Frames decoded by the main loop when the decoder was last tuned ( main loop only ).
+	double decode_ms;//!< Time spent decoding by the main loop when the decoder was last tuned ( main loop only ).
+	long prefetched;//!< Frames decoded by the prefetcher when the decoder was last tuned ( main loop only ).
+	long wasted;//!< Prefetched frames wasted or cancelled when the decoder was last tuned ( main loop only ).
+	pthread_mutex_t lock;//!< Protects \a held and \a prefetcher.
+} Thread_Budget;
+
+//! Structure holding the histograms and statistics of a frame.
+/*!
+  The histograms of the blue, green, red and luma values of a frame, along with the mean and standard deviation of each of them. Index 0, 1, 2 and 3 of every array stands for blue, green, red and luma respectively.
+  \sa compute_histogram(), draw_histogram().
+  */
+typedef struct{
+	int frame_no;//!< Frame number of the entry, -1 when the entry is empty.
+	unsigned int bins[ 4 ][ 256 ];//!< The histograms.
+	double mean[ 4 ];//!< Mean of each channel.
+	double sdv[ 4 ];//!< Standard deviation of each channel.
+} Hist_Entry;
+
+//! Structure describing a client of the command interface.
+/*!
+  A client is either a connection to the command socket, or stdin / stdout in the <em>--commands -</em> mode. It is shared by its reading thread and by every command of it still in the queue, and is closed once all of them are done with it.
+  \sa release_client().
+  */
+typedef struct{
+	int in_fd;//!< Descriptor commands are read from.
+	int out_fd;//!< Descriptor replies are written to.
+	int refs;//!< Number of references ( reading thread + queued commands ), protected by the queue lock.
+} Cmd_Client;
+
+//! Structure holding one scripted command.
+typedef struct{
+	int type;//!< One of the CMD_ aliases, e.g. CMD_SEEK.
+	int arg;//!< Frame number or step.
+	int arg2;//!< Last frame of <em>mark</em>.
+	char path[ 256 ];//!< Output path of <em>get-frame</em>, the label of <em>mark</em>, the file of <em>export-markers</em> and <em>import-markers</em>, or the offending text of an invalid command.
+	Cmd_Client* client;//!< The client waiting for the reply.
+} Command;
+
+//! Bounded FIFO of commands.
+/*!
+  Filled by the reading threads of the clients and drained by the main loop, so that every command runs on the same thread as the mouse actions.
+  \sa push_command(), drain_commands().
+  */
+typedef struct{
+	Command items[ CMD_QUEUE_SIZE ];//!< The queued commands.
+	int head;//!< Index of the oldest command.
+	int count;//!< Number of queued commands.
+	pthread_mutex_t lock;//!< Protects the queue and the reference counts of the clients.
+	pthread_cond_t not_full;//!< Signalled when a command is taken out of the queue.
+} Cmd_Queue;
+
+//! Structure holding one action of the user, as queued by the mouse callback.
+typedef struct{
+	int type;//!< One of the UI_ aliases, e.g. UI_PLAY_PAUSE.
+	int x;//!< x coordinate of the mouse.
+	int y;//!< y coordinate of the mouse.
+	int arg;//!< Direction of the wheel for UI_WHEEL; 1 for UI_STEP_UP and UI_STEP_DOWN with Ctrl held down.
+} UI_Event;
+
+//! Lock-free queue of UI events.
+/*!
+  A single-producer / single-consumer ring: the mouse callback is the only writer of \a tail and the main loop the only writer of \a head. Each side publishes its index with a release store and reads the other one with an acquire load, so neither ever waits for the other.
+  \sa ui_push(), drain_ui_events().
+  */
+typedef struct{
+	UI_Event items[ UI_QUEUE_SIZE ];//!< The queued events.
+	int head;//!< Index of the oldest event, written by the main loop only.
+	int tail;//!< Index where the next event is written, written by the callback only.
+	int dropped;//!< Number of events dropped because the queue was full, written by the callback only.
+} UI_Queue;
+
+//! State of the player owned by the main loop.
+/*!
+  Only the main loop reads or writes these fields. The mouse callback and the command threads never touch them; they queue events or commands instead.
+  \sa execute_ui_event(), execute_command().
+  */
+typedef struct{
+	bool playing;//!< True when the video is being played.
+	bool sldr_moving;//!< True while the left button is held down, i.e. the slider follows the mouse.
+	bool panning;//!< True while the view is dragged with the mouse.
+	int pan_x;//!< x coordinate of the last mouse event while panning.
+	int pan_y;//!< y coordinate of the last mouse event while panning.
+	long ui_events;//!< Number of UI events executed so far.
+	long tick;//!< Number of iterations of the main loop so far, i.e. the frame clock.
+} Engine_State;
+
+//! Structure used to record or replay a session.
+/*!
+  A recorded session is a text file with one action per line: <em>tick ms name x y arg</em>, where \a tick is the iteration of the main loop ( the frame clock ) at which the action was executed, \a ms the time since the start of the session and \a name one of the names of #ui_names. After every iteration with some action a line <em>tick ms frame N</em> holds the frame number then displayed. The file ends with <em>tick ms end</em>. Lines starting with '#' are comments.
+
+  A replay feeds the actions back at the same ticks, without waiting between ticks, so the result does not depend on the speed of the machine. The frame numbers are checked and the time from the start of every action to the end of its tick is collected per kind of action.
+  \sa record_action(), replay_tick(), end_tick(), replay_report().
+  */
+typedef struct{
+	FILE* rec;//!< File the session is recorded to ( <em>--record</em> ), NULL when not recording.
+	FILE* replay;//!< File the session is replayed from ( <em>--replay</em> ), NULL when not replaying.
+	char line[ 256 ];//!< Line of the replayed file read ahead but not due yet.
+	bool has_line;//!< True when \a line holds such a line.
+	bool done;//!< True once the end of the replayed file is reached.
+	int expect_frame;//!< Frame number expected at the end of the current tick, -1 when there is nothing to check.
+	int actions;//!< Number of actions executed in the current tick.
+	int act_type[ UI_QUEUE_SIZE + 1 ];//!< Kind of every action of the current tick.
+	int64 act_start[ UI_QUEUE_SIZE + 1 ];//!< Start time of every action of the current tick.
+	long checks;//!< Number of frame numbers checked.
+	long mismatches;//!< Number of frame numbers which differed from the recorded ones.
+	double* samples[ UI_KEY + 1 ];//!< Latencies ( ms ) collected for every kind of action.
+	int nsamples[ UI_KEY + 1 ];//!< Number of latencies in \a samples.
+	int64 start;//!< Tick count at the start of the session.
+} Session_Log;
+
+//! Structure shared by the decoder and the encoder threads of an export.
+/*!
+  Exporting a range of frames decodes every frame once on the calling thread and hands it over to a pool of encoder threads. A fixed set of buffers circulates between the two sides: the decoder takes a buffer from \a free_bufs, copies the decoded frame into it and appends it to the \a full queue; an encoder takes it from the \a full queue, writes it and returns it to \a free_bufs. Thus no memory is allocated per exported frame and the decoder blocks when the encoders fall behind.
+  \sa export_range(), export_worker().
+  */
+typedef struct{
+	Frame_Buf** bufs;//!< All the buffers of the export, taken from the frame pool.
+	int nbufs;//!< Number of buffers.
+	IplImage** free_bufs;//!< Stack of buffers ready to be filled by the decoder.
+	int nfree;//!< Number of buffers in \a free_bufs.
+	IplImage** full;//!< FIFO of buffers waiting to be written.
+	int* full_no;//!< Frame number of every buffer in \a full.
+	int full_head;//!< Index of the oldest entry of \a full.
+	int full_count;//!< Number of entries in \a full.
+	pthread_mutex_t lock;//!< Protects all the fields above.
+	pthread_cond_t cond;//!< Signalled whenever a buffer changes sides or the export is done.
+	bool done;//!< True once the decoder has queued the last frame.
+	const char* pattern;//!< printf() style pattern of the output files, e.g. <em>frame_%06d.png</em>.
+	CvVideoWriter* writer;//!< The output video when exporting to a video file, NULL when exporting images.
+	int written;//!< Number of frames written.
+	int failed;//!< Number of frames which could not be written.
+} Export_Queue;
+
+//! An export started from the window.
+/*!
+  The export button does not block the window: a video file is exported by a thread of its own, with a VP_Player of its own, so the main loop goes on playing and only shows the progress in the status field. A streamed or a live input is exported on the main loop, since its frames are only held by the main loop's buffers.
+  \sa export_start(), export_poll().
+  */
+typedef struct{
+	VP_Player* player;//!< Player of the export thread, NULL when no export runs.
+	pthread_t thread;//!< The export thread.
+	int first;//!< First frame of the range.
+	int last;//!< Last frame of the range.
+	int step;//!< Distance between two exported frames.
+	int total;//!< Number of frames of the range.
+	int queued;//!< Number of frames decoded so far, updated atomically.
+	int written;//!< Number of frames written, set when the thread ends.
+	int shown;//!< Progress shown last in the status field, in percent.
+	bool finished;//!< Set atomically by the thread when it ends.
+	bool cancel;//!< Set atomically to stop the export.
+} Export_Job;
+
+
+//Global Variables
+//! Pointer to the player of the video file.
+/*!
+  A video file is opened with libvideoplayer ( see videoplayer.h ), whose VP_Player wraps the CvCapture of the file: the properties of the video are read, and the frames decoded and seeked, through it. The player is one client of the library among others; the background threads open CvCaptures of their own on the same file.
+  \sa vp_open(), vp_close(), decode_vid().
+  */
+VP_Player *vid;
+IplImage *decoded = NULL;				//!< Header over the frame decoded last by \a vid, see vp_peek_frame().
+
+//! Pointer to the streamed input.
+/*!
+  When the video is read from a pipe, from stdin ( given as "-" ) or from a <em>.y4m</em> file, \a vid stays NULL and the frames are fetched from this stream instead. All the functions that fetch or seek frames ( query_frame(), seek_frame(), get_frame_pos() ) hide the difference between the two.
+  \sa Y4M_Stream, stream_open().
+  */
+Y4M_Stream *stream;
+
+//! Pointer to the live input.
+/*!
+  With <em>--live</em> the video is a camera, a pipe or a video replayed at its frame rate, captured while it is being watched. Both \a vid and \a stream stay NULL and query_frame(), seek_frame() and get_frame_pos() read the timeshift buffer instead.
+  \sa Live_Input, live_open().
+  */
+Live_Input *live;
+
+//! Pointer to the main image.
+/*!
+  Pointer to the main image shown on the screen. The various buttons, screen-area etc are sub-images of this image. Initially this image is created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. Later, every sub-image's data part is assigned the desired part of this main image. Now, any further operation on the sub-images reflects the change in this image as well.
+
+  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+  */
+IplImage *player;
+
+//! Pointer to the control-pannel sub-image.
+/*!
+  The control-pannel sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
+  <ul>
+  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
+  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
+  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
+</ul>
+  Once this assignment is done, any change in this Control-Pannel sub-image, will be reflected directly on the screen.
+
+   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+ */
+IplImage *pnl;
+
+//! Pointer to the slider-strip sub-image.
+/*!
+  The slider-strip sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
+  <ul>
+  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
+  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
+  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
+</ul>
+  Once this assignment is done, any change in this Slider-strip sub-image, will be reflected directly on the screen.
+
+   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+ */
+IplImage *slider;
+
+//! Pointer to the slider-button sub-image.
+/*!
+  The slider-button sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
+  <ul>
+  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
+  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
+  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
+</ul>
+  Once this assignment is done, any change in this Slider-Button sub-image, will be reflected directly on the screen.
+
+   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+ */
+IplImage *sldr_btn;
+
+//! Pointer to the slider-value static-text sub-image.
+/*!
+  The slider-value static-text sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
+  <ul>
+  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
+  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
+  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
+</ul>
+  Once this assignment is done, any change in this Slider-value Static-Text sub-image, will be reflected directly on the screen.
+
+   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</a></b>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+ */
+IplImage *sldr_val;
+
+//! Pointer to temporary slider-value static-text sub-image.
+/*!
+  The temporary slider-value static-text sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. This is used to temporarily store the original slider-value. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
+  <ul>
+  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
+  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
+  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
+</ul>
+  Once this assignment is done, any change in this temporary slider-value static-text sub-image, will be reflected directly on the screen.
+
+   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+ */
+IplImage *oslider;
+
+//! Pointer to the frame-area sub-image.
+/*!
+  The frame-area sub-image is originally created as an empty image using the <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=createimage#cvCreateImage" target="_blank"><b>cvCreateImage()</b></a> function. Here the currently fetched frame will be displayed. It is then assigned the following properties of the main image so that it becomes a sub-image ( or region of interest ).
+  <ul>
+  <li>\a origin = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=origin#origin" target="_blank"><b>origin</b></a> of main image.
+  <li>\a widthStep = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=widthstep#widthStep" target="_blank"><b>widthStep</b></a> of main image.
+  <li>\a data origin location = <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html?highlight=imagedata#imageData" target="_blank"><b>desired data location</b></a> from the main image
+</ul>
+  Once this assignment is done, any change in this Frame-area sub-image, will be reflected directly on the screen.
+
+   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+ */
+IplImage *frame_area;
+
+//! Pointer to the fetched frame sub-image.
+/*!
+  This will point to frame fetched using <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a>. Therefore, this pointer is only declared and not defined. The allocation and deallocation of memory pointed by this pointer is handled by <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a>.
+
+   \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+ */
+IplImage *frame;
+
+//! Pointer to the previously fetched frame.
+/*!
+  The current fetched frame using <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a> is copied to \a old_frame before fetching the next frame. Thus, this pointer points to an <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a> structure holding the previously fetched frame. It is the image of \a cur_buf, a buffer of the frame pool, and is set by set_current().
+
+   \sa <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#loadimage" target="_blank"><b>cvLoadImage()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/operations_on_arrays.html?highlight=releaseimage#cvReleaseImage" target="_blank"><b>cvReleaseImage()</b></a>.
+ */
+IplImage *old_frame;
+Frame_Buf *cur_buf;					//!< The frame pool buffer holding \a old_frame.
+
+//! Pointer to current frame number static-text.
+/*!
+  Points to the sub-image showing the current frame number.
+  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl(), moveSlider().
+  */
+IplImage *cur_frame_no;
+
+//! Pointer to the timecode static-text.
+/*!
+  Points to the sub-image showing the SMPTE timecode of the current frame, next to its number.
+  \sa initialize_pnl(), moveSlider(), format_timecode().
+  */
+IplImage *time_code;
+
+//! Pointer to FPS (Frames Per Second) static-text.
+/*!
+  Points to the sub-image showing the FPS. This is currently a static-text field and its value is to be loaded from the video initially. Later, the functionality to edit this field can be added, therefore the pointer has "edit" in its name. It hold the value of #fps.
+
+  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl().
+  */
+IplImage *fps_edit;
+
+//! Pointer to FOUR_CC static-text.
+/*!
+  Points to the sub-image showing FOUR_CC static text.
+
+  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl().
+  */
+IplImage *four_cc_edit;
+
+//! Pointer to "Status" static-text.
+/*!
+  Points to the sub-image showing the status static-text. Holds the string in #status_line.
+
+  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl().
+  */
+IplImage *status_edit;
 
 //! Pointer to Total Frames static-text.
 /*!
@@ -353,6 +1372,30 @@ IplImage *stepup_btn;
  */
 IplImage *stepdown_btn;
 
+//! Pointer to export button area.
+/*!
+  Points to the sub-image having the export button.
+
+  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl(), export_range().
+ */
+IplImage *export_btn;
+
+//! Pointer to the pixel-value static-text.
+/*!
+  Points to the sub-image showing the coordinates and the value of the video pixel under the mouse, along with the zoom factor.
+
+  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl(), show_pixel().
+ */
+IplImage *pixel_info;
+
+//! Pointer to the histogram area.
+/*!
+  Points to the sub-image of the control pannel where the histograms and the mean / standard deviation of the current frame are drawn.
+
+  \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#IplImage" target="_blank"><b>IplImage</b></a>, initialize_pnl(), draw_histogram().
+ */
+IplImage *hist_area;
+
 
 int sldr_start; //!< Indicates the starting position (frame number) of the slider.
 int sldr_maxval; //!< The maximum number of frames in the video.
@@ -363,60 +1406,274 @@ int sldr_maxval; //!< The maximum number of frames in the video.
   */
 int step_val = 1;
 
-char line[ 20 ];//!< Memory to hold any string temporarily.
+int stream_history = STREAM_HISTORY;	//!< Number of frames kept for a streamed input ( <em>--history</em> ).
+int raw_width = 0;						//!< Width of raw I420 input ( <em>--raw WxH</em> ), 0 when the input is not raw.
+int raw_height = 0;						//!< Height of raw I420 input ( <em>--raw WxH</em> ).
+int raw_chroma = STREAM_I420;			//!< Layout of raw input, STREAM_I420 or STREAM_MONO ( <em>--pix-fmt</em> ).
+int raw_bits = 8;						//!< Significant bits of the samples of raw input ( <em>--pix-fmt</em> ).
+double raw_fps = 25;					//!< Frame rate assumed for raw I420 input ( <em>--fps</em> ).
+bool live_mode = false;					//!< True when the video is a live input ( <em>--live</em> ).
+double live_minutes = LIVE_MINUTES;		//!< Length of the timeshift buffer in minutes ( <em>--live-minutes</em> ).
+int live_mb = LIVE_MB;					//!< Memory of the timeshift buffer in MB ( <em>--live-mb</em> ).
 
-//! Memory to hold a textbox string temporarily.
+//! The playlist.
 /*!
-   This will hold a textbox string temporarily. Whenever a textbox is to be used, the original string in the textbox is required while editing its contents. This is the primary use of this memory.
+  \sa Playlist.
   */
-char edit_text[ 20 ];
+Playlist playlist = { NULL, 0, NULL, 0, {}, {}, 0, false, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, 0, 0 };
 
-char status_line[ 15 ];//!< Memory to hold the "status" string.
-char four_cc_str[4];//!< Memory to hold the Four Character Code (FOUR_CC).
+//! The frame markers.
+/*!
+  \sa Marker_Store.
+  */
+Marker_Store markers;
 
-//! Frames per second.
+//! The filter pipeline.
 /*!
-	Frames Per Second value is stored in this variable. This value is read from the input video file.
-  */ 
-double fps;
+  \sa Filter_Pipeline.
+  */
+Filter_Pipeline filters = { "", {}, 0, true, false, 0, {}, 0, 0, 0, 0, NULL, {}, {}, 0, 0, 0, false, {}, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
 
-//! Four Character Code.
+//! The thread budget.
 /*!
-	Hold the FOUR_CC value in double format. This value is directly read from the input video file, parsed to a string (using #fourcc) and stored to #four_cc_str.
+  \sa Thread_Budget.
   */
-long fourcc_l;
-//! Four_CC temporary string.
+Thread_Budget threads = { 0, 0, false, 0, DECODE_AHEAD, -1, 0, 0, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+bool length_known = true;				//!< False while the total number of frames of a streamed input is not known yet.
+
+//! Output pattern of an export.
 /*!
-	An intermediate string to hold the FOUR_CC value while parsing from #fourcc_l to #four_cc_str.
+  A printf() style pattern holding the frame number, e.g. <em>frame_%06d.png</em> ( PNG / JPEG images ), or the name of a video file ending in <em>.avi</em>. Set using the <em>--export-to</em> option.
+  \sa export_range().
   */
-char *fourcc;
+const char* export_pattern = "frame_%06d.png";
+int export_in = -1;						//!< First frame of the range to be exported ( <em>[</em> key ), -1 when not set.
+int export_out = -1;					//!< Last frame of the range to be exported ( <em>]</em> key ), -1 when not set.
+int export_jobs = 0;					//!< Number of encoder threads ( <em>--jobs</em> ), 0 for one per thread of the budget ( <em>--threads</em> ).
+Export_Job export_job = { NULL, 0, 0, 0, 1, 0, 0, 0, -1, false, false };	//!< The export started from the window, see Export_Job.
+bool headless = false;					//!< True when running without a window ( e.g. <em>--export</em> ).
 
-//! Blinker count.
+//! Frame-difference display mode.
 /*!
-	This counter is used to toogle the blinker character #blink_char. Whenever this counter crosses #blink_max, the \a blink_char is toogled.
-	
-	\sa type_step().
+  One of DIFF_OFF, DIFF_REPLACE or DIFF_BLEND, cycled using the <em>d</em> key. In the last two modes \f$ |frame - previous| \f$ is shown, which makes cuts and dissolves easy to spot.
+  \sa render_frame().
   */
-int blink_count = 0;
+int diff_mode = DIFF_OFF;
+bool diff_luma = true;					//!< True to show the difference of luma, false for the per-channel difference ( <em>l</em> key ).
+bool diff_colormap = true;				//!< True to colour-map the luma difference ( <em>c</em> key ).
+int diff_threshold = 0;					//!< Differences below this value are not shown ( <em>t</em> key, <em>--diff-threshold</em> ).
+int diff_gain = 4;						//!< The difference is multiplied by this value before being shown.
+int shown_frame = -1;					//!< Number of the frame currently held in \a disp_cur.
 
-int blink_max = 5;				//! Threshold to toogle the \a blink_char.
-char blink_char = '|' ;			//! The blinking character, toogled with an underscore (\_).
+//! Significant bits of the samples of the video.
+/*!
+  8, except for a streamed input of more than 8 bits per sample, whose frames are kept at 16 bits ( gray, or BGR ) and mapped to the display through the window / level table \a wl_lut.
+  \sa build_wl_lut(), window_level().
+  */
+int native_bits = 8;
+double wl_window = 0;					//!< Width of the range of samples spread over the display levels, 0 for the whole range ( <em>--window</em>, <em>&lt;</em> and <em>&gt;</em> keys ).
+double wl_level = -1;					//!< Centre of that range, -1 for the middle of the whole range ( <em>--level</em>, <em>{</em> and <em>}</em> keys ).
+uchar wl_lut[ 65536 ];					//!< Display level of every sample value, see build_wl_lut().
+bool wl_identity = true;				//!< True when \a wl_lut leaves 8-bit samples unchanged.
+IplImage *disp_native = NULL;			//!< The visible region of a frame which is not 8-bit BGR, resized to the display resolution before window_level().
+bool gray_cur_ok = false;				//!< True when \a gray_cur holds the luma of \a disp_cur.
+bool gray_prev_ok = false;				//!< True when \a gray_prev holds the luma of \a disp_prev.
 
-Field_Area play_pause_btn_area;	//!< Play / Pause Button coordinates.
-Field_Area stop_btn_area;		//!< Stop Button coordinates.
-Field_Area stepup_btn_area;		//!< Step Up Button coordinates.
-Field_Area stepdown_btn_area;	//!< Step Down Button coordinates.
-Field_Area fps_edit_area;		//!< FPS static-text coordinates.
-Field_Area four_cc_edit_area;	//!< FOUR_CC static-text coordinates.
-Field_Area status_edit_area;	//!< Status string coordinates.
-Field_Area step_edit_area;		//!< Step textbox coordinates.
+//! Current frame at display resolution.
+/*!
+  The fetched frame is resized to the display resolution into this image, and from there copied to \a frame_area. Whenever a new frame is displayed, \a disp_cur and \a disp_prev are swapped, so \a disp_prev always holds the previously displayed frame. The frame difference is computed from these two images, i.e. at display resolution and not at the resolution of the video.
+  \sa disp_prev, render_frame().
+  */
+IplImage *disp_cur;
+IplImage *disp_prev;					//!< Previously displayed frame at display resolution.
+IplImage *gray_cur;						//!< Luma of \a disp_cur.
+IplImage *gray_prev;					//!< Luma of \a disp_prev.
+IplImage *diff_img;						//!< The frame difference at display resolution.
+IplImage *diff_gray;					//!< The luma difference at display resolution.
+CvMat *diff_lut;						//!< Look-up table applying \a diff_gain and the colour map to the difference.
 
-//Controllers
-bool sldr_moving	=	false; 		//!< Ture when slider is moving.
-bool playing		=	false;		//!< True when the video is being played.
-bool processing		= 	false;		//!< True when some processing is carried out.
-bool typing_step	=	false;		//!< True when any textbox value is being edited.
-bool blinking		=	false;		//!< True when blinking character is set.
+//! Zoom factor.
+/*!
+  At a zoom of 1 the whole frame is fitted to the frame area. At a zoom of \f$ z \f$ only \f$ 1/z \f$ of the width and height of the frame, centred at ( \a view_cx, \a view_cy ), is shown. Changed with the mouse wheel or the <em>+</em>, <em>-</em> and <em>0</em> keys.
+  \sa zoom_at(), get_view_rect().
+  */
+double zoom = 1;
+double view_cx = -1;					//!< x coordinate ( in video pixels ) of the centre of the view, -1 for the centre of the frame.
+double view_cy = -1;					//!< y coordinate ( in video pixels ) of the centre of the view, -1 for the centre of the frame.
+CvRect view_rect;						//!< The region of the frame currently shown in the frame area.
+
+//! Cache of histograms.
+/*!
+  Filled by the histogram thread ( hist_worker() ) and read by the main loop, both under \a hist_lock.
+  \sa HIST_CACHE_SIZE, update_histogram().
+  */
+Hist_Entry *hist_cache;
+Frame_Buf *hist_buf;					//!< Reference to the frame handed over to the histogram thread.
+int hist_stride = 1;					//!< Subsampling stride of the histograms.
+int hist_request = -1;					//!< Frame number of \a hist_buf.
+bool hist_pending = false;				//!< True while the histogram thread owns \a hist_buf.
+bool hist_quit = false;					//!< Set to stop the histogram thread.
+int hist_shown = -1;					//!< Frame number of the histograms currently drawn.
+int hist_epoch = 0;						//!< Incremented when the cached histograms no longer apply, i.e. when another file is opened.
+pthread_t hist_thread;					//!< The histogram thread.
+pthread_mutex_t hist_lock = PTHREAD_MUTEX_INITIALIZER;	//!< Protects the histogram cache and request.
+pthread_cond_t hist_cond = PTHREAD_COND_INITIALIZER;		//!< Signalled when a histogram is requested.
+
+//! The command queue.
+/*!
+  \sa Cmd_Queue, CMD_QUEUE_SIZE.
+  */
+Cmd_Queue cmd_queue = { {}, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+const char* cmd_socket_path = NULL;		//!< Path of the command socket ( <em>--socket</em> ), NULL when not used.
+bool cmd_stdin = false;					//!< True when commands are read from stdin ( <em>--commands -</em> ).
+int cmd_listen_fd = -1;					//!< The listening command socket.
+long cmds_executed = 0;					//!< Number of commands executed so far.
+bool export_only = false;				//!< True when only an export is to be done ( <em>--export</em> ).
+
+//! The UI event queue.
+/*!
+  \sa UI_Queue, UI_QUEUE_SIZE.
+  */
+UI_Queue ui_queue;
+
+//! The frame pool.
+/*!
+  \sa Frame_Pool.
+  */
+Frame_Pool frame_pool = { {}, 0, 0, ( size_t )POOL_CEILING_MB<<20, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+
+//! The memory governor.
+/*!
+  \sa Mem_Governor.
+  */
+Mem_Governor mem_gov = { {}, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+bool show_stats = false;				//!< True to show the statistics over the frame ( <em>s</em> key ).
+
+//! The frame cache.
+/*!
+  \sa Frame_Cache.
+  */
+Frame_Cache frame_cache = { {}, 0, 0, 0, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+
+//! The prefetcher.
+/*!
+  \sa Prefetcher.
+  */
+Prefetcher prefetch = { NULL, PREFETCH_DEPTH, 0, 0, PREFETCH_DEPTH, 0, -1, {}, 0, 0, false, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+//! Position of a CvCapture.
+/*!
+  The number of the frame displayed, as counted by the engine from the decoded frames ( see vp_position() ). Frames served from the frame cache move \a play_pos but not the capture, which is repositioned only when the next frame has to be decoded.
+  \sa get_frame_pos(), query_frame().
+  */
+int play_pos;
+Frame_Buf *fetched_buf;					//!< Reference to the cached frame returned last by query_frame() or seek_frame(), NULL when the frame belongs to the capture.
+
+//! The perceptual hash index.
+/*!
+  \sa Phash_Index.
+  */
+Phash_Index phash;
+bool phash_at_start = false;			//!< True to start hashing the frames as soon as the video is opened ( <em>--phash</em> ).
+IplImage *slider_base;					//!< The slider without any marker, \a oslider being this plus the timeline and the markers.
+
+//! The activity timeline.
+/*!
+  \sa Activity.
+  */
+Activity activity = { 0, 0, {}, {}, {}, 0, NULL, 0, false, ACT_DIFF, 0, 0 };
+bool timeline_off = false;				//!< True when the activity timeline is disabled ( <em>--no-timeline</em> ).
+
+//! Part of the video the slider spans.
+/*!
+  The slider spans the frames \a tl_first to \a tl_first + \a tl_span, or the whole video when \a tl_span is 0.
+  \sa tl_window(), tl_zoom().
+  */
+int tl_first = 0;
+int tl_span = 0;						//!< See \a tl_first.
+
+//! The thumbnails.
+/*!
+  \sa Thumb_Cache.
+  */
+Thumb_Cache thumbs = { {}, {}, 0, { 0, 0 }, {}, 0, 0, 0, 0, 0, 0, NULL, false, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+//! The storyboard.
+/*!
+  \sa Storyboard.
+  */
+Storyboard board = { false, NULL, 0, 0, 0, 0, 0 };
+double board_seconds = BOARD_INTERVAL;	//!< Seconds after which a shot gets another tile ( <em>--board-interval</em> ).
+
+//! The compare mode.
+/*!
+  \sa Compare.
+  */
+Compare compare = { {}, 0, COMPARE_SIDE, p_width/2, 1, NULL, 0, 0, 0, false, {}, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+//! The quality engine.
+/*!
+  \sa Quality.
+  */
+Quality quality;
+bool quality_only = false;				//!< True to compare the videos without a window and exit ( <em>--quality</em> with <em>--headless</em> and no command ).
+
+//! State owned by the main loop.
+/*!
+  \sa Engine_State.
+  */
+Engine_State engine = { false, false, false, 0, 0, 0, 0 };
+
+//! The recorded or replayed session.
+/*!
+  \sa Session_Log.
+  */
+Session_Log session;
+
+//! Names of the UI events, as written to a recorded session.
+const char* ui_names[] = { "move", "press", "release", "slider", "play-pause", "stop", "step-up", "step-down", "export", "edit-step", "wheel", "key" };
+
+char line[ 20 ];//!< Memory to hold any string temporarily.
+
+//! Memory to hold a textbox string temporarily.
+/*!
+   This will hold a textbox string temporarily. Whenever a textbox is to be used, the original string in the textbox is required while editing its contents. This is the primary use of this memory.
+  */
+char edit_text[ 20 ];
+
+char status_line[ 15 ];//!< Memory to hold the "status" string.
+char four_cc_str[4];//!< Memory to hold the Four Character Code (FOUR_CC).
+
+//! Frames per second.
+/*!
+	Frames Per Second value is stored in this variable. This value is read from the input video file.
+  */ 
+double fps;
+
+//! Blinker count.
+/*!
+	This counter is used to toogle the blinker character #blink_char. Whenever this counter crosses #blink_max, the \a blink_char is toogled.
+	
+	\sa type_step().
+  */
+int blink_count = 0;
+
+int blink_max = 5;				//! Threshold to toogle the \a blink_char.
+char blink_char = '|' ;			//! The blinking character, toogled with an underscore (\_).
+
+Field_Area play_pause_btn_area;	//!< Play / Pause Button coordinates.
+Field_Area stop_btn_area;		//!< Stop Button coordinates.
+Field_Area stepup_btn_area;		//!< Step Up Button coordinates.
+Field_Area stepdown_btn_area;	//!< Step Down Button coordinates.
+Field_Area fps_edit_area;		//!< FPS static-text coordinates.
+Field_Area four_cc_edit_area;	//!< FOUR_CC static-text coordinates.
+Field_Area status_edit_area;	//!< Status string coordinates.
+Field_Area step_edit_area;		//!< Step textbox coordinates.
+Field_Area export_btn_area;		//!< Export Button coordinates.
+
+//Controllers
+bool typing_step	=	false;		//!< True when any textbox value is being edited.
+bool blinking		=	false;		//!< True when blinking character is set.
 
 
 //Colors
@@ -437,6 +1694,7 @@ CvFont font;				//!< Normal font.
 CvFont font_italic;			//!< Italic font.
 CvFont font_bold;			//!< Bold font.
 CvFont font_bold_italic;	//!< Bold Italic font.
+CvFont font_small;			//!< Small font.
 int font_face_italic = CV_FONT_HERSHEY_SIMPLEX|CV_FONT_ITALIC;	//!< Font face.
 int font_face = CV_FONT_HERSHEY_SIMPLEX;						//!< Font face.
 double hscale = 0.5;		//!< Font's Horizontal Scale parameter.
@@ -485,6 +1743,60 @@ void draw_stepdown( IplImage* image, CvScalar color );
 //! Function to fill a symbol with a given color.
 void fill_color( IplImage* image, CvScalar color );
 
+//! Function to fill an image with a colour.
+void fill_image( IplImage* image, CvScalar color );
+
+//! Function template to fill a row with one pixel.
+template< typename T, int CN > void fill_row( T* row, const T* px, int width );
+
+//! Function template to convert a colour to a pixel.
+template< typename T, int CN > void scalar_to_pixel( CvScalar color, T* px );
+
+//! Function template to fill an image with a colour.
+template< typename T, int CN > void fill_k( IplImage* image, CvScalar color );
+
+//! Function template to fill an image with a colour inside a one pixel border.
+template< typename T, int CN > void frame_k( IplImage* image, CvScalar border, CvScalar inside );
+
+//! Function template to vertically color an image.
+template< typename T, int CN > void spectrum_vert_k( IplImage* image, CvScalar color1, CvScalar color2 );
+
+//! Function template to horizontally color an image.
+template< typename T, int CN > void spectrum_horz_k( IplImage* image, CvScalar color1, CvScalar color2 );
+
+//! Function template to fill the area bounded by a colour.
+template< typename T, int CN > void fill_color_k( IplImage* image, CvScalar color );
+
+//! Function template to count the pixels of an image in the histograms.
+template< typename T, int CN > void histogram_k( const IplImage* img, int stride, unsigned int bins[][ 256 ], unsigned int bins2[][ 256 ], int shift );
+
+//! Function template to map an image through the window / level table.
+template< typename T, int CN > void window_level_k( const IplImage* src, IplImage* dst, const uchar* lut );
+
+//! Function template to find the lowest and the highest sample of an image.
+template< typename T, int CN > void minmax_k( const IplImage* img, int* lo, int* hi );
+
+//! Function to build the window / level table.
+void build_wl_lut();
+
+//! Function to map a frame to the display through the window / level table.
+void window_level( const IplImage* src, IplImage* dst );
+
+//! Function to change the window / level with a key.
+bool adjust_window_level( char c );
+
+//! Function to read the integer value of a command line option.
+bool option_int( const char* name, const char* arg, int lo, int hi, int* value );
+
+//! Function to read the real value of a command line option.
+bool option_real( const char* name, const char* arg, double lo, double hi, double* value );
+
+//! Function to parse a pixel format.
+bool parse_pix_fmt( const char* name, int* chroma, int* bits );
+
+//! Function to convert high bit depth I420 planes to BGR.
+void i420_to_bgr16( const ushort* planes, IplImage* dst, int bits );
+
 //! Function to change the status message.
 void change_status();
 
@@ -494,978 +1806,9304 @@ void type_step( char c, int frame_val );
 //! Function to reset all fields to their previous contents.
 void resetAllEdits();
 
-/*
-width 		840 (display)
-height		480(display) + 10(slider) + 200(ctrl pnl)	
-*/
-//Main function
-//argv[1]	:	video-file path
-/*! The main function creates the main image and various sub-images that constitute the video player. Once this outline is ready, frames from the video are fetched and displayed on the sub-image denoting the "screen area". Simultaneously, contents of other sub-image (frame number, slider position) are also updated.
- */
-int main( int argc, char** argv ){
+//! Function to fetch the next frame from the video.
+IplImage* query_frame();
 
-	//Initialize the font
-	/*! Before starting to initialize the various sub-images, the fonts to be used need to be initialized. The fonts are initialized using the <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=initfont#cvInitFont" target="_blank"><b>cvInitFont()</b></a> function.
-	 * */
-	cvInitFont( &font, font_face, hscale, vscale, shear, thickness, line_type );
-	cvInitFont( &font_italic, font_face_italic, hscale, vscale, shear, thickness, line_type );
-	cvInitFont( &font_bold, font_face, hscale, vscale, shear, thickness+1, line_type );
-	cvInitFont( &font_bold_italic, font_face_italic, hscale, vscale, shear, thickness+1, line_type );
-	
-	//Create the player image
-	/*! This is followed by the creation of an empty image (which serves as the main image of the player). The \a player image is created using the various dimensions shown earlier.
-	 * */
-	player = cvCreateImage( cvSize( p_width, p_height ), IPL_DEPTH_8U, 3 );
-	
-	//Create Control Pannel
-	/*! Then the control-pannel sub-image is assigned as a part of the main \a player image.
-	 * */
-	pnl = cvCreateImageHeader( cvSize( p_width, ctrl_pnl_height ), IPL_DEPTH_8U, 3 );
-	pnl->origin = player->origin;
-	pnl->widthStep = player->widthStep;
-	pnl->imageData = player->imageData + ( p_height - ctrl_pnl_height )*player->widthStep;
-	for( int row=0; row<pnl->height; row++ ){
-		uchar* ptr = ( uchar* )( pnl->imageData + row*pnl->widthStep );
-		for( int col=0; col<pnl->width; col++ ){
-			ptr[ col*pnl->nChannels + 0 ] = 226;
-			ptr[ col*pnl->nChannels + 1 ] = 235;
-			ptr[ col*pnl->nChannels + 2 ] = 240;
-		}
-	}
-	//Add text & buttons
-	/*! All the buttons, textboxes, static-texts, etc are initialized.
-	 * */
-	initialize_pnl( argv[1] );
-	
-	//create custom slider (non-opencv)
-	/*! Above the control-pannel, a sub-image is assigned to be a slider. OpenCV has an inbuilt function <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=createtrackbar#cvCreateTrackbar" target="_blank"><b>cvCreateTrackbar()</b></a> to create a slider. But the disadvantage with this function is, the slider is placed at either at the top or the buttom of an image in a window. Therefore, to have the slider at a custom location in the window, I created my own slider. Practically, this slider is a sub-image to which I have assigned a mouse_callback function. Setting the ROI to this sub-image was possible, but then simultaneously accessing all the sub-images would not had been possible. Therefore, the slider sub-image is created by first creating the sub-image of the required dimensions and then setting the origin, widthstep to be the same as that of the main image and the imageData to the appropriate value of imageData of the main image. Everytime the slider position is updated, the original slider needs to be restored first and then the new position is to be marked. Therefore, the original slider sub-image is cloned to \a oslider sub-image. \a sldr_val sub-image is nothing but a rectangular image at a position derived from the slider's value. Thus, every time the slider's value is updated, the original slider sub-image ( \a oslider ) is restored, followed by placing the \a sldr_val sub-image at it appropriate position on the slider.
-	 * */
-	slider = cvCreateImageHeader( cvSize( p_width, 10 ), IPL_DEPTH_8U, 3 );
-	slider->origin = player->origin;
-	slider->widthStep = player->widthStep;
-	slider->imageData = player->imageData + ( p_height - sldr_height - ctrl_pnl_height )*player->widthStep;
-	for( int row=0; row<slider->height; row++ ){
-		uchar* ptr = ( uchar* )( slider->imageData + row*slider->widthStep );
-		for( int col=0; col<slider->width; col++ ){
-			ptr[ col*slider->nChannels + 0 ] = 94;
-			ptr[ col*slider->nChannels + 1 ] = 118;
-			ptr[ col*slider->nChannels + 2 ] = 254;
-		}
-	}
-	oslider = cvCloneImage( slider );
-	sldr_btn = cvCreateImage( cvSize( 15, sldr_height ), IPL_DEPTH_8U, 3 );
-	for( int row=0; row<sldr_btn->height; row++ ){
-		uchar* ptr = ( uchar* )( sldr_btn->imageData + row*sldr_btn->widthStep );
-		for( int col=0; col<sldr_btn->width; col++ ){
-			ptr[ col*slider->nChannels + 0 ] = 100;
-			ptr[ col*slider->nChannels + 1 ] = 150;
-			ptr[ col*slider->nChannels + 2 ] = 100;
-		}
-	}
-	sldr_val = cvCreateImageHeader( cvSize( sldr_btn_width, sldr_height ), IPL_DEPTH_8U, 3 );
-	sldr_val->origin = slider->origin;
-	sldr_val->widthStep = slider->widthStep;
-	sldr_val->imageData = slider->imageData;
-	cvCopy( sldr_btn, sldr_val );
-	
-	//display window
-	/*!
-	 * The main player images needs to be displayed using a <i>Named Window</i>. Using the <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=namedwindow#cvNamedWindow" target="_blank"><b>cvNamedWindow()</b></a> function we create a display window.
-	 * */
-	cvNamedWindow( "Video Player", CV_WINDOW_AUTOSIZE );
+//! Function to seek the video and fetch the frame at the new position.
+void seek_frame( int pos );
 
-	//install mouse callback
-	/*!
-	 * Everytime a mouse action ( move, click, etc ) occurs on the main display window, the events need to be captured and appropriate actions are to be called. For achieveing this task the <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=setmousecallback#cvSetMouseCallback" target="_blank"><b>cvSetMouseCallback()</b></a> function is used.
-	 * */
-	cvSetMouseCallback(
-		"Video Player",
-		my_mouse_callback,
-		( void* )NULL
-	);
-	
-	
-	//load the video
-	/*!
-	 * Now that we are ready with the video-player's outline, the video file should be loaded. This is achieved using the <a href="http://opencv.willowgarage.com/documentation/c/highgui_reading_and_writing_images_and_video.html?highlight=capture#cvCaptureFromFile" target="_blank"><b>cvCaptureFromFile()</b></a> function. The next task is to access various properties of this video and then display them at appropriate locations on the \a Control Pannel. To access the video properites <a href="http://opencv.willowgarage.com/documentation/c/highgui_reading_and_writing_images_and_video.html?highlight=cvgetcaptureproperty#cvGetCaptureProperty" target="_blank"><b>cvGetCaptureProperty()</b></a> function is used.
-	 * */
-	vid = cvCaptureFromFile( argv[1] );
-	//check the video
-	if( !vid ){
-		printf( "Error loading the video file. Either missing file or codec not installed\n" );
-		return( 1 );
-	}
-	frame_area = cvCreateImageHeader( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 3 );
-	frame_area->origin = player->origin;
-	frame_area->widthStep = player->widthStep;
-	frame_area->imageData = player->imageData;
-	fps = cvGetCaptureProperty( vid, CV_CAP_PROP_FPS );
-	sldr_start = cvGetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES );
-	fourcc_l = cvGetCaptureProperty( vid, CV_CAP_PROP_FOURCC );
-	fourcc = ( char* )( &fourcc_l );
-	sprintf( four_cc_str, "%c%c%c%c", fourcc[0], fourcc[1], fourcc[2], fourcc[3] );
-	//printf( "FPS : %f\n", fps );
-	sldr_maxval = cvGetCaptureProperty( vid, CV_CAP_PROP_FRAME_COUNT ); //check this property
-	if( sldr_maxval<1 ){
-		printf( "Number of frames < 1. Cannot continue...\n" );
-		return( 1 );
-	}
-	cvSetCaptureProperty(
-		vid,
-		CV_CAP_PROP_POS_FRAMES,
-		sldr_start
-	);
-	sprintf( line, "%d", sldr_maxval );
-	cvPutText( numFrames, line, cvPoint( 3, numFrames->height - 4 ), &font, black );
-	sprintf( line, "%d", ( int )cvRound( fps ) );
-	cvPutText( fps_edit, line, cvPoint( 3, fps_edit->height - 4 ), &font, black );
-	sprintf( line, "%d", sldr_start );
-	cvPutText( cur_frame_no, line, cvPoint( 3, cur_frame_no->height - 4 ), &font, black );
-	sprintf( line, "%s", four_cc_str );
-	cvPutText( four_cc_edit, line, cvPoint( 3, four_cc_edit->height - 8 ), &font, black );
-	moveSlider( sldr_start, OTHER_CALLS );
-	
-	/*!
-	 * If proper codecs are installed and the video consists of atleast one frame, then <a href="http://opencv.willowgarage.com/documentation/c/highgui_reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a> should return the initial frame in the video. If no frame is returned then there must be some problem either with the codecs or the video itself. In such a case, the program is halted with an appropriate error message. If everything goes fine, then the currently grabbed frame is stored into \a old_frame.
-	 * */
-	frame = cvQueryFrame( vid );
-	old_frame = cvCloneImage( frame );
-	if( !frame ){
-		printf( "Cannot load video. Missing Codec : %s\n", four_cc_str );
-		return( 1 );
-	}
-	cvShowImage( "Video Player", player );
-	
-	/*!
-	 * Now we come to the task where a frame is grabbed and displayed on the screen. If the player is in <i>play mode</i> ( i.e. \a player is set to true ) then frames are grabbed sequentially at an interval derived from the \a FPS value. The grabbed frame is then resized to the screen_area and displayed to the viewes.
-	 * */
-	char c;
-	int cur_frame;
-	while( 1 ){
-		if( ( c = cvWaitKey( 1000/fps ) )==27 ){
-			break;
-		}
-		if( !processing ){
-			if( playing ){
-				for( int i = 0; i < ( step_val - 1 ); i++ ){
-					cvQueryFrame( vid );
-				}
-				frame = cvQueryFrame( vid );
-				if( !frame ){
-					playing = false;
-				}
-				else{
-					cvCopy( frame, old_frame );
-				}
-			}
-			//to avoid any negative value of cur_frame
-			while( 1 ){
-				if( ( cur_frame = ( int )cvGetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES ) )>=0 ){
-					break;
-				}
-				//for some unknown reason cvQueryFrame was needed to be called twice to get to the desired frame.
-				frame = cvQueryFrame( vid );
-				cvCopy( frame, old_frame );
-			}
-			//defines the task to be carried out when editing a text-field
-			if( typing_step ){
-				type_step( c, cur_frame );
-			}
-			//this takes care if for some reason the cur_frame overshoots the sldr_maxval.
-			if( cur_frame == ( sldr_maxval-1 ) ){
-				getButton( play_pause_btn, PLAY_BTN, BTN_ACTIVE );
-				sprintf( status_line, "End reached" );
-				change_status();
-			}
-			cvResize( old_frame, frame_area );
-			//printf( "Current frame : %d\n", cur_frame );
-			moveSlider( cur_frame, OTHER_CALLS );
-		}
-		cvShowImage( "Video Player", player );
-	}
-	
-	/*!
-	 * Finally, cleaning up is done by destroying all the open windows and releasing all the images and sub-images.
-	 * */
-	//destory window
-	cvDestroyWindow( "Video Player" );
-	
-	//Release image
-	cvReleaseImageHeader( &stepdown_btn );
-	cvReleaseImageHeader( &stepup_btn );
-	cvReleaseImageHeader( &stop_btn );
-	cvReleaseImageHeader( &play_pause_btn );
-	cvReleaseImageHeader( &step_edit );
-	cvReleaseImageHeader( &four_cc_edit );
-	cvReleaseImageHeader( &fps_edit );
-	cvReleaseImageHeader( &numFrames );
-	cvReleaseImageHeader( &cur_frame_no );
-	cvReleaseImageHeader( &pnl );
-	cvReleaseImageHeader( &sldr_val );
-	cvReleaseImageHeader( &slider );
-	cvReleaseImageHeader( &frame_area );
-	cvReleaseImage( &old_frame );
-	cvReleaseImage( &sldr_btn );
-	cvReleaseImage( &oslider );
-	cvReleaseImage( &player );
-	
-	//Release the video
-	cvReleaseCapture( &vid );
-	
-	return( 0 );
-	/*!
-	 * \param argv[1] : Video file path
-	 * \retval 0 Exit without any problem.
-	 * \retval 1 Early exit with due to some error.
-	 * */
-}
+//! Function to get the current position in the video.
+int get_frame_pos();
 
+//! Function to get the timestamp of a frame.
+bool get_frame_time( int frame_no, double* ms );
 
+//! Function to write a time as an SMPTE timecode.
+void format_timecode( double ms, char* text, int size );
 
-//Function to move the custom built slider
-/*!
+//! Function to read a time given as a timecode or in seconds.
+bool parse_time( const char* text, double* ms );
+
+//! Function to go to the frame shown at a given time.
+int seek_time( double ms );
+
+//! Function to update the total number of frames of a streamed input.
+void update_total_frames();
+
+//! Function to allocate a ring of frame buffers.
+void ring_create( Frame_Ring* ring, int size, CvSize frame_size, int depth, int channels );
+
+//! Function to release a ring of frame buffers.
+void ring_release( Frame_Ring* ring );
+
+//! Function to get the buffer holding a given frame number.
+IplImage* ring_slot( Frame_Ring* ring, int frame_no );
+
+//! Function to get the buffer where the next frame is to be written.
+IplImage* ring_next_slot( Frame_Ring* ring );
+
+//! Function to mark the next frame of a ring as written.
+void ring_commit( Frame_Ring* ring );
+
+//! Function to open a streamed input.
+Y4M_Stream* stream_open( const char* filename );
+
+//! Function to read one frame of a streamed input into its history ring.
+bool stream_read( Y4M_Stream* s );
+
+//! Function to fetch the next frame from a streamed input.
+IplImage* stream_query( Y4M_Stream* s );
+
+//! Function to set the position of a streamed input.
+void stream_set_pos( Y4M_Stream* s, int pos );
+
+//! Function to close a streamed input.
+void stream_close( Y4M_Stream** s );
+
+//! Function to handle a key pressed while no textbox is being edited.
+void handle_key( char c, int cur_frame );
+
+//! Function to get the number of CPUs.
+int num_cpus();
+
+//! Function to take threads from the thread budget.
+int threads_take( int wanted );
+
+//! Function to give threads back to the thread budget.
+void threads_release( int n );
+
+//! Function to adjust the mode of the decoder and share out the thread budget.
+void decode_tune( bool reset );
+
+//! Function to write the state of the thread budget as JSON.
+int thread_metrics( char* buf, int size );
+
+//! Function to export a range of frames to images or a video file.
+int export_range( VP_Player* src, int first, int last, int step, const char* pattern, int jobs );
+
+//! Function to start exporting a range of frames in the background.
+bool export_start( int first, int last, int step );
+
+//! Function run by the thread of an export started from the window.
+void* export_thread( void* arg );
+
+//! Function to show the progress of a background export and finish it.
+void export_poll();
+
+//! Function to stop a background export.
+void export_cancel();
+
+//! Function to check an export pattern.
+bool export_pattern_valid( const char* pattern );
+
+//! Function run by every encoder thread of an export.
+void* export_worker( void* arg );
+
+//! Function to show the current frame in the frame area.
+void render_frame( int cur_frame );
+
+//! Function to rebuild the look-up table of the frame difference.
+void build_diff_lut();
+
+//! Function to compute the absolute difference of two rows of pixels.
+void absdiff_u8( const uchar* a, const uchar* b, uchar* dst, int n );
+
+//! Function to zero the values of a row of pixels below a threshold.
+void threshold_u8( uchar* data, int n, int thresh );
+
+//! Function to average two rows of pixels.
+void blend_u8( const uchar* a, const uchar* b, uchar* dst, int n );
+
+//! Function to get the region of the frame to be shown.
+CvRect get_view_rect( CvSize frame_size );
+
+//! Function to zoom the view about a point of the frame area.
+void zoom_at( double factor, int x, int y );
+
+//! Function to show the value of the pixel under the mouse.
+void show_pixel( int x, int y );
+
+//! Function to show ( or request ) the histograms of the current frame.
+void update_histogram( int cur_frame );
+
+//! Function run by the histogram thread.
+void* hist_worker( void* arg );
+
+//! Function to compute the histograms and statistics of an image.
+void compute_histogram( const IplImage* img, int stride, Hist_Entry* e );
+
+//! Function to draw histograms and statistics in the histogram area.
+void draw_histogram( const Hist_Entry* e );
+
+//! Function to start or pause playing.
+void set_playing( bool play );
+
+//! Function to step a number of frames forward or back.
+void step_frames( int k );
+
+//! Function to go to a given frame number.
+void seek_to( int frame_no );
+
+//! Function to show a given frame.
+void show_frame( int frame_no );
+
+//! Function to open the command socket and start accepting clients.
+bool start_command_socket( const char* path );
+
+//! Function run by the thread accepting clients of the command socket.
+void* cmd_listener( void* arg );
+
+//! Function run by the thread reading the commands of a client.
+void* cmd_reader( void* arg );
+
+//! Function to parse a command.
+void parse_command( char* text, Command* cmd );
+
+//! Function to queue a command, waiting while the queue is full.
+void push_command( const Command* cmd );
+
+//! Function to drop a reference to a client.
+void release_client( Cmd_Client* client );
+
+//! Function to execute all the queued commands.
+bool drain_commands();
+
+//! Function to execute a command and reply to its client.
+bool execute_command( Command* cmd );
+
+//! Function to write the counters of the player as JSON.
+int write_metrics( char* buf, int size );
+
+//! Function to write a reply line to a client.
+void send_reply( Cmd_Client* client, const char* text );
+
+//! Function to queue a UI event without waiting.
+bool ui_push( int type, int x, int y, int arg );
+
+//! Function to execute all the queued UI events.
+void drain_ui_events();
+
+//! Function to execute a UI event.
+void execute_ui_event( const UI_Event* ev );
+
+//! Function to note an action of the user for the recorded or replayed session.
+void record_action( int type, int x, int y, int arg );
+
+//! Function to feed the actions of the current tick of a replayed session.
+char replay_tick();
+
+//! Function to record or check the frame displayed at the end of a tick.
+void end_tick( int cur_frame );
+
+//! Function to print the latencies and frame checks of a replayed session.
+void replay_report();
+
+//! Function to compare two latencies, for qsort().
+int compare_ms( const void* a, const void* b );
+
+//! Function to get a buffer from the frame pool.
+Frame_Buf* pool_get( CvSize size, int depth, int channels, bool optional );
+
+//! Function to add a reference to a frame buffer.
+Frame_Buf* frame_ref( Frame_Buf* buf );
+
+//! Function to drop a reference to a frame buffer.
+void frame_unref( Frame_Buf* buf );
+
+//! Function to free the idle buffers of the frame pool.
+void pool_trim( size_t target, int keep_cls );
+
+//! Function to write the counters of the frame pool as JSON.
+int pool_metrics( char* buf, int size );
+
+//! Function to make a copy of a frame the current frame.
+void set_current( const IplImage* img );
+
+//! Function to register a subsystem with the memory governor.
+void mem_register( const char* name, int priority, size_t ( *usage )(), size_t ( *evict )( size_t ) );
+
+//! Function to get the memory used by all the registered subsystems.
+size_t mem_used();
+
+//! Function to evict memory until the budget is met.
+bool mem_enforce( size_t incoming );
+
+//! Function to write the memory usage as JSON.
+int mem_metrics( char* buf, int size );
+
+//! Function to get the size of the idle buffers of the frame pool.
+size_t pool_idle_usage();
+
+//! Function to free idle buffers of the frame pool.
+size_t pool_idle_evict( size_t bytes );
+
+//! Function to get the size of the history window of a streamed input.
+size_t history_usage();
+
+//! Function to get the size of the display images.
+size_t display_usage();
+
+//! Function to get the size of the histogram cache.
+size_t hist_usage();
+
+//! Function to draw the statistics over the frame area.
+void draw_stats();
+
+//! Function to decode the next frame, bypassing the frame cache.
+IplImage* decode_frame();
+
+//! Function to decode the next frame of the video file.
+IplImage* decode_vid();
+
+//! Function to decode the next frame of a VP_Player without copying it.
+IplImage* decode_player( VP_Player* v, IplImage** header );
+
+//! Function to skip frames.
+void skip_frames( int n );
+
+//! Function to keep a frame decoded by the main loop.
+IplImage* keep_decoded( IplImage* img );
+
+//! Function to look up a frame in the frame cache.
+Frame_Buf* cache_lookup( int frame_no );
+
+//! Function to check whether a frame is in the frame cache.
+bool cache_contains( int frame_no );
+
+//! Function to store a copy of a frame in the frame cache.
+Frame_Buf* cache_store( const IplImage* img, int frame_no, double pts_ms, bool prefetched );
+
+//! Function to add a frame buffer to the frame cache.
+Frame_Buf* cache_insert( Frame_Buf* buf, bool prefetched );
+
+//! Function to get the entry of the frame cache farthest from the playhead.
+int cache_farthest( int kind );
+
+//! Function to get the size of one kind of cached frames.
+size_t cache_bytes( int kind );
+
+//! Function to evict one kind of cached frames.
+size_t cache_shrink( int kind, size_t bytes );
+
+//! Function to drop an entry of the frame cache.
+size_t cache_drop( int i );
+
+//! Function to empty the frame cache.
+void cache_clear();
+
+//! Function to get the size of the prefetched frames not displayed yet.
+size_t prefetch_usage();
+
+//! Function to evict prefetched frames not displayed yet.
+size_t prefetch_evict( size_t bytes );
+
+//! Function to get the size of the cached frames.
+size_t cache_usage();
+
+//! Function to evict cached frames.
+size_t cache_evict( size_t bytes );
+
+//! Function to report the displayed frame to the prefetcher.
+void prefetch_note( int pos );
+
+//! Function to list the frames the prefetcher should decode.
+int prefetch_plan( int base, int stride, int ahead, int* targets );
+
+//! The thread prefetching frames.
+void* prefetch_worker( void* arg );
+
+//! Function to decode a given frame with a capture of a background thread.
+IplImage* decode_at( CvCapture* v, int frame_no );
+
+//! Function to write the counters of the frame cache and the prefetcher as JSON.
+int cache_metrics( char* buf, int size );
+
+//! Function to compute the perceptual hash of an image.
+uint64 phash_image( const IplImage* img );
+
+//! Function to start hashing the frames, or to load the sidecar index.
+bool phash_start();
+
+//! Function to stop the hashing threads and release the index.
+void phash_stop();
+
+//! The thread hashing a range of frames.
+void* phash_worker( void* arg );
+
+//! Function to build the multi-index tables.
+void phash_build_tables();
+
+//! Function to load the sidecar index.
+bool phash_load();
+
+//! Function to save the sidecar index.
+bool phash_save();
+
+//! Function to search the frames within a Hamming radius of a hash.
+int phash_search( uint64 h, int radius, int* out );
+
+//! Function to find the frames similar to the current frame.
+int phash_find( int cur_frame, int radius );
+
+//! Function to get the size of the perceptual hash index.
+size_t phash_usage();
+
+//! Function to write the state of the perceptual hash index as JSON.
+int phash_metrics( char* buf, int size );
+
+//! Function to compare two integers, for qsort().
+int compare_int( const void* a, const void* b );
+
+//! Function to draw the activity timeline and the markers on the slider.
+void draw_slider_strip();
+
+//! Function to start the activity thread.
+bool activity_start( const char* video );
+
+//! Function to stop the activity thread and release the timeline.
+void activity_stop();
+
+//! The thread computing the activity of every frame.
+void* activity_worker( void* arg );
+
+//! Function to store the activity of a frame in the pyramid.
+void activity_set( int frame_no, const uchar* values );
+
+//! Function to get the range of a signal over a range of frames.
+bool activity_range( int signal, int first, int last, uchar* lo, uchar* hi );
+
+//! Function to draw the activity timeline.
+void draw_timeline( IplImage* strip );
+
+//! Function to redraw the slider as the activity arrives.
+void update_timeline();
+
+//! Function to get the size of the activity timeline.
+size_t activity_usage();
+
+//! Function to write the progress of the activity timeline as JSON.
+int activity_metrics( char* buf, int size );
+
+//! Function to get the part of the video the slider spans.
+void tl_window( int* first, int* span );
+
+//! Function to zoom the timeline about a point of the slider.
+void tl_zoom( double factor, int x );
+
+//! Function to pan the zoomed timeline.
+void tl_pan( int frames );
+
+//! Function to start the thumbnail thread.
+bool thumb_start( const char* video );
+
+//! Function to stop the thumbnail thread and release the thumbnails.
+void thumb_stop();
+
+//! The thread decoding the thumbnails.
+void* thumb_worker( void* arg );
+
+//! Function to ask for the thumbnails about to be drawn.
+void thumb_want( const int* frames, int n );
+
+//! Function to get a thumbnail if it is ready.
+Frame_Buf* thumb_get( int frame_no );
+
+//! Function to find a thumbnail.
+int thumb_find( int frame_no );
+
+//! Function to evict the thumbnail drawn least recently.
+size_t thumb_drop_lru();
+
+//! Function to get the size of the thumbnails.
+size_t thumb_usage();
+
+//! Function to evict thumbnails for the memory governor.
+size_t thumb_evict( size_t bytes );
+
+//! Function to draw the thumbnails of the zoomed timeline.
+void draw_thumb_strip( int cur_frame );
+
+//! Function to write the state of the zoomed timeline and the thumbnails as JSON.
+int thumb_metrics( char* buf, int size );
+
+//! Function to show or hide the storyboard.
+void board_toggle( int cur_frame );
+
+//! Function to add the tiles of the frames analysed since the last call.
+void board_update();
+
+//! Function to get the layout of the storyboard.
+void board_layout( int* cols, int* rows, int* cell_w, int* cell_h );
+
+//! Function to find the tile of a frame.
+int board_tile( int frame_no );
+
+//! Function to scroll the storyboard.
+void board_scroll( int rows );
+
+//! Function to seek to the tile under the mouse.
+void board_click( int x, int y );
+
+//! Function to draw the storyboard.
+void draw_storyboard( int cur_frame );
+
+//! Function to write the state of the storyboard as JSON.
+int board_metrics( char* buf, int size );
+
+//! Function to add the time taken by a decode to a running average.
+void note_decode( long* avg_us, int64 start );
+
+//! Function to open the inputs of the compare mode and start the decoding threads.
+bool compare_start();
+
+//! Function to stop the decoding threads and close the inputs of the compare mode.
+void compare_stop();
+
+//! The threads decoding the inputs of the compare mode.
+void* compare_worker( void* arg );
+
+//! Function to hand a frame of every input to the decoding threads.
+void compare_dispatch( int frame_no );
+
+//! Function to decode the current frame of every input.
+void compare_sync( int frame_no );
+
+//! Function to draw a frame with the current zoom and pan.
+void compare_view( IplImage* img, CvArr* dst );
+
+//! Function to draw the name and decode time of an input.
+void compare_label( int i, int x, int y, long slowest );
+
+//! Function to draw the inputs of the compare mode.
+void draw_compare( int cur_frame );
+
+//! Function to get the size of the frames of the compare mode.
+size_t compare_usage();
+
+//! Function to write the state of the compare mode as JSON.
+int compare_metrics( char* buf, int size );
+
+//! Function to start comparing the quality of two videos.
+bool quality_start( const char* main_video, const char* other );
+
+//! Function to stop the quality engine and save its results.
+void quality_stop();
+
+//! The threads decoding the videos for the quality engine.
+void* decode_queue_worker( void* arg );
+
+//! Function to take the next decoded frame of a queue.
+Frame_Buf* decode_queue_pop( Decode_Queue* q );
+
+//! The thread comparing the frames of the two videos.
+void* quality_worker( void* arg );
+
+//! Function to compare a pair of frames on the band threads.
+void quality_frame( const IplImage* a, const IplImage* b, int frame_no );
+
+//! The threads comparing the bands of a pair of frames.
+void* quality_band_worker( void* arg );
+
+//! Function to compare a band of 8 rows of a pair of frames.
+void quality_band( const IplImage* a, const IplImage* b, int y0, int rows, Quality_Sums* s, uchar* scratch );
+
+//! Function to split a BGR row into planes and compute its luma.
+void split_bgr_u8( const uchar* src, uchar* b, uchar* g, uchar* r, uchar* y, int n );
+
+//! Function to get the sum of the squared differences of two rows.
+uint64 ssd_u8( const uchar* a, const uchar* b, int n );
+
+//! Function to add a row to the sums of the 8x8 SSIM blocks.
+void ssim_row_u8( const uchar* a, const uchar* b, int groups, int* sums );
+
+//! Function to get the SSIM of an 8x8 block from its sums.
+double ssim_block( const int* sums );
+
+//! Function to write the results of the quality engine to its CSV file.
+bool quality_save();
+
+//! Function to add the frames compared since the last call to the running totals.
+void quality_tally();
+
+//! Function to find the frame with the K-th lowest luma PSNR.
+int quality_worst( int rank );
+
+//! Function to draw the luma PSNR on the slider.
+void draw_quality( IplImage* strip );
+
+//! Function to get the size of the quality engine.
+size_t quality_usage();
+
+//! Function to write the progress of the quality engine as JSON.
+int quality_metrics( char* buf, int size );
+
+//! Function to open a live input and start capturing it.
+Live_Input* live_open( const char* source );
+
+//! Function to stop capturing a live input and release it.
+void live_close( Live_Input** l );
+
+//! Function to grab the next frame of the source of a live input.
+IplImage* live_grab( Live_Input* l );
+
+//! The thread capturing a live input.
+void* live_capture_worker( void* arg );
+
+//! The thread storing the captured frames in the timeshift buffer.
+void* live_buffer_worker( void* arg );
+
+//! Function to fetch the next frame from the timeshift buffer.
+IplImage* live_query( Live_Input* l );
+
+//! Function to set the position of the display in the timeshift buffer.
+void live_set_pos( Live_Input* l, int pos );
+
+//! Function to get the oldest frame held by the timeshift buffer.
+int live_oldest( Live_Input* l );
+
+//! Function to get the size of the timeshift buffer.
+size_t live_usage();
+
+//! Function to write the counters of the live input as JSON.
+int live_metrics( char* buf, int size );
+
+//! Function to show the name of the file in the control pannel.
+void show_file_name( const char* filename );
+
+//! Function to show the properties of the video in the control pannel.
+void show_properties();
+
+//! Function to start the prefetch thread.
+void prefetch_start( const char* video );
+
+//! Function to stop the prefetch thread.
+void prefetch_stop();
+
+//! Function to open a capture for a background thread.
+CvCapture* open_capture( const char* video );
+
+//! Function to add a file, or the files of a directory, to the playlist.
+void playlist_add( const char* path );
+
+//! Function to start opening the files of the playlist in advance.
+void playlist_start();
+
+//! Function to stop the playlist thread and close the files opened in advance.
+void playlist_stop();
+
+//! The thread opening the files of the playlist in advance.
+void* playlist_worker( void* arg );
+
+//! Function to open a file of the playlist, probe it and decode its first frames.
+void playlist_open( const char* path, Preopen* p );
+
+//! Function to close a file opened in advance.
+void playlist_release( Preopen* p );
+
+//! Function to return the memory held by the first frames of the files opened in advance.
+size_t playlist_usage();
+
+//! Function to drop the first frames of the files opened in advance.
+size_t playlist_evict( size_t bytes );
+
+//! Function to switch to another file of the playlist.
+bool playlist_switch( int index );
+
+//! Function to go to the next or the previous file of the playlist which can be played.
+bool playlist_step( int dir );
+
+//! Function to write the state of the playlist as JSON.
+int playlist_metrics( char* buf, int size );
+
+//! Function to compare two markers, for qsort().
+int compare_marker( const void* a, const void* b );
+
+//! Function to get the index of a marker label, adding it if needed.
+int marker_label( const char* label );
+
+//! Function to add a marker.
+bool marker_add( int first, int last, int label );
+
+//! Function to merge the markers added since the last lookup with the sorted ones.
+void marker_sort();
+
+//! Function to find the first marker starting at or after a frame.
+int marker_lower( int frame );
+
+//! Function to find the next or the previous marker.
+int marker_find( int frame, int dir );
+
+//! Function to remove the markers over a frame.
+int marker_remove( int frame );
+
+//! Function to go to the next or the previous marker.
+bool marker_jump( int dir );
+
+//! Function to count the markers over every column of the slider.
+const int* marker_bins( int first, int span );
+
+//! Function to write an unsigned LEB128 number.
+bool put_varint( FILE* fp, unsigned int v );
+
+//! Function to read an unsigned LEB128 number.
+bool get_varint( FILE* fp, unsigned int* v );
+
+//! Function to add the markers of a file.
+int marker_read( const char* path );
+
+//! Function to write the markers to a file.
+bool marker_write( const char* path );
+
+//! Function to load the markers of a video from its sidecar file.
+void markers_open( const char* video );
+
+//! Function to save the markers, if modified, and release them.
+void markers_close();
+
+//! Function to get the size of the markers.
+size_t marker_usage();
+
+//! Function to write the state of the markers as JSON.
+int marker_metrics( char* buf, int size );
+
+//! Function to set the stages of the filter pipeline.
+bool parse_filters( const char* spec );
+
+//! Function to find a filtered frame among the frames kept.
+bool filter_lookup( int frame_no, IplImage* dst );
+
+//! Function to filter the visible region of the current frame into the display image.
+void filter_frame( int frame_no, IplImage* src, IplImage* dst, bool pixel_level );
+
+//! Function to run a stage of the filter pipeline on the filter threads.
+void filter_stage( Filter_Stage* s, const CvMat* src, const CvMat* dst );
+
+//! The threads filtering the tiles of a stage.
+void* filter_worker( void* arg );
+
+//! Function to filter a tile of rows.
+void filter_tile( const Filter_Stage* s, const CvMat* src, const CvMat* dst, int y0, int rows, uchar* scratch );
+
+//! Function to drop the filtered frames kept.
+void filter_flush();
+
+//! Function to stop the filter threads and release the frames kept.
+void filter_stop();
+
+//! Function to get the size of the filtered frames kept.
+size_t filter_usage();
+
+//! Function to write the state of the filter pipeline as JSON.
+int filter_metrics( char* buf, int size );
+
+/*
+width 		840 (display)
+height		480(display) + 10(slider) + 200(ctrl pnl)	
+*/
+//Main function
+//argv[1]	:	video-file path
+/*! The main function creates the main image and various sub-images that constitute the video player. Once this outline is ready, frames from the video are fetched and displayed on the sub-image denoting the "screen area". Simultaneously, contents of other sub-image (frame number, slider position) are also updated.
+ */
+int main( int argc, char** argv ){
+
+	//Parse the arguments
+	/*! The arguments are parsed first. Apart from the video file path, the options for streamed input are read here. A path "-" stands for stdin.
+	 * */
+	char* filename = NULL;
+	for( int i=1; i<argc; i++ ){
+		if( !strcmp( argv[i], "--raw" ) && i+1<argc ){
+			if( sscanf( argv[++i], "%dx%d", &raw_width, &raw_height )!=2 || raw_width<2 || raw_height<2 ){
+				printf( "Invalid raw frame size : %s\n", argv[i] );
+				return( 1 );
+			}
+		}
+		else if( !strcmp( argv[i], "--fps" ) && i+1<argc ){
+			if( !option_real( argv[i], argv[i+1], 0.001, 1e6, &raw_fps ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--pix-fmt" ) && i+1<argc ){
+			if( !parse_pix_fmt( argv[++i], &raw_chroma, &raw_bits ) ){
+				printf( "Unsupported pixel format : %s\n", argv[i] );
+				return( 1 );
+			}
+		}
+		else if( !strcmp( argv[i], "--window" ) && i+1<argc ){
+			if( !option_real( argv[i], argv[i+1], 0, 1e6, &wl_window ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--level" ) && i+1<argc ){
+			if( !option_real( argv[i], argv[i+1], -1e6, 1e6, &wl_level ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--live" ) ){
+			live_mode = true;
+		}
+		else if( !strcmp( argv[i], "--live-minutes" ) && i+1<argc ){
+			if( !option_real( argv[i], argv[i+1], 0.01, 1e6, &live_minutes ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--live-mb" ) && i+1<argc ){
+			if( !option_int( argv[i], argv[i+1], 1, INT_MAX, &live_mb ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--history" ) && i+1<argc ){
+			if( !option_int( argv[i], argv[i+1], 2, INT_MAX, &stream_history ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--export" ) && i+1<argc ){
+			if( sscanf( argv[++i], "%d:%d", &export_in, &export_out )!=2 || export_in<0 || export_out<export_in ){
+				printf( "Invalid export range : %s\n", argv[i] );
+				return( 1 );
+			}
+			headless = true;
+			export_only = true;
+		}
+		else if( !strcmp( argv[i], "--socket" ) && i+1<argc ){
+			cmd_socket_path = argv[++i];
+		}
+		else if( !strcmp( argv[i], "--commands" ) && i+1<argc ){
+			if( strcmp( argv[++i], "-" )!=0 ){
+				printf( "Commands can only be read from stdin ( --commands - )\n" );
+				return( 1 );
+			}
+			cmd_stdin = true;
+		}
+		else if( !strcmp( argv[i], "--headless" ) ){
+			headless = true;
+		}
+		else if( !strcmp( argv[i], "--pool-mb" ) && i+1<argc ){
+			int mb;
+			if( !option_int( argv[i], argv[i+1], 1, INT_MAX, &mb ) ){
+				return( 1 );
+			}
+			frame_pool.ceiling = ( size_t )mb<<20;
+			i++;
+		}
+		else if( !strcmp( argv[i], "--no-timeline" ) ){
+			timeline_off = true;
+		}
+		else if( !strcmp( argv[i], "--phash" ) ){
+			phash_at_start = true;
+		}
+		else if( !strcmp( argv[i], "--compare" ) && i+1<argc ){
+			if( compare.count==COMPARE_MAX ){
+				printf( "At most %d videos can be compared\n", COMPARE_MAX );
+				return( 1 );
+			}
+			compare.count = MAX( compare.count, 1 );
+			compare.inputs[ compare.count++ ].path = argv[++i];
+		}
+		else if( !strcmp( argv[i], "--quality" ) && i+1<argc ){
+			quality.out_path = argv[++i];
+		}
+		else if( !strcmp( argv[i], "--board-interval" ) && i+1<argc ){
+			if( !option_real( argv[i], argv[i+1], 0.1, 1e6, &board_seconds ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--prefetch" ) && i+1<argc ){
+			if( !option_int( argv[i], argv[i+1], 0, FRAME_CACHE_SIZE/2, &prefetch.depth ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--mem-budget" ) && i+1<argc ){
+			int mb;
+			if( !option_int( argv[i], argv[i+1], 1, INT_MAX, &mb ) ){
+				return( 1 );
+			}
+			mem_gov.budget = ( size_t )mb<<20;
+			i++;
+		}
+		else if( !strcmp( argv[i], "--record" ) && i+1<argc ){
+			if( !( session.rec = fopen( argv[++i], "w" ) ) ){
+				printf( "Cannot write the session file : %s\n", argv[i] );
+				return( 1 );
+			}
+		}
+		else if( !strcmp( argv[i], "--replay" ) && i+1<argc ){
+			if( !( session.replay = fopen( argv[++i], "r" ) ) ){
+				printf( "Cannot read the session file : %s\n", argv[i] );
+				return( 1 );
+			}
+			headless = true;
+		}
+		else if( !strcmp( argv[i], "--export-to" ) && i+1<argc ){
+			export_pattern = argv[++i];
+		}
+		else if( !strcmp( argv[i], "--step" ) && i+1<argc ){
+			if( !option_int( argv[i], argv[i+1], 1, INT_MAX, &step_val ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--jobs" ) && i+1<argc ){
+			if( !option_int( argv[i], argv[i+1], 0, INT_MAX, &export_jobs ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--diff-threshold" ) && i+1<argc ){
+			if( !option_int( argv[i], argv[i+1], 0, 255, &diff_threshold ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--filter" ) && i+1<argc ){
+			if( !parse_filters( argv[++i] ) ){
+				printf( "Invalid filters : %s\n", argv[i] );
+				return( 1 );
+			}
+		}
+		else if( !strcmp( argv[i], "--filter-full" ) ){
+			filters.full = true;
+		}
+		else if( !strcmp( argv[i], "--threads" ) && i+1<argc ){
+			if( !option_int( argv[i], argv[i+1], 1, INT_MAX, &threads.total ) ){
+				return( 1 );
+			}
+			i++;
+		}
+		else if( !strcmp( argv[i], "--prefetch-mode" ) && i+1<argc ){
+			i++;
+			if( !strcmp( argv[i], "ahead" ) ){
+				threads.mode_set = DECODE_AHEAD;
+			}
+			else if( !strcmp( argv[i], "demand" ) ){
+				threads.mode_set = DECODE_DEMAND;
+			}
+			else if( strcmp( argv[i], "auto" ) ){
+				printf( "Invalid prefetch mode : %s\n", argv[i] );
+				return( 1 );
+			}
+		}
+		else{
+			playlist_add( argv[i] );
+		}
+	}
+	if( threads.total<=0 ){
+		threads.total = num_cpus();
+	}
+	filename = playlist.count ? playlist.paths[0] : NULL;
+	if( cmd_stdin && filename && !strcmp( filename, "-" ) ){
+		printf( "stdin cannot carry both the video and the commands\n" );
+		return( 1 );
+	}
+	if( live_mode && ( export_only || compare.count ) ){
+		printf( "--live cannot be combined with --export or --compare\n" );
+		return( 1 );
+	}
+	if( playlist.count>1 && ( live_mode || export_only ) ){
+		printf( "Several videos cannot be combined with --live or --export\n" );
+		return( 1 );
+	}
+	//a playlist is made of video files, which a stream cannot be switched to and from
+	for( int i=0; i<playlist.count && playlist.count>1; i++ ){
+		if( !strcmp( playlist.paths[i], "-" ) ){
+			printf( "stdin cannot be played along with other videos\n" );
+			return( 1 );
+		}
+	}
+	//a comparison of quality alone needs neither the timeline nor the prefetcher
+	if( headless && quality.out_path && !export_only && !cmd_socket_path && !cmd_stdin && !session.replay ){
+		quality_only = true;
+		timeline_off = true;
+		prefetch.depth = 0;
+	}
+	if( headless && !export_only && !quality_only && !cmd_socket_path && !cmd_stdin && !session.replay ){
+		printf( "--headless needs --socket or --commands\n" );
+		return( 1 );
+	}
+	if( !filename ){
+		printf( "Usage : %s [--live] [--live-minutes M] [--live-mb N] [--raw WxH] [--pix-fmt F] [--fps FPS] [--window W] [--level L] [--history N] [--step N] [--export FIRST:LAST] [--export-to PATTERN] [--jobs N] [--diff-threshold N] [--filter F1,F2...] [--filter-full] [--threads N] [--prefetch-mode ahead|demand|auto] [--socket PATH] [--commands -] [--headless] [--record FILE] [--replay FILE] [--pool-mb N] [--mem-budget N] [--prefetch N] [--phash] [--no-timeline] [--board-interval S] [--compare FILE]... [--quality CSV] video-file|directory|-...\n", argv[0] );
+		return( 1 );
+	}
+
+	//Initialize the font
+	/*! Before starting to initialize the various sub-images, the fonts to be used need to be initialized. The fonts are initialized using the <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=initfont#cvInitFont" target="_blank"><b>cvInitFont()</b></a> function.
+	 * */
+	cvInitFont( &font, font_face, hscale, vscale, shear, thickness, line_type );
+	cvInitFont( &font_italic, font_face_italic, hscale, vscale, shear, thickness, line_type );
+	cvInitFont( &font_bold, font_face, hscale, vscale, shear, thickness+1, line_type );
+	cvInitFont( &font_bold_italic, font_face_italic, hscale, vscale, shear, thickness+1, line_type );
+	cvInitFont( &font_small, font_face, 0.35, 0.35, shear, thickness, line_type );
+	
+	//Create the player image
+	/*! This is followed by the creation of an empty image (which serves as the main image of the player). The \a player image is created using the various dimensions shown earlier.
+	 * */
+	player = cvCreateImage( cvSize( p_width, p_height ), IPL_DEPTH_8U, 3 );
+	
+	//Create Control Pannel
+	/*! Then the control-pannel sub-image is assigned as a part of the main \a player image.
+	 * */
+	pnl = cvCreateImageHeader( cvSize( p_width, ctrl_pnl_height ), IPL_DEPTH_8U, 3 );
+	pnl->origin = player->origin;
+	pnl->widthStep = player->widthStep;
+	pnl->imageData = player->imageData + ( p_height - ctrl_pnl_height )*player->widthStep;
+	fill_image( pnl, cvScalar( 226, 235, 240 ) );
+	//Add text & buttons
+	/*! All the buttons, textboxes, static-texts, etc are initialized.
+	 * */
+	initialize_pnl( filename );
+	
+	//create custom slider (non-opencv)
+	/*! Above the control-pannel, a sub-image is assigned to be a slider. OpenCV has an inbuilt function <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=createtrackbar#cvCreateTrackbar" target="_blank"><b>cvCreateTrackbar()</b></a> to create a slider. But the disadvantage with this function is, the slider is placed at either at the top or the buttom of an image in a window. Therefore, to have the slider at a custom location in the window, I created my own slider. Practically, this slider is a sub-image to which I have assigned a mouse_callback function. Setting the ROI to this sub-image was possible, but then simultaneously accessing all the sub-images would not had been possible. Therefore, the slider sub-image is created by first creating the sub-image of the required dimensions and then setting the origin, widthstep to be the same as that of the main image and the imageData to the appropriate value of imageData of the main image. Everytime the slider position is updated, the original slider needs to be restored first and then the new position is to be marked. Therefore, the original slider sub-image is cloned to \a oslider sub-image. \a sldr_val sub-image is nothing but a rectangular image at a position derived from the slider's value. Thus, every time the slider's value is updated, the original slider sub-image ( \a oslider ) is restored, followed by placing the \a sldr_val sub-image at it appropriate position on the slider.
+	 * */
+	slider = cvCreateImageHeader( cvSize( p_width, 10 ), IPL_DEPTH_8U, 3 );
+	slider->origin = player->origin;
+	slider->widthStep = player->widthStep;
+	slider->imageData = player->imageData + ( p_height - sldr_height - ctrl_pnl_height )*player->widthStep;
+	fill_image( slider, cvScalar( 94, 118, 254 ) );
+	oslider = cvCloneImage( slider );
+	slider_base = cvCloneImage( slider );
+	sldr_btn = cvCreateImage( cvSize( 15, sldr_height ), IPL_DEPTH_8U, 3 );
+	fill_image( sldr_btn, cvScalar( 100, 150, 100 ) );
+	sldr_val = cvCreateImageHeader( cvSize( sldr_btn_width, sldr_height ), IPL_DEPTH_8U, 3 );
+	sldr_val->origin = slider->origin;
+	sldr_val->widthStep = slider->widthStep;
+	sldr_val->imageData = slider->imageData;
+	cvCopy( sldr_btn, sldr_val );
+	
+	//display window
+	/*!
+	 * The main player images needs to be displayed using a <i>Named Window</i>. Using the <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=namedwindow#cvNamedWindow" target="_blank"><b>cvNamedWindow()</b></a> function we create a display window.
+	 * */
+	if( !headless ){
+		cvNamedWindow( "Video Player", CV_WINDOW_AUTOSIZE );
+
+		//install mouse callback
+		/*!
+		 * Everytime a mouse action ( move, click, etc ) occurs on the main display window, the events need to be captured and appropriate actions are to be called. For achieveing this task the <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=setmousecallback#cvSetMouseCallback" target="_blank"><b>cvSetMouseCallback()</b></a> function is used.
+		 * */
+		cvSetMouseCallback(
+			"Video Player",
+			my_mouse_callback,
+			( void* )NULL
+		);
+	}
+	
+	
+	//load the video
+	/*!
+	 * Now that we are ready with the video-player's outline, the video file should be loaded. This is achieved using the <a href="http://opencv.willowgarage.com/documentation/c/highgui_reading_and_writing_images_and_video.html?highlight=capture#cvCaptureFromFile" target="_blank"><b>cvCaptureFromFile()</b></a> function. The next task is to access various properties of this video and then display them at appropriate locations on the \a Control Pannel. To access the video properites <a href="http://opencv.willowgarage.com/documentation/c/highgui_reading_and_writing_images_and_video.html?highlight=cvgetcaptureproperty#cvGetCaptureProperty" target="_blank"><b>cvGetCaptureProperty()</b></a> function is used.
+	 * */
+	/*!
+	 * Input arriving over a pipe, from stdin or from a <em>.y4m</em> file cannot be handled by <b>cvCaptureFromFile()</b> without seeking. Such input is opened as a Y4M_Stream using stream_open() instead. The total number of frames of a stream is not known until its end is reached, therefore \a sldr_maxval then grows with the frames received.
+	 * */
+	/*!
+	 * With <em>--live</em> the input is captured while it is being watched: a camera, a pipe or a video replayed at its frame rate is opened by live_open(), which starts the capture and buffer threads, and the main loop only displays the timeshift buffer ( see Live_Input ).
+	 * */
+	if( live_mode ){
+		live = live_open( filename );
+	}
+	else if( playlist.count>1 ){
+		//like playlist_step(), the files which cannot be played are passed over
+		for( int i=0; i<playlist.count && !vid; i++ ){
+			VP_Properties props;
+			if( !( vid = vp_open( playlist.paths[i] ) ) || vp_get_properties( vid, &props )!=VP_OK || props.frames<1 ){
+				printf( "Cannot play %s\n", playlist.paths[i] );
+				vp_close( vid );
+				vid = NULL;
+				continue;
+			}
+			playlist.cur = i;
+			filename = playlist.paths[i];
+			show_file_name( filename );
+		}
+	}
+	else if( !( stream = stream_open( filename ) ) ){
+		vid = vp_open( filename );
+	}
+	//check the video
+	if( !vid && !stream && !live ){
+		printf( "Error loading the video file. Either missing file or codec not installed\n" );
+		return( 1 );
+	}
+	frame_area = cvCreateImageHeader( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 3 );
+	frame_area->origin = player->origin;
+	frame_area->widthStep = player->widthStep;
+	frame_area->imageData = player->imageData;
+	disp_cur = cvCreateImage( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 3 );
+	disp_prev = cvCreateImage( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 3 );
+	cvZero( disp_prev );
+	diff_img = cvCreateImage( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 3 );
+	gray_cur = cvCreateImage( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 1 );
+	gray_prev = cvCreateImage( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 1 );
+	diff_gray = cvCreateImage( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 1 );
+	diff_lut = cvCreateMat( 1, 256, CV_8UC3 );
+	build_diff_lut();
+	if( live ){
+		fps = live->fps;
+		sldr_start = 0;
+		sprintf( four_cc_str, "DVR" );
+		sldr_maxval = 1;
+		length_known = false;
+	}
+	else if( stream ){
+		fps = stream->fps;
+		sldr_start = 0;
+		sprintf( four_cc_str, "%s", stream->is_y4m ? "Y4M" : "I420" );
+		sldr_maxval = 1;
+		length_known = false;
+	}
+	else{
+		VP_Properties props;
+		vp_get_properties( vid, &props );
+		fps = props.fps;
+		sldr_start = props.start;
+		sprintf( four_cc_str, "%s", props.fourcc );
+		//printf( "FPS : %f\n", fps );
+		sldr_maxval = props.frames; //check this property
+		if( sldr_maxval<1 ){
+			printf( "Number of frames < 1. Cannot continue...\n" );
+			return( 1 );
+		}
+		play_pos = sldr_start;
+	}
+	if( fps<=0 ){
+		fps = 25;
+	}
+	/*!
+	 * The prefetcher of a video file takes its thread from the thread budget, and OpenCV gets the threads left, see Thread_Budget.
+	 * */
+	if( vid ){
+		decode_tune( true );
+	}
+	/*!
+	 * A streamed input of more than 8 bits per sample is displayed through the window / level table, see build_wl_lut().
+	 * */
+	if( stream || ( live && live->stream ) ){
+		native_bits = ( stream ? stream : live->stream )->bits;
+	}
+	build_wl_lut();
+	show_properties();
+	moveSlider( sldr_start, OTHER_CALLS );
+
+	/*!
+	 * With <em>--export</em> no window is shown. The requested range is exported using export_range() and the program exits.
+	 * */
+	if( export_only ){
+		int64 start = cvGetTickCount();
+		int written = export_range( NULL, export_in, export_out, step_val, export_pattern, export_jobs );
+		double secs = ( cvGetTickCount() - start )/( cvGetTickFrequency()*1e6 );
+		printf( "Exported %d frames in %.2f s ( %.1f frames/s )\n", written, secs, written/MAX( secs, 1e-6 ) );
+		vp_close( vid );
+		stream_close( &stream );
+		return( written>0 ? 0 : 1 );
+	}
+	
+	/*!
+	 * If proper codecs are installed and the video consists of atleast one frame, then <a href="http://opencv.willowgarage.com/documentation/c/highgui_reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a> should return the initial frame in the video. If no frame is returned then there must be some problem either with the codecs or the video itself. In such a case, the program is halted with an appropriate error message. If everything goes fine, then the currently grabbed frame is stored into \a old_frame.
+	 * */
+	frame = query_frame();
+	if( !frame ){
+		printf( "Cannot load video. Missing Codec : %s\n", four_cc_str );
+		return( 1 );
+	}
+	set_current( frame );
+	if( !headless ){
+		cvShowImage( "Video Player", player );
+	}
+
+	/*!
+	 * The histograms of the displayed frames are computed by a separate thread so that the playback timing is not affected. The frames are subsampled with a regular stride such that at most #HIST_SAMPLES pixels are used.
+	 * */
+	hist_cache = ( Hist_Entry* )malloc( HIST_CACHE_SIZE*sizeof( Hist_Entry ) );
+	for( int i=0; i<HIST_CACHE_SIZE; i++ ){
+		hist_cache[i].frame_no = -1;
+	}
+	hist_stride = MAX( cvCeil( sqrt( old_frame->width*( double )old_frame->height/HIST_SAMPLES ) ), 1 );
+	pthread_create( &hist_thread, NULL, hist_worker, NULL );
+
+	/*!
+	 * Every subsystem holding frames or other large buffers registers with the memory governor, which keeps their total under <em>--mem-budget</em>. The frame pool never holds more than the budget either.
+	 * */
+	if( mem_gov.budget && frame_pool.ceiling>mem_gov.budget ){
+		frame_pool.ceiling = mem_gov.budget;
+	}
+	mem_register( "pool idle", MEM_PRIO_IDLE, pool_idle_usage, pool_idle_evict );
+	mem_register( "display", MEM_PRIO_FIXED, display_usage, NULL );
+	mem_register( "history", MEM_PRIO_FIXED, history_usage, NULL );
+	mem_register( "histograms", MEM_PRIO_FIXED, hist_usage, NULL );
+	//the filters can be turned on at any time by a command, their threads start then
+	mem_register( "filters", MEM_PRIO_FIXED, filter_usage, NULL );
+	if( live ){
+		mem_register( "live buffer", MEM_PRIO_FIXED, live_usage, NULL );
+	}
+
+	/*!
+	 * The frames of a CvCapture are kept in the frame cache. The prefetch thread decodes the frames predicted to be requested next into it, using a second CvCapture opened on the same file ( see Prefetcher ).
+	 * */
+	if( vid ){
+		mem_register( "prefetch", MEM_PRIO_PREFETCH, prefetch_usage, prefetch_evict );
+		mem_register( "frame cache", MEM_PRIO_CACHE, cache_usage, cache_evict );
+		prefetch_start( filename );
+		phash.video = filename;
+		if( phash_at_start ){
+			phash_start();
+		}
+		if( !timeline_off ){
+			activity_start( filename );
+		}
+		thumb_start( filename );
+	}
+	/*!
+	 * The frame markers set the last time the video was reviewed are loaded from its sidecar file ( see Marker_Store ).
+	 * */
+	markers_open( filename );
+	mem_register( "markers", MEM_PRIO_FIXED, marker_usage, NULL );
+	/*!
+	 * With several videos, or a directory, the playlist thread opens the files next to the current one in advance ( see Playlist ); <em>n</em> and <em>p</em> switch to them.
+	 * */
+	playlist_start();
+	/*!
+	 * With <em>--compare</em> the other inputs are opened, each with its own CvCapture, and decoded by a pool of threads along with the main video ( see Compare ).
+	 * */
+	if( compare.count ){
+		compare.inputs[0].path = filename;
+		if( !compare_start() ){
+			return( 1 );
+		}
+	}
+	/*!
+	 * With <em>--quality</em> the main video and the first <em>--compare</em> input are compared frame by frame in the background ( see Quality ). Without a window and commands, the player waits for the comparison to finish, reports it and exits.
+	 * */
+	if( quality.out_path ){
+		if( compare.count<2 ){
+			printf( "--quality needs --compare\n" );
+			return( 1 );
+		}
+		if( !quality_start( filename, compare.inputs[1].path ) ){
+			return( 1 );
+		}
+	}
+	if( quality_only ){
+		while( !__atomic_load_n( &quality.finished, __ATOMIC_ACQUIRE ) ){
+			usleep( 100000 );
+		}
+		int done = __atomic_load_n( &quality.done, __ATOMIC_ACQUIRE );
+		printf( "Compared %d frames in %.2f s ( %.1f frames/s ), written to %s\n", done, quality.secs, done/MAX( quality.secs, 1e-6 ), quality.out_path );
+		if( quality.mismatch ){
+			printf( "The videos differ in size or format\n" );
+		}
+	}
+
+	/*!
+	 * Scripts may drive the player through a Unix-domain socket ( <em>--socket</em> ) or stdin ( <em>--commands -</em> ). The commands are read by separate threads but executed by the main loop, between two frames, exactly like the mouse actions. With <em>--headless</em> no window is shown and the player is driven by the commands alone.
+	 * */
+	signal( SIGPIPE, SIG_IGN );
+	if( cmd_socket_path && !start_command_socket( cmd_socket_path ) ){
+		return( 1 );
+	}
+	if( cmd_stdin ){
+		Cmd_Client* client = ( Cmd_Client* )calloc( 1, sizeof( Cmd_Client ) );
+		client->in_fd = 0;
+		client->out_fd = 1;
+		client->refs = 1;
+		pthread_t reader;
+		pthread_create( &reader, NULL, cmd_reader, client );
+		pthread_detach( reader );
+	}
+	
+	/*!
+	 * Now we come to the task where a frame is grabbed and displayed on the screen. If the player is in <i>play mode</i> ( i.e. \a player is set to true ) then frames are grabbed sequentially at an interval derived from the \a FPS value. The grabbed frame is then resized to the screen_area and displayed to the viewes.
+	 * */
+	/*!
+	 * With <em>--record</em> every action of the user is written to a session file, and with <em>--replay</em> such a file is played back without a window. The replay checks the frame displayed after every action and reports how long the actions took, see Session_Log.
+	 * */
+	char c;
+	int cur_frame;
+	session.start = cvGetTickCount();
+	session.expect_frame = -1;
+	if( session.rec ){
+		fprintf( session.rec, "# video_player session : %s, step %d\n", filename, step_val );
+	}
+	//a live input starts with its newest frame
+	if( live ){
+		set_playing( true );
+	}
+	while( !quality_only ){
+		//commands are executed at machine speed, without waiting for the next frame time
+		pthread_mutex_lock( &cmd_queue.lock );
+		int delay = ( cmd_queue.count>0 ) ? 1 : MAX( ( int )( 1000/fps ), 1 );
+		pthread_mutex_unlock( &cmd_queue.lock );
+		engine.tick++;
+		if( session.replay ){
+			c = replay_tick();
+			if( session.done ){
+				break;
+			}
+		}
+		else if( headless ){
+			usleep( delay*1000 );
+			c = -1;
+		}
+		else if( ( c = cvWaitKey( delay ) )==27 ){
+			break;
+		}
+		//the mouse actions queued while waiting, then the scripted commands
+		drain_ui_events();
+		if( !drain_commands() ){
+			break;
+		}
+		if( engine.playing ){
+			skip_frames( step_val - 1 );
+			frame = query_frame();
+			if( frame ){
+				set_current( frame );
+			}
+			//a live input has just not captured the next frame yet
+			else if( !live || length_known ){
+				engine.playing = false;
+			}
+		}
+		//the position is counted from the decoded frames, the capture is not queried for it
+		cur_frame = MAX( get_frame_pos(), 0 );
+		if( vid ){
+			decode_tune( false );
+		}
+		export_poll();
+		if( !length_known ){
+			update_total_frames();
+		}
+		if( c!=-1 ){
+			record_action( UI_KEY, 0, 0, ( uchar )c );
+		}
+		//defines the task to be carried out when editing a text-field
+		if( typing_step ){
+			type_step( c, cur_frame );
+		}
+		else{
+			handle_key( c, cur_frame );
+		}
+		//this takes care if for some reason the cur_frame overshoots the sldr_maxval.
+		if( length_known && cur_frame == ( sldr_maxval-1 ) ){
+			getButton( play_pause_btn, PLAY_BTN, BTN_ACTIVE );
+			sprintf( status_line, "End reached" );
+			change_status();
+		}
+		if( board.shown ){
+			draw_storyboard( cur_frame );
+		}
+		else{
+			render_frame( cur_frame );
+			draw_compare( cur_frame );
+			draw_thumb_strip( cur_frame );
+		}
+		if( show_stats ){
+			draw_stats();
+		}
+		update_histogram( cur_frame );
+		update_timeline();
+		//printf( "Current frame : %d\n", cur_frame );
+		moveSlider( cur_frame, OTHER_CALLS );
+		end_tick( cur_frame );
+		prefetch_note( get_frame_pos() );
+		mem_enforce( 0 );
+		if( !headless ){
+			cvShowImage( "Video Player", player );
+		}
+	}
+	
+	/*!
+	 * Finally, cleaning up is done by destroying all the open windows and releasing all the images and sub-images.
+	 * */
+	//destory window
+	if( !headless ){
+		cvDestroyWindow( "Video Player" );
+	}
+	if( cmd_listen_fd>=0 ){
+		close( cmd_listen_fd );
+		unlink( cmd_socket_path );
+	}
+	int status = 0;
+	if( session.rec ){
+		fprintf( session.rec, "%ld %.3f end\n", engine.tick, ( cvGetTickCount() - session.start )/( cvGetTickFrequency()*1e3 ) );
+		fclose( session.rec );
+	}
+	if( session.replay ){
+		replay_report();
+		status = ( session.mismatches>0 ) ? 1 : 0;
+		fclose( session.replay );
+		for( int i=0; i<=UI_KEY; i++ ){
+			free( session.samples[i] );
+		}
+	}
+
+	//stop the histogram thread
+	pthread_mutex_lock( &hist_lock );
+	hist_quit = true;
+	pthread_cond_signal( &hist_cond );
+	pthread_mutex_unlock( &hist_lock );
+	pthread_join( hist_thread, NULL );
+	free( hist_cache );
+	if( hist_buf ){
+		frame_unref( hist_buf );
+	}
+
+	//stop the background export and the prefetch thread
+	export_cancel();
+	prefetch_stop();
+	cache_clear();
+	frame_unref( fetched_buf );
+	markers_close();
+	phash_stop();
+	activity_stop();
+	thumb_stop();
+	free( board.frames );
+	quality_stop();
+	compare_stop();
+	playlist_stop();
+	filter_stop();
+	
+	//Release image
+	cvReleaseImageHeader( &hist_area );
+	cvReleaseImageHeader( &pixel_info );
+	cvReleaseImageHeader( &export_btn );
+	cvReleaseImageHeader( &stepdown_btn );
+	cvReleaseImageHeader( &stepup_btn );
+	cvReleaseImageHeader( &stop_btn );
+	cvReleaseImageHeader( &play_pause_btn );
+	cvReleaseImageHeader( &step_edit );
+	cvReleaseImageHeader( &four_cc_edit );
+	cvReleaseImageHeader( &fps_edit );
+	cvReleaseImageHeader( &numFrames );
+	cvReleaseImageHeader( &cur_frame_no );
+	cvReleaseImageHeader( &time_code );
+	cvReleaseImageHeader( &pnl );
+	cvReleaseImageHeader( &sldr_val );
+	cvReleaseImageHeader( &slider );
+	cvReleaseImageHeader( &frame_area );
+	frame_unref( cur_buf );
+	cvReleaseImage( &disp_cur );
+	cvReleaseImage( &disp_prev );
+	if( disp_native ){
+		cvReleaseImage( &disp_native );
+	}
+	cvReleaseImage( &diff_img );
+	cvReleaseImage( &gray_cur );
+	cvReleaseImage( &gray_prev );
+	cvReleaseImage( &diff_gray );
+	cvReleaseMat( &diff_lut );
+	cvReleaseImage( &sldr_btn );
+	cvReleaseImage( &oslider );
+	cvReleaseImage( &slider_base );
+	cvReleaseImage( &player );
+	
+	//Release the video
+	vp_close( vid );
+	cvReleaseImageHeader( &decoded );
+	stream_close( &stream );
+	live_close( &live );
+	pool_trim( 0, -1 );
+	
+	return( status );
+	/*!
+	 * \param argv[1] : Video file path, or "-" to read a Y4M ( or raw I420 ) stream from stdin; with --live also a camera ( N or /dev/videoN ).
+	 * \param argv[2]... : More video files, or directories, make a playlist played one after the other ( <em>n</em> and <em>p</em> keys ).
+	 * \param --live : Capture the input while watching it, keeping its last minutes in memory to pause, step back and scrub.
+	 * \param --live-minutes M : Minutes of a live input kept in memory.
+	 * \param --live-mb N : Maximum memory of the frames of a live input kept in MB.
+	 * \param --raw WxH : The streamed input is raw I420 of the given size instead of Y4M.
+	 * \param --pix-fmt F : Format of raw input: <em>yuv420p</em> ( default ), <em>gray</em>, or either with 9 to 16 bits per sample, e.g. <em>gray16le</em> or <em>yuv420p10le</em>.
+	 * \param --window W : Width of the range of samples shown from black to white.
+	 * \param --level L : Centre of that range.
+	 * \param --fps FPS : Frame rate of raw I420 input, or of a camera which does not report it.
+	 * \param --history N : Number of frames of a streamed input kept for stepping back.
+	 * \param --export FIRST:LAST : Export the range without showing a window ( see also --export-to, --step and --jobs ).
+	 * \param --socket PATH : Accept commands on a Unix-domain socket.
+	 * \param --commands - : Accept commands on stdin, replies are written to stdout.
+	 * \param --headless : Do not show a window, the player is driven by the commands alone.
+	 * \param --record FILE : Record the actions of the user to a session file.
+	 * \param --replay FILE : Replay a recorded session without a window and report the latency of its actions.
+	 * \param --pool-mb N : Ceiling of the frame pool in MB.
+	 * \param --mem-budget N : Total memory budget of the frames, caches and buffers in MB.
+	 * \param --prefetch N : Number of frames decoded ahead of the playhead, 0 to disable the prefetcher.
+	 * \param --phash : Hash every frame in the background for the similar-frames search ( <em>f</em> key ), or load the hashes saved by an earlier run.
+	 * \param --no-timeline : Do not compute the activity timeline drawn on the slider.
+	 * \param --board-interval S : Seconds after which a shot gets another tile on the storyboard ( <em>b</em> key ).
+	 * \param --compare FILE : Show another video next to the main one, frame by frame; may be given up to three times.
+	 * \param --quality CSV : Compute the PSNR and SSIM of every frame between the main video and the first <em>--compare</em> input, and write them to a CSV file; with <em>--headless</em> and no command the player exits once done.
+	 * \retval 0 Exit without any problem.
+	 * \retval 1 Early exit with due to some error, or a replayed session did not show the recorded frames.
+	 * */
+}
+
+
+
+//Function to move the custom built slider
+/*!
  * Whenever a right-click on our custom-built slider occurs and the mouse is moved over the slider or there is a change in the displayed frame, this function is called.
  * */
-int moveSlider( int pos, int call_from ){
-	int frame_val;
-	//Scaling to obtain the current frame number
-	/*!
-	 * If the function is called from a mouse event then \a call_from is set to MOUSE_CALLBACK and corresponding \a pos indicates the x-coordinate (Cartesian System) of the latest mouse event. The current frame value ( \a frame_val ) is derived from \a pos using appropriate scaling.
-	 * */
-	float scale = ( sldr_maxval )/( float )( p_width );
-	//printf( "Pos : %d\tScale : %f\n", pos, scale );
-	if( call_from == MOUSE_CALLBACK ){
-		frame_val = cvCeil( scale*pos );
+int moveSlider( int pos, int call_from ){
+	int frame_val;
+	//Scaling to obtain the current frame number
+	/*!
+	 * If the function is called from a mouse event then \a call_from is set to MOUSE_CALLBACK and corresponding \a pos indicates the x-coordinate (Cartesian System) of the latest mouse event. The current frame value ( \a frame_val ) is derived from \a pos using appropriate scaling.
+	 * */
+	int first, span;
+	tl_window( &first, &span );
+	float scale = ( span )/( float )( p_width );
+	//printf( "Pos : %d\tScale : %f\n", pos, scale );
+	if( call_from == MOUSE_CALLBACK ){
+		frame_val = first + cvCeil( scale*pos );
+	}
+	/*!
+	 * If this function is called from any other function then \a call_from is set to OTHER_CALLS and corresponding \a pos indicates the current frame value which is directly assigned to \a frame_val.
+	 * */
+	if( call_from == OTHER_CALLS ){
+		frame_val = pos;
+	}
+	//Scaling to set the slider button at an appropriate location between 0 and (p_width - sldr_btn_width)
+	/*!
+	 * Again scaling is done so that the slider button can be set to an appropriate location between 0 and (p_width - sldr_btn_width)
+	 * */
+	/*!
+	 * When the timeline is zoomed in ( see tl_zoom() ), the slider only spans the frames \a first to \a first + \a span. When the current frame moves out of them, the timeline is panned so that it is centred; the timeline panned away from a frame which does not move is left alone.
+	 * */
+	static int last_val = -1;
+	bool moved = ( frame_val!=last_val );
+	last_val = frame_val;
+	if( tl_span && moved && ( frame_val<first || frame_val>first + span ) ){
+		tl_first = frame_val - span/2;
+		tl_window( &first, &span );
+		draw_slider_strip();
+	}
+	scale = ( p_width - sldr_btn_width )/( float )( span );
+	//printf( "Frame slider : %d\n", frame_val );
+	int new_pos = MIN( MAX( cvCeil( scale*( frame_val - first ) ), 0 ), p_width - sldr_btn_width );
+	//frame_val should be an integral multiple of step_val
+	/*!
+	 * Proper care is taken so that \a frame_val remains an integeral multiple of \a step_val between 0 and \a sldr_maxval.
+	 * */
+	if( frame_val%step_val != 0 ){
+		frame_val = step_val*( ( int )frame_val/( int )step_val );
+	}
+	/*!
+	 * Current frame number is then updated in the control pannel and lastly the slider button is set at its appropriate location on the custom-built slider.
+	 * */
+	resetField( cur_frame_no, STATIC_TEXT );
+	sprintf( line, "%d", frame_val );
+	cvPutText( cur_frame_no, line, cvPoint( 3, cur_frame_no->height - 4 ), &font, black );
+	double ms;
+	get_frame_time( frame_val, &ms );
+	resetField( time_code, STATIC_TEXT );
+	format_timecode( ms, line, sizeof( line ) );
+	cvPutText( time_code, line, cvPoint( 3, time_code->height - 5 ), &font_small, black );
+	cvCopy( oslider, slider );
+	sldr_val->imageData = slider->imageData + new_pos*slider->nChannels;
+	cvCopy( sldr_btn, sldr_val );
+	return( frame_val );
+	/*!
+	 * \param pos Either the x-coordinate of the latest mouse event on the slider or the current frame number.
+	 * \param call_from Set to MOUSE_CALLBACK when this function is called from a mouse callback event, else set to OTHER_CALLS.
+	 * \return frame_val: The current frame number.
+	 * \sa resetField(), <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=put#cvPutText" target="_blank"><b>cvPutText()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_operations_on_arrays.html?highlight=copy#cvCopy" target="_blank"><b>cvCopy()</b></a>
+	 * */
+}
+
+//Function for mouse callback events
+/*!
+ * The function is callback for mouse events. Actions to be taken for various mouse events are defined in this function. This function is the 2<sup>nd</sup> argument to the <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=setmousecallback#cvSetMouseCallback" target="_blank"><b>cvSetMouseCallback()</b></a> function.
+
+We associate this mouse callback function for events on the custom-built slider as well as on the different fields in the control pannel. Following is the explaination of the various mouse events used in this scenario and their respective actions. 
+*/
+void my_mouse_callback( int event, int x, int y, int flags, void* param ){
+	IplImage* image = ( IplImage* )param;
+	switch( event ){
+		/*!
+			Case1, event = CV_EVENT_MOUSEMOVE i.e. mouse is moved. The new position is queued as UI_MOVE. The main loop uses it to drag the slider ( while \a engine.sldr_moving ), to pan the zoomed frame and to show the pixel under the mouse.
+		 */
+		case CV_EVENT_MOUSEMOVE: {
+			ui_push( UI_MOVE, x, y, 0 );
+		}
+		break;
+/*!
+			Case2, event = CV_EVENT_LBUTTONDOWN i.e. mouse's left button is pressed down. This event indicates some button being pressed ( play, pause, etc or slider button ). The mouse coordinates help to identify the button being pressed. A UI_PRESS event, followed by the event of the button ( or slider, or textbox ) pressed, is queued. A step button clicked with Ctrl held down goes to the next or previous frame marker instead, see marker_jump().
+		 */
+		case CV_EVENT_LBUTTONDOWN: {
+			ui_push( UI_PRESS, x, y, 0 );
+			// mouse on slider
+			if( ( y > scrn_height ) && ( y <= scrn_height + sldr_height ) ){
+				ui_push( UI_SLIDER, x, y, 0 );
+			}
+			// mouse on play/pause button
+			if(
+				( y > play_pause_btn_area.y1 ) &&
+				( y <= play_pause_btn_area.y2 ) &&
+				( x > play_pause_btn_area.x1 ) &&
+				( x <= play_pause_btn_area.x2 )
+			){
+				ui_push( UI_PLAY_PAUSE, x, y, 0 );
+			}
+			// mouse on stop button
+			if(
+				( y > stop_btn_area.y1 ) &&
+				( y <= stop_btn_area.y2 ) &&
+				( x > stop_btn_area.x1 ) &&
+				( x <= stop_btn_area.x2 )
+			){
+				ui_push( UI_STOP, x, y, 0 );
+			}
+			// mouse on stepup button
+			if(
+				( y > stepup_btn_area.y1 ) &&
+				( y <= stepup_btn_area.y2 ) &&
+				( x > stepup_btn_area.x1 ) &&
+				( x <= stepup_btn_area.x2 )
+			){
+				ui_push( UI_STEP_UP, x, y, ( flags & CV_EVENT_FLAG_CTRLKEY ) ? 1 : 0 );
+			}
+			// mouse on stepdown button
+			if(
+				( y > stepdown_btn_area.y1 ) &&
+				( y <= stepdown_btn_area.y2 ) &&
+				( x > stepdown_btn_area.x1 ) &&
+				( x <= stepdown_btn_area.x2 )
+			){
+				ui_push( UI_STEP_DOWN, x, y, ( flags & CV_EVENT_FLAG_CTRLKEY ) ? 1 : 0 );
+			}
+			// mouse on export button
+			if(
+				( y > export_btn_area.y1 ) &&
+				( y <= export_btn_area.y2 ) &&
+				( x > export_btn_area.x1 ) &&
+				( x <= export_btn_area.x2 )
+			){
+				ui_push( UI_EXPORT, x, y, 0 );
+			}
+			// mouse on step_edit field
+			if(
+				( y > step_edit_area.y1 ) &&
+				( y <= step_edit_area.y2 ) &&
+				( x > step_edit_area.x1 ) &&
+				( x <= step_edit_area.x2 )
+			){
+				ui_push( UI_EDIT_STEP, x, y, 0 );
+			}
+		}
+		break;
+/*!
+			Case3, event = CV_EVENT_LBUTTONUP i.e. mouse's left button is released after earlier press. Only the slider-button depends on this event it can be dragged along the slider-strip. Therefore, on this event a UI_RELEASE is queued, which stops the slider movement.
+		 */
+		case CV_EVENT_LBUTTONUP: {
+			ui_push( UI_RELEASE, x, y, 0 );
+		}
+		break;
+#ifdef CV_GET_WHEEL_DELTA
+/*!
+			Case4, event = CV_EVENT_MOUSEWHEEL i.e. the mouse wheel is turned. Over the frame area this zooms in or out about the mouse position, over the slider it zooms the timeline.
+		 */
+		case CV_EVENT_MOUSEWHEEL: {
+			if( y <= scrn_height + sldr_height ){
+				ui_push( UI_WHEEL, x, y, CV_GET_WHEEL_DELTA( flags )>0 ? 1 : -1 );
+			}
+		}
+		break;
+#endif
+	}
+/*!
+	The callback neither decodes nor draws anything, and it does not touch the state of the main loop. It only queues the events using ui_push(), which never blocks, so highgui's event loop stays responsive even while a seek is in progress. The events are executed by the main loop in drain_ui_events().
+
+	\sa <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=setmousecallback#cvSetMouseCallback" target="_blank"><b>cvSetMouseCallback()</b></a> function
+	 * for \param event
+	 * \param x
+	 * \param y
+	 * \param flags
+	 * \param param
+*/
+}
+
+
+//Function to reset any field
+/*!
+ * This function will reset a text-field ( a textbox or a static text). The text-field is nothing but a sub-image. Therefore all the pixel values are to be reset to the original values of the respecitve text fields (white with black border for EDIT_TEXT and Control Pannel's color with black border for STATIC_TEXT).
+ * 
+ * Whenever the value in the text-field is changed, the text-field being an image, the new value is overwritten over the old value. Therefore, every time a new value is to be written, the respective field need to be reset.
+ * 
+ * The pixels are written by fill_k() or frame_k(), specialised for the format of the image ( see PIXEL_DISPATCH ).
+ * 
+ * \param image : The sub-image (i.e. the text-field) to be reset.
+ * \param text_type : Either STATIC_TEXT or EDIT_TEXT.
+ * \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#iplimage" target="_blank"><b>IplImage</b></a> 
+ * */
+void resetField( IplImage* image, int text_type ){
+	if( text_type == STATIC_TEXT ){
+		fill_image( image, cvScalar( 226, 235, 240 ) );
+	}
+	else{
+		PIXEL_DISPATCH( image, frame_k, ( image, cvScalar( 0, 0, 0 ), cvScalar( 255, 255, 255 ) ) );
+	}
+}
+
+//Function to get new buttons
+/*!
+ * Function to get the desired control button, say play, pause, stop, stepup, stepdown. The buttons are nothing but sub-images.
+ * \param image : This is the sub-image for the desired button.
+ * \param btn_type : Can be any of the following viz. PLAY_BTN, PAUSE_BTN, STOP_BTN, STEPUP_BTN, STEPDOWN_BTN, EXPORT_BTN.
+ * \param btn_state : Can be either BTN_ACTIVE or BTN_INACTIVE. For the time being, only BTN_ACTIVE is used and it is meaningless to pass BTN_INACTIVE.
+ * \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#iplimage" target="_blank"><b>IplImage</b></a>
+ * */
+void getButton( IplImage* image, int btn_type, int btn_state ){
+	getSpectrumVert( image, voilet, black );
+	if( btn_type==PLAY_BTN ){
+		draw_triangle( image, green );
+	}
+	if( btn_type==STOP_BTN ){
+		draw_square( image, green );
+	}
+	if( btn_type==PAUSE_BTN ){
+		draw_pause( image, green );
+	}
+	if( btn_type==STEPUP_BTN ){
+		draw_stepup( image, green );
+	}
+	if( btn_type==STEPDOWN_BTN ){
+		draw_stepdown( image, green );
+	}
+	if( btn_type==EXPORT_BTN ){
+		cvPutText( image, "Export", cvPoint( 4, image->height - 4 ), &font, green );
+	}
+}
+
+//Function to vertically color a button
+/*!
+ * This function is nothing by an implementation of linear interploation vertically i.e. The <i>color1</i> is the color of the topmost row of the sub-image (<i>image</i>) and <i>color2</i> is the color of the bottom most row of the sub-image. The intermediate colors are calculated using the following formula.
+ * 
+ * <center>
+ * \f$ X = \frac{B-A}{L} \times l + A \f$
+ * </center>
+ * where,<br>
+ * X : color of the pixel to be determined.<br>
+ * B : Color of the bottommost row.<br>
+ * A : Color of the topmost row.<br>
+ * l : Distance of the current pixel from the top (i.e. row number).<br>
+ * L : Total number of rows.<br>
+ * 
+ * \param image : The input sub-image for the button to be colored.
+ * \param color1 : Color of the topmost row.
+ * \param color2 : Color of the bottommost row.
+ * \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#iplimage" target="_blank"><b>IplImage</b></a>
+ * */
+void getSpectrumVert( IplImage* image, CvScalar color1, CvScalar color2 ){
+	PIXEL_DISPATCH( image, spectrum_vert_k, ( image, color1, color2 ) );
+}
+
+//Function to get the horizontal spectrum
+/*!
+ * This function is nothing by an implementation of linear interploation horizontally i.e. The <i>color1</i> is the color of the leftmost row of the sub-image (<i>image</i>) and <i>color2</i> is the color of the rightmost row of the sub-image. The intermediate colors are calculated using the following formula.
+ * 
+ * <center>
+ * \f$ X = \frac{B-A}{L} \times l + A \f$
+ * </center>
+ * where,<br>
+ * X : color of the pixel to be determined.<br>
+ * B : Color of the rightmost row.<br>
+ * A : Color of the leftmost row.<br>
+ * l : Distance of the current pixel from the left (i.e. column number).<br>
+ * L : Total number of columns.<br>
+ * 
+ * \param image : The input sub-image for the button to be colored.
+ * \param color1 : Color of the leftmost row.
+ * \param color2 : Color of the rightmost row.
+ * \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#iplimage" target="_blank"><b>IplImage</b></a>
+ * */
+void getSpectrumHorz( IplImage* image, CvScalar color1, CvScalar color2 ){
+	PIXEL_DISPATCH( image, spectrum_horz_k, ( image, color1, color2 ) );
+}
+
+//Function to initialize the control pannel...adding text & buttons
+/*!
+ * This function is for initializing the control pannel, adding textfields, text and buttons to it. One may learn how to create a sub-image from an existing IplImage. Each sub-image can act as an independent image. The advantage of using sub-image over ROI is that multiple parts of an image can be worked upon simultaneously. You will come to know the importance of sub-image in the following where you will see how text-boxes and buttons are created with the use of sub-images. Lets's start.
+ * 
+ * In the initial lines you will come across the <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=cvputtext#cvPutText" target="_blank"><b>cvPutText()</b></a> function. This is used to place text at various parts of the control pannel sub-image. Next you come across are the <i>row</i> and <i>col</i>. These are the starting coordinates where you want to place the textfields or buttons. To create such fields and buttons (which are nothing but sub-images of the control pannel, which is again a sub-image of the video-player), declare the IplImage header using <a href="http://opencv.willowgarage.com/documentation/c/core_operations_on_arrays.html?highlight=createimageheader#cvCreateImageHeader" target="_blank"><b>cvCreateImageHeader()</b></a> using the required dimensions. This will only create the image header and no data is assigned to it. To use this as a sub-image we need to need to make the following assignments.
+ * <ol>
+ * 	<li>sub_image->origin = parent_image->origin.</li>
+ * 	<li>sub_image->widthStep = parent_image->widthStep.</li>
+ * 	<li>sub_image->imageData = parent_image->imageData + row*sub_image->widthStep + col*sub_image->nChannels.</li>
+ * </ol>
+ * 
+ * Now the sub-image can be used as if it were an independent image. Further, for a few operations we need to keep a track of the coordinates of this newly created image. We store them in Field_Area structure of the respective button or text-field using the naming convention as <i>sub_image_area</i>. If the sub-image is a text-field then resetField() function is called. If the sub-image is a button then getButton() function is called.
+ * 
+ * \param filename : The absolute path of the video file to be played.
+ * 
+ * \sa <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=cvputtext#cvPutText" target="_blank"><b>cvPutText()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_basic_structures.html?highlight=cvpoint#CvPoint" target="_blank"><b>cvPoint()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_operations_on_arrays.html?highlight=createimageheader#cvCreateImageHeader" target="_blank"><b>cvCreateImageHeader()</b></a>, resetField(), getButton().
+ * */
+void initialize_pnl( char *filename ){
+	int row, col;
+	cvPutText( pnl, "Step : ", cvPoint( 3, 60 ), &font, black );
+	cvPutText( pnl, "File : ", cvPoint( 3, 140 ), &font, black );
+	show_file_name( filename );
+	cvPutText( pnl, "Control Pannel", cvPoint( 3, 15 ), &font_bold_italic, black );
+	cvPutText( pnl, "FPS : ", cvPoint( 700, 100 ), &font, black );
+	cvPutText( pnl, "Current Frame : ", cvPoint( 3, 100 ), &font, black );
+	cvPutText( pnl, "Total Frames : ", cvPoint( 300, 100 ), &font, black );
+	cvPutText( pnl, "FOURCC : ", cvPoint( 668, 60 ), &font, black );
+	cvPutText( pnl, "Status : ", cvPoint( 325, 30 ), &font, black );
+	cvPutText( pnl, "Pixel : ", cvPoint( 3, 175 ), &font, black );
+	cvPutText( pnl, "Time : ", cvPoint( 558, 100 ), &font, black );
+	//Current Frame field
+	row = 88;
+	col = 150;
+	cur_frame_no = cvCreateImageHeader( cvSize( 120, 18), IPL_DEPTH_8U, 3 );
+	cur_frame_no->origin = pnl->origin;
+	cur_frame_no->widthStep = pnl->widthStep;
+	cur_frame_no->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( cur_frame_no, STATIC_TEXT );
+	//timecode field
+	row = 88;
+	col = 612;
+	time_code = cvCreateImageHeader( cvSize( 84, 18), IPL_DEPTH_8U, 3 );
+	time_code->origin = pnl->origin;
+	time_code->widthStep = pnl->widthStep;
+	time_code->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( time_code, STATIC_TEXT );
+	//number of frames field
+	row = 88;
+	col = 430;
+	numFrames = cvCreateImageHeader( cvSize( 120, 18), IPL_DEPTH_8U, 3 );
+	numFrames->origin = pnl->origin;
+	numFrames->widthStep = pnl->widthStep;
+	numFrames->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( numFrames, STATIC_TEXT );
+	//Step field
+	row = 48;
+	col = 65;
+	step_edit = cvCreateImageHeader( cvSize( 110, 18), IPL_DEPTH_8U, 3 );
+	step_edit->origin = pnl->origin;
+	step_edit->widthStep = pnl->widthStep;
+	step_edit->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( step_edit, EDIT_TEXT );
+	step_edit_area.x1 = col;
+	step_edit_area.x2 = col + step_edit->width;
+	step_edit_area.y1 = p_height - ctrl_pnl_height + row;
+	step_edit_area.y2 = p_height - ctrl_pnl_height + step_edit->height + row;
+	sprintf( line, "%d", step_val );
+	cvPutText( step_edit, line, cvPoint( 3, step_edit->height - 4 ), &font, black );
+	//FPS field
+	row = 88;
+	col = 755;
+	fps_edit = cvCreateImageHeader( cvSize( 50, 18), IPL_DEPTH_8U, 3 );
+	fps_edit->origin = pnl->origin;
+	fps_edit->widthStep = pnl->widthStep;
+	fps_edit->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( fps_edit, STATIC_TEXT );
+	fps_edit_area.x1 = col;
+	fps_edit_area.x2 = col + fps_edit->width;
+	fps_edit_area.y1 = p_height - ctrl_pnl_height + row;
+	fps_edit_area.y2 = p_height - ctrl_pnl_height + fps_edit->height + row;
+	//FOURCC field
+	row = 48;
+	col = 755;
+	four_cc_edit = cvCreateImageHeader( cvSize( 50, 22), IPL_DEPTH_8U, 3 );
+	four_cc_edit->origin = pnl->origin;
+	four_cc_edit->widthStep = pnl->widthStep;
+	four_cc_edit->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( four_cc_edit, STATIC_TEXT );
+	four_cc_edit_area.x1 = col;
+	four_cc_edit_area.x2 = col + four_cc_edit->width;
+	four_cc_edit_area.y1 = p_height - ctrl_pnl_height + row;
+	four_cc_edit_area.y2 = p_height - ctrl_pnl_height + four_cc_edit->height + row;
+	//Play/Pause button
+	row = 48;
+	col = 350;
+	play_pause_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
+	play_pause_btn->origin = pnl->origin;
+	play_pause_btn->widthStep = pnl->widthStep;
+	play_pause_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	getButton( play_pause_btn, PLAY_BTN, BTN_ACTIVE );
+	play_pause_btn_area.x1 = col;
+	play_pause_btn_area.x2 = col + play_pause_btn->width;
+	play_pause_btn_area.y1 = p_height - ctrl_pnl_height + row;
+	play_pause_btn_area.y2 = p_height - ctrl_pnl_height + play_pause_btn->height + row;
+	//Stop button
+	row = 48;
+	col = 415;
+	stop_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
+	stop_btn->origin = pnl->origin;
+	stop_btn->widthStep = pnl->widthStep;
+	stop_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	getButton( stop_btn, STOP_BTN, BTN_ACTIVE );
+	stop_btn_area.x1 = col;
+	stop_btn_area.x2 = col + stop_btn->width;
+	stop_btn_area.y1 = p_height - ctrl_pnl_height + row;
+	stop_btn_area.y2 = p_height - ctrl_pnl_height + stop_btn->height + row;
+	//Stepup button
+	row = 48;
+	col = 480;
+	stepup_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
+	stepup_btn->origin = pnl->origin;
+	stepup_btn->widthStep = pnl->widthStep;
+	stepup_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	getButton( stepup_btn, STEPUP_BTN, BTN_ACTIVE );
+	stepup_btn_area.x1 = col;
+	stepup_btn_area.x2 = col + stepup_btn->width;
+	stepup_btn_area.y1 = p_height - ctrl_pnl_height + row;
+	stepup_btn_area.y2 = p_height - ctrl_pnl_height + stepup_btn->height + row;
+	//Stepdown button
+	row = 48;
+	col = 285;
+	stepdown_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
+	stepdown_btn->origin = pnl->origin;
+	stepdown_btn->widthStep = pnl->widthStep;
+	stepdown_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	getButton( stepdown_btn, STEPDOWN_BTN, BTN_ACTIVE );
+	stepdown_btn_area.x1 = col;
+	stepdown_btn_area.x2 = col + stepdown_btn->width;
+	stepdown_btn_area.y1 = p_height - ctrl_pnl_height + row;
+	stepdown_btn_area.y2 = p_height - ctrl_pnl_height + stepdown_btn->height + row;
+	//Export button
+	row = 48;
+	col = 545;
+	export_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
+	export_btn->origin = pnl->origin;
+	export_btn->widthStep = pnl->widthStep;
+	export_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	getButton( export_btn, EXPORT_BTN, BTN_ACTIVE );
+	export_btn_area.x1 = col;
+	export_btn_area.x2 = col + export_btn->width;
+	export_btn_area.y1 = p_height - ctrl_pnl_height + row;
+	export_btn_area.y2 = p_height - ctrl_pnl_height + export_btn->height + row;
+	//Status Field
+	row = 18;
+	col = 395;
+	status_edit = cvCreateImageHeader( cvSize( 130, 22), IPL_DEPTH_8U, 3 );
+	status_edit->origin = pnl->origin;
+	status_edit->widthStep = pnl->widthStep;
+	status_edit->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( status_edit, STATIC_TEXT );
+	status_edit_area.x1 = col;
+	status_edit_area.x2 = col + status_edit->width;
+	status_edit_area.y1 = p_height - ctrl_pnl_height + row;
+	status_edit_area.y2 = p_height - ctrl_pnl_height + status_edit->height + row;
+	//Pixel value field
+	row = 162;
+	col = 65;
+	pixel_info = cvCreateImageHeader( cvSize( 400, 18), IPL_DEPTH_8U, 3 );
+	pixel_info->origin = pnl->origin;
+	pixel_info->widthStep = pnl->widthStep;
+	pixel_info->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( pixel_info, STATIC_TEXT );
+	//Histogram area
+	row = 112;
+	col = 560;
+	hist_area = cvCreateImageHeader( cvSize( 275, 84 ), IPL_DEPTH_8U, 3 );
+	hist_area->origin = pnl->origin;
+	hist_area->widthStep = pnl->widthStep;
+	hist_area->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
+	resetField( hist_area, EDIT_TEXT );
+	sprintf( status_line, "Stopped" );
+	change_status();
+}
+
+//Draw triangle in the image
+/*!
+ * Function to draw a triangle for the play button. We pass the sub-image where we want to create the play button and also pass the color which we desire of the button. We first define 3 points for the triangle whose coordinates are stored in pt1, pt2 and pt3. Now we simply draw segments to connect these points and finally fill up the triangle with the desired color.
+ * 
+ * \param image : The image where we want to place the play-triangle
+ * \param color : The desired color
+ * 
+ * \sa <a href="http://opencv.willowgarage.com/documentation/c/core_basic_structures.html?highlight=point#CvPoint" target="_blank"><b>cvPoint()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=line#cvLine" target="_blank"><b>cvLine()</b></a>, fill_color.
+ * 
+ * */
+void draw_triangle( IplImage* image, CvScalar color ){
+	CvPoint pt1, pt2, pt3;
+	pt1.x = image->width/3;
+	pt1.y = 3;
+	pt2.x = pt1.x;
+	pt2.y = image->height - pt1.y;
+	pt3.x = 2*pt1.x;
+	pt3.y = image->height/2;
+	cvLine( image, pt1, pt2, color );
+	cvLine( image, pt3, pt2, color );
+	cvLine( image, pt1, pt3, color );
+	fill_color( image, color );
+}
+
+//Draw square in the image
+/*!
+ * Function to draw a square for the stop button. We pass the sub-image where we want to create the stop button and also pass the color which we desire of the button. We first define 4 points for the square whose coordinates are stored in pt1, pt2, pt3 and pt4. Now we simply draw segments to connect these points and finally fill up the square with the desired color.
+ * 
+ * \param image : The image where we want to place the stop-square
+ * \param color : The desired color
+ * 
+ * \sa <a href="http://opencv.willowgarage.com/documentation/c/core_basic_structures.html?highlight=point#CvPoint" target="_blank"><b>cvPoint()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=rectangle#cvRectangle" target="_blank"><b>cvRectangle</b></a>, fill_color.
+ * 
+ * */
+void draw_square( IplImage* image, CvScalar color ){
+	CvPoint pt1, pt2;
+	pt1.x = 3*image->width/8;
+	pt1.y = 3;
+	pt2.x = 5*image->width/8;
+	pt2.y = image->height - pt1.y;
+	cvRectangle( image, pt1, pt2, color );
+	fill_color( image, color );
+}
+
+//Draw pause symbol in the image
+/*!
+ * Function to draw a two parallel rectangles for the pause button. We pass the sub-image where we want to create the pause button and also pass the color which we desire of the button. We first define 2 points for the first rectangle whose coordinates are stored in pt1 and pt2 and a line between these points would be a vertical line. Now we simply draw 5 lines parallel to this line for the first rectangle and also 5 parallel lines for the second rectangle
+ * 
+ * \param image : The image where we want to place the pause-rectangles
+ * \param color : The desired color
+ * 
+ * \sa <a href="http://opencv.willowgarage.com/documentation/c/core_basic_structures.html?highlight=point#CvPoint" target="_blank"><b>cvPoint()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=line#cvLine" target="_blank"><b>cvLine()</b></a>.
+ * 
+ * */
+void draw_pause( IplImage* image, CvScalar color ){
+	int y_start = 3;
+	int y_end = image->height - y_start;
+	int dist = 3;
+	CvPoint pt1, pt2, tmp1, tmp2;
+	pt1.x = image->width/2;
+	pt1.y = y_start;
+	pt2.x = pt1.x;
+	pt2.y = y_end;
+	for( int col=0; col<5; col++  ){
+		tmp1.x = pt1.x + dist + col;
+		tmp1.y = pt1.y;
+		tmp2.x = pt2.x + dist + col;
+		tmp2.y = pt2.y;
+		cvLine( image, tmp1, tmp2, color );
+		tmp1.x = pt1.x - dist - col;
+		tmp1.y = pt1.y;
+		tmp2.x = pt2.x - dist - col;
+		tmp2.y = pt2.y;
+		cvLine( image, tmp1, tmp2, color );
+	}
+}
+
+
+
+//Function to fill color in the area bounded by the given color
+/*!
+ * Every row is filled from the first pixel of the given color to the next one. See fill_color_k().
+ * */
+void fill_color( IplImage* image, CvScalar color ){
+	PIXEL_DISPATCH( image, fill_color_k, ( image, color ) );
+}
+
+//Draw stepup symbol
+void draw_stepup( IplImage* image, CvScalar color ){
+	CvPoint pt1, pt2, pt3, pt4;
+	pt1.x = 2*image->width/8;
+	pt2.x = 4*image->width/8;
+	pt3.x = pt1.x;
+	pt4.x = pt2.x;
+	int y_start = 3;
+	int y_end = image->height/2 ;
+	for( int row=y_start; row<=y_end; row++ ){
+		pt1.x = pt1.x + row - y_start;
+		pt2.x = pt2.x + row - y_start;
+		pt1.y = row;
+		pt2.y = row;
+		pt3.x = pt1.x;
+		pt4.x = pt2.x;
+		pt3.y = image->height - row;
+		pt4.y = pt3.y;
+		cvLine( image, pt1, pt2, color );
+		cvLine( image, pt3, pt4, color );
+	}
+}
+
+//Draw stepdown_symbol
+void draw_stepdown( IplImage* image, CvScalar color ){
+	CvPoint pt1, pt2, pt3, pt4;
+	pt1.x = 4*image->width/8;
+	pt2.x = 6*image->width/8;
+	pt3.x = pt1.x;
+	pt4.x = pt2.x;
+	int y_start = 3;
+	int y_end = image->height/2 ;
+	for( int row=y_start; row<=y_end; row++ ){
+		pt1.x = pt1.x - row + y_start;
+		pt2.x = pt2.x - row + y_start;
+		pt1.y = row;
+		pt2.y = row;
+		pt3.x = pt1.x;
+		pt4.x = pt2.x;
+		pt3.y = image->height - row;
+		pt4.y = pt3.y;
+		cvLine( image, pt1, pt2, color );
+		cvLine( image, pt3, pt4, color );
+	}
+}
+
+//Function to change the status
+void change_status(){
+	resetField( status_edit, STATIC_TEXT );
+	cvPutText( status_edit, status_line, cvPoint( 3, status_edit->height - 8 ), &font, black );
+}
+
+//Function for editing the step_edit field
+void type_step( char c, int frame_val ){
+	resetField( step_edit, EDIT_TEXT );
+	char temp_text[ 20 ];
+	int cur_frame;
+	sprintf( temp_text, "" );
+	if( blinking ){
+		if( blink_count<blink_max ){
+			blink_count++;
+		}
+		else{
+			blinking = false;
+			blink_char = ' ';
+			blink_count = 0;
+		}
+		//printf( "Blinking...\n" );
+	}
+	else{
+		if( blink_count<blink_max ){
+			blink_count++;
+		}
+		else{
+			blinking = true;
+			blink_char = '|';
+			blink_count = 0;
+		}
+		//printf( "Not blinking...\n" );
+	}
+	//a time to go to, e.g. 01:02:03.04, 1:30 or 0.5, rather than a step
+	bool is_time = ( strpbrk( edit_text, ":;." ) || edit_text[0]=='0' );
+	//valid number
+	if( c>=48 && c<=57 ){
+		sprintf( temp_text, "%s%c", edit_text, c );
+		if( is_time || temp_text[0]=='0' ){
+			if( strlen( temp_text )<=11 ){
+				sprintf( edit_text, "%s", temp_text );
+			}
+		}
+		else if( ( frame_val + atoi( temp_text ) )>=0 && ( !length_known || ( frame_val + atoi( temp_text ) )<=sldr_maxval ) && ( atoi( temp_text )!=0 ) ){
+			sprintf( edit_text, "%s", temp_text );
+		}
+	}
+	//separators of a time
+	if( ( c==':' || c==';' || c=='.' ) && strcmp( edit_text, "" )!=0 && strlen( edit_text )<11 ){
+		sprintf( temp_text, "%s%c", edit_text, c );
+		sprintf( edit_text, "%s", temp_text );
+		is_time = true;
+	}
+	//backspace
+	if( c==8 ){
+		if( strcmp( edit_text, "" )!=0 ){
+			for( int count=0; count<( strlen( edit_text )-1 ); count++ ){
+				sprintf( temp_text, "%s%c", temp_text, edit_text[ count ] );
+			}
+			sprintf( edit_text, "%s", temp_text );
+		}
+	}
+	sprintf( temp_text, "%s%c", edit_text, blink_char );
+	cvPutText( step_edit, temp_text, cvPoint( 3, step_edit->height - 4 ), &font, black );
+	if( c==10 ){
+		double ms;
+		if( is_time ){
+			int f;
+			if( !parse_time( edit_text, &ms ) ){
+				sprintf( status_line, "Invalid time" );
+			}
+			else if( ( f = seek_time( ms ) )<0 ){
+				sprintf( status_line, "Time not found" );
+			}
+			else{
+				snprintf( status_line, sizeof( status_line ), "Frame %d", f );
+			}
+			change_status();
+			sprintf( edit_text, "%d", step_val );
+		}
+		else if( atoi( edit_text )>0 ){
+			step_val = atoi( edit_text );
+		}
+		else{
+			sprintf( edit_text, "%d", step_val );
+		}
+		resetField( step_edit, EDIT_TEXT );
+		cvPutText( step_edit, edit_text, cvPoint( 3, step_edit->height - 4 ), &font, black );
+		//printf( "Step : %d\n", step );
+		typing_step = false;
+	}
+}
+
+//Function to reset all edit fields after mouse-left-click is performed
+void resetAllEdits(){
+	resetField( step_edit, EDIT_TEXT );
+	sprintf( edit_text, "%d", step_val );
+	cvPutText( step_edit, edit_text, cvPoint( 3, step_edit->height - 4 ), &font, black );
+	typing_step = false;
+}
+
+//Function to fetch the next frame
+/*!
+ * Fetches the next frame either from the video file ( using decode_vid() ), from the streamed input or from the timeshift buffer of a live input. The returned image must not be released by the caller. The frame following \a play_pos is taken from the frame cache when it is there; otherwise it is decoded and cached.
+ * 
+ * \return The fetched frame, or NULL when no more frames are available ( or, for a live input, not yet ).
+ * \sa stream_query(), live_query(), decode_frame().
+ * */
+IplImage* query_frame(){
+	if( live ){
+		return( live_query( live ) );
+	}
+	if( stream ){
+		return( stream_query( stream ) );
+	}
+	if( !vid ){
+		return( NULL );
+	}
+	compare_dispatch( play_pos + 1 );
+	frame_unref( fetched_buf );
+	if( ( fetched_buf = cache_lookup( play_pos + 1 ) ) ){
+		play_pos++;
+		return( fetched_buf->img );
+	}
+	//the frames served from the cache did not move the capture
+	int64 start = cvGetTickCount();
+	vp_seek( vid, play_pos + 1 );
+	IplImage* img = decode_vid();
+	note_decode( &compare.inputs[0].decode_us, start );
+	return( keep_decoded( img ) );
+}
+
+//Function to seek the video
+/*!
+ * Sets the position of the video to \a pos and copies the frame fetched at the new position to \a old_frame. For a video file the frame reached is \a pos + 2, as for a CvCapture whose position is set to \a pos with <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#setcaptureproperty" target="_blank"><b>cvSetCaptureProperty()</b></a>, for some unknown reason, cvQueryFrame() needs to be called twice to get to the desired frame ( see vp_next_frame() ); no seek is done when that frame is in the frame cache. A streamed input returns the frame \a pos directly, provided it is still in the history window, and so does a live input for its timeshift buffer.
+ * 
+ * \param pos : The new position.
+ * \sa stream_set_pos(), live_set_pos(), get_frame_pos().
+ * */
+void seek_frame( int pos ){
+	IplImage* img = NULL;
+	if( live ){
+		live_set_pos( live, pos );
+		img = live_query( live );
+	}
+	else if( stream ){
+		stream_set_pos( stream, pos );
+		img = stream_query( stream );
+	}
+	else if( vid ){
+		//the frame reached by seeking to pos, as get_frame_pos() reports it; the first frame from the start of the slider
+		int f = MAX( pos + 2, 1 );
+		compare_dispatch( f );
+		frame_unref( fetched_buf );
+		fetched_buf = cache_lookup( f );
+		if( fetched_buf ){
+			play_pos = f;
+			img = fetched_buf->img;
+		}
+		else{
+			int64 start = cvGetTickCount();
+			vp_seek( vid, f );
+			img = decode_vid();
+			note_decode( &compare.inputs[0].decode_us, start );
+			img = keep_decoded( img );
+		}
+	}
+	if( img ){
+		set_current( img );
+	}
+}
+
+//Function to get the current position
+/*!
+ * For a video file this is \a play_pos, the number of the displayed frame as counted by the engine. For a streamed or a live input it is the number of the frame fetched last.
+ * 
+ * \return The current position.
+ * */
+int get_frame_pos(){
+	if( live ){
+		return( live->next - 1 );
+	}
+	if( stream ){
+		return( stream->next - 1 );
+	}
+	return( play_pos );
+}
+
+//Function to update the total number of frames of a streamed input
+/*!
+ * While a stream ( or a live input ) is being received, \a sldr_maxval is the number of frames received so far and the "Total Frames" field shows it with a trailing "+". Once the end of the stream is reached, the length is known and the field shows the final count.
+ * */
+void update_total_frames(){
+	int received = live ? __atomic_load_n( &live->head, __ATOMIC_ACQUIRE ) : stream->ring.head;
+	bool eof = live ? __atomic_load_n( &live->ended, __ATOMIC_ACQUIRE ) : stream->eof;
+	received = MAX( received, 1 );
+	if( received == sldr_maxval && !eof ){
+		return;
+	}
+	sldr_maxval = received;
+	length_known = eof;
+	resetField( numFrames, STATIC_TEXT );
+	sprintf( line, length_known ? "%d" : "%d+", sldr_maxval );
+	cvPutText( numFrames, line, cvPoint( 3, numFrames->height - 4 ), &font, black );
+}
+
+//Function to allocate a ring of frame buffers
+/*!
+ * All the \a size buffers are taken from the frame pool here, so that no memory is allocated while frames are written into the ring.
+ * 
+ * \param ring : The ring to be initialised.
+ * \param size : Number of frames held by the ring.
+ * \param frame_size : Dimensions of every frame.
+ * \param depth : Depth of every frame.
+ * \param channels : Number of channels of every frame.
+ * */
+void ring_create( Frame_Ring* ring, int size, CvSize frame_size, int depth, int channels ){
+	ring->size = size;
+	ring->head = 0;
+	ring->slots = ( Frame_Buf** )malloc( size*sizeof( Frame_Buf* ) );
+	for( int i=0; i<size; i++ ){
+		ring->slots[i] = pool_get( frame_size, depth, channels, false );
+	}
+}
+
+//Function to release a ring of frame buffers
+void ring_release( Frame_Ring* ring ){
+	for( int i=0; i<ring->size; i++ ){
+		frame_unref( ring->slots[i] );
+	}
+	free( ring->slots );
+	ring->slots = NULL;
+	ring->size = 0;
+}
+
+//Function to get the buffer of a given frame
+/*!
+ * \param ring : The ring.
+ * \param frame_no : The desired frame number.
+ * \return The buffer holding the frame, or NULL if the frame is not ( or no longer ) in the ring.
+ * */
+IplImage* ring_slot( Frame_Ring* ring, int frame_no ){
+	if( frame_no<0 || frame_no>=ring->head || frame_no<ring->head-ring->size ){
+		return( NULL );
+	}
+	return( ring->slots[ frame_no%ring->size ]->img );
+}
+
+//Function to get the buffer for the next frame
+/*!
+ * Returns the slot where frame number \a head is to be written. The frame becomes visible through ring_slot() only after ring_commit() is called.
+ * */
+IplImage* ring_next_slot( Frame_Ring* ring ){
+	return( ring->slots[ ring->head%ring->size ]->img );
+}
+
+//Function to commit the next frame
+void ring_commit( Frame_Ring* ring ){
+	ring->head++;
+}
+
+//Function to open a streamed input
+/*!
+ * The input is treated as a stream when it is stdin ( "-" ), a pipe ( FIFO ), a file with <em>.y4m</em> extension or when the <em>--raw</em> option is given. For Y4M input the stream header is parsed for the width ( W ), height ( H ), frame rate ( F ) and colour space ( C ). Only 4:2:0 and mono colour spaces are supported, of 8 to 16 bits ( see parse_pix_fmt() ). For raw input the size, frame rate and format are taken from the <em>--raw</em>, <em>--fps</em> and <em>--pix-fmt</em> options.
+ * 
+ * Once the frame size is known, the plane buffer and the history ring ( \a stream_history frames ) are allocated. No further memory is allocated while the stream is read.
+ * 
+ * \param filename : The input path, "-" for stdin.
+ * \return Pointer to the opened stream, or NULL if the input is not a stream ( or is invalid ).
+ * \sa stream_query(), stream_close().
+ * */
+Y4M_Stream* stream_open( const char* filename ){
+	struct stat st;
+	bool from_stdin = ( strcmp( filename, "-" )==0 );
+	bool is_fifo = ( !from_stdin && stat( filename, &st )==0 && S_ISFIFO( st.st_mode ) );
+	const char* ext = strrchr( filename, '.' );
+	bool is_y4m_file = ( ext && strcmp( ext, ".y4m" )==0 );
+	if( !from_stdin && !is_fifo && !is_y4m_file && raw_width==0 ){
+		return( NULL );
+	}
+	FILE* fp = from_stdin ? stdin : fopen( filename, "rb" );
+	if( !fp ){
+		return( NULL );
+	}
+	Y4M_Stream* s = ( Y4M_Stream* )calloc( 1, sizeof( Y4M_Stream ) );
+	s->fp = fp;
+	s->chroma = STREAM_I420;
+	s->bits = 8;
+	if( raw_width>0 ){
+		s->is_y4m = false;
+		s->chroma = raw_chroma;
+		s->bits = raw_bits;
+		s->width = raw_width;
+		s->height = raw_height;
+		s->fps = raw_fps;
+	}
+	else{
+		//parse the stream header
+		char header[ 256 ];
+		if( !fgets( header, sizeof( header ), fp ) || strncmp( header, "YUV4MPEG2", 9 )!=0 ){
+			printf( "Not a YUV4MPEG2 stream : %s\n", filename );
+			stream_close( &s );
+			return( NULL );
+		}
+		s->is_y4m = true;
+		s->fps = 25;
+		for( char* tok = strtok( header + 9, " \n" ); tok; tok = strtok( NULL, " \n" ) ){
+			int num, den;
+			if( tok[0]=='W' ){
+				s->width = atoi( tok + 1 );
+			}
+			if( tok[0]=='H' ){
+				s->height = atoi( tok + 1 );
+			}
+			if( tok[0]=='F' && sscanf( tok + 1, "%d:%d", &num, &den )==2 && den>0 ){
+				s->fps = num/( double )den;
+			}
+			if( tok[0]=='C' ){
+				if( !parse_pix_fmt( tok + 1, &s->chroma, &s->bits ) ){
+					printf( "Unsupported Y4M colour space : %s\n", tok + 1 );
+					stream_close( &s );
+					return( NULL );
+				}
+			}
+		}
+	}
+	if( s->width<2 || s->height<2 || ( s->chroma==STREAM_I420 && ( s->width%2 || s->height%2 ) ) ){
+		printf( "Invalid stream frame size : %dx%d\n", s->width, s->height );
+		stream_close( &s );
+		return( NULL );
+	}
+	s->plane_bytes = s->width*s->height;
+	if( s->chroma==STREAM_I420 ){
+		s->plane_bytes += s->plane_bytes/2;
+	}
+	if( s->bits>8 ){
+		s->plane_bytes *= 2;
+	}
+	s->planes = ( uchar* )malloc( s->plane_bytes );
+	ring_create( &s->ring, stream_history, cvSize( s->width, s->height ), s->bits>8 ? IPL_DEPTH_16U : IPL_DEPTH_8U, s->chroma==STREAM_MONO ? 1 : 3 );
+	return( s );
+}
+
+//Function to read one frame from the stream into the ring
+/*!
+ * Reads the raw planes of the next frame ( skipping the FRAME header of a Y4M stream ) and converts them to BGR directly into the next slot of the history ring. Luma-only planes are copied as they are.
+ * 
+ * \return false at the end of the stream.
+ * */
+bool stream_read( Y4M_Stream* s ){
+	if( s->eof ){
+		return( false );
+	}
+	if( s->is_y4m ){
+		char header[ 256 ];
+		if( !fgets( header, sizeof( header ), s->fp ) || strncmp( header, "FRAME", 5 )!=0 ){
+			s->eof = true;
+			return( false );
+		}
+	}
+	if( fread( s->planes, 1, s->plane_bytes, s->fp )!=( size_t )s->plane_bytes ){
+		s->eof = true;
+		return( false );
+	}
+	IplImage* slot = ring_next_slot( &s->ring );
+	if( s->chroma==STREAM_I420 && s->bits>8 ){
+		i420_to_bgr16( ( const ushort* )s->planes, slot, s->bits );
+	}
+	else if( s->chroma==STREAM_I420 ){
+		CvMat yuv = cvMat( s->height + s->height/2, s->width, CV_8UC1, s->planes );
+		cvCvtColor( &yuv, slot, CV_YUV2BGR_I420 );
+	}
+	else{
+		CvMat y = cvMat( s->height, s->width, s->bits>8 ? CV_16UC1 : CV_8UC1, s->planes );
+		cvCopy( &y, slot );
+	}
+	ring_commit( &s->ring );
+	return( true );
+}
+
+//Function to fetch the next frame from the stream
+/*!
+ * Returns the frame at the current position of the stream. If the frame has not been received yet, the stream is read up to it. If it has already dropped out of the history window, the oldest frame still held is returned instead.
+ * 
+ * \param s : The stream.
+ * \return The frame ( owned by the ring ), or NULL at the end of the stream.
+ * */
+IplImage* stream_query( Y4M_Stream* s ){
+	while( s->next>=s->ring.head ){
+		if( !stream_read( s ) ){
+			return( NULL );
+		}
+	}
+	s->next = MAX( s->next, s->ring.head - s->ring.size );
+	return( ring_slot( &s->ring, s->next++ ) );
+}
+
+//Function to set the position of the stream
+/*!
+ * Positions beyond the received frames are reached by reading forward on the next stream_query(). Positions before the history window are clamped to the oldest frame held.
+ * */
+void stream_set_pos( Y4M_Stream* s, int pos ){
+	s->next = MAX( pos, MAX( s->ring.head - s->ring.size, 0 ) );
+}
+
+//Function to close a streamed input
+void stream_close( Y4M_Stream** s ){
+	if( !*s ){
+		return;
+	}
+	if( ( *s )->fp && ( *s )->fp!=stdin ){
+		fclose( ( *s )->fp );
+	}
+	if( ( *s )->ring.slots ){
+		ring_release( &( *s )->ring );
+	}
+	free( ( *s )->planes );
+	free( *s );
+	*s = NULL;
+}
+
+//Function to handle the hotkeys
+/*!
+ * Keys pressed while no textbox is being edited are handled here.
+ * <ul>
+ * <li><b>[</b> : marks the current frame as the first frame to be exported.</li>
+ * <li><b>]</b> : marks the current frame as the last frame to be exported.</li>
+ * <li><b>d</b> : cycles the frame-difference display ( off, in place of the frame, blended over the frame ).</li>
+ * <li><b>l</b> : switches the frame difference between luma and per-channel.</li>
+ * <li><b>c</b> : switches the colour map of the luma difference on / off.</li>
+ * <li><b>t</b> : cycles the threshold of the frame difference ( 0, 8, 16, 32, 64 ).</li>
+ * <li><b>+</b> / <b>-</b> : zooms in / out about the centre of the view.</li>
+ * <li><b>0</b> : resets the zoom so that the whole frame is shown.</li>
+ * <li><b>s</b> : shows / hides the statistics ( memory usage, frame pool ) over the frame.</li>
+ * <li><b>f</b> : marks on the slider the frames similar to the current frame, see phash_find().</li>
+ * <li><b>F</b> : removes the markers from the slider.</li>
+ * <li><b>a</b> : cycles the activity signal drawn on the slider ( difference, luma, cuts, none ).</li>
+ * <li><b>L</b> : goes back to the newest frame of a live input and follows it again.</li>
+ * <li><b>n</b> / <b>p</b> : switch to the next / previous video of the playlist.</li>
+ * <li><b>m</b> : marks the current frame, see Marker_Store.</li>
+ * <li><b>M</b> : marks the range set with <b>[</b> and <b>]</b>.</li>
+ * <li><b>u</b> : removes the markers over the current frame.</li>
+ * <li><b>v</b>, <b>V</b>, <b>&lt;</b>, <b>&gt;</b>, <b>{</b>, <b>}</b> : change the window / level, see adjust_window_level().</li>
+ * </ul>
+ * 
+ * \param c : The key returned by <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=waitkey#cvWaitKey" target="_blank"><b>cvWaitKey()</b></a>.
+ * \param cur_frame : The current frame number.
+ * */
+void handle_key( char c, int cur_frame ){
+	if( c=='[' ){
+		export_in = cur_frame;
+		snprintf( status_line, sizeof( status_line ), "In %d", cur_frame );
+		change_status();
+	}
+	if( c==']' ){
+		export_out = cur_frame;
+		snprintf( status_line, sizeof( status_line ), "Out %d", cur_frame );
+		change_status();
+	}
+	if( c=='d' ){
+		diff_mode = ( diff_mode + 1 )%3;
+		sprintf( status_line, "%s", diff_mode==DIFF_OFF ? "Diff off" : ( diff_mode==DIFF_REPLACE ? "Diff" : "Diff blend" ) );
+		change_status();
+	}
+	if( c=='l' ){
+		diff_luma = !diff_luma;
+		build_diff_lut();
+		sprintf( status_line, "%s", diff_luma ? "Diff luma" : "Diff BGR" );
+		change_status();
+	}
+	if( c=='c' ){
+		diff_colormap = !diff_colormap;
+		build_diff_lut();
+		sprintf( status_line, "%s", diff_colormap ? "Heatmap on" : "Heatmap off" );
+		change_status();
+	}
+	if( c=='t' ){
+		diff_threshold = ( diff_threshold==0 ? 8 : ( diff_threshold>=64 ? 0 : 2*diff_threshold ) );
+		snprintf( status_line, sizeof( status_line ), "Threshold %d", diff_threshold );
+		change_status();
+	}
+	if( c=='+' || c=='=' ){
+		zoom_at( 1.25, p_width/2, scrn_height/2 );
+	}
+	if( c=='-' ){
+		zoom_at( 0.8, p_width/2, scrn_height/2 );
+	}
+	if( c=='0' ){
+		zoom_at( 0, p_width/2, scrn_height/2 );
+	}
+	if( c=='s' ){
+		show_stats = !show_stats;
+	}
+	if( c=='e' && filters.count ){
+		filters.enabled = !filters.enabled;
+		sprintf( status_line, "%s", filters.enabled ? "Filters on" : "Filters off" );
+		change_status();
+	}
+	if( c=='f' ){
+		int n = phash_find( cur_frame, PHASH_RADIUS );
+		if( n<0 ){
+			sprintf( status_line, "No index" );
+		}
+		else{
+			snprintf( status_line, sizeof( status_line ), "%d similar", n );
+		}
+		change_status();
+	}
+	if( c=='F' ){
+		phash.nmatches = 0;
+		draw_slider_strip();
+	}
+	if( c=='z' || c=='Z' ){
+		int first, span;
+		tl_window( &first, &span );
+		tl_zoom( c=='z' ? 4 : 0.25, cvRound( ( cur_frame - first )*p_width/( double )span ) );
+	}
+	if( c=='b' ){
+		board_toggle( cur_frame );
+	}
+	if( c=='w' && compare.count ){
+		compare.layout = ( compare.layout + 1 )%3;
+		static const char* names[] = { "Side by side", "Grid", "Wipe" };
+		sprintf( status_line, "%s", names[ compare.layout ] );
+		change_status();
+	}
+	if( c=='q' && quality.size ){
+		quality.shown = !quality.shown;
+		sprintf( status_line, "%s", quality.shown ? "PSNR curve" : "Activity" );
+		change_status();
+		draw_slider_strip();
+	}
+	if( c=='j' && quality.size ){
+		quality.rank = ( quality.rank + 1 )%QUALITY_WORST;
+		int f = quality_worst( quality.rank );
+		if( f<0 ){
+			quality.rank = -1;
+			sprintf( status_line, "No worst frame" );
+		}
+		else{
+			show_frame( f );
+			snprintf( status_line, sizeof( status_line ), "#%d %.1f dB", quality.rank + 1, quality.values[0][f] );
+		}
+		change_status();
+	}
+	if( c=='W' && compare.count ){
+		compare.wiped = compare.wiped%( compare.count - 1 ) + 1;
+		snprintf( status_line, sizeof( status_line ), "Wipe input %d", compare.wiped + 1 );
+		change_status();
+	}
+	if( ( c==',' || c=='.' ) && board.shown ){
+		int cols, rows, cell_w, cell_h;
+		board_layout( &cols, &rows, &cell_w, &cell_h );
+		board_scroll( c==',' ? -rows : rows );
+	}
+	else if( c==',' || c=='.' ){
+		int first, span;
+		tl_window( &first, &span );
+		tl_pan( c==',' ? -span/2 : span/2 );
+	}
+	if( c=='a' ){
+		activity.shown = ( activity.shown==ACT_SIGNALS - 1 ) ? -1 : activity.shown + 1;
+		static const char* names[] = { "Act. diff", "Act. luma", "Act. cuts" };
+		sprintf( status_line, "%s", activity.shown<0 ? "Act. off" : names[ activity.shown ] );
+		change_status();
+		draw_slider_strip();
+	}
+	if( c=='L' && live ){
+		seek_to( __atomic_load_n( &live->head, __ATOMIC_ACQUIRE ) - 1 );
+		live->following = true;
+		set_playing( true );
+		sprintf( status_line, "Live" );
+		change_status();
+	}
+	if( ( c=='n' || c=='p' ) && playlist.count>1 ){
+		playlist_step( c=='n' ? 1 : -1 );
+	}
+	if( c=='m' ){
+		marker_add( cur_frame, cur_frame, 0 );
+		snprintf( status_line, sizeof( status_line ), "Marked %d", cur_frame );
+		change_status();
+		draw_slider_strip();
+	}
+	if( c=='M' ){
+		if( export_in>=0 && export_out>=export_in ){
+			marker_add( export_in, export_out, 0 );
+			sprintf( status_line, "Range marked" );
+			draw_slider_strip();
+		}
+		else{
+			sprintf( status_line, "No range" );
+		}
+		change_status();
+	}
+	if( c=='u' ){
+		snprintf( status_line, sizeof( status_line ), "%d unmarked", marker_remove( cur_frame ) );
+		change_status();
+		draw_slider_strip();
+	}
+	adjust_window_level( c );
+}
+
+//Function to get the number of CPUs
+int num_cpus(){
+	long n = sysconf( _SC_NPROCESSORS_ONLN );
+	return( n>0 ? ( int )n : 1 );
+}
+
+//Function to take threads from the thread budget
+/*!
+ * Grants \a wanted threads, or fewer when the worker pools and the prefetcher already hold most of the budget. At least one thread is granted, so that every pool makes progress even when the budget is exhausted.
+ * 
+ * \param wanted : Number of threads the pool would use.
+ * \return The number of threads granted, to be given back with threads_release().
+ * \sa Thread_Budget.
+ * */
+int threads_take( int wanted ){
+	pthread_mutex_lock( &threads.lock );
+	int granted = MAX( MIN( wanted, threads.total - threads.held ), 1 );
+	threads.held += granted;
+	pthread_mutex_unlock( &threads.lock );
+	return( granted );
+}
+
+//Function to give threads back to the thread budget
+void threads_release( int n ){
+	pthread_mutex_lock( &threads.lock );
+	threads.held = MAX( threads.held - n, 0 );
+	pthread_mutex_unlock( &threads.lock );
+}
+
+//Function to adjust the mode of the decoder and share out the thread budget
+/*!
+ * Called by the main loop every iteration; the decoder is only adjusted every #DECODE_TUNE_FRAMES frames decoded, when the time the main loop takes to decode a frame is measured against the frame period ( the load ). The prefetcher is stopped when the load is under #DECODE_LOAD_LOW, when more than half of the frames prefetched since the last adjustment were wasted or cancelled, or when it would leave no thread to the main loop; it is started again once the load reaches #DECODE_LOAD_HIGH while the playhead moves with a regular stride. What was set with <em>--prefetch-mode</em> is kept. The prefetcher holds a thread of the budget in #DECODE_AHEAD mode only, and OpenCV is given the threads nobody holds.
+ * 
+ * \param reset : True for a newly opened video, which starts with the prefetcher running when its frames have at least #DECODE_AHEAD_PIXELS pixels.
+ * \sa Thread_Budget.
+ * */
+void decode_tune( bool reset ){
+	VP_Stats stats;
+	vp_get_stats( vid, &stats );
+	if( !reset && stats.decoded - threads.decoded<DECODE_TUNE_FRAMES ){
+		return;
+	}
+	pthread_mutex_lock( &frame_cache.lock );
+	long prefetched = frame_cache.prefetched;
+	long wasted = frame_cache.wasted + __atomic_load_n( &frame_cache.cancelled, __ATOMIC_RELAXED );
+	pthread_mutex_unlock( &frame_cache.lock );
+
+	pthread_mutex_lock( &threads.lock );
+	//the threads left by the worker pools, one of which is the main loop's
+	int left = threads.total - threads.held + ( threads.prefetcher ? 1 : 0 );
+	int mode = threads.mode;
+	if( reset ){
+		//nothing measured yet, large frames are expected to be slow to decode
+		VP_Properties props;
+		bool large = ( vp_get_properties( vid, &props )==VP_OK && ( double )props.width*props.height>=DECODE_AHEAD_PIXELS );
+		mode = large ? DECODE_AHEAD : DECODE_DEMAND;
+		threads.load = 0;
+	}
+	else{
+		threads.load = ( stats.decode_ms - threads.decode_ms )/( stats.decoded - threads.decoded )*fps/1e3;
+		long ahead = prefetched - threads.prefetched;
+		bool wasteful = ( ahead>=DECODE_TUNE_FRAMES/4 && 2*( wasted - threads.wasted )>ahead );
+		if( mode==DECODE_AHEAD && ( threads.load<DECODE_LOAD_LOW || wasteful ) ){
+			mode = DECODE_DEMAND;
+		}
+		else if( mode==DECODE_DEMAND && threads.load>=DECODE_LOAD_HIGH && prefetch.stride!=0 ){
+			mode = DECODE_AHEAD;
+		}
+	}
+	if( left<2 ){
+		mode = DECODE_DEMAND;
+	}
+	if( threads.mode_set>=0 ){
+		mode = threads.mode_set;
+	}
+	//the prefetcher holds a thread while it decodes ahead
+	bool prefetcher = ( mode==DECODE_AHEAD && prefetch.depth>0 );
+	threads.held += ( prefetcher ? 1 : 0 ) - ( threads.prefetcher ? 1 : 0 );
+	threads.prefetcher = prefetcher;
+	int opencv = MAX( threads.total - threads.held, 1 );
+	bool changed = ( mode!=threads.mode );
+	__atomic_store_n( &threads.mode, mode, __ATOMIC_RELAXED );
+	threads.tunes += ( changed && !reset );
+	pthread_mutex_unlock( &threads.lock );
+	threads.decoded = stats.decoded;
+	threads.decode_ms = stats.decode_ms;
+	threads.prefetched = prefetched;
+	threads.wasted = wasted;
+
+	//OpenCV's own parallel functions ( resizing, colour conversion, ... ) get the threads nobody holds
+	if( opencv!=threads.opencv ){
+		threads.opencv = opencv;
+		cvSetNumThreads( opencv );
+	}
+	if( changed || reset ){
+		//the prefetcher waits for the mode to change, among others
+		pthread_mutex_lock( &prefetch.lock );
+		pthread_cond_signal( &prefetch.cond );
+		pthread_mutex_unlock( &prefetch.lock );
+	}
+}
+
+//Function to write the state of the thread budget as JSON
+/*!
+ * Writes the budget, the threads held by every worker pool and by the prefetcher, the threads given to OpenCV and the mode and measured load of the decoder as comma separated JSON members.
+ * 
+ * \return The number of characters written.
+ * */
+int thread_metrics( char* buf, int size ){
+	pthread_mutex_lock( &threads.lock );
+	int len = snprintf( buf, size,
+		"\"threads\":%d,\"threads_held\":%d,\"thread_pools\":{\"phash\":%d,\"compare\":%d,\"quality\":%d,\"filters\":%d,\"prefetch\":%d},\"opencv_threads\":%d,\"prefetch_mode\":\"%s\",\"prefetch_auto\":%s,\"decode_load\":%.3f,\"decode_tunes\":%ld",
+		threads.total, threads.held, __atomic_load_n( &phash.running, __ATOMIC_RELAXED ), compare.nworkers, quality.nworkers, filters.nworkers, threads.prefetcher ? 1 : 0,
+		threads.opencv, ( threads.mode==DECODE_DEMAND ) ? "demand" : "ahead", ( threads.mode_set<0 ) ? "true" : "false", threads.load, threads.tunes );
+	pthread_mutex_unlock( &threads.lock );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to export a range of frames
+/*!
+ * The frames \a first, \a first + \a step, ... up to \a last are decoded once, on the calling thread, from \a src or else from the current input, and handed over to \a jobs encoder threads through an Export_Queue. Every file is named after the number of the frame it holds, using \a pattern, so that the exported frames keep their exact frame numbers. If \a pattern ends with <em>.avi</em> the frames are written to a single video file instead; since the frames of a video must be written in order, a single encoder thread is used in that case. Images keep the depth of the frames ( e.g. 16-bit PNG ), while gray or 16-bit frames go to a video through the window / level, as displayed.
+ * 
+ * After the export the position of the video is undefined, the caller has to seek back if required. The number of frames decoded so far is kept in \a export_job.queued, and the export stops early once \a export_job.cancel is set.
+ * 
+ * \param src : A player of the export's own, NULL to export from the current input on the main loop.
+ * \param first : First frame of the range.
+ * \param last : Last frame of the range.
+ * \param step : Distance between two exported frames.
+ * \param pattern : printf() style output pattern ( e.g. <em>frame_%06d.png</em> ) or a video file name.
+ * \param jobs : Number of encoder threads wanted, 0 for as many as the thread budget holds; they are taken from the budget with threads_take().
+ * \return The number of frames written.
+ * \sa export_worker(), <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#saveimage" target="_blank"><b>cvSaveImage()</b></a>.
+ * */
+int export_range( VP_Player* src, int first, int last, int step, const char* pattern, int jobs ){
+	const char* ext = strrchr( pattern, '.' );
+	bool to_video = ( ext && strcmp( ext, ".avi" )==0 );
+	if( !to_video && !export_pattern_valid( pattern ) ){
+		printf( "Export pattern needs exactly one frame number ( e.g. frame_%%06d.png ) : %s\n", pattern );
+		return( 0 );
+	}
+	if( jobs<=0 ){
+		jobs = threads.total;
+	}
+	if( to_video ){
+		jobs = 1;
+	}
+	jobs = threads_take( jobs );
+	step = MAX( step, 1 );
+
+	//position the video at the first frame
+	IplImage* header = NULL;
+	if( src ){
+		vp_seek( src, first + 1 );
+	}
+	else if( live ){
+		live_set_pos( live, first );
+	}
+	else if( stream ){
+		stream_set_pos( stream, first );
+	}
+	else{
+		vp_seek( vid, first + 1 );
+	}
+
+	Export_Queue q;
+	memset( &q, 0, sizeof( q ) );
+	q.pattern = pattern;
+	pthread_mutex_init( &q.lock, NULL );
+	pthread_cond_init( &q.cond, NULL );
+	pthread_t* workers = ( pthread_t* )malloc( jobs*sizeof( pthread_t ) );
+	int nworkers = 0;
+	bool mapped = false;
+
+	for( int frame_no = first; frame_no<=last && !__atomic_load_n( &export_job.cancel, __ATOMIC_RELAXED ); frame_no += step ){
+		if( frame_no>first ){
+			for( int i=0; i<( step - 1 ); i++ ){
+				if( src ){
+					decode_player( src, &header );
+				}
+				else{
+					decode_frame();
+				}
+			}
+		}
+		IplImage* img = src ? decode_player( src, &header ) : decode_frame();
+		if( !img ){
+			break;
+		}
+		__atomic_store_n( &export_job.queued, ( frame_no - first )/step + 1, __ATOMIC_RELAXED );
+		//the buffers and encoders are created once the frame size is known
+		if( !q.bufs ){
+			q.nbufs = 2*jobs;
+			q.bufs = ( Frame_Buf** )malloc( q.nbufs*sizeof( Frame_Buf* ) );
+			q.free_bufs = ( IplImage** )malloc( q.nbufs*sizeof( IplImage* ) );
+			q.full = ( IplImage** )malloc( q.nbufs*sizeof( IplImage* ) );
+			q.full_no = ( int* )malloc( q.nbufs*sizeof( int ) );
+			//a video file only takes 8-bit BGR, deeper or gray frames are written as displayed
+			mapped = to_video && ( img->depth!=IPL_DEPTH_8U || img->nChannels!=3 );
+			for( int i=0; i<q.nbufs; i++ ){
+				q.bufs[i] = mapped ? pool_get( cvGetSize( img ), IPL_DEPTH_8U, 3, false ) : pool_get( cvGetSize( img ), img->depth, img->nChannels, false );
+				q.free_bufs[ q.nfree++ ] = q.bufs[i]->img;
+			}
+			if( to_video ){
+				q.writer = cvCreateVideoWriter( pattern, CV_FOURCC( 'M', 'J', 'P', 'G' ), fps, cvGetSize( img ), 1 );
+				if( !q.writer ){
+					printf( "Cannot create the video file : %s\n", pattern );
+					break;
+				}
+			}
+			for( nworkers=0; nworkers<jobs; nworkers++ ){
+				if( pthread_create( &workers[ nworkers ], NULL, export_worker, &q )!=0 ){
+					break;
+				}
+			}
+			if( nworkers==0 ){
+				printf( "Cannot start the export threads\n" );
+				break;
+			}
+		}
+		//wait for a free buffer and queue the frame
+		pthread_mutex_lock( &q.lock );
+		while( q.nfree==0 ){
+			pthread_cond_wait( &q.cond, &q.lock );
+		}
+		IplImage* buf = q.free_bufs[ --q.nfree ];
+		pthread_mutex_unlock( &q.lock );
+		if( mapped ){
+			window_level( img, buf );
+		}
+		else{
+			cvCopy( img, buf );
+		}
+		pthread_mutex_lock( &q.lock );
+		int tail = ( q.full_head + q.full_count )%q.nbufs;
+		q.full[ tail ] = buf;
+		q.full_no[ tail ] = frame_no;
+		q.full_count++;
+		pthread_cond_broadcast( &q.cond );
+		pthread_mutex_unlock( &q.lock );
+	}
+
+	//let the encoders drain the queue
+	pthread_mutex_lock( &q.lock );
+	q.done = true;
+	pthread_cond_broadcast( &q.cond );
+	pthread_mutex_unlock( &q.lock );
+	for( int i=0; i<nworkers; i++ ){
+		pthread_join( workers[i], NULL );
+	}
+	threads_release( jobs );
+	if( q.failed>0 ){
+		printf( "%d frames could not be written\n", q.failed );
+	}
+
+	if( q.writer ){
+		cvReleaseVideoWriter( &q.writer );
+	}
+	for( int i=0; i<q.nbufs; i++ ){
+		frame_unref( q.bufs[i] );
+	}
+	free( q.bufs );
+	free( q.free_bufs );
+	free( q.full );
+	free( q.full_no );
+	free( workers );
+	if( header ){
+		cvReleaseImageHeader( &header );
+	}
+	pthread_cond_destroy( &q.cond );
+	pthread_mutex_destroy( &q.lock );
+	return( q.written );
+}
+
+//Function to check an export pattern
+/*!
+ * The pattern is used as the format of snprintf() with the frame number as its only argument, so it must hold exactly one integer conversion ( <em>%d</em>, <em>%i</em> or <em>%u</em>, with optional flags, width and precision ) and no other conversion but <em>%%</em>.
+ * 
+ * \param pattern : The pattern given with <em>--export-to</em>.
+ * \return true if the pattern can be used.
+ * */
+bool export_pattern_valid( const char* pattern ){
+	int conversions = 0;
+	for( const char* p = pattern; *p; p++ ){
+		if( *p!='%' ){
+			continue;
+		}
+		if( *++p=='%' ){
+			continue;
+		}
+		p += strspn( p, "-+ #0" );
+		p += strspn( p, "0123456789" );
+		if( *p=='.' ){
+			p++;
+			p += strspn( p, "0123456789" );
+		}
+		if( *p!='d' && *p!='i' && *p!='u' ){
+			return( false );
+		}
+		conversions++;
+	}
+	return( conversions==1 );
+}
+
+//Function run by the encoder threads
+/*!
+ * Takes the queued frames in order and writes them, either as an image named after the frame number or to the output video. Returns once the decoder is done and the queue is empty.
+ * 
+ * \param arg : Pointer to the Export_Queue.
+ * \sa export_range().
+ * */
+void* export_worker( void* arg ){
+	Export_Queue* q = ( Export_Queue* )arg;
+	char name[ 1024 ];
+	while( 1 ){
+		pthread_mutex_lock( &q->lock );
+		while( q->full_count==0 && !q->done ){
+			pthread_cond_wait( &q->cond, &q->lock );
+		}
+		if( q->full_count==0 ){
+			pthread_mutex_unlock( &q->lock );
+			break;
+		}
+		IplImage* buf = q->full[ q->full_head ];
+		int frame_no = q->full_no[ q->full_head ];
+		q->full_head = ( q->full_head + 1 )%q->nbufs;
+		q->full_count--;
+		pthread_mutex_unlock( &q->lock );
+
+		bool ok;
+		if( q->writer ){
+			ok = ( cvWriteFrame( q->writer, buf )!=0 );
+		}
+		else{
+			snprintf( name, sizeof( name ), q->pattern, frame_no );
+			ok = ( cvSaveImage( name, buf )!=0 );
+		}
+
+		pthread_mutex_lock( &q->lock );
+		if( ok ){
+			q->written++;
+		}
+		else{
+			q->failed++;
+		}
+		q->free_bufs[ q->nfree++ ] = buf;
+		pthread_cond_broadcast( &q->cond );
+		pthread_mutex_unlock( &q->lock );
+	}
+	return( NULL );
+}
+
+//Function to start exporting a range of frames in the background
+/*!
+ * Opens the current video file once more and exports the range from it on a thread of its own, so that the window stays responsive; the progress is shown by export_poll().
+ * 
+ * \param first : First frame of the range.
+ * \param last : Last frame of the range.
+ * \param step : Distance between two exported frames.
+ * \return false when the video cannot be opened again, the caller then exports on the main loop.
+ * \sa Export_Job.
+ * */
+bool export_start( int first, int last, int step ){
+	if( !( export_job.player = vp_open( playlist.paths[ playlist.cur ] ) ) ){
+		return( false );
+	}
+	export_job.first = first;
+	export_job.last = last;
+	export_job.step = MAX( step, 1 );
+	export_job.total = MAX( ( last - first )/export_job.step + 1, 1 );
+	export_job.queued = 0;
+	export_job.shown = -1;
+	export_job.finished = false;
+	export_job.cancel = false;
+	if( pthread_create( &export_job.thread, NULL, export_thread, NULL )!=0 ){
+		vp_close( export_job.player );
+		export_job.player = NULL;
+		return( false );
+	}
+	return( true );
+}
+
+//Function run by the thread of an export started from the window
+void* export_thread( void* arg ){
+	export_job.written = export_range( export_job.player, export_job.first, export_job.last, export_job.step, export_pattern, export_jobs );
+	__atomic_store_n( &export_job.finished, true, __ATOMIC_RELEASE );
+	return( NULL );
+}
+
+//Function to show the progress of a background export and finish it
+/*!
+ * Called by the main loop every iteration. Shows the part of the range exported in the status field while the export runs, and the number of frames written once it has finished.
+ * */
+void export_poll(){
+	if( !export_job.player ){
+		return;
+	}
+	if( !__atomic_load_n( &export_job.finished, __ATOMIC_ACQUIRE ) ){
+		int percent = 100*__atomic_load_n( &export_job.queued, __ATOMIC_RELAXED )/export_job.total;
+		if( percent!=export_job.shown ){
+			export_job.shown = percent;
+			snprintf( status_line, sizeof( status_line ), "Exporting %d%%", percent );
+			change_status();
+		}
+		return;
+	}
+	pthread_join( export_job.thread, NULL );
+	vp_close( export_job.player );
+	export_job.player = NULL;
+	snprintf( status_line, sizeof( status_line ), "Exported %d", export_job.written );
+	change_status();
+}
+
+//Function to stop a background export
+void export_cancel(){
+	if( !export_job.player ){
+		return;
+	}
+	__atomic_store_n( &export_job.cancel, true, __ATOMIC_RELAXED );
+	pthread_join( export_job.thread, NULL );
+	vp_close( export_job.player );
+	export_job.player = NULL;
+}
+
+//Function to show the current frame
+/*!
+ * The visible region of the current frame ( \a old_frame, see get_view_rect() ) is resized to the display resolution into \a disp_cur, and goes through the filter pipeline when it has stages ( see Filter_Pipeline ). The region is selected as the ROI of the full-resolution frame, so only the visible pixels are resampled and zooming never needs a new decode. A gray or high bit depth frame is resized at its own format into \a disp_native and mapped to BGR by window_level(), so the window / level costs one table look-up per displayed sample, whatever the resolution of the video; an 8-bit BGR frame goes through the table only when the window / level has been changed. When zoomed to pixel level, nearest-neighbour interpolation is used so that individual pixels are visible. If a new frame is being displayed, \a disp_cur and \a disp_prev are swapped first so that the previous frame is retained. Depending on \a diff_mode, the frame itself, the difference between the current and the previous frame, or both blended are then copied to \a frame_area.
+ * 
+ * The difference is computed with the vectorised kernels absdiff_u8(), threshold_u8() and blend_u8() at display resolution, while the colour map and the gain are applied using a look-up table. Therefore the frame-difference display costs about as much as a copy of the displayed image.
+ * 
+ * \param cur_frame : The current frame number.
+ * \sa build_diff_lut().
+ * */
+void render_frame( int cur_frame ){
+	bool new_frame = ( cur_frame!=shown_frame );
+	if( new_frame ){
+		IplImage* tmp = disp_prev;
+		disp_prev = disp_cur;
+		disp_cur = tmp;
+		tmp = gray_prev;
+		gray_prev = gray_cur;
+		gray_cur = tmp;
+		gray_prev_ok = gray_cur_ok;
+		shown_frame = cur_frame;
+	}
+	//only the visible region of the frame is resampled
+	view_rect = get_view_rect( cvGetSize( old_frame ) );
+	bool pixel_level = ( view_rect.width*2<=disp_cur->width );
+	bool filtered = ( filters.count && filters.enabled );
+	bool bgr = ( old_frame->depth==IPL_DEPTH_8U && old_frame->nChannels==3 );
+	//a frame filtered when shown before is not filtered again
+	bool kept = ( filtered && filter_lookup( cur_frame, disp_cur ) );
+	if( !kept && filtered && filters.full && bgr ){
+		filter_frame( cur_frame, old_frame, disp_cur, pixel_level );
+	}
+	else if( !kept ){
+		cvSetImageROI( old_frame, view_rect );
+		if( bgr ){
+			cvResize( old_frame, disp_cur, pixel_level ? CV_INTER_NN : CV_INTER_LINEAR );
+			if( !wl_identity ){
+				window_level( disp_cur, disp_cur );
+			}
+		}
+		else{
+			if( !disp_native || disp_native->depth!=old_frame->depth || disp_native->nChannels!=old_frame->nChannels ){
+				if( disp_native ){
+					cvReleaseImage( &disp_native );
+				}
+				disp_native = cvCreateImage( cvGetSize( disp_cur ), old_frame->depth, old_frame->nChannels );
+			}
+			cvResize( old_frame, disp_native, pixel_level ? CV_INTER_NN : CV_INTER_LINEAR );
+			window_level( disp_native, disp_cur );
+		}
+		cvResetImageROI( old_frame );
+		if( filtered ){
+			filter_frame( cur_frame, NULL, disp_cur, pixel_level );
+		}
+	}
+	gray_cur_ok = false;
+	if( diff_mode==DIFF_OFF ){
+		cvCopy( disp_cur, frame_area );
+		return;
+	}
+	if( diff_luma ){
+		if( !gray_prev_ok ){
+			cvCvtColor( disp_prev, gray_prev, CV_BGR2GRAY );
+			gray_prev_ok = true;
+		}
+		cvCvtColor( disp_cur, gray_cur, CV_BGR2GRAY );
+		gray_cur_ok = true;
+		for( int row=0; row<diff_gray->height; row++ ){
+			uchar* ptr = ( uchar* )( diff_gray->imageData + row*diff_gray->widthStep );
+			absdiff_u8(
+				( uchar* )( gray_cur->imageData + row*gray_cur->widthStep ),
+				( uchar* )( gray_prev->imageData + row*gray_prev->widthStep ),
+				ptr, diff_gray->width
+			);
+			threshold_u8( ptr, diff_gray->width, diff_threshold );
+		}
+		cvCvtColor( diff_gray, diff_img, CV_GRAY2BGR );
+	}
+	else{
+		for( int row=0; row<diff_img->height; row++ ){
+			uchar* ptr = ( uchar* )( diff_img->imageData + row*diff_img->widthStep );
+			absdiff_u8(
+				( uchar* )( disp_cur->imageData + row*disp_cur->widthStep ),
+				( uchar* )( disp_prev->imageData + row*disp_prev->widthStep ),
+				ptr, diff_img->width*diff_img->nChannels
+			);
+			threshold_u8( ptr, diff_img->width*diff_img->nChannels, diff_threshold );
+		}
+	}
+	cvLUT( diff_img, diff_img, diff_lut );
+	if( diff_mode==DIFF_REPLACE ){
+		cvCopy( diff_img, frame_area );
+	}
+	else{
+		for( int row=0; row<frame_area->height; row++ ){
+			blend_u8(
+				( uchar* )( disp_cur->imageData + row*disp_cur->widthStep ),
+				( uchar* )( diff_img->imageData + row*diff_img->widthStep ),
+				( uchar* )( frame_area->imageData + row*frame_area->widthStep ),
+				frame_area->width*frame_area->nChannels
+			);
+		}
+	}
+}
+
+//Function to build the look-up table of the frame difference
+/*!
+ * Every difference value \f$ d \f$ is first multiplied by \a diff_gain ( saturating at 255 ). For the colour-mapped luma difference, the result is then mapped to a heat colour going from black through blue, red and yellow to white; otherwise it is left gray.
+ * */
+void build_diff_lut(){
+	uchar* ptr = diff_lut->data.ptr;
+	for( int d=0; d<256; d++ ){
+		int v = MIN( d*diff_gain, 255 );
+		if( diff_luma && diff_colormap ){
+			//4 segments of 64 values each
+			int seg = v/64, f = ( v%64 )*4;
+			int b[] = { f, 255 - f, 0, f };
+			int g[] = { 0, 0, f, 255 };
+			int r[] = { 0, f, 255, 255 };
+			ptr[ d*3 + 0 ] = b[ seg ];
+			ptr[ d*3 + 1 ] = g[ seg ];
+			ptr[ d*3 + 2 ] = r[ seg ];
+		}
+		else{
+			ptr[ d*3 + 0 ] = v;
+			ptr[ d*3 + 1 ] = v;
+			ptr[ d*3 + 2 ] = v;
+		}
+	}
+}
+
+//Function to compute the absolute difference of two rows
+/*!
+ * Computes \f$ dst = |a - b| \f$ for \a n bytes. With SSE2, 16 bytes are processed at a time as the bitwise OR of the two saturated differences \f$ (a - b) \f$ and \f$ (b - a) \f$, one of which is always 0.
+ * */
+void absdiff_u8( const uchar* a, const uchar* b, uchar* dst, int n ){
+	int i = 0;
+#ifdef __SSE2__
+	for( ; i + 16<=n; i += 16 ){
+		__m128i va = _mm_loadu_si128( ( const __m128i* )( a + i ) );
+		__m128i vb = _mm_loadu_si128( ( const __m128i* )( b + i ) );
+		_mm_storeu_si128( ( __m128i* )( dst + i ), _mm_or_si128( _mm_subs_epu8( va, vb ), _mm_subs_epu8( vb, va ) ) );
+	}
+#endif
+	for( ; i<n; i++ ){
+		dst[i] = a[i]>b[i] ? a[i] - b[i] : b[i] - a[i];
+	}
+}
+
+//Function to threshold a row
+/*!
+ * Values lower than \a thresh are set to 0, the others are kept. With SSE2, a value \f$ v \f$ is below the threshold when the saturated difference \f$ thresh - v \f$ is not 0.
+ * */
+void threshold_u8( uchar* data, int n, int thresh ){
+	if( thresh<=0 ){
+		return;
+	}
+	int i = 0;
+#ifdef __SSE2__
+	__m128i vt = _mm_set1_epi8( ( char )thresh );
+	__m128i zero = _mm_setzero_si128();
+	for( ; i + 16<=n; i += 16 ){
+		__m128i v = _mm_loadu_si128( ( const __m128i* )( data + i ) );
+		__m128i keep = _mm_cmpeq_epi8( _mm_subs_epu8( vt, v ), zero );
+		_mm_storeu_si128( ( __m128i* )( data + i ), _mm_and_si128( v, keep ) );
+	}
+#endif
+	for( ; i<n; i++ ){
+		if( data[i]<thresh ){
+			data[i] = 0;
+		}
+	}
+}
+
+//Function to blend two rows
+/*!
+ * Computes the rounded average \f$ dst = (a + b + 1)/2 \f$ for \a n bytes, 16 bytes at a time with SSE2.
+ * */
+void blend_u8( const uchar* a, const uchar* b, uchar* dst, int n ){
+	int i = 0;
+#ifdef __SSE2__
+	for( ; i + 16<=n; i += 16 ){
+		__m128i va = _mm_loadu_si128( ( const __m128i* )( a + i ) );
+		__m128i vb = _mm_loadu_si128( ( const __m128i* )( b + i ) );
+		_mm_storeu_si128( ( __m128i* )( dst + i ), _mm_avg_epu8( va, vb ) );
+	}
+#endif
+	for( ; i<n; i++ ){
+		dst[i] = ( a[i] + b[i] + 1 )/2;
+	}
+}
+
+//Function to get the visible region of the frame
+/*!
+ * Computes the region of a frame of size \a frame_size which is shown at the current \a zoom, centred at ( \a view_cx, \a view_cy ). The region is kept inside the frame; the centre is updated accordingly so that panning beyond the border of the frame has no effect.
+ * 
+ * \param frame_size : Size of the full-resolution frame.
+ * \return The visible region.
+ * */
+CvRect get_view_rect( CvSize frame_size ){
+	CvRect rect;
+	rect.width = MAX( cvRound( frame_size.width/zoom ), 1 );
+	rect.height = MAX( cvRound( frame_size.height/zoom ), 1 );
+	if( view_cx<0 || view_cy<0 ){
+		view_cx = frame_size.width/2.0;
+		view_cy = frame_size.height/2.0;
+	}
+	rect.x = MIN( MAX( cvRound( view_cx - rect.width/2.0 ), 0 ), frame_size.width - rect.width );
+	rect.y = MIN( MAX( cvRound( view_cy - rect.height/2.0 ), 0 ), frame_size.height - rect.height );
+	view_cx = rect.x + rect.width/2.0;
+	view_cy = rect.y + rect.height/2.0;
+	return( rect );
+}
+
+//Function to zoom about a point
+/*!
+ * Multiplies the zoom by \a factor, keeping the pixel of the frame under the point ( \a x, \a y ) of the frame area at the same place. The zoom is limited between 1 ( the whole frame ) and the zoom at which a video pixel covers #ZOOM_PIXEL_MAX screen pixels. A \a factor of 0 resets the zoom to 1.
+ * 
+ * \param factor : Zoom multiplier.
+ * \param x : x coordinate in the frame area.
+ * \param y : y coordinate in the frame area.
+ * */
+void zoom_at( double factor, int x, int y ){
+	if( !old_frame ){
+		return;
+	}
+	double zoom_max = MAX( ZOOM_PIXEL_MAX*MAX( old_frame->width/( double )p_width, old_frame->height/( double )scrn_height ), 1.0 );
+	//frame pixel under the point
+	double fx = view_rect.x + x*view_rect.width/( double )p_width;
+	double fy = view_rect.y + y*view_rect.height/( double )scrn_height;
+	zoom = ( factor==0 ) ? 1 : MIN( MAX( zoom*factor, 1.0 ), zoom_max );
+	double w = old_frame->width/zoom;
+	double h = old_frame->height/zoom;
+	view_cx = fx - x*w/p_width + w/2;
+	view_cy = fy - y*h/scrn_height + h/2;
+	view_rect = get_view_rect( cvGetSize( old_frame ) );
+}
+
+//Function to show the pixel value under the mouse
+/*!
+ * Maps the point ( \a x, \a y ) of the frame area to the full-resolution frame and shows the coordinates and the BGR value of that pixel, along with the current zoom, in the \a pixel_info field. The samples are shown as stored, i.e. before the window / level, and a gray frame shows a single value.
+ * */
+void show_pixel( int x, int y ){
+	if( !old_frame || view_rect.width==0 ){
+		return;
+	}
+	int fx = MIN( view_rect.x + x*view_rect.width/p_width, old_frame->width - 1 );
+	int fy = MIN( view_rect.y + y*view_rect.height/scrn_height, old_frame->height - 1 );
+	const char* ptr = old_frame->imageData + fy*old_frame->widthStep;
+	int v[ 3 ];
+	for( int chl=0; chl<3; chl++ ){
+		int i = fx*old_frame->nChannels + MIN( chl, old_frame->nChannels - 1 );
+		v[ chl ] = ( old_frame->depth==IPL_DEPTH_16U ) ? ( ( const ushort* )ptr )[i] : ( ( const uchar* )ptr )[i];
+	}
+	char text[ 64 ];
+	if( old_frame->nChannels==1 ){
+		snprintf( text, sizeof( text ), "( %d, %d ) V:%d   x%.1f", fx, fy, v[0], zoom );
+	}
+	else{
+		snprintf( text, sizeof( text ), "( %d, %d ) B:%d G:%d R:%d   x%.1f", fx, fy, v[0], v[1], v[2], zoom );
+	}
+	resetField( pixel_info, STATIC_TEXT );
+	cvPutText( pixel_info, text, cvPoint( 3, pixel_info->height - 4 ), &font, black );
+}
+
+//Function to update the histogram area
+/*!
+ * If the histograms of \a cur_frame are in the cache they are drawn ( once ). Otherwise, if the histogram thread is idle, a reference to the current frame is handed over to the thread; the frame is neither copied nor subsampled here. While the thread is busy no new request is made, so during playback the histograms are refreshed as often as the thread can compute them, without ever delaying the display.
+ * 
+ * \param cur_frame : The current frame number.
+ * \sa hist_worker(), draw_histogram().
+ * */
+void update_histogram( int cur_frame ){
+	Hist_Entry entry;
+	bool cached = false, request = false;
+	pthread_mutex_lock( &hist_lock );
+	Hist_Entry* e = &hist_cache[ cur_frame%HIST_CACHE_SIZE ];
+	if( e->frame_no==cur_frame ){
+		cached = true;
+		if( hist_shown!=cur_frame ){
+			entry = *e;
+		}
+	}
+	else if( !hist_pending ){
+		request = true;
+	}
+	pthread_mutex_unlock( &hist_lock );
+	if( cached ){
+		if( hist_shown!=cur_frame ){
+			draw_histogram( &entry );
+			hist_shown = cur_frame;
+		}
+		return;
+	}
+	if( request ){
+		//the buffer is not written to while the thread holds a reference to it, see set_current()
+		pthread_mutex_lock( &hist_lock );
+		hist_buf = frame_ref( cur_buf );
+		hist_request = cur_frame;
+		hist_pending = true;
+		pthread_cond_signal( &hist_cond );
+		pthread_mutex_unlock( &hist_lock );
+	}
+}
+
+//Function run by the histogram thread
+/*!
+ * Waits for a request from update_histogram(), computes the histograms of \a hist_buf, subsampled by \a hist_stride, and stores them in the cache. The reference to \a hist_buf is then dropped.
+ * */
+void* hist_worker( void* arg ){
+	Hist_Entry entry;
+	pthread_mutex_lock( &hist_lock );
+	while( 1 ){
+		while( !hist_pending && !hist_quit ){
+			pthread_cond_wait( &hist_cond, &hist_lock );
+		}
+		if( hist_quit ){
+			break;
+		}
+		int frame_no = hist_request, epoch = hist_epoch, stride = hist_stride;
+		Frame_Buf* buf = hist_buf;
+		hist_buf = NULL;
+		pthread_mutex_unlock( &hist_lock );
+		compute_histogram( buf->img, stride, &entry );
+		frame_unref( buf );
+		entry.frame_no = frame_no;
+		pthread_mutex_lock( &hist_lock );
+		if( epoch==hist_epoch ){
+			hist_cache[ frame_no%HIST_CACHE_SIZE ] = entry;
+		}
+		hist_pending = false;
+	}
+	pthread_mutex_unlock( &hist_lock );
+	return( NULL );
+}
+
+//Function to compute histograms
+/*!
+ * Computes the blue, green, red and luma histograms of a BGR image, using every \a stride-th pixel of every \a stride-th row, where luma is \f$ Y = ( 29B + 150G + 77R )/256 \f$ in integer arithmetic. The four histograms of a gray image are alike. Samples of more than 8 bits are binned by their 8 most significant bits of \a native_bits. Two consecutive pixels are counted into two separate sets of bins which are added at the end; this avoids the stall of incrementing the same bin twice in a row on flat areas, the common case in video. The mean and standard deviation are then derived from the histograms alone.
+ * 
+ * \param img : The BGR or gray image, 8 or 16 bits.
+ * \param stride : Subsampling stride, 1 to use every pixel.
+ * \param e : The entry receiving the histograms and statistics.
+ * */
+void compute_histogram( const IplImage* img, int stride, Hist_Entry* e ){
+	unsigned int bins2[ 4 ][ 256 ];
+	memset( e->bins, 0, sizeof( e->bins ) );
+	memset( bins2, 0, sizeof( bins2 ) );
+	int cols = ( img->width + stride - 1 )/stride;
+	int rows = ( img->height + stride - 1 )/stride;
+	PIXEL_DISPATCH( img, histogram_k, ( img, stride, e->bins, bins2, MAX( native_bits - 8, 0 ) ) );
+	double n = cols*( double )rows;
+	for( int chl=0; chl<4; chl++ ){
+		double sum = 0, sum_sq = 0;
+		for( int v=0; v<256; v++ ){
+			e->bins[ chl ][ v ] += bins2[ chl ][ v ];
+			sum += v*( double )e->bins[ chl ][ v ];
+			sum_sq += v*( double )v*e->bins[ chl ][ v ];
+		}
+		e->mean[ chl ] = sum/n;
+		e->sdv[ chl ] = sqrt( MAX( sum_sq/n - e->mean[ chl ]*e->mean[ chl ], 0.0 ) );
+	}
+}
+
+//Function to draw histograms
+/*!
+ * The four histograms are drawn as curves ( two bins per column, normalised to the highest bin ) in the left part of \a hist_area, and the mean and standard deviation of every channel are written to the right of them.
+ * */
+void draw_histogram( const Hist_Entry* e ){
+	static const char* names[] = { "B", "G", "R", "Y" };
+	CvScalar colors[] = { blue, green, red, black };
+	int width = 128, height = hist_area->height - 4;
+	resetField( hist_area, EDIT_TEXT );
+	unsigned int peak = 1;
+	for( int chl=0; chl<4; chl++ ){
+		for( int v=0; v<256; v++ ){
+			peak = MAX( peak, e->bins[ chl ][ v ] );
+		}
+	}
+	for( int chl=0; chl<4; chl++ ){
+		CvPoint prev = cvPoint( 2, height + 1 );
+		for( int x=0; x<width; x++ ){
+			unsigned int count = e->bins[ chl ][ 2*x ] + e->bins[ chl ][ 2*x + 1 ];
+			CvPoint pt = cvPoint( 2 + x, height + 1 - ( int )( count*( double )height/( 2.0*peak ) ) );
+			pt.y = MAX( pt.y, 2 );
+			cvLine( hist_area, prev, pt, colors[ chl ] );
+			prev = pt;
+		}
+	}
+	char text[ 32 ];
+	for( int chl=0; chl<4; chl++ ){
+		snprintf( text, sizeof( text ), "%s m%6.1f s%5.1f", names[ chl ], e->mean[ chl ], e->sdv[ chl ] );
+		cvPutText( hist_area, text, cvPoint( width + 8, 18 + chl*19 ), &font_small, colors[ chl ] );
+	}
+}
+
+//Function to start or pause playing
+/*!
+ * Sets \a engine.playing and shows the matching button and status.
+ * 
+ * \param play : true to start playing, false to pause.
+ * */
+void set_playing( bool play ){
+	engine.playing = play;
+	//playing again after a pause goes on from the paused frame, behind the live input
+	if( live && !play ){
+		live->following = false;
+	}
+	getButton( play_pause_btn, play ? PAUSE_BTN : PLAY_BTN, BTN_ACTIVE );
+	sprintf( status_line, play ? "Playing" : "Paused" );
+	change_status();
+}
+
+//Function to step frames
+/*!
+ * Steps \a k frames forward ( \a k > 0 ), by fetching the frames in between, or \a -k frames back ( \a k < 0 ), by seeking. Steps going beyond the first or the last frame are ignored. This is what the step-up and step-down buttons do with \a k = #step_val.
+ * 
+ * \param k : The number of frames to step.
+ * */
+void step_frames( int k ){
+	int cur_frame = get_frame_pos();
+	//printf( "Frame val : %d\n", cur_frame );
+	if( k>0 ){
+		if( !length_known || cur_frame + k < sldr_maxval ){
+			skip_frames( k - 1 );
+			frame = query_frame();
+			if( frame ){
+				set_current( frame );
+			}
+		}
+	}
+	if( k<0 ){
+		if( cur_frame + k >= sldr_start ){
+			//cur_frame is the frame shown, seek_frame() would land two frames further in a video file
+			show_frame( cur_frame + k );
+			//printf( "New Frame val : %d\n", get_frame_pos() );
+		}
+	}
+}
+
+//Function to go to a frame
+/*!
+ * Goes to frame \a frame_no the way the slider does. The frame actually reached is given by get_frame_pos() afterwards.
+ * */
+void seek_to( int frame_no ){
+	frame_no = MAX( frame_no, sldr_start );
+	if( length_known ){
+		frame_no = MIN( frame_no, sldr_maxval - 1 );
+	}
+	moveSlider( frame_no, OTHER_CALLS );
+	//a stream ( or live input ) returns the frame at the position set, a CvCapture the one after it
+	seek_frame( ( stream || live ) ? frame_no : frame_no - 1 );
+}
+
+//Function to show a frame
+/*!
+ * Goes to the frame numbered \a frame_no the way get_frame_pos() numbers them, for the places which jump to a frame found rather than to a slider position: seek_to() shows the frame after the one asked for in a video file, but that very frame in a stream or a live input.
+ * */
+void show_frame( int frame_no ){
+	seek_to( ( stream || live ) ? frame_no : frame_no - 1 );
+}
+
+//Function to open the command socket
+/*!
+ * Creates a Unix-domain stream socket listening at \a path ( an existing socket file is replaced ) and starts cmd_listener() to accept its clients.
+ * 
+ * \param path : Path of the socket.
+ * \return false if the socket could not be created.
+ * */
+bool start_command_socket( const char* path ){
+	struct sockaddr_un addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sun_family = AF_UNIX;
+	if( strlen( path )>=sizeof( addr.sun_path ) ){
+		printf( "Socket path too long : %s\n", path );
+		return( false );
+	}
+	strcpy( addr.sun_path, path );
+	cmd_listen_fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	unlink( path );
+	if( cmd_listen_fd<0 || bind( cmd_listen_fd, ( struct sockaddr* )&addr, sizeof( addr ) )!=0 || listen( cmd_listen_fd, 4 )!=0 ){
+		printf( "Cannot open the command socket : %s\n", path );
+		return( false );
+	}
+	pthread_t listener;
+	pthread_create( &listener, NULL, cmd_listener, NULL );
+	pthread_detach( listener );
+	return( true );
+}
+
+//Function accepting the clients of the command socket
+/*!
+ * Every accepted connection gets its own cmd_reader() thread.
+ * */
+void* cmd_listener( void* arg ){
+	while( 1 ){
+		int fd = accept( cmd_listen_fd, NULL, NULL );
+		if( fd<0 ){
+			break;
+		}
+		Cmd_Client* client = ( Cmd_Client* )calloc( 1, sizeof( Cmd_Client ) );
+		client->in_fd = fd;
+		client->out_fd = fd;
+		client->refs = 1;
+		pthread_t reader;
+		pthread_create( &reader, NULL, cmd_reader, client );
+		pthread_detach( reader );
+	}
+	return( NULL );
+}
+
+//Function reading the commands of a client
+/*!
+ * Reads the client line by line. A line may hold several commands separated by ';', which are queued in order. Every command gets exactly one reply, written by the main loop once the command has been executed. When stdin reaches its end in headless mode, a <em>quit</em> command is queued so that the player exits once all the commands are done.
+ * 
+ * \param arg : Pointer to the Cmd_Client.
+ * \sa parse_command(), push_command().
+ * */
+void* cmd_reader( void* arg ){
+	Cmd_Client* client = ( Cmd_Client* )arg;
+	char buf[ 4096 ];
+	int len = 0;
+	Command cmd;
+	while( 1 ){
+		int n = read( client->in_fd, buf + len, sizeof( buf ) - 1 - len );
+		if( n<=0 ){
+			break;
+		}
+		len += n;
+		buf[ len ] = '\0';
+		char* start = buf;
+		char* end;
+		while( ( end = strchr( start, '\n' ) ) ){
+			*end = '\0';
+			char* save;
+			for( char* tok = strtok_r( start, ";", &save ); tok; tok = strtok_r( NULL, ";", &save ) ){
+				parse_command( tok, &cmd );
+				if( cmd.type>=0 ){
+					cmd.client = client;
+					push_command( &cmd );
+				}
+			}
+			start = end + 1;
+		}
+		len -= start - buf;
+		memmove( buf, start, len );
+		if( len==( int )sizeof( buf ) - 1 ){
+			//line too long, drop it
+			len = 0;
+		}
+	}
+	if( client->in_fd==0 && headless ){
+		cmd.type = CMD_QUIT;
+		cmd.client = client;
+		push_command( &cmd );
+	}
+	release_client( client );
+	return( NULL );
+}
+
+//Function to parse a command
+/*!
+ * Parses one command of the form <em>name [arguments]</em>. Blank commands set \a type to -1 and are ignored; unknown or malformed commands become CMD_INVALID so that their error is reported in order with the other replies.
+ * 
+ * \param text : The command text ( modified ).
+ * \param cmd : The parsed command.
+ * */
+void parse_command( char* text, Command* cmd ){
+	char name[ 32 ] = "";
+	int n = 0;
+	memset( cmd, 0, sizeof( Command ) );
+	cmd->type = CMD_INVALID;
+	snprintf( cmd->path, sizeof( cmd->path ), "%s", text );
+	if( sscanf( text, "%31s%n", name, &n )!=1 ){
+		cmd->type = -1;
+		return;
+	}
+	char* args = text + n;
+	if( !strcmp( name, "seek" ) && sscanf( args, "%d", &cmd->arg )==1 ){
+		cmd->type = CMD_SEEK;
+	}
+	if( !strcmp( name, "step" ) && sscanf( args, "%d", &cmd->arg )==1 ){
+		cmd->type = CMD_STEP;
+	}
+	if( !strcmp( name, "play" ) ){
+		cmd->type = CMD_PLAY;
+	}
+	if( !strcmp( name, "pause" ) ){
+		cmd->type = CMD_PAUSE;
+	}
+	if( !strcmp( name, "get-frame" ) && sscanf( args, "%d", &cmd->arg )==1 ){
+		cmd->type = CMD_GET_FRAME;
+		cmd->path[0] = '\0';
+		sscanf( args, "%*d %255s", cmd->path );
+	}
+	if( !strcmp( name, "metrics" ) ){
+		cmd->type = CMD_METRICS;
+	}
+	if( !strcmp( name, "quit" ) ){
+		cmd->type = CMD_QUIT;
+	}
+	if( !strcmp( name, "worst" ) ){
+		cmd->type = CMD_WORST;
+		if( sscanf( args, "%d", &cmd->arg )!=1 ){
+			cmd->arg = 1;
+		}
+	}
+	if( !strcmp( name, "similar" ) ){
+		cmd->type = CMD_SIMILAR;
+		if( sscanf( args, "%d", &cmd->arg )!=1 ){
+			cmd->arg = PHASH_RADIUS;
+		}
+		cmd->arg = MIN( MAX( cmd->arg, 0 ), 64 );
+	}
+	if( !strcmp( name, "next" ) ){
+		cmd->type = CMD_NEXT;
+	}
+	if( !strcmp( name, "prev" ) ){
+		cmd->type = CMD_PREV;
+	}
+	if( !strcmp( name, "mark" ) && sscanf( args, "%d", &cmd->arg )==1 ){
+		cmd->type = CMD_MARK;
+		cmd->path[0] = '\0';
+		//the last frame may be left out, the label too
+		if( sscanf( args, "%*d %d %255s", &cmd->arg2, cmd->path )<1 ){
+			cmd->arg2 = cmd->arg;
+			sscanf( args, "%*d %255s", cmd->path );
+		}
+	}
+	if( !strcmp( name, "unmark" ) && sscanf( args, "%d", &cmd->arg )==1 ){
+		cmd->type = CMD_UNMARK;
+	}
+	if( !strcmp( name, "next-marker" ) ){
+		cmd->type = CMD_NEXT_MARKER;
+	}
+	if( !strcmp( name, "prev-marker" ) ){
+		cmd->type = CMD_PREV_MARKER;
+	}
+	if( !strcmp( name, "export-markers" ) && sscanf( args, "%255s", cmd->path )==1 ){
+		cmd->type = CMD_EXPORT_MARKERS;
+	}
+	if( !strcmp( name, "import-markers" ) && sscanf( args, "%255s", cmd->path )==1 ){
+		cmd->type = CMD_IMPORT_MARKERS;
+	}
+	if( !strcmp( name, "filter" ) && sscanf( args, "%255s", cmd->path )==1 ){
+		cmd->type = CMD_FILTER;
+	}
+	if( !strcmp( name, "seek-time" ) && sscanf( args, "%255s", cmd->path )==1 ){
+		cmd->type = CMD_SEEK_TIME;
+	}
+}
+
+//Function to queue a command
+/*!
+ * Blocks while the queue is full. The queued command holds a reference to its client.
+ * */
+void push_command( const Command* cmd ){
+	pthread_mutex_lock( &cmd_queue.lock );
+	while( cmd_queue.count==CMD_QUEUE_SIZE ){
+		pthread_cond_wait( &cmd_queue.not_full, &cmd_queue.lock );
+	}
+	cmd_queue.items[ ( cmd_queue.head + cmd_queue.count )%CMD_QUEUE_SIZE ] = *cmd;
+	cmd_queue.count++;
+	cmd->client->refs++;
+	pthread_mutex_unlock( &cmd_queue.lock );
+}
+
+//Function to release a client
+/*!
+ * Drops a reference to \a client; the connection is closed and the client freed with the last one.
+ * */
+void release_client( Cmd_Client* client ){
+	pthread_mutex_lock( &cmd_queue.lock );
+	bool last = ( --client->refs==0 );
+	pthread_mutex_unlock( &cmd_queue.lock );
+	if( last ){
+		if( client->in_fd>2 ){
+			close( client->in_fd );
+		}
+		free( client );
+	}
+}
+
+//Function to execute the queued commands
+/*!
+ * Called by the main loop once per iteration. Executes the commands queued so far, in order.
+ * 
+ * \return false if a <em>quit</em> command was executed.
+ * */
+bool drain_commands(){
+	Command cmd;
+	bool go_on = true;
+	while( go_on ){
+		pthread_mutex_lock( &cmd_queue.lock );
+		if( cmd_queue.count==0 ){
+			pthread_mutex_unlock( &cmd_queue.lock );
+			break;
+		}
+		cmd = cmd_queue.items[ cmd_queue.head ];
+		cmd_queue.head = ( cmd_queue.head + 1 )%CMD_QUEUE_SIZE;
+		cmd_queue.count--;
+		pthread_cond_signal( &cmd_queue.not_full );
+		pthread_mutex_unlock( &cmd_queue.lock );
+		go_on = execute_command( &cmd );
+		release_client( cmd.client );
+	}
+	return( go_on );
+}
+
+//Function to execute a command
+/*!
+ * Executes \a cmd on the main loop's thread and writes a one-line JSON reply to its client. Every reply holds the command name and <em>"ok"</em>; the replies to <em>seek</em>, <em>step</em> and <em>get-frame</em> also hold the frame number actually reached.
+ * 
+ * \return false for a <em>quit</em> command.
+ * */
+bool execute_command( Command* cmd ){
+	char reply[ 4096 ];
+	static const char* names[] = { "seek", "step", "play", "pause", "get-frame", "metrics", "quit", "similar", "worst", "next", "prev", "mark", "unmark", "next-marker", "prev-marker", "export-markers", "import-markers", "filter", "seek-time" };
+	int found = 0;
+	double ms = 0;
+	cmds_executed++;
+	switch( cmd->type ){
+		case CMD_SEEK:
+			//frame N as get_frame_pos() numbers it, not slider position N
+			show_frame( cmd->arg );
+			break;
+		case CMD_STEP:
+			step_frames( cmd->arg );
+			break;
+		case CMD_PLAY:
+			set_playing( true );
+			break;
+		case CMD_PAUSE:
+			set_playing( false );
+			break;
+		case CMD_GET_FRAME:
+			show_frame( cmd->arg );
+			break;
+		case CMD_SIMILAR:
+			if( ( found = phash_find( get_frame_pos(), cmd->arg ) )<0 ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"similar\",\"ok\":false,\"error\":\"no index for a streamed input\"}" );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			break;
+		case CMD_WORST:
+			if( !quality.size || ( found = quality_worst( cmd->arg - 1 ) )<0 ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"worst\",\"ok\":false,\"error\":\"no such frame compared\"}" );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			show_frame( found );
+			break;
+		case CMD_NEXT:
+		case CMD_PREV:
+			if( !playlist_step( cmd->type==CMD_NEXT ? 1 : -1 ) ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"%s\",\"ok\":false,\"error\":\"no more videos\"}", names[ cmd->type ] );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			break;
+		case CMD_MARK:
+			if( !marker_add( cmd->arg, cmd->arg2, marker_label( cmd->path ) ) ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"mark\",\"ok\":false,\"error\":\"invalid marker\"}" );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			draw_slider_strip();
+			break;
+		case CMD_UNMARK:
+			found = marker_remove( cmd->arg );
+			draw_slider_strip();
+			break;
+		case CMD_NEXT_MARKER:
+		case CMD_PREV_MARKER:
+			if( !marker_jump( cmd->type==CMD_NEXT_MARKER ? 1 : -1 ) ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"%s\",\"ok\":false,\"error\":\"no more markers\"}", names[ cmd->type ] );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			break;
+		case CMD_EXPORT_MARKERS:
+			if( !marker_write( cmd->path ) ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"export-markers\",\"ok\":false,\"error\":\"cannot write the file\"}" );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			break;
+		case CMD_IMPORT_MARKERS:
+			if( ( found = marker_read( cmd->path ) )<0 ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"import-markers\",\"ok\":false,\"error\":\"cannot read the file\"}" );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			draw_slider_strip();
+			break;
+		case CMD_FILTER:
+			if( !parse_filters( cmd->path ) ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"filter\",\"ok\":false,\"error\":\"invalid filters\"}" );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			break;
+		case CMD_SEEK_TIME:
+			if( !parse_time( cmd->path, &ms ) ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"seek-time\",\"ok\":false,\"error\":\"invalid time\"}" );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			if( seek_time( ms )<0 ){
+				snprintf( reply, sizeof( reply ), "{\"cmd\":\"seek-time\",\"ok\":false,\"error\":\"time not found\"}" );
+				send_reply( cmd->client, reply );
+				return( true );
+			}
+			break;
+		case CMD_INVALID:
+			//do not let quotes of the offending text break the JSON
+			for( char* p = cmd->path; *p; p++ ){
+				if( *p=='"' || *p=='\\' || ( uchar )*p<32 ){
+					*p = '\'';
+				}
+			}
+			snprintf( reply, sizeof( reply ), "{\"ok\":false,\"error\":\"invalid command\",\"text\":\"%.200s\"}", cmd->path );
+			send_reply( cmd->client, reply );
+			return( true );
+	}
+	int len = snprintf( reply, sizeof( reply ), "{\"cmd\":\"%s\",\"ok\":true", names[ cmd->type ] );
+	if( cmd->type==CMD_SEEK || cmd->type==CMD_STEP ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"frame\":%d", get_frame_pos() );
+	}
+	if( cmd->type==CMD_GET_FRAME ){
+		CvScalar mean = cvAvg( old_frame );
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"frame\":%d,\"width\":%d,\"height\":%d,\"mean\":[%.3f,%.3f,%.3f]",
+			get_frame_pos(), old_frame->width, old_frame->height, mean.val[0], mean.val[1], mean.val[2] );
+		if( cmd->path[0] ){
+			bool saved = ( cvSaveImage( cmd->path, old_frame )!=0 );
+			len += snprintf( reply + len, sizeof( reply ) - len, ",\"saved\":%s", saved ? "true" : "false" );
+		}
+	}
+	if( cmd->type==CMD_SIMILAR ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"frame\":%d,\"radius\":%d,\"indexed\":%d,\"complete\":%s,\"matches\":%d,\"ms\":%.3f,\"frames\":[",
+			get_frame_pos(), cmd->arg, __atomic_load_n( &phash.indexed, __ATOMIC_RELAXED ), phash.complete ? "true" : "false", found, phash.query_ms );
+		//the first matches only, the reply has to fit in one line
+		for( int i=0; i<MIN( found, 256 ) && len<( int )sizeof( reply ) - 16; i++ ){
+			len += snprintf( reply + len, sizeof( reply ) - len, "%s%d", i ? "," : "", phash.matches[i] );
+		}
+		len += snprintf( reply + len, sizeof( reply ) - len, "]" );
+	}
+	if( cmd->type==CMD_WORST ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"frame\":%d,\"rank\":%d,\"psnr_y\":%.3f,\"ssim_y\":%.5f",
+			get_frame_pos(), cmd->arg, quality.values[0][ found ], quality.values[ QUALITY_PLANES ][ found ] );
+	}
+	if( cmd->type==CMD_NEXT || cmd->type==CMD_PREV ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"index\":%d,\"frame\":%d,\"switch_ms\":%.3f", playlist.cur, get_frame_pos(), playlist.switch_ms );
+	}
+	if( cmd->type==CMD_UNMARK ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"removed\":%d", found );
+	}
+	if( cmd->type==CMD_NEXT_MARKER || cmd->type==CMD_PREV_MARKER ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"frame\":%d", get_frame_pos() );
+	}
+	if( cmd->type==CMD_EXPORT_MARKERS ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"markers\":%d", markers.count );
+	}
+	if( cmd->type==CMD_IMPORT_MARKERS ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"read\":%d", found );
+	}
+	if( cmd->type==CMD_FILTER ){
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"stages\":%d", filters.count );
+	}
+	if( cmd->type==CMD_SEEK_TIME ){
+		char timecode[ 16 ];
+		get_frame_time( get_frame_pos(), &ms );
+		format_timecode( ms, timecode, sizeof( timecode ) );
+		len += snprintf( reply + len, sizeof( reply ) - len, ",\"frame\":%d,\"time_ms\":%.3f,\"timecode\":\"%s\"", get_frame_pos(), ms, timecode );
+	}
+	if( cmd->type==CMD_METRICS ){
+		len += snprintf( reply + len, sizeof( reply ) - len, "," );
+		len += write_metrics( reply + len, sizeof( reply ) - len );
+	}
+	snprintf( reply + len, sizeof( reply ) - len, "}" );
+	send_reply( cmd->client, reply );
+	return( cmd->type!=CMD_QUIT );
+}
+
+//Function to write the metrics
+/*!
+ * Writes the state and counters of the player as comma separated JSON members ( without the enclosing braces ).
+ * 
+ * \return The number of characters written.
+ * */
+int write_metrics( char* buf, int size ){
+	int queued;
+	pthread_mutex_lock( &cmd_queue.lock );
+	queued = cmd_queue.count;
+	pthread_mutex_unlock( &cmd_queue.lock );
+	int len = snprintf( buf, size,
+		"\"frame\":%d,\"total_frames\":%d,\"length_known\":%s,\"fps\":%.3f,\"step\":%d,\"playing\":%s,\"commands\":%ld,\"queued\":%d,\"ui_events\":%ld,\"ui_dropped\":%d",
+		get_frame_pos(), sldr_maxval, length_known ? "true" : "false", fps, step_val, engine.playing ? "true" : "false", cmds_executed, queued,
+		engine.ui_events, __atomic_load_n( &ui_queue.dropped, __ATOMIC_RELAXED ) );
+	len = MIN( len, size - 1 );
+	double ms;
+	char timecode[ 16 ];
+	bool exact = get_frame_time( get_frame_pos(), &ms );
+	format_timecode( ms, timecode, sizeof( timecode ) );
+	len += snprintf( buf + len, size - len, ",\"time_ms\":%.3f,\"time_exact\":%s,\"timecode\":\"%s\"", ms, exact ? "true" : "false", timecode );
+	len = MIN( len, size - 1 );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += pool_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += mem_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += cache_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += phash_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += activity_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += thumb_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += board_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += compare_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += quality_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += live_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += playlist_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += marker_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += filter_metrics( buf + len, size - len );
+	len += snprintf( buf + len, size - len, "," );
+	len = MIN( len, size - 1 );
+	len += thread_metrics( buf + len, size - len );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to reply to a client
+/*!
+ * Writes \a text followed by a newline. Errors ( e.g. a client which has gone away ) are ignored.
+ * */
+void send_reply( Cmd_Client* client, const char* text ){
+	char line_buf[ 4100 ];
+	int len = snprintf( line_buf, sizeof( line_buf ), "%s\n", text );
+	for( int done = 0; done<len; ){
+		int n = write( client->out_fd, line_buf + done, len - done );
+		if( n<=0 ){
+			break;
+		}
+		done += n;
+	}
+}
+
+//Function to queue a UI event
+/*!
+ * Called by the mouse callback. Never blocks: when the queue is full the event is dropped and counted in \a ui_queue.dropped.
+ * 
+ * \param type : One of the UI_ aliases.
+ * \param x : x coordinate of the mouse.
+ * \param y : y coordinate of the mouse.
+ * \param arg : Direction of the wheel for UI_WHEEL, 1 for a step button clicked with Ctrl, else 0.
+ * \return false if the event was dropped.
+ * \sa UI_Queue.
+ * */
+bool ui_push( int type, int x, int y, int arg ){
+	int tail = ui_queue.tail;
+	int next = ( tail + 1 )%UI_QUEUE_SIZE;
+	if( next==__atomic_load_n( &ui_queue.head, __ATOMIC_ACQUIRE ) ){
+		__atomic_store_n( &ui_queue.dropped, ui_queue.dropped + 1, __ATOMIC_RELAXED );
+		return( false );
+	}
+	UI_Event* ev = &ui_queue.items[ tail ];
+	ev->type = type;
+	ev->x = x;
+	ev->y = y;
+	ev->arg = arg;
+	__atomic_store_n( &ui_queue.tail, next, __ATOMIC_RELEASE );
+	return( true );
+}
+
+//Function to execute the queued UI events
+/*!
+ * Called by the main loop once per iteration, right after <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=waitkey#cvWaitKey" target="_blank"><b>cvWaitKey()</b></a> has dispatched the window events. The events are executed in order, except that of several UI_MOVE events in a row only the last one is executed: dragging the slider then seeks once per iteration instead of once per mouse event.
+ * */
+void drain_ui_events(){
+	int head = ui_queue.head;
+	int tail = __atomic_load_n( &ui_queue.tail, __ATOMIC_ACQUIRE );
+	while( head!=tail ){
+		UI_Event ev = ui_queue.items[ head ];
+		int next = ( head + 1 )%UI_QUEUE_SIZE;
+		bool superseded = ( ev.type==UI_MOVE && next!=tail && ui_queue.items[ next ].type==UI_MOVE );
+		head = next;
+		__atomic_store_n( &ui_queue.head, head, __ATOMIC_RELEASE );
+		if( !superseded ){
+			execute_ui_event( &ev );
+		}
+	}
+}
+
+//Function to execute a UI event
+/*!
+ * Performs the action of the user described by \a ev, on the main loop's thread. These are the actions the mouse callback used to perform itself.
+ * 
+ * \param ev : The event.
+ * \sa my_mouse_callback().
+ * */
+void execute_ui_event( const UI_Event* ev ){
+	int x = ev->x;
+	int y = ev->y;
+	engine.ui_events++;
+	record_action( ev->type, x, y, ev->arg );
+	switch( ev->type ){
+		case UI_MOVE:
+			// mouse on frame area
+			if( y < scrn_height && !board.shown ){
+				if( engine.panning ){
+					view_cx -= ( x - engine.pan_x )*view_rect.width/( double )p_width;
+					view_cy -= ( y - engine.pan_y )*view_rect.height/( double )scrn_height;
+					engine.pan_x = x;
+					engine.pan_y = y;
+				}
+				show_pixel( x, y );
+			}
+			// the wipe follows the mouse
+			if( y < scrn_height && compare.count && compare.layout==COMPARE_WIPE ){
+				compare.wipe_x = x;
+			}
+			// slider dragged
+			if( engine.sldr_moving && ( y > scrn_height ) && ( y <= scrn_height + sldr_height ) ){
+				seek_to( moveSlider( x, MOUSE_CALLBACK ) );
+			}
+			break;
+		case UI_PRESS:
+			engine.sldr_moving = true;
+			resetAllEdits();
+			if( y < scrn_height && board.shown ){
+				board_click( x, y );
+			}
+			else if( y < scrn_height && zoom>1 ){
+				engine.panning = true;
+				engine.pan_x = x;
+				engine.pan_y = y;
+			}
+			break;
+		case UI_RELEASE:
+			engine.sldr_moving = false;
+			engine.panning = false;
+			break;
+		case UI_SLIDER: {
+			int cur_frame = moveSlider( x, MOUSE_CALLBACK );
+			seek_to( cur_frame + step_val - 1 );
+			if( !engine.playing ){
+				sprintf( status_line, "Slider moved" );
+				change_status();
+			}
+		}
+		break;
+		case UI_PLAY_PAUSE:
+			set_playing( !engine.playing );
+			break;
+		case UI_STOP:
+			engine.playing = false;
+			seek_to( sldr_start );
+			getButton( play_pause_btn, PLAY_BTN, BTN_ACTIVE );
+			sprintf( status_line, "Stopped" );
+			change_status();
+			break;
+		case UI_STEP_UP:
+			//with Ctrl, the step buttons go from marker to marker
+			if( ev->arg ){
+				marker_jump( 1 );
+				break;
+			}
+			step_frames( step_val );
+			if( !engine.playing ){
+				sprintf( status_line, "Stepped Up" );
+				change_status();
+			}
+			break;
+		case UI_STEP_DOWN:
+			if( ev->arg ){
+				marker_jump( -1 );
+				break;
+			}
+			step_frames( -step_val );
+			if( !engine.playing ){
+				sprintf( status_line, "Stepped Down" );
+				change_status();
+			}
+			break;
+		case UI_EXPORT: {
+			int first = export_in>=0 ? export_in : sldr_start;
+			int last = export_out>=0 ? export_out : sldr_maxval - 1;
+			if( export_job.player ){
+				sprintf( status_line, "Export running" );
+				change_status();
+				break;
+			}
+			//a video file is exported in the background, see export_poll()
+			if( vid && export_start( first, last, step_val ) ){
+				sprintf( status_line, "Exporting 0%%" );
+				change_status();
+				break;
+			}
+			int cur_frame = get_frame_pos();
+			sprintf( status_line, "Exporting" );
+			change_status();
+			if( !headless ){
+				cvShowImage( "Video Player", player );
+			}
+			int written = export_range( NULL, first, last, step_val, export_pattern, export_jobs );
+			show_frame( cur_frame );
+			snprintf( status_line, sizeof( status_line ), "Exported %d", written );
+			change_status();
+		}
+		break;
+		case UI_EDIT_STEP:
+			sprintf( edit_text, "" );
+			typing_step = true;
+			break;
+		case UI_WHEEL:
+			if( y > scrn_height ){
+				tl_zoom( ev->arg>0 ? 2 : 0.5, x );
+				break;
+			}
+			if( board.shown ){
+				board_scroll( ev->arg>0 ? -1 : 1 );
+				break;
+			}
+			zoom_at( ev->arg>0 ? 1.25 : 0.8, x, y );
+			show_pixel( x, y );
+			break;
+	}
+}
+
+//Function to note an action of the user
+/*!
+ * When recording, writes the action to the session file. When replaying, notes the time the action started, so that its latency can be measured at the end of the tick.
+ * 
+ * \param type : One of the UI_ aliases.
+ * \param x : x coordinate of the mouse.
+ * \param y : y coordinate of the mouse.
+ * \param arg : Direction of the wheel for UI_WHEEL, the key for UI_KEY, 1 for a step button clicked with Ctrl, else 0.
+ * \sa Session_Log.
+ * */
+void record_action( int type, int x, int y, int arg ){
+	int64 now = cvGetTickCount();
+	if( session.rec ){
+		fprintf( session.rec, "%ld %.3f %s %d %d %d\n", engine.tick, ( now - session.start )/( cvGetTickFrequency()*1e3 ), ui_names[ type ], x, y, arg );
+	}
+	if( session.actions<=UI_QUEUE_SIZE ){
+		session.act_type[ session.actions ] = type;
+		session.act_start[ session.actions ] = now;
+		session.actions++;
+	}
+}
+
+//Function to feed the actions of a tick of a replayed session
+/*!
+ * Reads the lines of the session file due at the current tick. Mouse actions are queued with ui_push(), i.e. they take the very path the events of the mouse callback take. The frame number to be checked at the end of the tick is kept in \a session.expect_frame. A line due at a later tick is kept for later.
+ * 
+ * \return The key pressed in this tick, as if returned by <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=waitkey#cvWaitKey" target="_blank"><b>cvWaitKey()</b></a>, or -1.
+ * */
+char replay_tick(){
+	char c = -1;
+	while( 1 ){
+		if( !session.has_line ){
+			if( !fgets( session.line, sizeof( session.line ), session.replay ) ){
+				session.done = true;
+				break;
+			}
+			if( session.line[0]=='#' || session.line[0]=='\n' ){
+				continue;
+			}
+			session.has_line = true;
+		}
+		long tick;
+		char name[ 32 ];
+		int a = 0, b = 0, arg = 0;
+		int n = sscanf( session.line, "%ld %*f %31s %d %d %d", &tick, name, &a, &b, &arg );
+		if( n<2 ){
+			printf( "Invalid line in the session file : %s", session.line );
+			session.has_line = false;
+			continue;
+		}
+		if( tick>engine.tick ){
+			break;
+		}
+		session.has_line = false;
+		if( !strcmp( name, "end" ) ){
+			session.done = true;
+			break;
+		}
+		if( !strcmp( name, "frame" ) ){
+			session.expect_frame = a;
+			continue;
+		}
+		for( int type=0; type<=UI_KEY; type++ ){
+			if( !strcmp( name, ui_names[ type ] ) ){
+				if( type==UI_KEY ){
+					c = ( char )arg;
+				}
+				else{
+					ui_push( type, a, b, arg );
+				}
+			}
+		}
+	}
+	return( c );
+}
+
+//Function to end a tick
+/*!
+ * Called by the main loop once the frame of the tick has been rendered. If there was some action in this tick, a recorded session gets the displayed frame number. A replayed session checks the frame number against the recorded one and collects the latency of every action, i.e. the time from its start to this point.
+ * 
+ * \param cur_frame : The frame number displayed.
+ * */
+void end_tick( int cur_frame ){
+	int64 now = cvGetTickCount();
+	if( session.rec && session.actions>0 ){
+		fprintf( session.rec, "%ld %.3f frame %d\n", engine.tick, ( now - session.start )/( cvGetTickFrequency()*1e3 ), cur_frame );
+	}
+	if( session.replay ){
+		for( int i=0; i<session.actions; i++ ){
+			int type = session.act_type[i];
+			//grow by powers of 2
+			if( ( session.nsamples[ type ] & ( session.nsamples[ type ] - 1 ) )==0 ){
+				session.samples[ type ] = ( double* )realloc( session.samples[ type ], MAX( 2*session.nsamples[ type ], 16 )*sizeof( double ) );
+			}
+			session.samples[ type ][ session.nsamples[ type ]++ ] = ( now - session.act_start[i] )/( cvGetTickFrequency()*1e3 );
+		}
+		if( session.expect_frame>=0 ){
+			session.checks++;
+			if( cur_frame!=session.expect_frame ){
+				session.mismatches++;
+				printf( "Tick %ld : frame %d, recorded %d\n", engine.tick, cur_frame, session.expect_frame );
+			}
+			session.expect_frame = -1;
+		}
+	}
+	session.actions = 0;
+}
+
+//Function to compare two latencies
+int compare_ms( const void* a, const void* b ){
+	double d = *( const double* )a - *( const double* )b;
+	return( d<0 ? -1 : ( d>0 ? 1 : 0 ) );
+}
+
+//Function to print the report of a replayed session
+/*!
+ * Prints the number of frame checks and mismatches, followed by the count, mean, median, 95th percentile and maximum latency of every kind of action replayed.
+ * */
+void replay_report(){
+	printf( "Replayed %ld ticks : %ld frames checked, %ld mismatches\n", engine.tick, session.checks, session.mismatches );
+	printf( "%-12s %7s %9s %9s %9s %9s\n", "action", "count", "mean ms", "p50 ms", "p95 ms", "max ms" );
+	for( int type=0; type<=UI_KEY; type++ ){
+		int n = session.nsamples[ type ];
+		if( n==0 ){
+			continue;
+		}
+		double* s = session.samples[ type ];
+		double sum = 0;
+		qsort( s, n, sizeof( double ), compare_ms );
+		for( int i=0; i<n; i++ ){
+			sum += s[i];
+		}
+		printf( "%-12s %7d %9.3f %9.3f %9.3f %9.3f\n", ui_names[ type ], n, sum/n, s[ n/2 ], s[ MIN( ( int )( 0.95*n ), n - 1 ) ], s[ n - 1 ] );
+	}
+}
+
+//Function to get a frame buffer
+/*!
+ * Hands out an idle buffer of the requested geometry, or allocates a new one. Before allocating beyond \a frame_pool.ceiling, idle buffers of other geometries are freed. If that is not enough, an \a optional buffer is refused, while a required one is allocated anyway.
+ * 
+ * \param size : Frame size.
+ * \param depth : Depth of the frame.
+ * \param channels : Number of channels of the frame.
+ * \param optional : True when the caller can do without the buffer, e.g. to cache a frame.
+ * \return The buffer holding one reference, or NULL when an optional buffer is refused.
+ * \sa frame_unref().
+ * */
+Frame_Buf* pool_get( CvSize size, int depth, int channels, bool optional ){
+	pthread_mutex_lock( &frame_pool.lock );
+	frame_pool.gets++;
+	//find the class of this geometry, or a free class for it
+	int cls = -1;
+	for( int i=0; i<POOL_CLASSES; i++ ){
+		Pool_Class* pc = &frame_pool.classes[i];
+		if( pc->size.width==size.width && pc->size.height==size.height && pc->depth==depth && pc->channels==channels ){
+			cls = i;
+			break;
+		}
+		if( cls<0 && pc->nidle==0 && pc->nlive==0 ){
+			cls = i;
+		}
+	}
+	Frame_Buf* buf = NULL;
+	if( cls>=0 ){
+		Pool_Class* pc = &frame_pool.classes[ cls ];
+		pc->size = size;
+		pc->depth = depth;
+		pc->channels = channels;
+		if( pc->idle ){
+			buf = pc->idle;
+			pc->idle = buf->next;
+			pc->nidle--;
+			frame_pool.idle_bytes -= buf->bytes;
+		}
+	}
+	if( !buf ){
+		int row_bytes = size.width*channels*( ( depth & 255 )/8 );
+		int step = ( row_bytes + POOL_ALIGN - 1 )/POOL_ALIGN*POOL_ALIGN;
+		size_t bytes = ( size_t )step*size.height;
+		if( frame_pool.bytes + bytes>frame_pool.ceiling ){
+			pool_trim( frame_pool.ceiling - MIN( bytes, frame_pool.ceiling ), cls );
+		}
+		if( optional && frame_pool.bytes + bytes>frame_pool.ceiling ){
+			frame_pool.refused++;
+			pthread_mutex_unlock( &frame_pool.lock );
+			return( NULL );
+		}
+		void* data = NULL;
+		if( posix_memalign( &data, POOL_ALIGN, bytes )!=0 ){
+			pthread_mutex_unlock( &frame_pool.lock );
+			return( NULL );
+		}
+		buf = ( Frame_Buf* )malloc( sizeof( Frame_Buf ) );
+		buf->img = cvCreateImageHeader( size, depth, channels );
+		cvSetData( buf->img, data, step );
+		buf->cls = cls;
+		buf->bytes = bytes;
+		frame_pool.bytes += bytes;
+		frame_pool.allocs++;
+	}
+	if( buf->cls>=0 ){
+		frame_pool.classes[ buf->cls ].nlive++;
+	}
+	buf->refs = 1;
+	buf->frame_no = -1;
+	buf->pts_ms = -1;
+	buf->next = NULL;
+	pthread_mutex_unlock( &frame_pool.lock );
+	return( buf );
+}
+
+//Function to add a reference to a frame buffer
+/*!
+ * \return \a buf, for convenience.
+ * */
+Frame_Buf* frame_ref( Frame_Buf* buf ){
+	__atomic_add_fetch( &buf->refs, 1, __ATOMIC_RELAXED );
+	return( buf );
+}
+
+//Function to drop a reference to a frame buffer
+/*!
+ * When the last reference is dropped, the buffer goes back to the idle buffers of its class. It is freed instead if the pool is over its ceiling or the buffer belongs to no class.
+ * */
+void frame_unref( Frame_Buf* buf ){
+	if( !buf || __atomic_sub_fetch( &buf->refs, 1, __ATOMIC_ACQ_REL )>0 ){
+		return;
+	}
+	pthread_mutex_lock( &frame_pool.lock );
+	if( buf->cls>=0 ){
+		frame_pool.classes[ buf->cls ].nlive--;
+	}
+	if( buf->cls>=0 && frame_pool.bytes<=frame_pool.ceiling ){
+		Pool_Class* pc = &frame_pool.classes[ buf->cls ];
+		buf->next = pc->idle;
+		pc->idle = buf;
+		pc->nidle++;
+		frame_pool.idle_bytes += buf->bytes;
+	}
+	else{
+		frame_pool.bytes -= buf->bytes;
+		frame_pool.frees++;
+		free( buf->img->imageData );
+		cvReleaseImageHeader( &buf->img );
+		free( buf );
+	}
+	pthread_mutex_unlock( &frame_pool.lock );
+}
+
+//Function to free idle buffers
+/*!
+ * Frees idle buffers until the pool holds at most \a target bytes. The buffers of class \a keep_cls are freed last. Must be called with \a frame_pool.lock held, except at exit.
+ * 
+ * \param target : The desired size of the pool, 0 to free all the idle buffers.
+ * \param keep_cls : Class whose buffers are to be kept if possible, -1 for none.
+ * */
+void pool_trim( size_t target, int keep_cls ){
+	for( int pass=0; pass<2 && frame_pool.bytes>target; pass++ ){
+		for( int i=0; i<POOL_CLASSES && frame_pool.bytes>target; i++ ){
+			Pool_Class* pc = &frame_pool.classes[i];
+			if( pass==0 && i==keep_cls ){
+				continue;
+			}
+			while( pc->idle && frame_pool.bytes>target ){
+				Frame_Buf* buf = pc->idle;
+				pc->idle = buf->next;
+				pc->nidle--;
+				frame_pool.idle_bytes -= buf->bytes;
+				frame_pool.bytes -= buf->bytes;
+				frame_pool.frees++;
+				free( buf->img->imageData );
+				cvReleaseImageHeader( &buf->img );
+				free( buf );
+			}
+		}
+	}
+}
+
+//Function to write the counters of the frame pool
+/*!
+ * Writes the size, ceiling and counters of the frame pool as comma separated JSON members. Once the player is warmed up, <em>pool_allocs</em> no longer grows while frames are played.
+ * 
+ * \return The number of characters written.
+ * */
+int pool_metrics( char* buf, int size ){
+	pthread_mutex_lock( &frame_pool.lock );
+	int idle = 0, live = 0;
+	for( int i=0; i<POOL_CLASSES; i++ ){
+		idle += frame_pool.classes[i].nidle;
+		live += frame_pool.classes[i].nlive;
+	}
+	int len = snprintf( buf, size,
+		"\"pool_bytes\":%lu,\"pool_ceiling\":%lu,\"pool_live\":%d,\"pool_idle\":%d,\"pool_gets\":%ld,\"pool_allocs\":%ld,\"pool_frees\":%ld,\"pool_refused\":%ld",
+		( unsigned long )frame_pool.bytes, ( unsigned long )frame_pool.ceiling, live, idle, frame_pool.gets, frame_pool.allocs, frame_pool.frees, frame_pool.refused );
+	pthread_mutex_unlock( &frame_pool.lock );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to set the current frame
+/*!
+ * Copies \a img to \a old_frame. A frame just fetched from the frame cache is not copied; \a cur_buf then shares its buffer. Otherwise the copy is made in place when nobody else holds a reference to \a cur_buf; otherwise ( e.g. while the histogram thread reads it ) a fresh buffer is taken from the pool and \a cur_buf is released, so a frame is never modified under a reader.
+ * 
+ * \param img : The fetched frame.
+ * */
+void set_current( const IplImage* img ){
+	//a cached frame is shared rather than copied
+	if( fetched_buf && img==fetched_buf->img ){
+		if( cur_buf!=fetched_buf ){
+			frame_unref( cur_buf );
+			cur_buf = frame_ref( fetched_buf );
+		}
+		old_frame = cur_buf->img;
+		return;
+	}
+	if( !cur_buf || __atomic_load_n( &cur_buf->refs, __ATOMIC_ACQUIRE )>1 ||
+		cur_buf->img->width!=img->width || cur_buf->img->height!=img->height ||
+		cur_buf->img->depth!=img->depth || cur_buf->img->nChannels!=img->nChannels ){
+		Frame_Buf* buf = pool_get( cvGetSize( img ), img->depth, img->nChannels, false );
+		frame_unref( cur_buf );
+		cur_buf = buf;
+	}
+	cvCopy( img, cur_buf->img );
+	old_frame = cur_buf->img;
+}
+
+//Function to register with the memory governor
+/*!
+ * \param name : Name of the subsystem shown in the statistics.
+ * \param priority : One of the MEM_PRIO_ aliases; subsystems with a lower priority are evicted first.
+ * \param usage : Function returning the number of bytes used by the subsystem. It is called often and has to be cheap.
+ * \param evict : Function freeing about the given number of bytes and returning the number of bytes released, NULL for MEM_PRIO_FIXED. It is called with the governor's lock held, from any thread.
+ * \sa Mem_Governor.
+ * */
+void mem_register( const char* name, int priority, size_t ( *usage )(), size_t ( *evict )( size_t ) ){
+	pthread_mutex_lock( &mem_gov.lock );
+	//a subsystem restarted for another file is registered once
+	for( int i=0; i<mem_gov.nclients; i++ ){
+		if( !strcmp( mem_gov.clients[i].name, name ) ){
+			pthread_mutex_unlock( &mem_gov.lock );
+			return;
+		}
+	}
+	if( mem_gov.nclients<MEM_CLIENTS ){
+		Mem_Client* c = &mem_gov.clients[ mem_gov.nclients ];
+		c->name = name;
+		c->priority = priority;
+		c->usage = usage;
+		c->evict = evict;
+		//published once filled in, mem_used() walks the clients without the lock
+		__atomic_store_n( &mem_gov.nclients, mem_gov.nclients + 1, __ATOMIC_RELEASE );
+	}
+	pthread_mutex_unlock( &mem_gov.lock );
+}
+
+//Function to get the memory used
+/*!
+ * Called from any thread without the governor's lock; only the clients published by mem_register() are read.
+ * */
+size_t mem_used(){
+	size_t used = 0;
+	int nclients = __atomic_load_n( &mem_gov.nclients, __ATOMIC_ACQUIRE );
+	for( int i=0; i<nclients; i++ ){
+		used += mem_gov.clients[i].usage();
+	}
+	return( used );
+}
+
+//Function to enforce the memory budget
+/*!
+ * Called by the main loop once per iteration, and by a subsystem before it allocates \a incoming optional bytes. While the memory used plus \a incoming exceeds the budget, the subsystems are asked to evict, lowest priority first. Evicting frames usually only returns their buffers to the frame pool; therefore after every successful eviction the search starts again from the lowest priority, i.e. the idle buffers.
+ * 
+ * \param incoming : Number of bytes about to be allocated, 0 to only enforce the budget.
+ * \return false if \a incoming bytes do not fit in the budget.
+ * */
+bool mem_enforce( size_t incoming ){
+	if( mem_gov.budget==0 ){
+		return( true );
+	}
+	pthread_mutex_lock( &mem_gov.lock );
+	size_t used = mem_used();
+	for( int prio=MEM_PRIO_IDLE; prio<MEM_PRIO_FIXED && used + incoming>mem_gov.budget; prio++ ){
+		for( int i=0; i<mem_gov.nclients; i++ ){
+			Mem_Client* c = &mem_gov.clients[i];
+			if( c->priority!=prio || !c->evict ){
+				continue;
+			}
+			size_t freed = c->evict( used + incoming - mem_gov.budget );
+			if( freed>0 ){
+				mem_gov.evictions++;
+				mem_gov.evicted += freed;
+				used = mem_used();
+				//start again from the idle buffers
+				prio = MEM_PRIO_IDLE - 1;
+				break;
+			}
+		}
+	}
+	bool fits = ( used + incoming<=mem_gov.budget );
+	pthread_mutex_unlock( &mem_gov.lock );
+	return( fits );
+}
+
+//Function to write the memory usage
+/*!
+ * Writes the budget, the total, the usage of every subsystem and the eviction counters as comma separated JSON members.
+ * 
+ * \return The number of characters written.
+ * */
+int mem_metrics( char* buf, int size ){
+	pthread_mutex_lock( &mem_gov.lock );
+	int len = snprintf( buf, size, "\"mem_budget\":%lu,\"mem_used\":%lu,\"mem\":{",
+		( unsigned long )mem_gov.budget, ( unsigned long )mem_used() );
+	for( int i=0; i<mem_gov.nclients && len<size; i++ ){
+		len += snprintf( buf + len, size - len, "%s\"%s\":%lu", i ? "," : "", mem_gov.clients[i].name, ( unsigned long )mem_gov.clients[i].usage() );
+	}
+	len = MIN( len, size - 1 );
+	len += snprintf( buf + len, size - len, "},\"mem_evictions\":%ld,\"mem_evicted\":%lu", mem_gov.evictions, ( unsigned long )mem_gov.evicted );
+	pthread_mutex_unlock( &mem_gov.lock );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to get the size of the idle buffers
+size_t pool_idle_usage(){
+	pthread_mutex_lock( &frame_pool.lock );
+	size_t bytes = frame_pool.idle_bytes;
+	pthread_mutex_unlock( &frame_pool.lock );
+	return( bytes );
+}
+
+//Function to free idle buffers
+/*!
+ * \param bytes : Number of bytes to be released.
+ * \return The number of bytes released.
+ * */
+size_t pool_idle_evict( size_t bytes ){
+	pthread_mutex_lock( &frame_pool.lock );
+	size_t before = frame_pool.bytes;
+	pool_trim( before - MIN( bytes, before ), -1 );
+	size_t freed = before - frame_pool.bytes;
+	pthread_mutex_unlock( &frame_pool.lock );
+	return( freed );
+}
+
+//Function to get the size of the history window
+size_t history_usage(){
+	if( !stream || stream->ring.size==0 ){
+		return( 0 );
+	}
+	return( stream->ring.size*stream->ring.slots[0]->bytes );
+}
+
+//Function to get the size of the display images
+/*!
+ * The player window, the display-resolution images of render_frame() and the current frame.
+ * */
+size_t display_usage(){
+	size_t bytes = player->imageSize;
+	IplImage* imgs[] = { disp_cur, disp_prev, diff_img, gray_cur, gray_prev, diff_gray };
+	for( int i=0; i<6; i++ ){
+		bytes += imgs[i]->imageSize;
+	}
+	if( disp_native ){
+		bytes += disp_native->imageSize;
+	}
+	if( cur_buf ){
+		bytes += cur_buf->bytes;
+	}
+	return( bytes );
+}
+
+//Function to get the size of the histogram cache
+size_t hist_usage(){
+	return( HIST_CACHE_SIZE*sizeof( Hist_Entry ) );
+}
+
+//Function to draw the statistics
+/*!
+ * Draws the memory used by every subsystem registered with the memory governor, along with the counters of the frame pool and the frame cache and the threads in use, in a darkened box at the top-left corner of the frame area.
+ * */
+void draw_stats(){
+	char text[ 96 ];
+	bool filtered = ( filters.count && filters.enabled );
+	int nclients = __atomic_load_n( &mem_gov.nclients, __ATOMIC_ACQUIRE );
+	int rows = nclients + ( live ? 5 : 4 ) + ( filtered ? filters.count + 1 : 0 );
+	int height = MIN( 16*rows + 8, frame_area->height );
+	int width = MIN( 260, frame_area->width );
+	//darken the box so that the text is readable over any frame
+	for( int row=0; row<height; row++ ){
+		uchar* ptr = ( uchar* )( frame_area->imageData + row*frame_area->widthStep );
+		for( int col=0; col<width*3; col++ ){
+			ptr[ col ] >>= 2;
+		}
+	}
+	size_t used = mem_used();
+	if( mem_gov.budget ){
+		snprintf( text, sizeof( text ), "Memory %.1f / %.0f MB", used/1048576.0, mem_gov.budget/1048576.0 );
+	}
+	else{
+		snprintf( text, sizeof( text ), "Memory %.1f MB", used/1048576.0 );
+	}
+	cvPutText( frame_area, text, cvPoint( 6, 16 ), &font_small, white );
+	for( int i=0; i<nclients; i++ ){
+		snprintf( text, sizeof( text ), "  %-12s %8.1f MB", mem_gov.clients[i].name, mem_gov.clients[i].usage()/1048576.0 );
+		cvPutText( frame_area, text, cvPoint( 6, 32 + 16*i ), &font_small, white );
+	}
+	pthread_mutex_lock( &frame_pool.lock );
+	snprintf( text, sizeof( text ), "Pool %.1f MB, %ld allocs, %ld evictions", frame_pool.bytes/1048576.0, frame_pool.allocs, mem_gov.evictions );
+	pthread_mutex_unlock( &frame_pool.lock );
+	cvPutText( frame_area, text, cvPoint( 6, 32 + 16*nclients ), &font_small, white );
+	pthread_mutex_lock( &frame_cache.lock );
+	long lookups = frame_cache.hits + frame_cache.misses;
+	snprintf( text, sizeof( text ), "Cache %d frames, %.0f%% hits, stride %d, %ld wasted", frame_cache.count,
+		lookups ? 100.0*frame_cache.hits/lookups : 0.0, prefetch.stride, frame_cache.wasted );
+	pthread_mutex_unlock( &frame_cache.lock );
+	cvPutText( frame_area, text, cvPoint( 6, 48 + 16*nclients ), &font_small, white );
+	pthread_mutex_lock( &threads.lock );
+	snprintf( text, sizeof( text ), "Threads %d / %d, OpenCV %d, prefetch %s, load %.2f", threads.held, threads.total, threads.opencv,
+		( threads.mode==DECODE_DEMAND ) ? "on demand" : "ahead", threads.load );
+	pthread_mutex_unlock( &threads.lock );
+	cvPutText( frame_area, text, cvPoint( 6, 64 + 16*nclients ), &font_small, white );
+	if( live ){
+		pthread_mutex_lock( &live->lock );
+		snprintf( text, sizeof( text ), "Live %.1f s behind, %ld dropped, %ld skipped, %ld missed",
+			MAX( live->head - live->next, 0 )/live->fps, live->dropped, live->skipped, live->missed );
+		pthread_mutex_unlock( &live->lock );
+		cvPutText( frame_area, text, cvPoint( 6, 80 + 16*nclients ), &font_small, white );
+	}
+	if( filtered ){
+		int y = ( live ? 96 : 80 ) + 16*nclients;
+		snprintf( text, sizeof( text ), "Filters %.2f ms, %d threads, %ld kept", filters.last_ms, filters.nworkers, filters.hits );
+		cvPutText( frame_area, text, cvPoint( 6, y ), &font_small, white );
+		for( int i=0; i<filters.count; i++ ){
+			snprintf( text, sizeof( text ), "  %-12s %8.2f ms", filters.stages[i].name, filters.stages[i].us/1e3 );
+			cvPutText( frame_area, text, cvPoint( 6, y + 16*( i + 1 ) ), &font_small, white );
+		}
+	}
+}
+
+//Function to decode the next frame
+/*!
+ * Fetches the next frame from the streamed input or the CvCapture without going through the frame cache, for the callers which position the capture themselves, e.g. export_range().
+ * 
+ * \return The fetched frame, or NULL when no more frames are available.
+ * \sa query_frame().
+ * */
+IplImage* decode_frame(){
+	if( live ){
+		return( live_query( live ) );
+	}
+	if( stream ){
+		return( stream_query( stream ) );
+	}
+	if( vid ){
+		return( decode_vid() );
+	}
+	return( NULL );
+}
+
+//Function to skip frames
+/*!
+ * Skips the \a n frames following the current one. For a video file only the position moves: the frame after them is then taken from the frame cache or decoded by the engine, which decodes the skipped frames without keeping them, so they do not evict the frames planned by the prefetcher. The frames of a streamed or a live input are fetched one by one.
+ * 
+ * \param n : Number of frames to skip.
+ * */
+void skip_frames( int n ){
+	if( vid ){
+		play_pos += MAX( n, 0 );
+		return;
+	}
+	for( int i=0; i<n; i++ ){
+		query_frame();
+	}
+}
+
+//Function to keep a decoded frame
+/*!
+ * Updates \a play_pos once the main loop has decoded \a img from the video file, and stores a copy of the frame in the frame cache. The cached copy is returned, so that set_current() shares it instead of copying the frame once more.
+ * 
+ * \param img : The decoded frame, may be NULL.
+ * \return The frame to be displayed.
+ * */
+IplImage* keep_decoded( IplImage* img ){
+	play_pos = vp_position( vid );
+	double ms = -1;
+	vp_frame_time( vid, play_pos, &ms );
+	if( img && ( fetched_buf = cache_store( img, play_pos, ms, false ) ) ){
+		return( fetched_buf->img );
+	}
+	return( img );
+}
+
+//Function to look up a frame in the frame cache
+/*!
+ * Counts a hit or a miss; a prefetched frame found here counts as a prefetch hit the first time.
+ * 
+ * \param frame_no : Number of the frame.
+ * \return The frame holding a reference for the caller, or NULL when it is not cached.
+ * */
+Frame_Buf* cache_lookup( int frame_no ){
+	Frame_Buf* buf = NULL;
+	pthread_mutex_lock( &frame_cache.lock );
+	for( int i=0; i<FRAME_CACHE_SIZE; i++ ){
+		Cache_Entry* e = &frame_cache.entries[i];
+		if( e->buf && e->buf->frame_no==frame_no ){
+			if( e->prefetched && !e->used ){
+				frame_cache.prefetch_hits++;
+			}
+			e->used = true;
+			buf = frame_ref( e->buf );
+			break;
+		}
+	}
+	if( buf ){
+		frame_cache.hits++;
+	}
+	else{
+		frame_cache.misses++;
+	}
+	pthread_mutex_unlock( &frame_cache.lock );
+	return( buf );
+}
+
+//Function to check whether a frame is cached
+bool cache_contains( int frame_no ){
+	bool found = false;
+	pthread_mutex_lock( &frame_cache.lock );
+	for( int i=0; i<FRAME_CACHE_SIZE && !found; i++ ){
+		found = ( frame_cache.entries[i].buf && frame_cache.entries[i].buf->frame_no==frame_no );
+	}
+	pthread_mutex_unlock( &frame_cache.lock );
+	return( found );
+}
+
+//Function to store a frame in the frame cache
+/*!
+ * Copies \a img to a buffer of the frame pool and caches it as frame \a frame_no. The buffer is optional: when the memory budget, the pool ceiling or the size of the cache leaves no room for it, cached frames farther from the playhead than \a frame_no are evicted for it, and if there are none the frame is not cached. If the frame is already cached ( the prefetcher and the main loop may decode the same frame ), the cached buffer is returned.
+ * 
+ * \param img : The frame.
+ * \param frame_no : Number of the frame.
+ * \param pts_ms : Timestamp of the frame in milliseconds, negative when not known.
+ * \param prefetched : True when called by the prefetch thread, false when the frame is displayed.
+ * \return The cached frame holding a reference for the caller, or NULL when the frame could not be cached.
+ * */
+Frame_Buf* cache_store( const IplImage* img, int frame_no, double pts_ms, bool prefetched ){
+	int dist = abs( frame_no - __atomic_load_n( &play_pos, __ATOMIC_RELAXED ) );
+	//under a budget, the cached frames farther from the playhead make room first, whether prefetched or not
+	while( mem_gov.budget && mem_used() - pool_idle_usage() + img->imageSize>mem_gov.budget ){
+		pthread_mutex_lock( &frame_cache.lock );
+		int i = cache_farthest( CACHE_ANY );
+		bool farther = ( i>=0 && abs( frame_cache.entries[i].buf->frame_no - __atomic_load_n( &play_pos, __ATOMIC_RELAXED ) )>dist );
+		if( farther ){
+			cache_drop( i );
+		}
+		pthread_mutex_unlock( &frame_cache.lock );
+		if( !farther ){
+			return( NULL );
+		}
+	}
+	if( !mem_enforce( img->imageSize ) ){
+		return( NULL );
+	}
+	Frame_Buf* buf = pool_get( cvGetSize( img ), img->depth, img->nChannels, true );
+	if( !buf ){
+		//over the pool ceiling, make room by evicting a frame farther from the playhead
+		pthread_mutex_lock( &frame_cache.lock );
+		int i = cache_farthest( CACHE_ANY );
+		if( i>=0 && abs( frame_cache.entries[i].buf->frame_no - __atomic_load_n( &play_pos, __ATOMIC_RELAXED ) )>dist ){
+			cache_drop( i );
+		}
+		pthread_mutex_unlock( &frame_cache.lock );
+		if( !( buf = pool_get( cvGetSize( img ), img->depth, img->nChannels, true ) ) ){
+			return( NULL );
+		}
+	}
+	cvCopy( img, buf->img );
+	buf->frame_no = frame_no;
+	buf->pts_ms = pts_ms;
+	return( cache_insert( buf, prefetched ) );
+}
+
+//Function to add a frame buffer to the frame cache
+/*!
+ * Takes over the reference held by the caller on \a buf, whose \a frame_no is the key. When the cache is full, the frame farthest from the playhead is evicted, provided it is farther than \a buf; otherwise \a buf is not cached. If the frame is cached already, \a buf is released and the cached one is returned.
+ * 
+ * \param buf : The frame.
+ * \param prefetched : True when the frame was decoded ahead of the playhead.
+ * \return The cached frame holding a reference for the caller, or NULL when it could not be cached.
+ * */
+Frame_Buf* cache_insert( Frame_Buf* buf, bool prefetched ){
+	int frame_no = buf->frame_no;
+	int dist = abs( frame_no - __atomic_load_n( &play_pos, __ATOMIC_RELAXED ) );
+	Frame_Buf* result = NULL;
+	int slot = -1;
+	pthread_mutex_lock( &frame_cache.lock );
+	for( int i=0; i<FRAME_CACHE_SIZE; i++ ){
+		Cache_Entry* e = &frame_cache.entries[i];
+		if( e->buf && e->buf->frame_no==frame_no ){
+			e->used = e->used || !prefetched;
+			result = frame_ref( e->buf );
+			break;
+		}
+		if( !e->buf && slot<0 ){
+			slot = i;
+		}
+	}
+	if( !result && slot<0 ){
+		slot = cache_farthest( CACHE_ANY );
+		if( abs( frame_cache.entries[ slot ].buf->frame_no - __atomic_load_n( &play_pos, __ATOMIC_RELAXED ) )>dist ){
+			cache_drop( slot );
+		}
+		else{
+			slot = -1;
+		}
+	}
+	if( !result && slot>=0 ){
+		Cache_Entry* e = &frame_cache.entries[ slot ];
+		e->buf = buf;
+		e->prefetched = prefetched;
+		e->used = !prefetched;
+		frame_cache.count++;
+		if( prefetched ){
+			frame_cache.prefetched++;
+		}
+		result = frame_ref( buf );
+		buf = NULL;
+	}
+	pthread_mutex_unlock( &frame_cache.lock );
+	frame_unref( buf );
+	return( result );
+}
+
+//Function to find the cached frame farthest from the playhead
+/*!
+ * Must be called with \a frame_cache.lock held.
+ * 
+ * \param kind : One of the CACHE_ aliases.
+ * \return The index of the entry, -1 when no frame of this kind is cached.
+ * */
+int cache_farthest( int kind ){
+	int head = __atomic_load_n( &play_pos, __ATOMIC_RELAXED );
+	int best = -1, best_dist = -1;
+	for( int i=0; i<FRAME_CACHE_SIZE; i++ ){
+		Cache_Entry* e = &frame_cache.entries[i];
+		if( !e->buf ){
+			continue;
+		}
+		bool speculative = e->prefetched && !e->used;
+		if( ( kind==CACHE_SPECULATIVE && !speculative ) || ( kind==CACHE_KEPT && speculative ) ){
+			continue;
+		}
+		int dist = abs( e->buf->frame_no - head );
+		if( dist>best_dist ){
+			best = i;
+			best_dist = dist;
+		}
+	}
+	return( best );
+}
+
+//Function to drop a cached frame
+/*!
+ * A prefetched frame dropped before being displayed is counted as wasted. Must be called with \a frame_cache.lock held.
+ * 
+ * \param i : Index of the entry.
+ * \return The number of bytes released; 0 when the frame is the one displayed, which keeps its buffer.
+ * */
+size_t cache_drop( int i ){
+	Cache_Entry* e = &frame_cache.entries[i];
+	if( e->prefetched && !e->used ){
+		frame_cache.wasted++;
+	}
+	size_t bytes = ( e->buf==cur_buf ) ? 0 : e->buf->bytes;
+	frame_unref( e->buf );
+	e->buf = NULL;
+	frame_cache.count--;
+	return( bytes );
+}
+
+//Function to empty the frame cache
+void cache_clear(){
+	pthread_mutex_lock( &frame_cache.lock );
+	for( int i=0; i<FRAME_CACHE_SIZE; i++ ){
+		if( frame_cache.entries[i].buf ){
+			cache_drop( i );
+		}
+	}
+	pthread_mutex_unlock( &frame_cache.lock );
+}
+
+//Function to get the size of one kind of cached frames
+/*!
+ * The frame being displayed is not counted, the display accounts for it.
+ * 
+ * \param kind : One of the CACHE_ aliases.
+ * */
+size_t cache_bytes( int kind ){
+	size_t bytes = 0;
+	pthread_mutex_lock( &frame_cache.lock );
+	for( int i=0; i<FRAME_CACHE_SIZE; i++ ){
+		Cache_Entry* e = &frame_cache.entries[i];
+		if( !e->buf || e->buf==cur_buf ){
+			continue;
+		}
+		bool speculative = e->prefetched && !e->used;
+		if( kind==CACHE_ANY || ( kind==CACHE_SPECULATIVE )==speculative ){
+			bytes += e->buf->bytes;
+		}
+	}
+	pthread_mutex_unlock( &frame_cache.lock );
+	return( bytes );
+}
+
+//Function to evict one kind of cached frames
+/*!
+ * Drops the frames of the given kind farthest from the playhead first.
+ * 
+ * \param kind : One of the CACHE_ aliases.
+ * \param bytes : Number of bytes to be released.
+ * \return The number of bytes released.
+ * */
+size_t cache_shrink( int kind, size_t bytes ){
+	size_t freed = 0;
+	pthread_mutex_lock( &frame_cache.lock );
+	int i;
+	while( freed<bytes && ( i = cache_farthest( kind ) )>=0 ){
+		freed += cache_drop( i );
+	}
+	pthread_mutex_unlock( &frame_cache.lock );
+	return( freed );
+}
+
+//Function to get the size of the prefetched frames not displayed yet
+size_t prefetch_usage(){
+	return( cache_bytes( CACHE_SPECULATIVE ) );
+}
+
+//Function to evict prefetched frames not displayed yet
+size_t prefetch_evict( size_t bytes ){
+	return( cache_shrink( CACHE_SPECULATIVE, bytes ) );
+}
+
+//Function to get the size of the cached frames displayed at least once
+size_t cache_usage(){
+	return( cache_bytes( CACHE_KEPT ) );
+}
+
+//Function to evict cached frames displayed at least once
+size_t cache_evict( size_t bytes ){
+	return( cache_shrink( CACHE_KEPT, bytes ) );
+}
+
+//Function to report the displayed frame to the prefetcher
+/*!
+ * Called by the main loop every iteration. Predicts the stride from the state of the player and the last two moves of the playhead, and wakes the prefetch thread when the plan changes.
+ * 
+ * \param pos : The frame displayed.
+ * */
+void prefetch_note( int pos ){
+	if( !prefetch.vid ){
+		return;
+	}
+	int64 now = cvGetTickCount();
+	double since = ( now - prefetch.moved_at )/( cvGetTickFrequency()*1e3 );
+	if( pos!=prefetch.last_pos ){
+		prefetch.deltas[1] = prefetch.deltas[0];
+		prefetch.deltas[0] = pos - prefetch.last_pos;
+		prefetch.last_pos = pos;
+		//the rate of the moves, measured again after a rest
+		if( since>PREFETCH_REST_MS ){
+			prefetch.interval_ms = 0;
+		}
+		else{
+			prefetch.interval_ms = ( prefetch.interval_ms>0 ) ? 0.75*prefetch.interval_ms + 0.25*since : since;
+		}
+		prefetch.moved_at = now;
+	}
+	else if( since>PREFETCH_REST_MS && !engine.playing ){
+		//resting: the old stride no longer predicts anything
+		prefetch.deltas[0] = prefetch.deltas[1] = 0;
+	}
+	int stride = 0, ahead = prefetch.depth;
+	if( engine.playing ){
+		stride = step_val;
+	}
+	else if( prefetch.deltas[0]!=0 && prefetch.deltas[0]==prefetch.deltas[1] ){
+		stride = prefetch.deltas[0];
+		if( prefetch.interval_ms>0 ){
+			ahead = MIN( MAX( cvCeil( PREFETCH_AHEAD_MS/prefetch.interval_ms ), 2 ), prefetch.depth );
+		}
+	}
+	pthread_mutex_lock( &prefetch.lock );
+	if( stride!=prefetch.stride || pos!=prefetch.base || ahead!=prefetch.ahead ){
+		if( stride!=prefetch.stride ){
+			prefetch.generation++;
+		}
+		prefetch.stride = stride;
+		prefetch.base = pos;
+		prefetch.ahead = ahead;
+		pthread_cond_signal( &prefetch.cond );
+	}
+	pthread_mutex_unlock( &prefetch.lock );
+}
+
+//Function to list the frames to be prefetched
+/*!
+ * With a stride, the next \a ahead frames along it. Without one ( the playhead rests ), the neighbours at #step_val on both sides, nearest first, half as many as the depth of the prefetcher.
+ * 
+ * \param base : The frame displayed.
+ * \param stride : The predicted stride.
+ * \param ahead : Number of frames to plan along the stride, at most \a prefetch.depth.
+ * \param targets : Memory for at least \a prefetch.depth frame numbers.
+ * \return The number of frames listed, in the order they should be decoded.
+ * */
+int prefetch_plan( int base, int stride, int ahead, int* targets ){
+	int n = 0;
+	int count = ( stride!=0 ) ? MIN( ahead, prefetch.depth ) : prefetch.depth/2;
+	for( int k=1; k<=count; k++ ){
+		int f = ( stride!=0 ) ? base + k*stride : base + ( k + 1 )/2*step_val*( ( k % 2 ) ? 1 : -1 );
+		if( f>=1 && f<=sldr_maxval ){
+			targets[ n++ ] = f;
+		}
+	}
+	return( n );
+}
+
+//The prefetch thread
+/*!
+ * Decodes the first frame of the plan which is not cached yet, one frame at a time, so that a new plan is followed right away. Nothing is decoded in #DECODE_DEMAND mode ( see Thread_Budget ). When the stride changes, the frames of the old plan not decoded yet are counted as cancelled. The thread waits for the playhead to move when the whole plan is cached, or when it does not fit in memory: storing a frame then evicts a planned frame, which is counted as wasted.
+ * */
+void* prefetch_worker( void* arg ){
+	int* targets = ( int* )malloc( MAX( prefetch.depth, 1 )*sizeof( int ) );
+	int gen = -1, base = 0, stride = 0, ahead = 0;
+	pthread_mutex_lock( &prefetch.lock );
+	while( !prefetch.quit ){
+		if( prefetch.generation!=gen ){
+			if( gen>=0 ){
+				int n = prefetch_plan( base, stride, ahead, targets ), cancelled = 0;
+				for( int i=0; i<n; i++ ){
+					cancelled += !cache_contains( targets[i] );
+				}
+				__atomic_add_fetch( &frame_cache.cancelled, cancelled, __ATOMIC_RELAXED );
+			}
+			gen = prefetch.generation;
+		}
+		base = prefetch.base;
+		stride = prefetch.stride;
+		ahead = prefetch.ahead;
+		//nothing is decoded ahead in demand mode
+		int mode = __atomic_load_n( &threads.mode, __ATOMIC_RELAXED );
+		pthread_mutex_unlock( &prefetch.lock );
+
+		int n = ( mode==DECODE_DEMAND ) ? 0 : prefetch_plan( base, stride, ahead, targets ), target = -1;
+		for( int i=0; i<n && target<0; i++ ){
+			if( !cache_contains( targets[i] ) ){
+				target = targets[i];
+			}
+		}
+		bool idle = ( target<0 );
+		if( !idle ){
+			long wasted = __atomic_load_n( &frame_cache.wasted, __ATOMIC_RELAXED );
+			int64 start = cvGetTickCount();
+			IplImage* img = decode_at( prefetch.vid, target );
+			note_decode( &compare.inputs[0].decode_us, start );
+			int frame_no = ( int )cvGetCaptureProperty( prefetch.vid, CV_CAP_PROP_POS_FRAMES );
+			double ms = cvGetCaptureProperty( prefetch.vid, CV_CAP_PROP_POS_MSEC );
+			Frame_Buf* buf = img ? cache_store( img, frame_no, ms, true ) : NULL;
+			idle = ( !buf || frame_no!=target || __atomic_load_n( &frame_cache.wasted, __ATOMIC_RELAXED )!=wasted );
+			frame_unref( buf );
+		}
+
+		pthread_mutex_lock( &prefetch.lock );
+		while( idle && !prefetch.quit && prefetch.base==base && prefetch.stride==stride && prefetch.ahead==ahead && __atomic_load_n( &threads.mode, __ATOMIC_RELAXED )==mode ){
+			pthread_cond_wait( &prefetch.cond, &prefetch.lock );
+		}
+	}
+	pthread_mutex_unlock( &prefetch.lock );
+	free( targets );
+	return( NULL );
+}
+
+//Function to decode a given frame
+/*!
+ * Decodes the frame \a frame_no with \a v, the capture of a background thread ( the prefetcher, the thumbnails ): sequentially when the capture is just before it, otherwise by seeking the same way as seek_frame().
+ * 
+ * \param v : The capture.
+ * \param frame_no : Number of the frame, as get_frame_pos() would report it.
+ * \return The decoded frame, owned by the capture.
+ * */
+IplImage* decode_at( CvCapture* v, int frame_no ){
+	if( ( int )cvGetCaptureProperty( v, CV_CAP_PROP_POS_FRAMES )!=frame_no - 1 ){
+		cvSetCaptureProperty( v, CV_CAP_PROP_POS_FRAMES, ( double )MAX( frame_no - 2, 0 ) );
+		if( frame_no>=2 ){
+			cvQueryFrame( v );
+		}
+	}
+	return( cvQueryFrame( v ) );
+}
+
+//Function to write the counters of the frame cache and the prefetcher
+/*!
+ * Writes the counters as comma separated JSON members. <em>cache_hit_rate</em> is the fraction of the frames fetched by the main loop which were found in the cache; <em>prefetch_wasted</em> counts the frames decoded ahead in vain.
+ * 
+ * \return The number of characters written.
+ * */
+int cache_metrics( char* buf, int size ){
+	pthread_mutex_lock( &frame_cache.lock );
+	long lookups = frame_cache.hits + frame_cache.misses;
+	int len = snprintf( buf, size,
+		"\"cache_frames\":%d,\"cache_hits\":%ld,\"cache_misses\":%ld,\"cache_hit_rate\":%.3f,\"prefetch_depth\":%d,\"prefetch_stride\":%d,\"prefetch_ahead\":%d,\"prefetched\":%ld,\"prefetch_hits\":%ld,\"prefetch_wasted\":%ld,\"prefetch_cancelled\":%ld",
+		frame_cache.count, frame_cache.hits, frame_cache.misses, lookups ? frame_cache.hits/( double )lookups : 0.0,
+		prefetch.vid ? prefetch.depth : 0, prefetch.stride, prefetch.ahead, frame_cache.prefetched, frame_cache.prefetch_hits, frame_cache.wasted,
+		__atomic_load_n( &frame_cache.cancelled, __ATOMIC_RELAXED ) );
+	pthread_mutex_unlock( &frame_cache.lock );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to compute the perceptual hash of an image
+/*!
+ * The image is reduced to 32x32 luma pixels and transformed with a DCT ( <a href="http://opencv.willowgarage.com/documentation/c/core_operations_on_arrays.html#dct" target="_blank"><b>cvDCT()</b></a> ). The 8x8 lowest frequencies are compared to their median, giving one bit each. Frames which look alike have hashes differing in a few bits only, whatever their size, compression or small changes of brightness.
+ * 
+ * \param img : The image, BGR or gray.
+ * \return The 64-bit hash.
+ * */
+uint64 phash_image( const IplImage* img ){
+	uchar small_data[ 32*32*3 ], gray_data[ 32*32 ];
+	float in_data[ 32*32 ], dct_data[ 32*32 ];
+	CvMat gray = cvMat( 32, 32, CV_8UC1, gray_data );
+	CvMat in = cvMat( 32, 32, CV_32FC1, in_data );
+	CvMat dct = cvMat( 32, 32, CV_32FC1, dct_data );
+	if( img->nChannels==1 ){
+		cvResize( img, &gray, CV_INTER_AREA );
+	}
+	else{
+		CvMat small = cvMat( 32, 32, CV_8UC3, small_data );
+		cvResize( img, &small, CV_INTER_AREA );
+		cvCvtColor( &small, &gray, CV_BGR2GRAY );
+	}
+	cvConvertScale( &gray, &in, 1, 0 );
+	cvDCT( &in, &dct, CV_DXT_FORWARD );
+
+	float coef[ 64 ], sorted[ 64 ];
+	for( int i=0; i<64; i++ ){
+		coef[i] = dct_data[ ( i/8 )*32 + i%8 ];
+		//insertion sort, to find the median
+		int j = i;
+		for( ; j>0 && sorted[ j - 1 ]>coef[i]; j-- ){
+			sorted[j] = sorted[ j - 1 ];
+		}
+		sorted[j] = coef[i];
+	}
+	float median = ( sorted[31] + sorted[32] )/2;
+	uint64 h = 0;
+	for( int i=0; i<64; i++ ){
+		if( coef[i]>median ){
+			h |= ( uint64 )1<<i;
+		}
+	}
+	return( h );
+}
+
+//Function to start the perceptual hash index
+/*!
+ * Loads the sidecar file of the video if it is up to date. Otherwise starts the hashing threads, at most #PHASH_JOBS, each decoding its own range of the video. Calling it again does nothing. Only a CvCapture can be indexed; a streamed input cannot be decoded again from the start.
+ * 
+ * \return false for a streamed input.
+ * */
+bool phash_start(){
+	if( phash.size ){
+		return( true );
+	}
+	if( !vid ){
+		return( false );
+	}
+	phash.size = sldr_maxval + 1;
+	phash.hashes = ( uint64* )calloc( phash.size, sizeof( uint64 ) );
+	phash.done = ( uchar* )calloc( phash.size, 1 );
+	phash.matches = ( int* )malloc( phash.size*sizeof( int ) );
+	snprintf( phash.path, sizeof( phash.path ), "%s.phash", phash.video );
+	mem_register( "phash index", MEM_PRIO_FIXED, phash_usage, NULL );
+	if( phash_load() ){
+		phash_build_tables();
+		phash.complete = true;
+		return( true );
+	}
+	phash.nworkers = threads_take( PHASH_JOBS );
+	phash.running = phash.nworkers;
+	phash.workers = ( pthread_t* )malloc( phash.nworkers*sizeof( pthread_t ) );
+	for( long i=0; i<phash.nworkers; i++ ){
+		pthread_create( &phash.workers[i], NULL, phash_worker, ( void* )i );
+	}
+	return( true );
+}
+
+//Function to stop the perceptual hash index
+void phash_stop(){
+	if( !phash.size ){
+		return;
+	}
+	__atomic_store_n( &phash.quit, true, __ATOMIC_RELAXED );
+	for( int i=0; i<phash.nworkers; i++ ){
+		pthread_join( phash.workers[i], NULL );
+	}
+	free( phash.workers );
+	for( int c=0; c<PHASH_CHUNKS; c++ ){
+		free( phash.offsets[c] );
+		free( phash.ids[c] );
+		phash.offsets[c] = NULL;
+		phash.ids[c] = NULL;
+	}
+	free( phash.matches );
+	free( phash.done );
+	free( phash.hashes );
+	phash.size = 0;
+	phash.indexed = 0;
+	phash.complete = false;
+	phash.nmatches = 0;
+	phash.quit = false;
+}
+
+//The thread hashing a range of frames
+/*!
+ * Thread \a i of \f$ n \f$ hashes the \f$ i \f$-th of \f$ n \f$ equal ranges of frames, decoding them sequentially with its own CvCapture. The last thread to finish builds the multi-index tables and saves the sidecar file.
+ * 
+ * \param arg : Index of the thread.
+ * */
+void* phash_worker( void* arg ){
+	long w = ( long )arg;
+	int frames = phash.size - 1;
+	int first = 1 + ( int )( w*frames/phash.nworkers ), last = ( int )( ( w + 1 )*frames/phash.nworkers );
+	CvCapture* cap = ( first<=last ) ? cvCaptureFromFile( phash.video ) : NULL;
+	if( cap ){
+		cvSetCaptureProperty( cap, CV_CAP_PROP_POS_FRAMES, ( double )( first - 1 ) );
+		while( !__atomic_load_n( &phash.quit, __ATOMIC_RELAXED ) ){
+			IplImage* img = cvQueryFrame( cap );
+			int f = ( int )cvGetCaptureProperty( cap, CV_CAP_PROP_POS_FRAMES );
+			if( !img || f>last ){
+				break;
+			}
+			if( f<1 ){
+				continue;
+			}
+			phash.hashes[f] = phash_image( img );
+			if( !phash.done[f] ){
+				__atomic_store_n( &phash.done[f], 1, __ATOMIC_RELEASE );
+				__atomic_add_fetch( &phash.indexed, 1, __ATOMIC_RELAXED );
+			}
+		}
+		cvReleaseCapture( &cap );
+	}
+	threads_release( 1 );
+	if( __atomic_sub_fetch( &phash.running, 1, __ATOMIC_ACQ_REL )==0 && !__atomic_load_n( &phash.quit, __ATOMIC_RELAXED ) ){
+		phash_build_tables();
+		if( phash.indexed==frames ){
+			phash_save();
+		}
+		__atomic_store_n( &phash.complete, true, __ATOMIC_RELEASE );
+	}
+	return( NULL );
+}
+
+//Function to build the multi-index tables
+/*!
+ * For every chunk, the hashed frames are sorted by the value of the chunk with a counting sort, so that the frames having a given value are \a ids[ \a offsets[v] ] to \a ids[ \a offsets[v+1] - 1 ].
+ * */
+void phash_build_tables(){
+	int* next = ( int* )malloc( 65536*sizeof( int ) );
+	for( int c=0; c<PHASH_CHUNKS; c++ ){
+		int* offsets = ( int* )calloc( 65537, sizeof( int ) );
+		int* ids = ( int* )malloc( phash.size*sizeof( int ) );
+		for( int f=1; f<phash.size; f++ ){
+			if( phash.done[f] ){
+				offsets[ ( ( phash.hashes[f]>>( 16*c ) ) & 0xffff ) + 1 ]++;
+			}
+		}
+		for( int v=0; v<65536; v++ ){
+			offsets[ v + 1 ] += offsets[v];
+		}
+		memcpy( next, offsets, 65536*sizeof( int ) );
+		for( int f=1; f<phash.size; f++ ){
+			if( phash.done[f] ){
+				ids[ next[ ( phash.hashes[f]>>( 16*c ) ) & 0xffff ]++ ] = f;
+			}
+		}
+		phash.offsets[c] = offsets;
+		phash.ids[c] = ids;
+	}
+	free( next );
+}
+
+//Function to load the sidecar index
+/*!
+ * The file starts with "VPPHASH1", the number of frames and the size of the video, followed by the hashes of the frames 1 to N. It is only used if the number of frames and the size of the video match.
+ * 
+ * \return true if all the hashes were loaded.
+ * */
+bool phash_load(){
+	struct stat st;
+	FILE* fp = fopen( phash.path, "rb" );
+	if( !fp || stat( phash.video, &st )!=0 ){
+		if( fp ){
+			fclose( fp );
+		}
+		return( false );
+	}
+	char magic[ 8 ];
+	int frames = 0;
+	int64 video_bytes = 0;
+	bool ok = ( fread( magic, 1, 8, fp )==8 && !memcmp( magic, "VPPHASH1", 8 ) &&
+		fread( &frames, sizeof( int ), 1, fp )==1 && frames==phash.size - 1 &&
+		fread( &video_bytes, sizeof( int64 ), 1, fp )==1 && video_bytes==( int64 )st.st_size &&
+		fread( phash.hashes + 1, sizeof( uint64 ), frames, fp )==( size_t )frames );
+	fclose( fp );
+	if( ok ){
+		memset( phash.done + 1, 1, frames );
+		phash.indexed = frames;
+	}
+	return( ok );
+}
+
+//Function to save the sidecar index
+/*!
+ * \return false if the file cannot be written, e.g. in a read-only directory; the index then only lives as long as the player.
+ * \sa phash_load().
+ * */
+bool phash_save(){
+	struct stat st;
+	if( stat( phash.video, &st )!=0 ){
+		return( false );
+	}
+	FILE* fp = fopen( phash.path, "wb" );
+	if( !fp ){
+		return( false );
+	}
+	int frames = phash.size - 1;
+	int64 video_bytes = st.st_size;
+	bool ok = ( fwrite( "VPPHASH1", 1, 8, fp )==8 && fwrite( &frames, sizeof( int ), 1, fp )==1 &&
+		fwrite( &video_bytes, sizeof( int64 ), 1, fp )==1 && fwrite( phash.hashes + 1, sizeof( uint64 ), frames, fp )==( size_t )frames );
+	return( fclose( fp )==0 && ok );
+}
+
+//Function to search the index
+/*!
+ * Once the tables are built and \a radius < 8, the multi-index search is used: if two hashes differ in at most \a radius bits, at least one of their #PHASH_CHUNKS chunks differs in at most \f$ s = \lfloor radius/4 \rfloor \f$ bits. Only the frames found in the tables under a chunk value within \f$ s \f$ bits of the query are checked with a popcount. A frame is reported by the first chunk matching it, so that it is reported once. Otherwise ( e.g. while the frames are being hashed ) all the hashed frames are checked, which is still a single popcount per frame.
+ * 
+ * \param h : The hash searched.
+ * \param radius : Maximum number of differing bits.
+ * \param out : Memory for \a phash.size frame numbers, receives the frames found in ascending order.
+ * \return The number of frames found.
+ * */
+int phash_search( uint64 h, int radius, int* out ){
+	int n = 0;
+	int s = radius/PHASH_CHUNKS;
+	if( __atomic_load_n( &phash.complete, __ATOMIC_ACQUIRE ) && s<=1 ){
+		for( int c=0; c<PHASH_CHUNKS; c++ ){
+			int q = ( int )( ( h>>( 16*c ) ) & 0xffff );
+			for( int b=-1; b<( s ? 16 : 0 ); b++ ){
+				int v = ( b<0 ) ? q : ( q ^ ( 1<<b ) );
+				for( int j=phash.offsets[c][v]; j<phash.offsets[c][ v + 1 ]; j++ ){
+					int f = phash.ids[c][j];
+					uint64 d = phash.hashes[f] ^ h;
+					if( __builtin_popcountll( d )>radius ){
+						continue;
+					}
+					bool reported = false;
+					for( int e=0; e<c && !reported; e++ ){
+						reported = ( __builtin_popcount( ( unsigned )( ( d>>( 16*e ) ) & 0xffff ) )<=s );
+					}
+					if( !reported ){
+						out[ n++ ] = f;
+					}
+				}
+			}
+		}
+		qsort( out, n, sizeof( int ), compare_int );
+	}
+	else{
+		for( int f=1; f<phash.size; f++ ){
+			if( __atomic_load_n( &phash.done[f], __ATOMIC_ACQUIRE ) && __builtin_popcountll( phash.hashes[f] ^ h )<=radius ){
+				out[ n++ ] = f;
+			}
+		}
+	}
+	return( n );
+}
+
+//Function to find the frames similar to the current frame
+/*!
+ * Starts the index if needed and searches the frames within \a radius bits of the current frame, which itself is left out. The hash of the current frame is taken from the index, or computed if it is not there yet. The frames found are marked on the slider. While the frames are still being hashed, only the frames hashed so far are found.
+ * 
+ * \param cur_frame : The current frame number.
+ * \param radius : Maximum number of differing bits.
+ * \return The number of frames found, -1 for a streamed input.
+ * */
+int phash_find( int cur_frame, int radius ){
+	if( !phash_start() ){
+		return( -1 );
+	}
+	int64 start = cvGetTickCount();
+	bool hashed = ( cur_frame>0 && cur_frame<phash.size && __atomic_load_n( &phash.done[ cur_frame ], __ATOMIC_ACQUIRE ) );
+	uint64 h = hashed ? phash.hashes[ cur_frame ] : phash_image( old_frame );
+	int n = phash_search( h, radius, phash.matches );
+	int kept = 0;
+	for( int i=0; i<n; i++ ){
+		if( phash.matches[i]!=cur_frame ){
+			phash.matches[ kept++ ] = phash.matches[i];
+		}
+	}
+	phash.nmatches = kept;
+	phash.queries++;
+	phash.query_ms = ( cvGetTickCount() - start )/( cvGetTickFrequency()*1e3 );
+	draw_slider_strip();
+	return( kept );
+}
+
+//Function to get the size of the perceptual hash index
+size_t phash_usage(){
+	if( !phash.size ){
+		return( 0 );
+	}
+	size_t bytes = ( size_t )phash.size*( sizeof( uint64 ) + 1 + sizeof( int ) );
+	if( __atomic_load_n( &phash.complete, __ATOMIC_ACQUIRE ) ){
+		bytes += PHASH_CHUNKS*( 65537 + ( size_t )phash.size )*sizeof( int );
+	}
+	return( bytes );
+}
+
+//Function to write the state of the perceptual hash index
+/*!
+ * Writes the progress of the hashing and the duration of the last search as comma separated JSON members.
+ * 
+ * \return The number of characters written.
+ * */
+int phash_metrics( char* buf, int size ){
+	int len = snprintf( buf, size, "\"phash_frames\":%d,\"phash_indexed\":%d,\"phash_complete\":%s,\"phash_queries\":%ld,\"phash_query_ms\":%.3f",
+		MAX( phash.size - 1, 0 ), __atomic_load_n( &phash.indexed, __ATOMIC_RELAXED ),
+		__atomic_load_n( &phash.complete, __ATOMIC_ACQUIRE ) ? "true" : "false", phash.queries, phash.query_ms );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to compare two integers, for qsort()
+int compare_int( const void* a, const void* b ){
+	int x = *( const int* )a, y = *( const int* )b;
+	return( ( x>y ) - ( x<y ) );
+}
+
+//Function to draw the slider strip
+/*!
+ * Restores \a oslider from \a slider_base, draws the activity timeline and then a tick for every frame found by the last similar-frames search. Since the frames are sorted, at most one tick is drawn per column, whatever the number of frames found. The frame markers are drawn last as a blue bar along the top, one column at a time from the counts of marker_bins(); the bar is taller where more markers overlap. The slider itself is redrawn from \a oslider by moveSlider().
+ * */
+void draw_slider_strip(){
+	cvCopy( slider_base, oslider );
+	if( quality.shown ){
+		draw_quality( oslider );
+	}
+	else{
+		draw_timeline( oslider );
+	}
+	int first, span;
+	tl_window( &first, &span );
+	float scale = ( p_width - sldr_btn_width )/( float )( span );
+	int last_x = -1;
+	for( int i=0; i<phash.nmatches; i++ ){
+		int x = cvCeil( scale*( phash.matches[i] - first ) ) + sldr_btn_width/2;
+		if( phash.matches[i]<first || phash.matches[i]>first + span || x==last_x ){
+			continue;
+		}
+		cvLine( oslider, cvPoint( x, 0 ), cvPoint( x, oslider->height - 1 ), red, 1, 8, 0 );
+		last_x = x;
+	}
+	if( !markers.count ){
+		return;
+	}
+	const int* bins = marker_bins( first, span );
+	for( int x=0; x<p_width; x++ ){
+		if( bins[x]>0 ){
+			int h = MIN( 2*( 32 - __builtin_clz( ( unsigned )bins[x] ) ), oslider->height );
+			cvLine( oslider, cvPoint( x, 0 ), cvPoint( x, h - 1 ), blue, 1, 8, 0 );
+		}
+	}
+}
+
+//Function to start the activity timeline
+/*!
+ * Allocates the pyramids and starts the activity thread with its own CvCapture on \a video. Only a CvCapture has a timeline; a streamed input cannot be decoded ahead.
+ * 
+ * \param video : Path of the video.
+ * \return false when there is no timeline.
+ * */
+bool activity_start( const char* video ){
+	if( !vid ){
+		return( false );
+	}
+	activity.size = sldr_maxval + 1;
+	int nodes = 0;
+	for( int L=0; L<32; L++ ){
+		activity.offsets[L] = nodes;
+		activity.levels = L + 1;
+		int n = ( int )( ( activity.size + ( 1L<<L ) - 1 )>>L );
+		nodes += n;
+		if( n==1 ){
+			break;
+		}
+	}
+	//one more offset, marking the end of the top level
+	activity.offsets[ activity.levels ] = nodes;
+	for( int s=0; s<ACT_SIGNALS; s++ ){
+		activity.lo[s] = ( uchar* )malloc( nodes );
+		activity.hi[s] = ( uchar* )calloc( nodes, 1 );
+		memset( activity.lo[s], 255, nodes );
+	}
+	mem_register( "timeline", MEM_PRIO_FIXED, activity_usage, NULL );
+	if( !( activity.vid = open_capture( video ) ) ){
+		return( true );
+	}
+	pthread_create( &activity.thread, NULL, activity_worker, NULL );
+	return( true );
+}
+
+//Function to stop the activity timeline
+void activity_stop(){
+	if( !activity.size ){
+		return;
+	}
+	if( activity.vid ){
+		__atomic_store_n( &activity.quit, true, __ATOMIC_RELAXED );
+		pthread_join( activity.thread, NULL );
+		cvReleaseCapture( &activity.vid );
+	}
+	for( int s=0; s<ACT_SIGNALS; s++ ){
+		free( activity.lo[s] );
+		free( activity.hi[s] );
+	}
+	activity.size = 0;
+	activity.analysed = 0;
+	activity.drawn = 0;
+	activity.quit = false;
+}
+
+//The activity thread
+/*!
+ * Decodes the frames in order and reduces every frame to #ACT_WIDTH x #ACT_HEIGHT luma pixels, from which the mean luma, the mean absolute difference to the previous frame and the distance between the 32-bin luma histograms of the two frames ( 0 for identical histograms, 255 for disjoint ones ) are computed.
+ * */
+void* activity_worker( void* arg ){
+	const int n = ACT_WIDTH*ACT_HEIGHT;
+	uchar small_data[ ACT_WIDTH*ACT_HEIGHT*3 ], gray_data[ 2 ][ ACT_WIDTH*ACT_HEIGHT ];
+	int hist[ 2 ][ 32 ];
+	int cur = 0;
+	bool has_prev = false;
+	CvMat small = cvMat( ACT_HEIGHT, ACT_WIDTH, CV_8UC3, small_data );
+	memset( gray_data, 0, sizeof( gray_data ) );
+	memset( hist, 0, sizeof( hist ) );
+	while( !__atomic_load_n( &activity.quit, __ATOMIC_RELAXED ) ){
+		IplImage* img = cvQueryFrame( activity.vid );
+		int f = ( int )cvGetCaptureProperty( activity.vid, CV_CAP_PROP_POS_FRAMES );
+		if( !img || f>=activity.size ){
+			break;
+		}
+		CvMat gray = cvMat( ACT_HEIGHT, ACT_WIDTH, CV_8UC1, gray_data[ cur ] );
+		if( img->nChannels==1 ){
+			cvResize( img, &gray, CV_INTER_AREA );
+		}
+		else{
+			cvResize( img, &small, CV_INTER_AREA );
+			cvCvtColor( &small, &gray, CV_BGR2GRAY );
+		}
+		const uchar* p = gray_data[ cur ];
+		const uchar* q = gray_data[ 1 - cur ];
+		long luma = 0, diff = 0, dist = 0;
+		memset( hist[ cur ], 0, sizeof( hist[ cur ] ) );
+		for( int i=0; i<n; i++ ){
+			luma += p[i];
+			diff += abs( p[i] - q[i] );
+			hist[ cur ][ p[i]>>3 ]++;
+		}
+		for( int b=0; b<32; b++ ){
+			dist += abs( hist[ cur ][b] - hist[ 1 - cur ][b] );
+		}
+		uchar values[ ACT_SIGNALS ];
+		values[ ACT_DIFF ] = has_prev ? ( uchar )( diff/n ) : 0;
+		values[ ACT_LUMA ] = ( uchar )( luma/n );
+		values[ ACT_CUT ] = has_prev ? ( uchar )( dist*255/( 2*n ) ) : 0;
+		if( f>=1 ){
+			activity_set( f, values );
+			__atomic_add_fetch( &activity.analysed, 1, __ATOMIC_RELAXED );
+		}
+		cur = 1 - cur;
+		has_prev = true;
+	}
+	return( NULL );
+}
+
+//Function to store the activity of a frame
+/*!
+ * Sets the frame at level 0 and updates its ancestors, i.e. O( log n ) nodes per frame. The nodes are written atomically since the main loop reads them at the same time.
+ * 
+ * \param frame_no : Number of the frame.
+ * \param values : The value of every signal.
+ * */
+void activity_set( int frame_no, const uchar* values ){
+	for( int s=0; s<ACT_SIGNALS; s++ ){
+		uchar* lo = activity.lo[s];
+		uchar* hi = activity.hi[s];
+		__atomic_store_n( &lo[ frame_no ], values[s], __ATOMIC_RELAXED );
+		__atomic_store_n( &hi[ frame_no ], values[s], __ATOMIC_RELAXED );
+		for( int L=1; L<activity.levels; L++ ){
+			int i = frame_no>>L;
+			int child = activity.offsets[ L - 1 ] + 2*i;
+			int nl = lo[ child ], nh = hi[ child ];
+			//the last node of a level may have a single child
+			if( 2*i + 1<activity.offsets[L] - activity.offsets[ L - 1 ] ){
+				nl = MIN( nl, ( int )lo[ child + 1 ] );
+				nh = MAX( nh, ( int )hi[ child + 1 ] );
+			}
+			__atomic_store_n( &lo[ activity.offsets[L] + i ], ( uchar )nl, __ATOMIC_RELAXED );
+			__atomic_store_n( &hi[ activity.offsets[L] + i ], ( uchar )nh, __ATOMIC_RELAXED );
+		}
+	}
+}
+
+//Function to get the range of a signal over frames
+/*!
+ * Covers the frames with the largest aligned nodes of the pyramid, at most two per level.
+ * 
+ * \param signal : One of the ACT_ aliases.
+ * \param first : First frame.
+ * \param last : Last frame.
+ * \param lo : Receives the minimum.
+ * \param hi : Receives the maximum.
+ * \return false if none of the frames is analysed yet.
+ * */
+bool activity_range( int signal, int first, int last, uchar* lo, uchar* hi ){
+	int l = 255, h = 0;
+	bool any = false;
+	for( int a=first; a<=last; ){
+		int L = 0;
+		while( L + 1<activity.levels && ( a & ( ( 2<<L ) - 1 ) )==0 && a + ( 2<<L )<=last + 1 ){
+			L++;
+		}
+		int node = activity.offsets[L] + ( a>>L );
+		int nl = __atomic_load_n( &activity.lo[ signal ][ node ], __ATOMIC_RELAXED );
+		int nh = __atomic_load_n( &activity.hi[ signal ][ node ], __ATOMIC_RELAXED );
+		if( nl<=nh ){
+			l = MIN( l, nl );
+			h = MAX( h, nh );
+			any = true;
+		}
+		a += 1<<L;
+	}
+	*lo = ( uchar )l;
+	*hi = ( uchar )h;
+	return( any );
+}
+
+//Function to draw the activity timeline
+/*!
+ * Draws the signal \a activity.shown in every column of \a strip over the frames the column stands for, with the same scale as moveSlider() ( i.e. over the zoomed part of the timeline only ): the frame difference as bars coloured from blue to red, scaled to its maximum over the video; the luma as the band between its minimum and maximum; the likely cuts as full-height orange ticks.
+ * 
+ * \param strip : The slider strip.
+ * */
+void draw_timeline( IplImage* strip ){
+	if( !activity.size || activity.shown<0 ){
+		return;
+	}
+	uchar lo, hi, top_lo, top_hi = 0;
+	activity_range( activity.shown, 1, activity.size - 1, &top_lo, &top_hi );
+	int tl_first_frame, span;
+	tl_window( &tl_first_frame, &span );
+	float scale = ( p_width - sldr_btn_width )/( float )( span );
+	int half = sldr_btn_width/2, h = strip->height;
+	for( int x=0; x<strip->width; x++ ){
+		int first = MAX( tl_first_frame + cvFloor( ( x - half )/scale ), 1 );
+		int last = MIN( MAX( tl_first_frame + cvFloor( ( x + 1 - half )/scale ) - 1, first ), MIN( activity.size - 1, tl_first_frame + span ) );
+		if( first>last || !activity_range( activity.shown, first, last, &lo, &hi ) ){
+			continue;
+		}
+		if( activity.shown==ACT_DIFF ){
+			int v = hi*255/MAX( ( int )top_hi, 1 );
+			cvLine( strip, cvPoint( x, h - 1 - v*( h - 1 )/255 ), cvPoint( x, h - 1 ), cvScalar( 255 - v, 64, v ), 1, 8, 0 );
+		}
+		if( activity.shown==ACT_LUMA ){
+			cvLine( strip, cvPoint( x, h - 1 - hi*( h - 1 )/255 ), cvPoint( x, h - 1 - lo*( h - 1 )/255 ), cvScalarAll( hi/2 ), 1, 8, 0 );
+		}
+		if( activity.shown==ACT_CUT && hi>=ACT_CUT_LEVEL ){
+			cvLine( strip, cvPoint( x, 0 ), cvPoint( x, h - 1 ), orange, 1, 8, 0 );
+		}
+	}
+}
+
+//Function to redraw the slider as the activity arrives
+/*!
+ * Called by the main loop every iteration; redraws the slider strip at most 4 times a second, and only when frames were analysed since it was drawn last.
+ * */
+void update_timeline(){
+	int analysed;
+	if( quality.shown ){
+		analysed = __atomic_load_n( &quality.done, __ATOMIC_RELAXED );
+	}
+	else if( activity.size && activity.shown>=0 ){
+		analysed = __atomic_load_n( &activity.analysed, __ATOMIC_RELAXED );
+	}
+	else{
+		return;
+	}
+	int64 now = cvGetTickCount();
+	if( analysed==activity.drawn || ( now - activity.drawn_at )<cvGetTickFrequency()*250e3 ){
+		return;
+	}
+	activity.drawn = analysed;
+	activity.drawn_at = now;
+	draw_slider_strip();
+}
+
+//Function to get the size of the activity timeline
+size_t activity_usage(){
+	return( activity.size ? 2*ACT_SIGNALS*( size_t )activity.offsets[ activity.levels ] : 0 );
+}
+
+//Function to write the progress of the activity timeline
+/*!
+ * \return The number of characters written.
+ * */
+int activity_metrics( char* buf, int size ){
+	static const char* names[] = { "diff", "luma", "cut" };
+	int len = snprintf( buf, size, "\"timeline_frames\":%d,\"timeline_analysed\":%d,\"timeline_shown\":\"%s\"",
+		MAX( activity.size - 1, 0 ), __atomic_load_n( &activity.analysed, __ATOMIC_RELAXED ), activity.shown<0 ? "none" : names[ activity.shown ] );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to get the part of the video the slider spans
+/*!
+ * \param first : Set to the first frame the slider spans.
+ * \param span : Set to the number of frames the slider spans, at least 1.
+ * \sa tl_first.
+ * */
+void tl_window( int* first, int* span ){
+	if( tl_span<=0 || tl_span>=sldr_maxval ){
+		*first = 0;
+		*span = MAX( sldr_maxval, 1 );
+		return;
+	}
+	*span = tl_span;
+	*first = MIN( MAX( tl_first, 0 ), sldr_maxval - tl_span );
+}
+
+//Function to zoom the timeline
+/*!
+ * Scales the number of frames the slider spans by 1 / \a factor, keeping the frame under \a x where it is, and redraws the slider. The timeline is never zoomed to less than #TL_MIN_SPAN frames; zooming out to the whole video, or a \a factor of 0, resets it.
+ * 
+ * \param factor : Zoom factor, greater than 1 to zoom in.
+ * \param x : x coordinate on the slider.
+ * */
+void tl_zoom( double factor, int x ){
+	int first, span;
+	tl_window( &first, &span );
+	int new_span = ( factor>0 ) ? MAX( cvRound( span/factor ), TL_MIN_SPAN ) : sldr_maxval;
+	if( new_span>=sldr_maxval ){
+		tl_span = 0;
+		sprintf( status_line, "Timeline x1" );
+	}
+	else{
+		double at = MIN( MAX( x/( double )p_width, 0.0 ), 1.0 );
+		tl_first = cvRound( first + span*at - new_span*at );
+		tl_span = new_span;
+		tl_window( &first, &span );
+		tl_first = first;
+		snprintf( status_line, sizeof( status_line ), "Timeline x%d", sldr_maxval/tl_span );
+	}
+	change_status();
+	draw_slider_strip();
+}
+
+//Function to pan the zoomed timeline
+/*!
+ * \param frames : Number of frames to move the timeline by, negative to move it back.
+ * */
+void tl_pan( int frames ){
+	if( !tl_span ){
+		return;
+	}
+	int first, span;
+	tl_window( &first, &span );
+	tl_first = first + frames;
+	tl_window( &first, &span );
+	tl_first = first;
+	draw_slider_strip();
+}
+
+//Function to start the thumbnails
+/*!
+ * Opens a CvCapture on \a video for the thumbnail thread and starts it. The thread sleeps until thumbnails are asked for. Only a CvCapture has thumbnails.
+ * 
+ * \param video : Path of the video.
+ * \return false when there are no thumbnails.
+ * */
+bool thumb_start( const char* video ){
+	if( !vid || !( thumbs.vid = open_capture( video ) ) ){
+		return( false );
+	}
+	int height = cvRound( THUMB_WIDTH*old_frame->height/( double )old_frame->width );
+	thumbs.size = cvSize( THUMB_WIDTH, MIN( MAX( height, 8 ), THUMB_WIDTH ) );
+	mem_register( "thumbnails", MEM_PRIO_THUMBS, thumb_usage, thumb_evict );
+	pthread_create( &thumbs.thread, NULL, thumb_worker, NULL );
+	return( true );
+}
+
+//Function to stop the thumbnails
+void thumb_stop(){
+	if( !thumbs.vid ){
+		return;
+	}
+	pthread_mutex_lock( &thumbs.lock );
+	thumbs.quit = true;
+	pthread_cond_signal( &thumbs.cond );
+	pthread_mutex_unlock( &thumbs.lock );
+	pthread_join( thumbs.thread, NULL );
+	cvReleaseCapture( &thumbs.vid );
+	for( int i=0; i<THUMB_CACHE_SIZE; i++ ){
+		frame_unref( thumbs.bufs[i] );
+		thumbs.bufs[i] = NULL;
+	}
+	thumbs.count = 0;
+	thumbs.nwanted = 0;
+	thumbs.retry_at = 0;
+	thumbs.quit = false;
+}
+
+//The thumbnail thread
+/*!
+ * Decodes the first frame asked for which has no thumbnail yet, and sleeps when there is none. A frame which cannot be decoded is no longer asked for. When the memory budget refuses a thumbnail the frame stays asked for and the thread waits #THUMB_RETRY_MS before trying again, so that it does not decode and throw away the same frames endlessly.
+ * */
+void* thumb_worker( void* arg ){
+	size_t bytes = ( size_t )thumbs.size.width*thumbs.size.height*3;
+	pthread_mutex_lock( &thumbs.lock );
+	while( !thumbs.quit ){
+		int target = -1;
+		for( int i=0; i<thumbs.nwanted && target<0; i++ ){
+			if( thumb_find( thumbs.wanted[i] )<0 ){
+				target = thumbs.wanted[i];
+			}
+		}
+		if( target<0 ){
+			pthread_cond_wait( &thumbs.cond, &thumbs.lock );
+			continue;
+		}
+		//back off after a refusal, until memory may have been freed
+		int64 wait = thumbs.retry_at - cvGetTickCount();
+		if( wait>0 ){
+			struct timespec until;
+			clock_gettime( CLOCK_REALTIME, &until );
+			long long ns = until.tv_nsec + ( long long )( wait/( cvGetTickFrequency()*1e-3 ) );
+			until.tv_sec += ns/1000000000;
+			until.tv_nsec = ns%1000000000;
+			pthread_cond_timedwait( &thumbs.cond, &thumbs.lock, &until );
+			continue;
+		}
+		pthread_mutex_unlock( &thumbs.lock );
+		//the budget is checked before decoding, a refused thumbnail costs nothing
+		bool refused = !mem_enforce( bytes );
+		IplImage* img = refused ? NULL : decode_at( thumbs.vid, target );
+		Frame_Buf* buf = NULL;
+		if( img && img->nChannels==3 ){
+			refused = !( buf = pool_get( thumbs.size, img->depth, 3, true ) );
+		}
+		if( buf ){
+			cvResize( img, buf->img, CV_INTER_AREA );
+			buf->frame_no = target;
+		}
+		pthread_mutex_lock( &thumbs.lock );
+		if( refused ){
+			thumbs.refused++;
+			thumbs.retry_at = cvGetTickCount() + ( int64 )( THUMB_RETRY_MS*cvGetTickFrequency()*1e3 );
+			continue;
+		}
+		if( !buf ){
+			//a frame which cannot be decoded is not asked for again
+			int n = 0;
+			for( int i=0; i<thumbs.nwanted; i++ ){
+				if( thumbs.wanted[i]!=target ){
+					thumbs.wanted[ n++ ] = thumbs.wanted[i];
+				}
+			}
+			thumbs.nwanted = n;
+			continue;
+		}
+		if( thumbs.count==THUMB_CACHE_SIZE ){
+			thumb_drop_lru();
+		}
+		for( int i=0; i<THUMB_CACHE_SIZE; i++ ){
+			if( !thumbs.bufs[i] ){
+				thumbs.bufs[i] = buf;
+				thumbs.used[i] = cvGetTickCount();
+				thumbs.count++;
+				buf = NULL;
+				break;
+			}
+		}
+		thumbs.decoded++;
+		if( buf ){
+			//the cache is full of thumbnails asked for
+			frame_unref( buf );
+		}
+	}
+	pthread_mutex_unlock( &thumbs.lock );
+	return( NULL );
+}
+
+//Function to ask for thumbnails
+/*!
+ * Replaces the frames asked for, and wakes up the thumbnail thread if some of them have no thumbnail yet.
+ * 
+ * \param frames : The frames, most needed first.
+ * \param n : Number of frames, at most #THUMB_WANTED.
+ * */
+void thumb_want( const int* frames, int n ){
+	if( !thumbs.vid ){
+		return;
+	}
+	n = MIN( n, THUMB_WANTED );
+	pthread_mutex_lock( &thumbs.lock );
+	bool missing = false;
+	for( int i=0; i<n; i++ ){
+		thumbs.wanted[i] = frames[i];
+		missing = missing || thumb_find( frames[i] )<0;
+	}
+	thumbs.nwanted = n;
+	if( missing ){
+		pthread_cond_signal( &thumbs.cond );
+	}
+	pthread_mutex_unlock( &thumbs.lock );
+}
+
+//Function to get a thumbnail
+/*!
+ * \param frame_no : Number of the frame.
+ * \return The thumbnail holding a reference for the caller, or NULL when it is not decoded yet.
+ * */
+Frame_Buf* thumb_get( int frame_no ){
+	Frame_Buf* buf = NULL;
+	pthread_mutex_lock( &thumbs.lock );
+	int i = thumb_find( frame_no );
+	if( i>=0 ){
+		buf = frame_ref( thumbs.bufs[i] );
+		thumbs.used[i] = cvGetTickCount();
+		thumbs.hits++;
+	}
+	else{
+		thumbs.misses++;
+	}
+	pthread_mutex_unlock( &thumbs.lock );
+	return( buf );
+}
+
+//Function to find a thumbnail
+/*!
+ * Must be called with \a thumbs.lock held.
+ * 
+ * \return The index of the thumbnail of \a frame_no, -1 when there is none.
+ * */
+int thumb_find( int frame_no ){
+	for( int i=0; i<THUMB_CACHE_SIZE; i++ ){
+		if( thumbs.bufs[i] && thumbs.bufs[i]->frame_no==frame_no ){
+			return( i );
+		}
+	}
+	return( -1 );
+}
+
+//Function to evict the thumbnail drawn least recently
+/*!
+ * The thumbnails asked for are never evicted. Must be called with \a thumbs.lock held.
+ * 
+ * \return The number of bytes released, 0 when no thumbnail could be evicted.
+ * */
+size_t thumb_drop_lru(){
+	int best = -1;
+	for( int i=0; i<THUMB_CACHE_SIZE; i++ ){
+		if( !thumbs.bufs[i] || ( best>=0 && thumbs.used[i]>=thumbs.used[ best ] ) ){
+			continue;
+		}
+		bool wanted = false;
+		for( int j=0; j<thumbs.nwanted && !wanted; j++ ){
+			wanted = ( thumbs.wanted[j]==thumbs.bufs[i]->frame_no );
+		}
+		if( !wanted ){
+			best = i;
+		}
+	}
+	if( best<0 ){
+		return( 0 );
+	}
+	size_t bytes = thumbs.bufs[ best ]->bytes;
+	frame_unref( thumbs.bufs[ best ] );
+	thumbs.bufs[ best ] = NULL;
+	thumbs.count--;
+	return( bytes );
+}
+
+//Function to get the size of the thumbnails
+size_t thumb_usage(){
+	pthread_mutex_lock( &thumbs.lock );
+	size_t bytes = 0;
+	for( int i=0; i<THUMB_CACHE_SIZE; i++ ){
+		if( thumbs.bufs[i] ){
+			bytes += thumbs.bufs[i]->bytes;
+		}
+	}
+	pthread_mutex_unlock( &thumbs.lock );
+	return( bytes );
+}
+
+//Function to evict thumbnails
+/*!
+ * \param bytes : Number of bytes to free.
+ * \return The number of bytes released.
+ * */
+size_t thumb_evict( size_t bytes ){
+	size_t freed = 0, n;
+	pthread_mutex_lock( &thumbs.lock );
+	while( freed<bytes && ( n = thumb_drop_lru() )>0 ){
+		freed += n;
+	}
+	pthread_mutex_unlock( &thumbs.lock );
+	return( freed );
+}
+
+//Function to draw the thumbnails of the zoomed timeline
+/*!
+ * While the timeline is zoomed in, a row of thumbnails is drawn at the bottom of the frame area, each standing for an equal part of the frames the slider spans. The frame of a tile is rounded down to a multiple of the largest power of two not exceeding the frames per tile ( its level of detail ), so that the same thumbnails serve while panning and across nearby zoom levels. Under every tile a bar shows the highest frame difference over its part of the timeline, read from the activity pyramid; the tile holding the current frame is outlined in yellow. The cost of a redraw only depends on the number of tiles, not on the length of the video.
+ * 
+ * \param cur_frame : The current frame.
+ * */
+void draw_thumb_strip( int cur_frame ){
+	if( !tl_span || !thumbs.vid ){
+		return;
+	}
+	int first, span;
+	tl_window( &first, &span );
+	int n = MIN( p_width/( THUMB_WIDTH + 8 ), THUMB_WANTED );
+	int cell = p_width/n;
+	int lod = 1;
+	while( 2*lod<=span/n ){
+		lod *= 2;
+	}
+	int frames[ THUMB_WANTED ];
+	for( int i=0; i<n; i++ ){
+		int mid = first + ( int )( ( 2*i + 1 )*( int64 )span/( 2*n ) );
+		frames[i] = MIN( MAX( mid/lod*lod, 1 ), sldr_maxval );
+	}
+	thumb_want( frames, n );
+	uchar top_lo, top_hi = 0, lo, hi;
+	if( activity.size ){
+		activity_range( ACT_DIFF, 1, activity.size - 1, &top_lo, &top_hi );
+	}
+	int th = thumbs.size.height;
+	int y0 = scrn_height - th - 20;
+	char text[ 32 ];
+	for( int i=0; i<n; i++ ){
+		int x0 = i*cell + ( cell - THUMB_WIDTH )/2;
+		int a = first + ( int )( i*( int64 )span/n ), b = first + ( int )( ( i + 1 )*( int64 )span/n ) - 1;
+		CvMat tile;
+		cvGetSubRect( frame_area, &tile, cvRect( x0, y0, THUMB_WIDTH, th ) );
+		Frame_Buf* buf = thumb_get( frames[i] );
+		if( buf ){
+			cvCopy( buf->img, &tile );
+			frame_unref( buf );
+		}
+		else{
+			cvSet( &tile, cvScalarAll( 48 ) );
+		}
+		bool current = ( cur_frame>=a && cur_frame<=b );
+		cvRectangle( frame_area, cvPoint( x0 - 1, y0 - 1 ), cvPoint( x0 + THUMB_WIDTH, y0 + th ), current ? yellow : gray, 1, 8, 0 );
+		if( activity.size && activity_range( ACT_DIFF, MAX( a, 1 ), MIN( MAX( b, a ), activity.size - 1 ), &lo, &hi ) ){
+			int len = hi*THUMB_WIDTH/MAX( ( int )top_hi, 1 );
+			cvRectangle( frame_area, cvPoint( x0, y0 + th + 2 ), cvPoint( x0 + MAX( len, 1 ) - 1, y0 + th + 4 ), orange, CV_FILLED, 8, 0 );
+		}
+		snprintf( text, sizeof( text ), "%d", frames[i] );
+		cvPutText( frame_area, text, cvPoint( x0 + 2, y0 + th + 16 ), &font_small, white );
+	}
+}
+
+//Function to write the state of the zoomed timeline and the thumbnails
+/*!
+ * \return The number of characters written.
+ * */
+int thumb_metrics( char* buf, int size ){
+	int first, span;
+	tl_window( &first, &span );
+	pthread_mutex_lock( &thumbs.lock );
+	int len = snprintf( buf, size, "\"timeline_first\":%d,\"timeline_span\":%d,\"thumbs\":%d,\"thumbs_decoded\":%ld,\"thumb_hits\":%ld,\"thumb_misses\":%ld,\"thumbs_refused\":%ld",
+		first, span, thumbs.count, thumbs.decoded, thumbs.hits, thumbs.misses, thumbs.refused );
+	pthread_mutex_unlock( &thumbs.lock );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to show or hide the storyboard
+/*!
+ * When shown, the storyboard is scrolled so that the tile of the current frame is in the middle of the screen. Only a CvCapture has a storyboard.
+ * 
+ * \param cur_frame : The current frame.
+ * */
+void board_toggle( int cur_frame ){
+	if( !thumbs.vid ){
+		sprintf( status_line, "No storyboard" );
+		change_status();
+		return;
+	}
+	board.shown = !board.shown;
+	if( board.shown ){
+		board.interval = MAX( cvRound( board_seconds*fps ), 1 );
+		board_update();
+		int cols, rows, cell_w, cell_h;
+		board_layout( &cols, &rows, &cell_w, &cell_h );
+		board.top = MAX( board_tile( cur_frame ), 0 )/cols - rows/2;
+		board_scroll( 0 );
+	}
+	sprintf( status_line, "%s", board.shown ? "Storyboard" : "Frame view" );
+	change_status();
+}
+
+//Function to add the tiles of the frames analysed since the last call
+/*!
+ * Without an activity timeline the tiles of the whole video are added at once, one every \a board.interval frames.
+ * */
+void board_update(){
+	int limit = activity.vid ? MIN( __atomic_load_n( &activity.analysed, __ATOMIC_RELAXED ), activity.size - 1 ) : sldr_maxval;
+	uchar lo, hi;
+	for( int f=board.scanned + 1; f<=limit; f++ ){
+		bool cut = activity.vid && activity_range( ACT_CUT, f, f, &lo, &hi ) && hi>=ACT_CUT_LEVEL;
+		if( board.count && !cut && f - board.frames[ board.count - 1 ]<board.interval ){
+			continue;
+		}
+		if( board.count==board.capacity ){
+			board.capacity = MAX( 2*board.capacity, 64 );
+			board.frames = ( int* )realloc( board.frames, board.capacity*sizeof( int ) );
+		}
+		board.frames[ board.count++ ] = f;
+	}
+	board.scanned = MAX( board.scanned, limit );
+}
+
+//Function to get the layout of the storyboard
+/*!
+ * \param cols : Set to the number of tiles in a row.
+ * \param rows : Set to the number of rows on the screen.
+ * \param cell_w : Set to the width of a tile with its margin.
+ * \param cell_h : Set to the height of a tile with its margin and label.
+ * */
+void board_layout( int* cols, int* rows, int* cell_w, int* cell_h ){
+	*cols = MAX( p_width/( THUMB_WIDTH + 8 ), 1 );
+	*cell_w = p_width/( *cols );
+	*cell_h = thumbs.size.height + 24;
+	*rows = MAX( scrn_height/( *cell_h ), 1 );
+}
+
+//Function to find the tile of a frame
+/*!
+ * \return The index of the last tile starting at or before \a frame_no, -1 when there is none.
+ * */
+int board_tile( int frame_no ){
+	int lo = 0, hi = board.count;
+	while( lo<hi ){
+		int mid = ( lo + hi )/2;
+		if( board.frames[ mid ]<=frame_no ){
+			lo = mid + 1;
+		}
+		else{
+			hi = mid;
+		}
+	}
+	return( lo - 1 );
+}
+
+//Function to scroll the storyboard
+/*!
+ * \param rows : Number of rows to scroll by, negative to scroll up; 0 only keeps \a board.top in range.
+ * */
+void board_scroll( int rows ){
+	int cols, shown, cell_w, cell_h;
+	board_layout( &cols, &shown, &cell_w, &cell_h );
+	int total = ( board.count + cols - 1 )/cols;
+	board.top = MIN( MAX( board.top + rows, 0 ), MAX( total - shown, 0 ) );
+}
+
+//Function to seek to the tile under the mouse
+/*!
+ * Goes to the first frame of the tile through show_frame(), so that the frame shown is the one of the thumbnail, and returns to the frame view.
+ * 
+ * \param x : x coordinate of the mouse.
+ * \param y : y coordinate of the mouse.
+ * */
+void board_click( int x, int y ){
+	int cols, rows, cell_w, cell_h;
+	board_layout( &cols, &rows, &cell_w, &cell_h );
+	int col = x/cell_w, row = y/cell_h;
+	int i = ( board.top + row )*cols + col;
+	if( col>=cols || row>=rows || i>=board.count ){
+		return;
+	}
+	board.shown = false;
+	show_frame( board.frames[i] );
+	snprintf( status_line, sizeof( status_line ), "Tile %d", i + 1 );
+	change_status();
+}
+
+//Function to draw the storyboard
+/*!
+ * Fills the frame area with the tiles of the rows on the screen, each labelled with its first frame and its time. The tile holding the current frame is outlined in yellow, and the tiles whose thumbnail is not decoded yet are drawn as placeholders.
+ * 
+ * \param cur_frame : The current frame.
+ * */
+void draw_storyboard( int cur_frame ){
+	board_update();
+	board_scroll( 0 );
+	int cols, rows, cell_w, cell_h;
+	board_layout( &cols, &rows, &cell_w, &cell_h );
+	int first = board.top*cols;
+	int n = MIN( MIN( rows*cols, board.count - first ), THUMB_WANTED );
+	thumb_want( board.frames + first, n );
+	int cur = board_tile( cur_frame );
+	int th = thumbs.size.height;
+	char text[ 48 ];
+	cvZero( frame_area );
+	for( int i=0; i<n; i++ ){
+		int f = board.frames[ first + i ];
+		int x0 = ( i%cols )*cell_w + ( cell_w - THUMB_WIDTH )/2, y0 = ( i/cols )*cell_h + 4;
+		CvMat tile;
+		cvGetSubRect( frame_area, &tile, cvRect( x0, y0, THUMB_WIDTH, th ) );
+		Frame_Buf* buf = thumb_get( f );
+		if( buf ){
+			cvCopy( buf->img, &tile );
+			frame_unref( buf );
+		}
+		else{
+			cvSet( &tile, cvScalarAll( 48 ) );
+		}
+		cvRectangle( frame_area, cvPoint( x0 - 1, y0 - 1 ), cvPoint( x0 + THUMB_WIDTH, y0 + th ), first + i==cur ? yellow : gray, 1, 8, 0 );
+		int secs = cvFloor( f/fps );
+		snprintf( text, sizeof( text ), "%d  %02d:%02d:%02d", f, secs/3600, secs/60%60, secs%60 );
+		cvPutText( frame_area, text, cvPoint( x0 + 2, y0 + th + 14 ), &font_small, white );
+	}
+}
+
+//Function to write the state of the storyboard
+/*!
+ * \return The number of characters written.
+ * */
+int board_metrics( char* buf, int size ){
+	int len = snprintf( buf, size, "\"board_shown\":%s,\"board_tiles\":%d,\"board_top\":%d",
+		board.shown ? "true" : "false", board.count, board.top );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to add the time taken by a decode to a running average
+/*!
+ * \param avg_us : The running average in microseconds, updated atomically so that any thread may decode.
+ * \param start : Tick count when the decode started.
+ * */
+void note_decode( long* avg_us, int64 start ){
+	long us = ( long )( ( cvGetTickCount() - start )/cvGetTickFrequency() );
+	long avg = __atomic_load_n( avg_us, __ATOMIC_RELAXED );
+	__atomic_store_n( avg_us, avg ? ( 7*avg + us )/8 : MAX( us, 1L ), __ATOMIC_RELAXED );
+}
+
+//Function to start the compare mode
+/*!
+ * Opens every input other than the main video and starts one decoding thread per input, but no more than there are CPUs. Only a CvCapture can be compared.
+ * 
+ * \return false when an input cannot be opened.
+ * */
+bool compare_start(){
+	if( !vid ){
+		printf( "Only video files can be compared\n" );
+		return( false );
+	}
+	compare.inputs[0].frame_no = -1;
+	for( int i=1; i<compare.count; i++ ){
+		Compare_Input* in = &compare.inputs[i];
+		in->frame_no = -1;
+		if( !( in->vid = cvCaptureFromFile( in->path ) ) ){
+			printf( "Cannot open %s\n", in->path );
+			return( false );
+		}
+	}
+	compare.canvas = cvCreateImage( cvSize( p_width, scrn_height ), IPL_DEPTH_8U, 3 );
+	mem_register( "compare", MEM_PRIO_FIXED, compare_usage, NULL );
+	//nothing to decode until compare_sync()
+	compare.next = compare.count;
+	compare.nworkers = threads_take( compare.count - 1 );
+	for( int i=0; i<compare.nworkers; i++ ){
+		pthread_create( &compare.workers[i], NULL, compare_worker, NULL );
+	}
+	return( true );
+}
+
+//Function to stop the compare mode
+void compare_stop(){
+	pthread_mutex_lock( &compare.lock );
+	compare.quit = true;
+	pthread_cond_broadcast( &compare.work );
+	pthread_mutex_unlock( &compare.lock );
+	for( int i=0; i<compare.nworkers; i++ ){
+		pthread_join( compare.workers[i], NULL );
+	}
+	threads_release( compare.nworkers );
+	compare.nworkers = 0;
+	for( int i=1; i<compare.count; i++ ){
+		if( compare.inputs[i].vid ){
+			cvReleaseCapture( &compare.inputs[i].vid );
+		}
+		frame_unref( compare.inputs[i].frame );
+		compare.inputs[i].frame = NULL;
+	}
+	if( compare.canvas ){
+		cvReleaseImage( &compare.canvas );
+	}
+	compare.count = 0;
+}
+
+//The threads decoding the inputs of the compare mode
+/*!
+ * Every thread takes the next input not decoded yet, decodes the frame \a compare.target of it and copies it to a buffer of the frame pool, until no input is left; the last one to finish wakes up the main loop.
+ * */
+void* compare_worker( void* arg ){
+	pthread_mutex_lock( &compare.lock );
+	while( !compare.quit ){
+		if( compare.next>=compare.count ){
+			pthread_cond_wait( &compare.work, &compare.lock );
+			continue;
+		}
+		Compare_Input* in = &compare.inputs[ compare.next++ ];
+		int target = compare.target;
+		pthread_mutex_unlock( &compare.lock );
+		int64 start = cvGetTickCount();
+		IplImage* img = decode_at( in->vid, target );
+		note_decode( &in->decode_us, start );
+		Frame_Buf* buf = NULL;
+		if( img ){
+			buf = pool_get( cvGetSize( img ), img->depth, img->nChannels, false );
+			cvCopy( img, buf->img );
+			buf->frame_no = target;
+		}
+		pthread_mutex_lock( &compare.lock );
+		//an input which has ended keeps showing its last frame
+		if( buf ){
+			frame_unref( in->frame );
+			in->frame = buf;
+		}
+		in->ended = !img;
+		in->frame_no = target;
+		if( --compare.pending==0 ){
+			pthread_cond_signal( &compare.done );
+		}
+	}
+	pthread_mutex_unlock( &compare.lock );
+	return( NULL );
+}
+
+//Function to hand a frame of every input to the decoding threads
+/*!
+ * Called by the main loop before it decodes the frame \a frame_no of the main video, so that the other inputs are decoded meanwhile. The inputs which do not hold \a frame_no yet are handed to the decoding threads, once the frames handed to them before are decoded; nothing is waited for otherwise.
+ * 
+ * \param frame_no : The frame of the main video, as get_frame_pos() reports it.
+ * \sa compare_sync().
+ * */
+void compare_dispatch( int frame_no ){
+	//nothing to do before compare_start(), or without inputs to compare
+	if( !compare.nworkers ){
+		return;
+	}
+	pthread_mutex_lock( &compare.lock );
+	while( compare.pending>0 ){
+		pthread_cond_wait( &compare.done, &compare.lock );
+	}
+	bool stale = false;
+	for( int i=1; i<compare.count; i++ ){
+		stale = stale || compare.inputs[i].frame_no!=frame_no;
+	}
+	if( stale ){
+		compare.target = frame_no;
+		compare.next = 1;
+		compare.pending = compare.count - 1;
+		pthread_cond_broadcast( &compare.work );
+	}
+	pthread_mutex_unlock( &compare.lock );
+}
+
+//Function to decode the current frame of every input
+/*!
+ * Hands the inputs which do not hold \a frame_no yet to the decoding threads, unless compare_dispatch() did already, and waits until all of them are decoded.
+ * 
+ * \param frame_no : The frame of the main video, as get_frame_pos() reports it.
+ * */
+void compare_sync( int frame_no ){
+	compare.inputs[0].frame_no = frame_no;
+	compare_dispatch( frame_no );
+	pthread_mutex_lock( &compare.lock );
+	while( compare.pending>0 ){
+		pthread_cond_wait( &compare.done, &compare.lock );
+	}
+	pthread_mutex_unlock( &compare.lock );
+}
+
+//Function to draw a frame with the current zoom and pan
+/*!
+ * The region of the main video shown by render_frame() is mapped to \a img in proportion to its size, so that inputs of another resolution show the same part of the picture.
+ * 
+ * \param img : The frame.
+ * \param dst : The area to draw it in.
+ * */
+void compare_view( IplImage* img, CvArr* dst ){
+	double sx = img->width/( double )old_frame->width, sy = img->height/( double )old_frame->height;
+	CvRect r = cvRect( cvRound( view_rect.x*sx ), cvRound( view_rect.y*sy ), MAX( cvRound( view_rect.width*sx ), 1 ), MAX( cvRound( view_rect.height*sy ), 1 ) );
+	r.width = MIN( r.width, img->width - r.x );
+	r.height = MIN( r.height, img->height - r.y );
+	cvSetImageROI( img, r );
+	cvResize( img, dst, CV_INTER_LINEAR );
+	cvResetImageROI( img );
+}
+
+//Function to draw the name and decode time of an input
+/*!
+ * \param i : Index of the input.
+ * \param x : x coordinate of the label in the frame area.
+ * \param y : y coordinate of the label in the frame area.
+ * \param slowest : Decode time of the slowest input; the label of that input is drawn in red.
+ * */
+void compare_label( int i, int x, int y, long slowest ){
+	const Compare_Input* in = &compare.inputs[i];
+	const char* name = strrchr( in->path, '/' );
+	long us = __atomic_load_n( &in->decode_us, __ATOMIC_RELAXED );
+	char text[ 96 ];
+	snprintf( text, sizeof( text ), "%s  %.1f ms%s", name ? name + 1 : in->path, us/1000.0, in->ended ? "  ( ended )" : "" );
+	cvPutText( frame_area, text, cvPoint( x + 1, y + 1 ), &font_small, black );
+	cvPutText( frame_area, text, cvPoint( x, y ), &font_small, ( us==slowest && slowest>0 ) ? red : white );
+}
+
+//Function to draw the inputs of the compare mode
+/*!
+ * Replaces the frame drawn by render_frame() with all the inputs side by side or in a grid, every one with the current zoom and pan. With the wipe, the main video as drawn by render_frame() ( with its difference view, if any ) stays left of \a compare.wipe_x and the input \a compare.wiped is drawn right of it.
+ * 
+ * \param cur_frame : The current frame.
+ * */
+void draw_compare( int cur_frame ){
+	if( compare.count<2 ){
+		return;
+	}
+	compare_sync( cur_frame );
+	long slowest = 0;
+	for( int i=0; i<compare.count; i++ ){
+		slowest = MAX( slowest, __atomic_load_n( &compare.inputs[i].decode_us, __ATOMIC_RELAXED ) );
+	}
+	if( compare.layout==COMPARE_WIPE ){
+		Compare_Input* in = &compare.inputs[ compare.wiped ];
+		int x = MIN( MAX( compare.wipe_x, 0 ), p_width - 1 );
+		if( in->frame ){
+			compare_view( in->frame->img, compare.canvas );
+			CvMat src, dst;
+			cvGetSubRect( compare.canvas, &src, cvRect( x, 0, p_width - x, scrn_height ) );
+			cvGetSubRect( frame_area, &dst, cvRect( x, 0, p_width - x, scrn_height ) );
+			cvCopy( &src, &dst );
+		}
+		cvLine( frame_area, cvPoint( x, 0 ), cvPoint( x, scrn_height - 1 ), yellow, 1, 8, 0 );
+		compare_label( 0, 6, scrn_height - 8, slowest );
+		compare_label( compare.wiped, MIN( x + 6, p_width - 200 ), scrn_height - 8, slowest );
+		return;
+	}
+	int cols = ( compare.layout==COMPARE_SIDE ) ? compare.count : ( compare.count + 1 )/2;
+	int rows = ( compare.count + cols - 1 )/cols;
+	int cell_w = p_width/cols, cell_h = scrn_height/rows;
+	cvZero( frame_area );
+	for( int i=0; i<compare.count; i++ ){
+		int x0 = ( i%cols )*cell_w, y0 = ( i/cols )*cell_h;
+		Frame_Buf* buf = compare.inputs[i].frame;
+		IplImage* img = ( i==0 ) ? old_frame : ( buf ? buf->img : NULL );
+		CvMat cell;
+		cvGetSubRect( frame_area, &cell, cvRect( x0, y0, cell_w - 1, cell_h - 1 ) );
+		if( img ){
+			compare_view( img, &cell );
+		}
+		compare_label( i, x0 + 6, y0 + cell_h - 8, slowest );
+	}
+}
+
+//Function to get the size of the frames of the compare mode
+size_t compare_usage(){
+	size_t bytes = compare.canvas ? compare.canvas->imageSize : 0;
+	pthread_mutex_lock( &compare.lock );
+	for( int i=1; i<compare.count; i++ ){
+		if( compare.inputs[i].frame ){
+			bytes += compare.inputs[i].frame->bytes;
+		}
+	}
+	pthread_mutex_unlock( &compare.lock );
+	return( bytes );
+}
+
+//Function to write the state of the compare mode
+/*!
+ * \return The number of characters written.
+ * */
+int compare_metrics( char* buf, int size ){
+	static const char* names[] = { "side", "grid", "wipe" };
+	int len = snprintf( buf, size, "\"compare_inputs\":%d,\"compare_layout\":\"%s\",\"decode_us\":[", MAX( compare.count, 1 ), names[ compare.layout ] );
+	for( int i=0; i<MAX( compare.count, 1 ) && len<size; i++ ){
+		len += snprintf( buf + len, size - len, "%s%ld", i ? "," : "", __atomic_load_n( &compare.inputs[i].decode_us, __ATOMIC_RELAXED ) );
+	}
+	len = MIN( len, size - 1 );
+	len += snprintf( buf + len, size - len, "]" );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to start the quality engine
+/*!
+ * Opens both videos again, each for its own decoding thread, allocates the results and starts the comparing threads: one for the frames and, for their bands, as many as the thread budget allows.
+ * 
+ * \param main_video : Path of the main video.
+ * \param other : Path of the video compared to it.
+ * \return false when a video cannot be opened.
+ * */
+bool quality_start( const char* main_video, const char* other ){
+	const char* paths[ 2 ] = { main_video, other };
+	for( int i=0; i<2; i++ ){
+		Decode_Queue* q = &quality.inputs[i];
+		pthread_mutex_init( &q->lock, NULL );
+		pthread_cond_init( &q->cond, NULL );
+		if( !( q->vid = vp_open( paths[i] ) ) ){
+			printf( "Cannot open %s\n", paths[i] );
+			if( i>0 ){
+				vp_close( quality.inputs[0].vid );
+				quality.inputs[0].vid = NULL;
+			}
+			return( false );
+		}
+	}
+	pthread_mutex_init( &quality.lock, NULL );
+	pthread_cond_init( &quality.work, NULL );
+	pthread_cond_init( &quality.done_cond, NULL );
+	//started again for every file of a playlist
+	for( int i=0; i<2; i++ ){
+		Decode_Queue* q = &quality.inputs[i];
+		q->head = q->count = 0;
+		q->ended = false;
+	}
+	quality.done = quality.tallied = 0;
+	quality.nworst = 0;
+	quality.psnr_sum = quality.ssim_sum = quality.secs = 0;
+	quality.finished = quality.mismatch = quality.quit = false;
+	quality.size = sldr_maxval + 1;
+	for( int k=0; k<2*QUALITY_PLANES; k++ ){
+		quality.values[k] = ( float* )calloc( quality.size, sizeof( float ) );
+	}
+	quality.shown = true;
+	quality.rank = -1;
+	mem_register( "quality", MEM_PRIO_FIXED, quality_usage, NULL );
+	for( int i=0; i<2; i++ ){
+		pthread_create( &quality.inputs[i].thread, NULL, decode_queue_worker, &quality.inputs[i] );
+	}
+	quality.nworkers = threads_take( QUALITY_JOBS );
+	for( int i=0; i<quality.nworkers; i++ ){
+		pthread_create( &quality.workers[i], NULL, quality_band_worker, NULL );
+	}
+	pthread_create( &quality.thread, NULL, quality_worker, NULL );
+	return( true );
+}
+
+//Function to stop the quality engine
+/*!
+ * Stops all its threads and, if the comparison did not finish, saves the frames compared so far.
+ * */
+void quality_stop(){
+	if( !quality.size ){
+		return;
+	}
+	__atomic_store_n( &quality.quit, true, __ATOMIC_RELAXED );
+	for( int i=0; i<2; i++ ){
+		pthread_mutex_lock( &quality.inputs[i].lock );
+		pthread_cond_broadcast( &quality.inputs[i].cond );
+		pthread_mutex_unlock( &quality.inputs[i].lock );
+	}
+	pthread_join( quality.thread, NULL );
+	pthread_mutex_lock( &quality.lock );
+	pthread_cond_broadcast( &quality.work );
+	pthread_mutex_unlock( &quality.lock );
+	for( int i=0; i<quality.nworkers; i++ ){
+		pthread_join( quality.workers[i], NULL );
+	}
+	threads_release( quality.nworkers );
+	for( int i=0; i<2; i++ ){
+		Decode_Queue* q = &quality.inputs[i];
+		pthread_join( q->thread, NULL );
+		for( ; q->count>0; q->count-- ){
+			frame_unref( q->bufs[ q->head ] );
+			q->head = ( q->head + 1 )%QUALITY_QUEUE;
+		}
+		vp_close( q->vid );
+		q->vid = NULL;
+	}
+	if( !quality.finished ){
+		quality_save();
+	}
+	for( int k=0; k<2*QUALITY_PLANES; k++ ){
+		free( quality.values[k] );
+	}
+	free( quality.sums );
+	quality.sums = NULL;
+	quality.nbands = 0;
+	quality.size = 0;
+	quality.shown = false;
+}
+
+//The threads decoding the videos for the quality engine
+/*!
+ * Decodes the video of the queue \a arg in order with the engine ( see videoplayer.h ), copying every frame to a buffer of the frame pool, and waits while the queue is full.
+ * 
+ * \param arg : The Decode_Queue.
+ * */
+void* decode_queue_worker( void* arg ){
+	Decode_Queue* q = ( Decode_Queue* )arg;
+	IplImage* header = NULL;
+	while( 1 ){
+		pthread_mutex_lock( &q->lock );
+		while( q->count==QUALITY_QUEUE && !__atomic_load_n( &quality.quit, __ATOMIC_RELAXED ) ){
+			pthread_cond_wait( &q->cond, &q->lock );
+		}
+		pthread_mutex_unlock( &q->lock );
+		if( __atomic_load_n( &quality.quit, __ATOMIC_RELAXED ) ){
+			break;
+		}
+		IplImage* img = decode_player( q->vid, &header );
+		Frame_Buf* buf = img ? pool_get( cvGetSize( img ), img->depth, img->nChannels, false ) : NULL;
+		if( buf ){
+			cvCopy( img, buf->img );
+			buf->frame_no = vp_position( q->vid );
+		}
+		pthread_mutex_lock( &q->lock );
+		if( buf ){
+			q->bufs[ ( q->head + q->count )%QUALITY_QUEUE ] = buf;
+			q->count++;
+		}
+		else{
+			q->ended = true;
+		}
+		pthread_cond_broadcast( &q->cond );
+		pthread_mutex_unlock( &q->lock );
+		if( !buf ){
+			break;
+		}
+	}
+	if( header ){
+		cvReleaseImageHeader( &header );
+	}
+	return( NULL );
+}
+
+//Function to take the next decoded frame of a queue
+/*!
+ * Waits until a frame is decoded.
+ * 
+ * \return The frame, holding the queue's reference, or NULL at the end of the video or when stopping.
+ * */
+Frame_Buf* decode_queue_pop( Decode_Queue* q ){
+	Frame_Buf* buf = NULL;
+	pthread_mutex_lock( &q->lock );
+	while( !q->count && !q->ended && !__atomic_load_n( &quality.quit, __ATOMIC_RELAXED ) ){
+		pthread_cond_wait( &q->cond, &q->lock );
+	}
+	if( q->count ){
+		buf = q->bufs[ q->head ];
+		q->head = ( q->head + 1 )%QUALITY_QUEUE;
+		q->count--;
+		pthread_cond_broadcast( &q->cond );
+	}
+	pthread_mutex_unlock( &q->lock );
+	return( buf );
+}
+
+//The thread comparing the frames of the two videos
+/*!
+ * Takes the frames of both queues in pairs until either video ends, and saves the results once done. Videos whose frames differ in size or format are not compared.
+ * */
+void* quality_worker( void* arg ){
+	int64 start = cvGetTickCount();
+	while( !__atomic_load_n( &quality.quit, __ATOMIC_RELAXED ) ){
+		Frame_Buf* a = decode_queue_pop( &quality.inputs[0] );
+		Frame_Buf* b = a ? decode_queue_pop( &quality.inputs[1] ) : NULL;
+		bool same = ( a && b && a->img->width==b->img->width && a->img->height==b->img->height &&
+			a->img->depth==IPL_DEPTH_8U && b->img->depth==IPL_DEPTH_8U && a->img->nChannels==3 && b->img->nChannels==3 );
+		if( a && b && !same ){
+			quality.mismatch = true;
+		}
+		if( same && a->frame_no>0 && a->frame_no<quality.size ){
+			quality_frame( a->img, b->img, a->frame_no );
+			__atomic_store_n( &quality.done, a->frame_no, __ATOMIC_RELEASE );
+		}
+		if( a ){
+			frame_unref( a );
+		}
+		if( b ){
+			frame_unref( b );
+		}
+		if( !same ){
+			break;
+		}
+	}
+	quality.secs = ( cvGetTickCount() - start )/( cvGetTickFrequency()*1e6 );
+	if( !__atomic_load_n( &quality.quit, __ATOMIC_RELAXED ) ){
+		quality_save();
+	}
+	__atomic_store_n( &quality.finished, true, __ATOMIC_RELEASE );
+	return( NULL );
+}
+
+//Function to compare a pair of frames
+/*!
+ * Hands the bands of 8 rows of the frames to the band threads, waits for all of them and combines their sums into the PSNR and SSIM of every plane of frame \a frame_no. The PSNR of identical planes is reported as 100 dB.
+ * 
+ * \param a : The frame of the main video.
+ * \param b : The frame of the compared video.
+ * \param frame_no : Number of the frame.
+ * */
+void quality_frame( const IplImage* a, const IplImage* b, int frame_no ){
+	int nbands = ( a->height + 7 )/8;
+	pthread_mutex_lock( &quality.lock );
+	if( nbands!=quality.nbands ){
+		quality.sums = ( Quality_Sums* )realloc( quality.sums, nbands*sizeof( Quality_Sums ) );
+		quality.nbands = nbands;
+	}
+	quality.pair[0] = a;
+	quality.pair[1] = b;
+	quality.next_band = 0;
+	quality.pending = nbands;
+	pthread_cond_broadcast( &quality.work );
+	while( quality.pending>0 ){
+		pthread_cond_wait( &quality.done_cond, &quality.lock );
+	}
+	pthread_mutex_unlock( &quality.lock );
+
+	Quality_Sums total;
+	memset( &total, 0, sizeof( total ) );
+	for( int i=0; i<nbands; i++ ){
+		for( int c=0; c<QUALITY_PLANES; c++ ){
+			total.ssd[c] += quality.sums[i].ssd[c];
+			total.ssim[c] += quality.sums[i].ssim[c];
+		}
+		total.blocks += quality.sums[i].blocks;
+	}
+	double pixels = a->width*( double )a->height;
+	for( int c=0; c<QUALITY_PLANES; c++ ){
+		double mse = total.ssd[c]/pixels;
+		quality.values[c][ frame_no ] = ( mse>0 ) ? ( float )MIN( 10*log10( 255.0*255.0/mse ), 100.0 ) : 100.0f;
+		quality.values[ QUALITY_PLANES + c ][ frame_no ] = total.blocks ? ( float )( total.ssim[c]/total.blocks ) : 1.0f;
+	}
+}
+
+//The threads comparing the bands of a pair of frames
+/*!
+ * Every thread takes the next band not compared yet until none is left; the last one to finish wakes up quality_frame(). The planes of a band are split into a scratch buffer owned by the thread.
+ * */
+void* quality_band_worker( void* arg ){
+	uchar* scratch = NULL;
+	int scratch_width = 0;
+	pthread_mutex_lock( &quality.lock );
+	while( !__atomic_load_n( &quality.quit, __ATOMIC_RELAXED ) ){
+		if( quality.pending<=0 || quality.next_band>=quality.nbands ){
+			pthread_cond_wait( &quality.work, &quality.lock );
+			continue;
+		}
+		int band = quality.next_band++;
+		const IplImage* a = quality.pair[0];
+		const IplImage* b = quality.pair[1];
+		pthread_mutex_unlock( &quality.lock );
+		if( a->width>scratch_width ){
+			scratch_width = a->width;
+			free( scratch );
+			//the planes of both frames, and the sums of the 8x8 blocks of a row of blocks
+			scratch = ( uchar* )malloc( ( 2*QUALITY_PLANES*8 + 2 )*( size_t )scratch_width + 64 );
+		}
+		quality_band( a, b, band*8, MIN( 8, a->height - band*8 ), &quality.sums[ band ], scratch );
+		pthread_mutex_lock( &quality.lock );
+		if( --quality.pending==0 ){
+			pthread_cond_signal( &quality.done_cond );
+		}
+	}
+	pthread_mutex_unlock( &quality.lock );
+	free( scratch );
+	return( NULL );
+}
+
+//Function to compare a band of a pair of frames
+/*!
+ * Splits the rows of both frames into luma, blue, green and red planes, sums their squared differences and, when the band is a full row of 8x8 blocks, the SSIM of its blocks.
+ * 
+ * \param a : The frame of the main video.
+ * \param b : The frame of the compared video.
+ * \param y0 : First row of the band.
+ * \param rows : Number of rows of the band, at most 8.
+ * \param s : Set to the sums of the band.
+ * \param scratch : Buffer of at least ( 2 #QUALITY_PLANES 8 + 2 ) times the width of the frames.
+ * */
+void quality_band( const IplImage* a, const IplImage* b, int y0, int rows, Quality_Sums* s, uchar* scratch ){
+	int w = a->width;
+	uchar* pa[ QUALITY_PLANES ];
+	uchar* pb[ QUALITY_PLANES ];
+	for( int c=0; c<QUALITY_PLANES; c++ ){
+		pa[c] = scratch + c*8*w;
+		pb[c] = scratch + ( QUALITY_PLANES + c )*8*w;
+	}
+	memset( s, 0, sizeof( Quality_Sums ) );
+	for( int r=0; r<rows; r++ ){
+		split_bgr_u8( ( const uchar* )( a->imageData + ( y0 + r )*a->widthStep ), pa[1] + r*w, pa[2] + r*w, pa[3] + r*w, pa[0] + r*w, w );
+		split_bgr_u8( ( const uchar* )( b->imageData + ( y0 + r )*b->widthStep ), pb[1] + r*w, pb[2] + r*w, pb[3] + r*w, pb[0] + r*w, w );
+		for( int c=0; c<QUALITY_PLANES; c++ ){
+			s->ssd[c] += ssd_u8( pa[c] + r*w, pb[c] + r*w, w );
+		}
+	}
+	if( rows<8 ){
+		return;
+	}
+	int groups = w/8;
+	int* sums = ( int* )( ( ( size_t )( scratch + 2*QUALITY_PLANES*8*w ) + 15 )&~( size_t )15 );
+	for( int c=0; c<QUALITY_PLANES; c++ ){
+		memset( sums, 0, 4*groups*sizeof( int ) );
+		for( int r=0; r<8; r++ ){
+			ssim_row_u8( pa[c] + r*w, pb[c] + r*w, groups, sums );
+		}
+		for( int g=0; g<groups; g++ ){
+			s->ssim[c] += ssim_block( sums + 4*g );
+		}
+	}
+	s->blocks = groups;
+}
+
+//Function to split a BGR row into planes
+/*!
+ * The luma is the integer approximation \f$ Y = ( 29B + 150G + 77R + 128 )/256 \f$ of the BT.601 weights.
+ * 
+ * \param src : The BGR pixels.
+ * \param b : Set to the blue plane.
+ * \param g : Set to the green plane.
+ * \param r : Set to the red plane.
+ * \param y : Set to the luma plane.
+ * \param n : Number of pixels.
+ * */
+void split_bgr_u8( const uchar* src, uchar* b, uchar* g, uchar* r, uchar* y, int n ){
+	for( int i=0; i<n; i++, src+=3 ){
+		b[i] = src[0];
+		g[i] = src[1];
+		r[i] = src[2];
+		y[i] = ( uchar )( ( 29*src[0] + 150*src[1] + 77*src[2] + 128 )>>8 );
+	}
+}
+
+//Function to get the sum of the squared differences of two rows
+/*!
+ * With SSE2, 16 pixels are processed at once: the absolute differences are widened to 16 bits and squared and summed pairwise with _mm_madd_epi16(). The 32-bit lanes cannot overflow for rows of up to 8192 pixels.
+ * 
+ * \param a : First row.
+ * \param b : Second row.
+ * \param n : Number of pixels.
+ * \return The sum of the squared differences.
+ * */
+uint64 ssd_u8( const uchar* a, const uchar* b, int n ){
+	uint64 sum = 0;
+	int i = 0;
+#ifdef __SSE2__
+	__m128i zero = _mm_setzero_si128();
+	__m128i acc = zero;
+	for( ; i + 16<=n; i += 16 ){
+		__m128i va = _mm_loadu_si128( ( const __m128i* )( a + i ) );
+		__m128i vb = _mm_loadu_si128( ( const __m128i* )( b + i ) );
+		__m128i d = _mm_or_si128( _mm_subs_epu8( va, vb ), _mm_subs_epu8( vb, va ) );
+		__m128i lo = _mm_unpacklo_epi8( d, zero );
+		__m128i hi = _mm_unpackhi_epi8( d, zero );
+		acc = _mm_add_epi32( acc, _mm_add_epi32( _mm_madd_epi16( lo, lo ), _mm_madd_epi16( hi, hi ) ) );
+	}
+	int lanes[ 4 ];
+	_mm_storeu_si128( ( __m128i* )lanes, acc );
+	sum = ( uint64 )( unsigned )lanes[0] + ( unsigned )lanes[1] + ( unsigned )lanes[2] + ( unsigned )lanes[3];
+#endif
+	for( ; i<n; i++ ){
+		int d = a[i] - b[i];
+		sum += d*d;
+	}
+	return( sum );
+}
+
+//Function to add a row to the sums of the 8x8 SSIM blocks
+/*!
+ * For every group of 8 pixels \a g, adds to \a sums[ 4g ] to \a sums[ 4g + 3 ] the sum of \a a, the sum of \a b, the sum of their squares and the sum of their products. With SSE2 the sums of the pixels come from _mm_sad_epu8() and the others from _mm_madd_epi16().
+ * 
+ * \param a : First row.
+ * \param b : Second row.
+ * \param groups : Number of groups of 8 pixels.
+ * \param sums : The sums of the blocks.
+ * */
+void ssim_row_u8( const uchar* a, const uchar* b, int groups, int* sums ){
+	int g = 0;
+#ifdef __SSE2__
+	__m128i zero = _mm_setzero_si128();
+	for( ; g<groups; g++ ){
+		__m128i va = _mm_loadl_epi64( ( const __m128i* )( a + 8*g ) );
+		__m128i vb = _mm_loadl_epi64( ( const __m128i* )( b + 8*g ) );
+		__m128i a16 = _mm_unpacklo_epi8( va, zero );
+		__m128i b16 = _mm_unpacklo_epi8( vb, zero );
+		__m128i ss = _mm_add_epi32( _mm_madd_epi16( a16, a16 ), _mm_madd_epi16( b16, b16 ) );
+		__m128i s12 = _mm_madd_epi16( a16, b16 );
+		ss = _mm_add_epi32( ss, _mm_shuffle_epi32( ss, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		ss = _mm_add_epi32( ss, _mm_shuffle_epi32( ss, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		s12 = _mm_add_epi32( s12, _mm_shuffle_epi32( s12, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		s12 = _mm_add_epi32( s12, _mm_shuffle_epi32( s12, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		int* s = sums + 4*g;
+		s[0] += _mm_cvtsi128_si32( _mm_sad_epu8( va, zero ) );
+		s[1] += _mm_cvtsi128_si32( _mm_sad_epu8( vb, zero ) );
+		s[2] += _mm_cvtsi128_si32( ss );
+		s[3] += _mm_cvtsi128_si32( s12 );
+	}
+#endif
+	for( ; g<groups; g++ ){
+		int* s = sums + 4*g;
+		for( int i=8*g; i<8*g + 8; i++ ){
+			s[0] += a[i];
+			s[1] += b[i];
+			s[2] += a[i]*a[i] + b[i]*b[i];
+			s[3] += a[i]*b[i];
+		}
+	}
+}
+
+//Function to get the SSIM of an 8x8 block
+/*!
+ * \f[ SSIM = \frac{ ( 2 \mu_a \mu_b + c_1 )( 2 \sigma_{ab} + c_2 ) }{ ( \mu_a^2 + \mu_b^2 + c_1 )( \sigma_a^2 + \sigma_b^2 + c_2 ) } \f]
+ * with \f$ c_1 = ( 0.01 \cdot 255 )^2 \f$ and \f$ c_2 = ( 0.03 \cdot 255 )^2 \f$, computed from the sums of the 64 pixels: the means are scaled by 64, so both factors of the fraction by 64 x 64, and the ( sample ) variances by 64 x 63, which is how the constants are scaled too.
+ * 
+ * \param sums : The sum of \a a, of \a b, of their squares and of their products over the block.
+ * \return The SSIM of the block.
+ * */
+double ssim_block( const int* sums ){
+	const double c1 = 0.01*0.01*255*255*64*64, c2 = 0.03*0.03*255*255*64*63;
+	double s1 = sums[0], s2 = sums[1];
+	double vars = sums[2]*64.0 - s1*s1 - s2*s2;
+	double covar = sums[3]*64.0 - s1*s2;
+	return( ( 2*s1*s2 + c1 )*( 2*covar + c2 )/( ( s1*s1 + s2*s2 + c1 )*( vars + c2 ) ) );
+}
+
+//Function to write the results of the quality engine
+/*!
+ * Writes one line per frame compared, with a column per metric.
+ * 
+ * \return false when the file cannot be written.
+ * */
+bool quality_save(){
+	FILE* fp = fopen( quality.out_path, "w" );
+	if( !fp ){
+		printf( "Cannot write %s\n", quality.out_path );
+		return( false );
+	}
+	fprintf( fp, "frame,psnr_y,psnr_b,psnr_g,psnr_r,ssim_y,ssim_b,ssim_g,ssim_r\n" );
+	int done = __atomic_load_n( &quality.done, __ATOMIC_ACQUIRE );
+	for( int f=1; f<=done; f++ ){
+		fprintf( fp, "%d", f );
+		for( int k=0; k<2*QUALITY_PLANES; k++ ){
+			fprintf( fp, k<QUALITY_PLANES ? ",%.3f" : ",%.5f", quality.values[k][f] );
+		}
+		fprintf( fp, "\n" );
+	}
+	fclose( fp );
+	return( true );
+}
+
+//Function to add the frames compared since the last call to the running totals
+/*!
+ * Keeps the #QUALITY_WORST worst frames and the sums of the luma PSNR and SSIM up to date, so that every call only looks at the frames compared since the last one. Called by the main loop only.
+ * */
+void quality_tally(){
+	const float* psnr = quality.values[0];
+	int done = __atomic_load_n( &quality.done, __ATOMIC_ACQUIRE );
+	for( int f=quality.tallied + 1; f<=done; f++ ){
+		quality.psnr_sum += psnr[f];
+		quality.ssim_sum += quality.values[ QUALITY_PLANES ][f];
+		int n = quality.nworst;
+		if( n==QUALITY_WORST && psnr[f]>=psnr[ quality.worst[ n - 1 ] ] ){
+			continue;
+		}
+		//insert f into the sorted list of the worst frames
+		int i = MIN( n, QUALITY_WORST - 1 );
+		for( ; i>0 && psnr[ quality.worst[ i - 1 ] ]>psnr[f]; i-- ){
+			quality.worst[i] = quality.worst[ i - 1 ];
+		}
+		quality.worst[i] = f;
+		quality.nworst = MIN( n + 1, QUALITY_WORST );
+	}
+	quality.tallied = MAX( quality.tallied, done );
+}
+
+//Function to find the frame with the K-th lowest luma PSNR
+/*!
+ * \param rank : 0 for the worst frame, at most #QUALITY_WORST - 1.
+ * \return The frame, -1 when fewer frames are compared.
+ * */
+int quality_worst( int rank ){
+	if( !quality.size || rank<0 || rank>=QUALITY_WORST ){
+		return( -1 );
+	}
+	quality_tally();
+	return( quality.nworst>rank ? quality.worst[ rank ] : -1 );
+}
+
+//Function to draw the luma PSNR on the slider
+/*!
+ * Draws, with the same scale as moveSlider(), the lowest luma PSNR over the frames of every column as a curve between 20 dB ( bottom, red ) and 50 dB ( top, green ).
+ * 
+ * \param strip : The slider strip.
+ * */
+void draw_quality( IplImage* strip ){
+	int done = __atomic_load_n( &quality.done, __ATOMIC_ACQUIRE );
+	int tl_first_frame, span;
+	tl_window( &tl_first_frame, &span );
+	float scale = ( p_width - sldr_btn_width )/( float )( span );
+	int half = sldr_btn_width/2, h = strip->height;
+	CvPoint prev = cvPoint( 0, 0 );
+	bool has_prev = false;
+	for( int x=0; x<strip->width; x++ ){
+		int first = MAX( tl_first_frame + cvFloor( ( x - half )/scale ), 1 );
+		int last = MIN( MAX( tl_first_frame + cvFloor( ( x + 1 - half )/scale ) - 1, first ), MIN( done, tl_first_frame + span ) );
+		if( first>last ){
+			has_prev = false;
+			continue;
+		}
+		float low = quality.values[0][ first ];
+		for( int f=first + 1; f<=last; f++ ){
+			low = MIN( low, quality.values[0][f] );
+		}
+		double v = MIN( MAX( ( low - 20 )/30.0, 0.0 ), 1.0 );
+		CvPoint p = cvPoint( x, h - 1 - cvRound( v*( h - 1 ) ) );
+		cvLine( strip, has_prev ? prev : p, p, cvScalar( 0, 255*v, 255*( 1 - v ) ), 1, 8, 0 );
+		prev = p;
+		has_prev = true;
+	}
+}
+
+//Function to get the size of the quality engine
+size_t quality_usage(){
+	if( !quality.size ){
+		return( 0 );
+	}
+	size_t bytes = 2*QUALITY_PLANES*sizeof( float )*( size_t )quality.size;
+	for( int i=0; i<2; i++ ){
+		Decode_Queue* q = &quality.inputs[i];
+		pthread_mutex_lock( &q->lock );
+		for( int j=0; j<q->count; j++ ){
+			bytes += q->bufs[ ( q->head + j )%QUALITY_QUEUE ]->bytes;
+		}
+		pthread_mutex_unlock( &q->lock );
+	}
+	return( bytes );
+}
+
+//Function to write the progress of the quality engine
+/*!
+ * \return The number of characters written.
+ * */
+int quality_metrics( char* buf, int size ){
+	if( quality.size ){
+		quality_tally();
+	}
+	int done = quality.tallied;
+	int len = snprintf( buf, size, "\"quality_frames\":%d,\"quality_finished\":%s,\"psnr_y_mean\":%.3f,\"ssim_y_mean\":%.5f,\"quality_worst\":%d",
+		done, quality.finished ? "true" : "false", done ? quality.psnr_sum/done : 0.0, done ? quality.ssim_sum/done : 0.0, quality.nworst ? quality.worst[0] : -1 );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to open a live input
+/*!
+ * The source is a camera when it is a number or <em>/dev/videoN</em>, opened with <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#capturefromcam" target="_blank"><b>cvCaptureFromCAM()</b></a> ( V4L2 on Linux ). A pipe, stdin or a Y4M file is read as a Y4M_Stream ( see stream_open() ), and anything else is opened with cvCaptureFromFile() and read at its frame rate, so that the live mode can be tried without a camera. A camera that does not report its frame rate is assumed to run at <em>--fps</em>.
+ * 
+ * The first frame is grabbed here to learn the frame size. The timeshift buffer then holds <em>--live-minutes</em> of frames, as far as they fit in <em>--live-mb</em> ( and in half of <em>--mem-budget</em> ); the ceiling of the frame pool is raised by that much. Both threads are started and the first frame is waited for.
+ * 
+ * \param source : The camera, pipe or file.
+ * \return The live input, or NULL if no frame could be captured.
+ * \sa live_close(), Live_Input.
+ * */
+Live_Input* live_open( const char* source ){
+	Live_Input* l = ( Live_Input* )calloc( 1, sizeof( Live_Input ) );
+	int cam;
+	char tail;
+	if( sscanf( source, "/dev/video%d%c", &cam, &tail )!=1 && sscanf( source, "%d%c", &cam, &tail )!=1 ){
+		cam = -1;
+	}
+	if( cam>=0 ){
+		l->cap = cvCaptureFromCAM( cam );
+	}
+	else if( ( l->stream = stream_open( source ) ) ){
+		struct stat st;
+		l->paced = ( stat( source, &st )==0 && S_ISREG( st.st_mode ) );
+		l->fps = l->stream->fps;
+	}
+	else{
+		l->cap = cvCaptureFromFile( source );
+		l->paced = true;
+	}
+	if( l->cap ){
+		l->fps = cvGetCaptureProperty( l->cap, CV_CAP_PROP_FPS );
+	}
+	if( l->fps<=0 ){
+		l->fps = raw_fps;
+	}
+	IplImage* img = ( l->cap || l->stream ) ? live_grab( l ) : NULL;
+	if( !img ){
+		live_close( &l );
+		return( NULL );
+	}
+
+	//size the timeshift buffer
+	l->size = cvGetSize( img );
+	l->i420 = ( img->depth==IPL_DEPTH_8U && img->nChannels==3 && l->size.width%2==0 && l->size.height%2==0 );
+	size_t frame_bytes = ( size_t )l->size.width*l->size.height*img->nChannels*( ( img->depth & 255 )/8 );
+	size_t slot_bytes = l->i420 ? frame_bytes/2 : frame_bytes;
+	size_t max_bytes = ( size_t )live_mb<<20;
+	if( mem_gov.budget ){
+		max_bytes = MIN( max_bytes, mem_gov.budget/2 );
+	}
+	double wanted = MAX( live_minutes*60*l->fps, 2.0 );
+	l->nslots = ( int )MAX( MIN( wanted, ( double )( max_bytes/slot_bytes ) ), 2.0 );
+	if( l->nslots<wanted ){
+		printf( "The timeshift buffer holds %.1f s, limited by --live-mb\n", l->nslots/l->fps );
+	}
+	l->slots = ( Frame_Buf** )calloc( l->nslots, sizeof( Frame_Buf* ) );
+	frame_pool.ceiling += l->nslots*slot_bytes + LIVE_QUEUE*frame_bytes;
+
+	//queue the first frame and start the threads
+	pthread_mutex_init( &l->lock, NULL );
+	pthread_cond_init( &l->cond, NULL );
+	Frame_Buf* buf = pool_get( l->size, img->depth, img->nChannels, false );
+	cvCopy( img, buf->img );
+	l->queue[0] = buf;
+	l->q_count = 1;
+	l->captured = 1;
+	l->following = true;
+	pthread_create( &l->capture_thread, NULL, live_capture_worker, l );
+	pthread_create( &l->buffer_thread, NULL, live_buffer_worker, l );
+	pthread_mutex_lock( &l->lock );
+	while( l->head==0 && !l->ended ){
+		pthread_cond_wait( &l->cond, &l->lock );
+	}
+	pthread_mutex_unlock( &l->lock );
+	return( l );
+}
+
+//Function to close a live input
+/*!
+ * Stops both threads and releases the buffered frames and the source. The capture thread is cancelled when reading a pipe, which may block it forever; it can only be cancelled while it waits for a frame.
+ * */
+void live_close( Live_Input** l ){
+	Live_Input* p = *l;
+	if( !p ){
+		return;
+	}
+	if( p->slots ){
+		pthread_mutex_lock( &p->lock );
+		p->quit = true;
+		pthread_cond_broadcast( &p->cond );
+		pthread_mutex_unlock( &p->lock );
+		if( p->stream ){
+			pthread_cancel( p->capture_thread );
+		}
+		pthread_join( p->capture_thread, NULL );
+		pthread_join( p->buffer_thread, NULL );
+		for( int i=0; i<p->q_count; i++ ){
+			frame_unref( p->queue[ ( p->q_head + i )%LIVE_QUEUE ] );
+		}
+		for( int i=0; i<p->nslots; i++ ){
+			frame_unref( p->slots[i] );
+		}
+		free( p->slots );
+		pthread_mutex_destroy( &p->lock );
+		pthread_cond_destroy( &p->cond );
+	}
+	if( p->cap ){
+		cvReleaseCapture( &p->cap );
+	}
+	stream_close( &p->stream );
+	free( p );
+	*l = NULL;
+}
+
+//Function to grab the next frame of a live input
+/*!
+ * \return The frame, owned by the capture or the stream, or NULL when the source has no more frames.
+ * */
+IplImage* live_grab( Live_Input* l ){
+	if( l->stream ){
+		if( !stream_read( l->stream ) ){
+			return( NULL );
+		}
+		return( ring_slot( &l->stream->ring, l->stream->ring.head - 1 ) );
+	}
+	return( cvQueryFrame( l->cap ) );
+}
+
+//The thread capturing a live input
+/*!
+ * Grabs the frames as they arrive and queues a copy of each for live_buffer_worker(), without ever waiting for it: a frame arriving while the queue is full ( or when the frame pool refuses a buffer ) is dropped and counted. A file is read at its frame rate, a camera or a pipe as fast as it delivers the frames.
+ * 
+ * \param arg : The Live_Input.
+ * */
+void* live_capture_worker( void* arg ){
+	Live_Input* l = ( Live_Input* )arg;
+	pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
+	int64 start = cvGetTickCount();
+	for( long n=1; !__atomic_load_n( &l->quit, __ATOMIC_RELAXED ); n++ ){
+		if( l->paced ){
+			double wait_us = n*1e6/l->fps - ( cvGetTickCount() - start )/cvGetTickFrequency();
+			if( wait_us>0 ){
+				usleep( ( useconds_t )wait_us );
+			}
+		}
+		pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, NULL );
+		IplImage* img = live_grab( l );
+		pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
+		if( !img ){
+			break;
+		}
+		Frame_Buf* buf = pool_get( cvGetSize( img ), img->depth, img->nChannels, true );
+		if( buf ){
+			cvCopy( img, buf->img );
+		}
+		pthread_mutex_lock( &l->lock );
+		l->captured++;
+		if( buf && l->q_count<LIVE_QUEUE ){
+			l->queue[ ( l->q_head + l->q_count++ )%LIVE_QUEUE ] = buf;
+			buf = NULL;
+			pthread_cond_broadcast( &l->cond );
+		}
+		else{
+			l->dropped++;
+		}
+		pthread_mutex_unlock( &l->lock );
+		frame_unref( buf );
 	}
-	/*!
-	 * If this function is called from any other function then \a call_from is set to OTHER_CALLS and corresponding \a pos indicates the current frame value which is directly assigned to \a frame_val.
-	 * */
-	if( call_from == OTHER_CALLS ){
-		frame_val = pos;
+	pthread_mutex_lock( &l->lock );
+	l->captured_all = true;
+	pthread_cond_broadcast( &l->cond );
+	pthread_mutex_unlock( &l->lock );
+	return( NULL );
+}
+
+//The thread storing the captured frames in the timeshift buffer
+/*!
+ * Converts every captured frame to I420, half the size of BGR, into a fresh buffer of the frame pool and swaps it into its slot under the lock. The frame it replaces is released once the display no longer holds it, so storing a frame never waits for the display and the display never sees a frame being written.
+ * 
+ * \param arg : The Live_Input.
+ * */
+void* live_buffer_worker( void* arg ){
+	Live_Input* l = ( Live_Input* )arg;
+	CvSize slot_size = l->i420 ? cvSize( l->size.width, l->size.height*3/2 ) : l->size;
+	while( 1 ){
+		pthread_mutex_lock( &l->lock );
+		while( l->q_count==0 && !l->captured_all && !l->quit ){
+			pthread_cond_wait( &l->cond, &l->lock );
+		}
+		if( l->q_count==0 || l->quit ){
+			pthread_mutex_unlock( &l->lock );
+			break;
+		}
+		Frame_Buf* buf = l->queue[ l->q_head ];
+		l->q_head = ( l->q_head + 1 )%LIVE_QUEUE;
+		l->q_count--;
+		pthread_mutex_unlock( &l->lock );
+
+		Frame_Buf* slot = pool_get( slot_size, buf->img->depth, l->i420 ? 1 : buf->img->nChannels, false );
+		if( l->i420 ){
+			cvCvtColor( buf->img, slot->img, CV_BGR2YUV_I420 );
+		}
+		else{
+			cvCopy( buf->img, slot->img );
+		}
+		frame_unref( buf );
+
+		pthread_mutex_lock( &l->lock );
+		Frame_Buf* old = l->slots[ l->head%l->nslots ];
+		slot->frame_no = l->head;
+		l->slots[ l->head%l->nslots ] = slot;
+		if( old ){
+			l->evicted++;
+		}
+		__atomic_store_n( &l->head, l->head + 1, __ATOMIC_RELEASE );
+		pthread_cond_broadcast( &l->cond );
+		pthread_mutex_unlock( &l->lock );
+		frame_unref( old );
 	}
-	//Scaling to set the slider button at an appropriate location between 0 and (p_width - sldr_btn_width)
-	/*!
-	 * Again scaling is done so that the slider button can be set to an appropriate location between 0 and (p_width - sldr_btn_width)
-	 * */
-	scale = ( p_width - sldr_btn_width )/( float )( sldr_maxval );
-	//printf( "Frame slider : %d\n", frame_val );
-	int new_pos = cvCeil( scale*frame_val );
-	//frame_val should be an integral multiple of step_val
-	/*!
-	 * Proper care is taken so that \a frame_val remains an integeral multiple of \a step_val between 0 and \a sldr_maxval.
-	 * */
-	if( frame_val%step_val != 0 ){
-		frame_val = step_val*( ( int )frame_val/( int )step_val );
+	pthread_mutex_lock( &l->lock );
+	__atomic_store_n( &l->ended, true, __ATOMIC_RELEASE );
+	pthread_cond_broadcast( &l->cond );
+	pthread_mutex_unlock( &l->lock );
+	return( NULL );
+}
+
+//Function to fetch the next frame from the timeshift buffer
+/*!
+ * Returns frame \a l->next, converted back to BGR into \a fetched_buf. While the display follows the input and the video is playing, it skips to the newest frame when more than #LIVE_MAX_LAG frames are waiting; the skipped frames are counted. A timeshifted playback overtaken by the capture goes on from the oldest frame held, the lost frames being counted as missed. Reaching the newest frame makes the display follow the input again.
+ * 
+ * \param l : The live input.
+ * \return The frame, or NULL when it has not been captured yet ( or the input has ended ).
+ * */
+IplImage* live_query( Live_Input* l ){
+	int head = __atomic_load_n( &l->head, __ATOMIC_ACQUIRE );
+	if( l->following && engine.playing && head - l->next>LIVE_MAX_LAG ){
+		l->skipped += head - 1 - l->next;
+		l->next = head - 1;
 	}
-	/*!
-	 * Current frame number is then updated in the control pannel and lastly the slider button is set at its appropriate location on the custom-built slider.
-	 * */
+	if( l->next>=head ){
+		return( NULL );
+	}
+	pthread_mutex_lock( &l->lock );
+	int oldest = MAX( l->head - l->nslots, 0 );
+	if( l->next<oldest ){
+		l->missed += oldest - l->next;
+		l->next = oldest;
+	}
+	Frame_Buf* slot = frame_ref( l->slots[ l->next%l->nslots ] );
+	pthread_mutex_unlock( &l->lock );
+
+	frame_unref( fetched_buf );
+	if( l->i420 ){
+		fetched_buf = pool_get( l->size, IPL_DEPTH_8U, 3, false );
+		cvCvtColor( slot->img, fetched_buf->img, CV_YUV2BGR_I420 );
+	}
+	else{
+		fetched_buf = pool_get( l->size, slot->img->depth, slot->img->nChannels, false );
+		cvCopy( slot->img, fetched_buf->img );
+	}
+	fetched_buf->frame_no = l->next;
+	frame_unref( slot );
+	if( ++l->next>=head ){
+		l->following = true;
+	}
+	return( fetched_buf->img );
+}
+
+//Function to set the position of the display in the timeshift buffer
+/*!
+ * The position is clamped to the frames held. Going to a frame stops following the input, until the newest frame is reached again.
+ * */
+void live_set_pos( Live_Input* l, int pos ){
+	int newest = __atomic_load_n( &l->head, __ATOMIC_ACQUIRE ) - 1;
+	l->next = MIN( MAX( pos, live_oldest( l ) ), MAX( newest, 0 ) );
+	l->following = false;
+}
+
+//Function to get the oldest frame held by the timeshift buffer
+int live_oldest( Live_Input* l ){
+	int head = __atomic_load_n( &l->head, __ATOMIC_ACQUIRE );
+	return( MAX( head - l->nslots, 0 ) );
+}
+
+//Function to get the size of the timeshift buffer
+/*!
+ * The frames held by the ring and those waiting in the queue.
+ * */
+size_t live_usage(){
+	if( !live ){
+		return( 0 );
+	}
+	pthread_mutex_lock( &live->lock );
+	size_t bytes = live->slots[0] ? MIN( live->head, live->nslots )*live->slots[0]->bytes : 0;
+	for( int i=0; i<live->q_count; i++ ){
+		bytes += live->queue[ ( live->q_head + i )%LIVE_QUEUE ]->bytes;
+	}
+	pthread_mutex_unlock( &live->lock );
+	return( bytes );
+}
+
+//Function to write the counters of the live input
+/*!
+ * \a live_lag is the number of frames between the displayed frame and the newest one.
+ * 
+ * \return The number of characters written.
+ * */
+int live_metrics( char* buf, int size ){
+	if( !live ){
+		return( MIN( snprintf( buf, size, "\"live\":false" ), size - 1 ) );
+	}
+	pthread_mutex_lock( &live->lock );
+	int held = MIN( live->head, live->nslots );
+	int len = snprintf( buf, size, "\"live\":true,\"live_captured\":%ld,\"live_buffered\":%d,\"live_held\":%d,\"live_held_s\":%.1f,\"live_capacity_s\":%.1f,\"live_queued\":%d,\"live_dropped\":%ld,\"live_evicted\":%ld,\"live_skipped\":%ld,\"live_missed\":%ld,\"live_lag\":%d,\"live_following\":%s",
+		live->captured, live->head, held, held/live->fps, live->nslots/live->fps, live->q_count, live->dropped, live->evicted, live->skipped, live->missed,
+		MAX( live->head - live->next, 0 ), live->following ? "true" : "false" );
+	pthread_mutex_unlock( &live->lock );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to show the name of the file
+/*!
+ * Clears the name shown before and draws \a filename next to "File :". Long paths are shortened to their tail so that they do not run into the histogram area.
+ * */
+void show_file_name( const char* filename ){
+	cvRectangle( pnl, cvPoint( 65, 124 ), cvPoint( 559, 146 ), cvScalar( 226, 235, 240 ), CV_FILLED, 8, 0 );
+	if( strlen( filename )>44 ){
+		char short_name[ 48 ];
+		sprintf( short_name, "...%s", filename + strlen( filename ) - 41 );
+		cvPutText( pnl, short_name, cvPoint( 65, 140 ), &font, black );
+	}
+	else{
+		cvPutText( pnl, filename, cvPoint( 65, 140 ), &font, black );
+	}
+}
+
+//Function to show the properties of the video
+/*!
+ * Fills the "Total Frames", "FPS", "Current Frame" and "FOURCC" fields.
+ * */
+void show_properties(){
+	resetField( numFrames, STATIC_TEXT );
+	sprintf( line, "%d", sldr_maxval );
+	cvPutText( numFrames, line, cvPoint( 3, numFrames->height - 4 ), &font, black );
+	resetField( fps_edit, STATIC_TEXT );
+	sprintf( line, "%d", ( int )cvRound( fps ) );
+	cvPutText( fps_edit, line, cvPoint( 3, fps_edit->height - 4 ), &font, black );
 	resetField( cur_frame_no, STATIC_TEXT );
-	sprintf( line, "%d", frame_val );
+	sprintf( line, "%d", sldr_start );
 	cvPutText( cur_frame_no, line, cvPoint( 3, cur_frame_no->height - 4 ), &font, black );
-	cvCopy( oslider, slider );
-	sldr_val->imageData = slider->imageData + new_pos*slider->nChannels;
-	cvCopy( sldr_btn, sldr_val );
-	return( frame_val );
-	/*!
-	 * \param pos Either the x-coordinate of the latest mouse event on the slider or the current frame number.
-	 * \param call_from Set to MOUSE_CALLBACK when this function is called from a mouse callback event, else set to OTHER_CALLS.
-	 * \return frame_val: The current frame number.
-	 * \sa resetField(), <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=put#cvPutText" target="_blank"><b>cvPutText()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_operations_on_arrays.html?highlight=copy#cvCopy" target="_blank"><b>cvCopy()</b></a>
-	 * */
+	resetField( time_code, STATIC_TEXT );
+	format_timecode( 0, line, sizeof( line ) );
+	cvPutText( time_code, line, cvPoint( 3, time_code->height - 5 ), &font_small, black );
+	resetField( four_cc_edit, STATIC_TEXT );
+	sprintf( line, "%s", four_cc_str );
+	cvPutText( four_cc_edit, line, cvPoint( 3, four_cc_edit->height - 8 ), &font, black );
+}
+
+//Function to start the prefetch thread
+/*!
+ * Opens a second capture of \a video for the thread, see Prefetcher. Nothing is done when the prefetcher is disabled.
+ * */
+void prefetch_start( const char* video ){
+	if( prefetch.depth<=0 || !( prefetch.vid = open_capture( video ) ) ){
+		return;
+	}
+	prefetch.quit = false;
+	prefetch.base = 0;
+	prefetch.stride = 0;
+	prefetch.ahead = prefetch.depth;
+	prefetch.last_pos = -1;
+	prefetch.deltas[0] = prefetch.deltas[1] = 0;
+	prefetch.interval_ms = 0;
+	pthread_create( &prefetch.thread, NULL, prefetch_worker, NULL );
+}
+
+//Function to stop the prefetch thread
+void prefetch_stop(){
+	if( !prefetch.vid ){
+		return;
+	}
+	pthread_mutex_lock( &prefetch.lock );
+	prefetch.quit = true;
+	pthread_cond_signal( &prefetch.cond );
+	pthread_mutex_unlock( &prefetch.lock );
+	pthread_join( prefetch.thread, NULL );
+	cvReleaseCapture( &prefetch.vid );
+}
+
+//Function to open a capture for a background thread
+/*!
+ * Hands out one of the captures of the current file opened in advance by the playlist, while any is left, so that the threads restarted by playlist_switch() do not open the file once more. Otherwise the file is opened with cvCaptureFromFile().
+ * 
+ * \param video : Path of the video.
+ * \return The capture, NULL if the file cannot be opened.
+ * */
+CvCapture* open_capture( const char* video ){
+	if( playlist.nspares>0 ){
+		return( playlist.spares[ --playlist.nspares ] );
+	}
+	return( cvCaptureFromFile( video ) );
+}
+
+//Function to compare two paths
+/*!
+ * \return The result of strcmp() on the paths pointed to by \a a and \a b, for qsort().
+ * */
+int compare_paths( const void* a, const void* b ){
+	return( strcmp( *( char* const* )a, *( char* const* )b ) );
+}
+
+//Function to add to the playlist
+/*!
+ * A directory adds its files in alphabetical order. Hidden files, sub-directories and the sidecar files of the similar-frames search and of the markers are left out; any other file which turns out not to be a video is skipped when it is reached.
+ * 
+ * \param path : A file or a directory.
+ * */
+void playlist_add( const char* path ){
+	struct stat st;
+	DIR* dir = ( stat( path, &st )==0 && S_ISDIR( st.st_mode ) ) ? opendir( path ) : NULL;
+	if( !dir ){
+		playlist.paths = ( char** )realloc( playlist.paths, ( playlist.count + 1 )*sizeof( char* ) );
+		playlist.paths[ playlist.count++ ] = strdup( path );
+		return;
+	}
+	int first = playlist.count;
+	char full[ 1024 ];
+	for( struct dirent* e = readdir( dir ); e; e = readdir( dir ) ){
+		const char* ext = strrchr( e->d_name, '.' );
+		if( e->d_name[0]=='.' || ( ext && ( !strcmp( ext, ".phash" ) || !strcmp( ext, ".markers" ) ) ) ){
+			continue;
+		}
+		snprintf( full, sizeof( full ), "%s/%s", path, e->d_name );
+		if( stat( full, &st )!=0 || !S_ISREG( st.st_mode ) ){
+			continue;
+		}
+		playlist.paths = ( char** )realloc( playlist.paths, ( playlist.count + 1 )*sizeof( char* ) );
+		playlist.paths[ playlist.count++ ] = strdup( full );
+	}
+	closedir( dir );
+	qsort( playlist.paths + first, playlist.count - first, sizeof( char* ), compare_paths );
+}
+
+//Function to start the playlist thread
+/*!
+ * Nothing is done for a single file.
+ * */
+void playlist_start(){
+	for( int i=0; i<2*PLAYLIST_AHEAD; i++ ){
+		playlist.slots[i].index = -1;
+	}
+	playlist.bad = ( bool* )calloc( MAX( playlist.count, 1 ), sizeof( bool ) );
+	//the files before the first playable one were found not playable at startup
+	for( int i=0; i<playlist.cur; i++ ){
+		playlist.bad[i] = true;
+	}
+	if( playlist.count>1 ){
+		mem_register( "playlist", MEM_PRIO_PREFETCH, playlist_usage, playlist_evict );
+		pthread_create( &playlist.thread, NULL, playlist_worker, NULL );
+	}
+}
+
+//Function to stop the playlist thread
+void playlist_stop(){
+	if( playlist.count>1 ){
+		pthread_mutex_lock( &playlist.lock );
+		playlist.quit = true;
+		pthread_cond_broadcast( &playlist.cond );
+		pthread_mutex_unlock( &playlist.lock );
+		pthread_join( playlist.thread, NULL );
+		for( int i=0; i<2*PLAYLIST_AHEAD; i++ ){
+			if( playlist.slots[i].index>=0 ){
+				playlist_release( &playlist.slots[i] );
+			}
+		}
+	}
+	for( int i=0; i<playlist.count; i++ ){
+		free( playlist.paths[i] );
+	}
+	free( playlist.paths );
+	free( playlist.bad );
+	playlist.paths = NULL;
+	playlist.bad = NULL;
+	playlist.count = 0;
+}
+
+//The thread opening the files of the playlist in advance
+/*!
+ * Keeps the #PLAYLIST_AHEAD files after and before the current one opened, the next ones first; files found not playable are passed over. A file which is no longer next to the current one is closed.
+ * */
+void* playlist_worker( void* arg ){
+	pthread_mutex_lock( &playlist.lock );
+	while( !playlist.quit ){
+		int wanted[ 2*PLAYLIST_AHEAD ], nwanted = 0;
+		int next = playlist.cur, prev = playlist.cur;
+		for( int d=1; d<=PLAYLIST_AHEAD; d++ ){
+			for( next++; next<playlist.count && playlist.bad[ next ]; next++ );
+			for( prev--; prev>=0 && playlist.bad[ prev ]; prev-- );
+			if( next<playlist.count ){
+				wanted[ nwanted++ ] = next;
+			}
+			if( prev>=0 ){
+				wanted[ nwanted++ ] = prev;
+			}
+		}
+		//close a file no longer wanted, then open a wanted one
+		Preopen* stale = NULL;
+		Preopen* free_slot = NULL;
+		for( int i=0; i<2*PLAYLIST_AHEAD; i++ ){
+			Preopen* s = &playlist.slots[i];
+			bool keep = false;
+			for( int j=0; j<nwanted; j++ ){
+				keep = keep || ( s->index==wanted[j] );
+			}
+			if( s->index>=0 && !keep && !stale ){
+				stale = s;
+			}
+			if( s->index<0 && !free_slot ){
+				free_slot = s;
+			}
+		}
+		if( stale ){
+			Preopen p = *stale;
+			stale->index = -1;
+			pthread_mutex_unlock( &playlist.lock );
+			playlist_release( &p );
+			pthread_mutex_lock( &playlist.lock );
+			continue;
+		}
+		int todo = -1;
+		for( int j=0; j<nwanted && todo<0; j++ ){
+			todo = wanted[j];
+			for( int i=0; i<2*PLAYLIST_AHEAD; i++ ){
+				if( playlist.slots[i].index==wanted[j] ){
+					todo = -1;
+				}
+			}
+		}
+		if( todo<0 || !free_slot ){
+			pthread_cond_wait( &playlist.cond, &playlist.lock );
+			continue;
+		}
+		free_slot->index = todo;
+		free_slot->ready = false;
+		pthread_mutex_unlock( &playlist.lock );
+		Preopen p;
+		playlist_open( playlist.paths[ todo ], &p );
+		pthread_mutex_lock( &playlist.lock );
+		p.index = p.player ? todo : -1;
+		p.ready = true;
+		*free_slot = p;
+		playlist.bad[ todo ] = !p.player;
+		playlist.opened++;
+		playlist.open_ms += p.open_ms;
+		pthread_cond_broadcast( &playlist.cond );
+	}
+	pthread_mutex_unlock( &playlist.lock );
+	return( NULL );
+}
+
+//Function to open a file of the playlist
+/*!
+ * Opens the VP_Player of the main loop, probes the properties the player shows and decodes the first #PLAYLIST_FRAMES frames straight into pool buffers. Then a capture is opened for every background thread started with a file ( see open_capture() ), as these also take as long to open as the player.
+ * 
+ * \param path : Path of the file.
+ * \param p : Filled with the player, the captures, the properties and the frames; \a p->player is NULL when the file cannot be played.
+ * */
+void playlist_open( const char* path, Preopen* p ){
+	int64 start = cvGetTickCount();
+	memset( p, 0, sizeof( Preopen ) );
+	VP_Player* v = vp_open( path );
+	VP_Properties props;
+	if( vp_get_properties( v, &props )==VP_OK && ( p->frames = props.frames )>0 ){
+		p->player = v;
+		p->fps = props.fps;
+		p->start = props.start;
+		sprintf( p->fourcc, "%s", props.fourcc );
+		size_t bytes = ( size_t )props.width*props.height*props.channels;
+		for( int i=0; i<PLAYLIST_FRAMES && i<p->frames; i++ ){
+			//the first frames are only a head start, they give way to the budget
+			Frame_Buf* buf = mem_enforce( bytes ) ? pool_get( cvSize( props.width, props.height ), IPL_DEPTH_8U, props.channels, true ) : NULL;
+			if( !buf ){
+				break;
+			}
+			if( ( buf->frame_no = vp_next_frame( v, ( unsigned char* )buf->img->imageData, buf->img->widthStep ) )<=0 ){
+				frame_unref( buf );
+				break;
+			}
+			vp_frame_time( v, buf->frame_no, &buf->pts_ms );
+			p->first[ p->nfirst++ ] = buf;
+		}
+		int threads = ( prefetch.depth>0 ) + !timeline_off + 1;
+		for( int i=0; i<threads; i++ ){
+			CvCapture* cap = cvCaptureFromFile( path );
+			if( cap ){
+				p->caps[ p->ncaps++ ] = cap;
+			}
+		}
+	}
+	else{
+		vp_close( v );
+	}
+	p->open_ms = ( cvGetTickCount() - start )/( cvGetTickFrequency()*1e3 );
+}
+
+//Function to close a file opened in advance
+void playlist_release( Preopen* p ){
+	vp_close( p->player );
+	p->player = NULL;
+	for( int i=0; i<p->ncaps; i++ ){
+		cvReleaseCapture( &p->caps[i] );
+	}
+	for( int i=0; i<p->nfirst; i++ ){
+		frame_unref( p->first[i] );
+	}
+	p->ncaps = 0;
+	p->nfirst = 0;
+	p->index = -1;
+}
+
+//Function to return the memory held by the first frames of the files opened in advance
+/*!
+ * \return the size of the frames decoded ahead in the files the playlist thread opened, in bytes.
+ * \sa playlist_evict().
+ * */
+size_t playlist_usage(){
+	size_t bytes = 0;
+	pthread_mutex_lock( &playlist.lock );
+	for( int i=0; i<2*PLAYLIST_AHEAD; i++ ){
+		Preopen* s = &playlist.slots[i];
+		for( int j=0; s->index>=0 && s->ready && j<s->nfirst; j++ ){
+			bytes += s->first[j]->bytes;
+		}
+	}
+	pthread_mutex_unlock( &playlist.lock );
+	return( bytes );
+}
+
+//Function to drop the first frames of the files opened in advance
+/*!
+ * The files stay open, their first frames are decoded again when switching to them.
+ * 
+ * \param bytes : Number of bytes to free.
+ * \return the number of bytes freed.
+ * */
+size_t playlist_evict( size_t bytes ){
+	size_t freed = 0;
+	pthread_mutex_lock( &playlist.lock );
+	for( int i=0; i<2*PLAYLIST_AHEAD && freed<bytes; i++ ){
+		Preopen* s = &playlist.slots[i];
+		//a slot being filled belongs to the playlist thread
+		if( s->index<0 || !s->ready ){
+			continue;
+		}
+		for( ; s->nfirst>0 && freed<bytes; s->nfirst-- ){
+			freed += s->first[ s->nfirst - 1 ]->bytes;
+			frame_unref( s->first[ s->nfirst - 1 ] );
+		}
+	}
+	pthread_mutex_unlock( &playlist.lock );
+	return( freed );
+}
+
+//Function to switch to another file of the playlist
+/*!
+ * Takes the file from the playlist thread, waiting for it if it is being opened, or opens it here if it was not opened in advance. The background threads of the current file are stopped and everything bound to it is dropped: the frame cache, the histograms, the timeline, the thumbnails, the storyboard and the similar-frames index; its markers are saved. The new file then takes over: its first frames go to the frame cache, its first frame is displayed, and the background threads are started again with the captures opened in advance. The duration of the switch is shown in the status field.
+ * 
+ * \param index : Index of the file in the playlist.
+ * \return false when the file cannot be played; the current file is kept then.
+ * */
+bool playlist_switch( int index ){
+	int64 start = cvGetTickCount();
+	Preopen p;
+	bool found = false;
+	pthread_mutex_lock( &playlist.lock );
+	//a file being opened may turn out not to be playable
+	for( int i=0; i<2*PLAYLIST_AHEAD; i++ ){
+		while( playlist.slots[i].index==index && !playlist.slots[i].ready ){
+			pthread_cond_wait( &playlist.cond, &playlist.lock );
+		}
+	}
+	if( playlist.bad[ index ] ){
+		pthread_mutex_unlock( &playlist.lock );
+		return( false );
+	}
+	for( int i=0; i<2*PLAYLIST_AHEAD && !found; i++ ){
+		Preopen* s = &playlist.slots[i];
+		if( s->index==index ){
+			p = *s;
+			s->index = -1;
+			found = true;
+		}
+	}
+	pthread_mutex_unlock( &playlist.lock );
+	if( !found ){
+		playlist_open( playlist.paths[ index ], &p );
+	}
+	if( !p.player ){
+		pthread_mutex_lock( &playlist.lock );
+		playlist.bad[ index ] = true;
+		pthread_mutex_unlock( &playlist.lock );
+		return( false );
+	}
+
+	//drop the current file
+	quality_stop();
+	prefetch_stop();
+	markers_close();
+	phash_stop();
+	activity_stop();
+	thumb_stop();
+	cache_clear();
+	filter_flush();
+	frame_unref( fetched_buf );
+	fetched_buf = NULL;
+	vp_close( vid );
+	free( board.frames );
+	board.frames = NULL;
+	board.count = board.capacity = board.scanned = board.top = 0;
+	board.shown = false;
+	pthread_mutex_lock( &hist_lock );
+	hist_epoch++;
+	for( int i=0; i<HIST_CACHE_SIZE; i++ ){
+		hist_cache[i].frame_no = -1;
+	}
+	hist_shown = -1;
+	pthread_mutex_unlock( &hist_lock );
+
+	//take over the new one
+	const char* filename = playlist.paths[ index ];
+	vid = p.player;
+	for( int i=0; i<p.ncaps; i++ ){
+		playlist.spares[ playlist.nspares++ ] = p.caps[i];
+	}
+	fps = ( p.fps>0 ) ? p.fps : 25;
+	sldr_start = p.start;
+	sldr_maxval = p.frames;
+	play_pos = sldr_start;
+	sprintf( four_cc_str, "%s", p.fourcc );
+	decode_tune( true );
+	export_in = export_out = -1;
+	tl_first = tl_span = 0;
+	for( int i=0; i<p.nfirst; i++ ){
+		frame_unref( cache_insert( p.first[i], true ) );
+	}
+	frame = query_frame();
+	if( frame ){
+		set_current( frame );
+	}
+	pthread_mutex_lock( &hist_lock );
+	hist_stride = MAX( cvCeil( sqrt( old_frame->width*( double )old_frame->height/HIST_SAMPLES ) ), 1 );
+	pthread_mutex_unlock( &hist_lock );
+	zoom_at( 0, p_width/2, scrn_height/2 );
+	show_file_name( filename );
+	show_properties();
+
+	//restart the background threads on the new file
+	prefetch_start( filename );
+	phash.video = filename;
+	if( phash_at_start ){
+		phash_start();
+	}
+	if( !timeline_off ){
+		activity_start( filename );
+	}
+	thumb_start( filename );
+	markers_open( filename );
+	//the other inputs of a comparison stay, the main one is the new file
+	if( compare.count ){
+		compare.inputs[0].path = filename;
+		compare.inputs[0].frame_no = -1;
+	}
+	if( quality.out_path ){
+		quality_start( filename, compare.inputs[1].path );
+	}
+	while( playlist.nspares>0 ){
+		cvReleaseCapture( &playlist.spares[ --playlist.nspares ] );
+	}
+	draw_slider_strip();
+	moveSlider( get_frame_pos(), OTHER_CALLS );
+
+	pthread_mutex_lock( &playlist.lock );
+	playlist.cur = index;
+	playlist.switches++;
+	playlist.hits += found;
+	playlist.switch_ms = ( cvGetTickCount() - start )/( cvGetTickFrequency()*1e3 );
+	playlist.switch_max_ms = MAX( playlist.switch_max_ms, playlist.switch_ms );
+	pthread_cond_broadcast( &playlist.cond );
+	pthread_mutex_unlock( &playlist.lock );
+	snprintf( status_line, sizeof( status_line ), "%d/%d %.0fms", index + 1, playlist.count, playlist.switch_ms );
+	change_status();
+	return( true );
+}
+
+//Function to go to the next or the previous file of the playlist
+/*!
+ * Files which cannot be played are skipped.
+ * 
+ * \param dir : 1 for the next file, -1 for the previous one.
+ * \return false when there is no such file.
+ * */
+bool playlist_step( int dir ){
+	for( int i = playlist.cur + dir; i>=0 && i<playlist.count; i += dir ){
+		if( playlist_switch( i ) ){
+			return( true );
+		}
+		printf( "Cannot play %s\n", playlist.paths[i] );
+	}
+	sprintf( status_line, "%s", dir>0 ? "Last file" : "First file" );
+	change_status();
+	return( false );
+}
+
+//Function to write the state of the playlist
+/*!
+ * \a playlist_open_ms is the average time taken to open a file in advance, \a playlist_switch_ms the duration of the last switch.
+ * 
+ * \return The number of characters written.
+ * */
+int playlist_metrics( char* buf, int size ){
+	pthread_mutex_lock( &playlist.lock );
+	int len = snprintf( buf, size, "\"playlist_files\":%d,\"playlist_index\":%d,\"playlist_opened\":%ld,\"playlist_open_ms\":%.3f,\"playlist_switches\":%ld,\"playlist_hits\":%ld,\"playlist_switch_ms\":%.3f,\"playlist_switch_max_ms\":%.3f",
+		MAX( playlist.count, 1 ), playlist.cur, playlist.opened, playlist.opened ? playlist.open_ms/playlist.opened : 0.0,
+		playlist.switches, playlist.hits, playlist.switch_ms, playlist.switch_max_ms );
+	pthread_mutex_unlock( &playlist.lock );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function template to fill a row with one pixel
+/*!
+ * Writes \a px to the first column, then doubles the filled part of the row with memcpy() until the row is full. The row is thus written with wide stores whatever the number of channels, rather than one sample at a time.
+ * 
+ * \param row : The first sample of the row.
+ * \param px : The \a CN samples of the pixel.
+ * \param width : Number of pixels of the row.
+ * */
+template< typename T, int CN > void fill_row( T* row, const T* px, int width ){
+	if( width<=0 ){
+		return;
+	}
+	for( int chl=0; chl<CN; chl++ ){
+		row[ chl ] = px[ chl ];
+	}
+	for( int done=1; done<width; done *= 2 ){
+		memcpy( row + done*CN, row, MIN( done, width - done )*CN*sizeof( T ) );
+	}
+}
+
+//Function template to convert a colour to a pixel
+template< typename T, int CN > void scalar_to_pixel( CvScalar color, T* px ){
+	for( int chl=0; chl<CN; chl++ ){
+		px[ chl ] = ( T )color.val[ chl ];
+	}
+}
+
+//Function template to fill an image with a colour
+/*!
+ * The first row is filled with fill_row() and copied to the other rows.
+ * */
+template< typename T, int CN > void fill_k( IplImage* image, CvScalar color ){
+	T px[ CN ];
+	scalar_to_pixel< T, CN >( color, px );
+	T* first = ( T* )image->imageData;
+	fill_row< T, CN >( first, px, image->width );
+	for( int row=1; row<image->height; row++ ){
+		memcpy( image->imageData + row*image->widthStep, first, image->width*CN*sizeof( T ) );
+	}
 }
 
-//Function for mouse callback events
-/*!
- * The function is callback for mouse events. Actions to be taken for various mouse events are defined in this function. This function is the 2<sup>nd</sup> argument to the <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=setmousecallback#cvSetMouseCallback" target="_blank"><b>cvSetMouseCallback()</b></a> function.
+//Function template to fill an image with a colour inside a one pixel border
+template< typename T, int CN > void frame_k( IplImage* image, CvScalar border, CvScalar inside ){
+	T px[ CN ];
+	scalar_to_pixel< T, CN >( border, px );
+	fill_k< T, CN >( image, inside );
+	for( int row=0; row<image->height; row++ ){
+		T* ptr = ( T* )( image->imageData + row*image->widthStep );
+		if( row==0 || row==image->height - 1 ){
+			fill_row< T, CN >( ptr, px, image->width );
+			continue;
+		}
+		for( int chl=0; chl<CN; chl++ ){
+			ptr[ chl ] = px[ chl ];
+			ptr[ ( image->width - 1 )*CN + chl ] = px[ chl ];
+		}
+	}
+}
 
-We associate this mouse callback function for events on the custom-built slider as well as on the different fields in the control pannel. Following is the explaination of the various mouse events used in this scenario and their respective actions. 
-*/
-void my_mouse_callback( int event, int x, int y, int flags, void* param ){
-	IplImage* image = ( IplImage* )param;
-	switch( event ){
-		/*!
-			Case1, event = CV_EVENT_MOUSEMOVE i.e. mouse is moved. If the slider button is dragged to a different location, only then this mouse event is to be used to update the frame being displayed. So both conditions viz. the slider is moving ( #sldr_moving ) an the mouse coordinates belong to the custom-built slider are checked and accordingly the new frame number is calculated which is also updated in various fields of the player.
-		 */
-		case CV_EVENT_MOUSEMOVE: {
-			if( sldr_moving ){
-				// mouse on slider
-				if( ( y > scrn_height ) && ( y <= scrn_height + sldr_height ) ){
-					int cur_frame = moveSlider( x, MOUSE_CALLBACK );
-					if( vid ){
-						cvSetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES, ( double )( cur_frame-1 ) );
-						cvQueryFrame( vid );
-						cvCopy( cvQueryFrame( vid ), old_frame );
-					}
-				}
+//Function template to vertically color an image
+/*!
+ * Every row has a single colour, which is computed once and written with fill_row(). See getSpectrumVert().
+ * */
+template< typename T, int CN > void spectrum_vert_k( IplImage* image, CvScalar color1, CvScalar color2 ){
+	T a[ CN ], b[ CN ], px[ CN ];
+	scalar_to_pixel< T, CN >( color1, a );
+	scalar_to_pixel< T, CN >( color2, b );
+	for( int row=0; row<image->height; row++ ){
+		for( int chl=0; chl<CN; chl++ ){
+			if( row==image->height - 1 ){
+				px[ chl ] = b[ chl ];
+			}
+			else if( row==0 ){
+				px[ chl ] = a[ chl ];
+			}
+			else{
+				px[ chl ] = ( T )( ( b[ chl ] - a[ chl ] )*( row/( float )image->height ) + a[ chl ] );
 			}
 		}
-		break;
+		fill_row< T, CN >( ( T* )( image->imageData + row*image->widthStep ), px, image->width );
+	}
+}
+
+//Function template to horizontally color an image
 /*!
-			Case2, event = CV_EVENT_LBUTTONDOWN i.e. mouse's left button is pressed down. This event indicates some button being pressed ( play, pause, etc or slider button ). The mouse coordinates help to identify the button being pressed. Approproate actions on pressing respective buttons are taken.
-		 */
-		case CV_EVENT_LBUTTONDOWN: {
-			sldr_moving = true;
-			resetAllEdits();
-			// mouse on slider
-			if( ( y > scrn_height ) && ( y <= scrn_height + sldr_height ) ){
-				int cur_frame = moveSlider( x, MOUSE_CALLBACK );
-				if( vid ){
-					cvSetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES, ( double )( cur_frame-1 + step_val -1 ) );
-					cvQueryFrame( vid );
-					cvCopy( cvQueryFrame( vid ), old_frame );
-					//printf( "Before val : %f\n", cvGetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES ) );
-				}
-				if( !playing ){
-					sprintf( status_line, "Slider moved" );
-					change_status();
-				}
+ * All the rows are alike: the first row is interpolated and copied to the other rows. See getSpectrumHorz().
+ * */
+template< typename T, int CN > void spectrum_horz_k( IplImage* image, CvScalar color1, CvScalar color2 ){
+	T a[ CN ], b[ CN ];
+	scalar_to_pixel< T, CN >( color1, a );
+	scalar_to_pixel< T, CN >( color2, b );
+	T* first = ( T* )image->imageData;
+	for( int col=0; col<image->width; col++ ){
+		for( int chl=0; chl<CN; chl++ ){
+			first[ col*CN + chl ] = ( T )( ( b[ chl ] - a[ chl ] )*( col/( float )image->width ) + a[ chl ] );
+		}
+	}
+	for( int row=1; row<image->height; row++ ){
+		memcpy( image->imageData + row*image->widthStep, first, image->width*CN*sizeof( T ) );
+	}
+}
+
+//Function template to fill the area bounded by a colour
+/*!
+ * See fill_color(). Only the first three channels are compared and filled.
+ * */
+template< typename T, int CN > void fill_color_k( IplImage* image, CvScalar color ){
+	const int n = ( CN<3 ) ? CN : 3;
+	bool start_fill = false;
+	for( int row=0; row<image->height; row++ ){
+		T* ptr = ( T* )( image->imageData + row*image->widthStep );
+		for( int col=0; col<image->width; col++ ){
+			T* px = ptr + col*CN;
+			bool edge = true;
+			for( int chl=0; chl<n; chl++ ){
+				edge = edge && ( px[ chl ]==color.val[ chl ] );
 			}
-			// mouse on play/pause button
-			if(
-				( y > play_pause_btn_area.y1 ) &&
-				( y <= play_pause_btn_area.y2 ) &&
-				( x > play_pause_btn_area.x1 ) &&
-				( x <= play_pause_btn_area.x2 )
-			){
-				//printf( "Frame val : %d\n", ( int )cvGetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES ) );
-				if( playing ){
-					playing = false;
-					getButton( play_pause_btn, PLAY_BTN, BTN_ACTIVE );
-					sprintf( status_line, "Paused" );
-					change_status();
+			if( edge ){
+				if( !start_fill ){
+					start_fill = true;
 				}
 				else{
-					playing = true;
-					getButton( play_pause_btn, PAUSE_BTN, BTN_ACTIVE );
-					sprintf( status_line, "Playing" );
-					change_status();
+					start_fill = false;
+					break;
 				}
 			}
-			// mouse on stop button
-			if(
-				( y > stop_btn_area.y1 ) &&
-				( y <= stop_btn_area.y2 ) &&
-				( x > stop_btn_area.x1 ) &&
-				( x <= stop_btn_area.x2 )
-			){
-				playing = false;
-				moveSlider( sldr_start, OTHER_CALLS );
-				if( vid ){
-					cvSetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES, ( double )( sldr_start-1 ) );
-					cvQueryFrame( vid );
-					cvCopy( cvQueryFrame( vid ), old_frame );
+			if( start_fill ){
+				for( int chl=0; chl<n; chl++ ){
+					px[ chl ] = ( T )color.val[ chl ];
 				}
-				getButton( play_pause_btn, PLAY_BTN, BTN_ACTIVE );
-				sprintf( status_line, "Stopped" );
-				change_status();
 			}
-			// mouse on stepup button
-			if(
-				( y > stepup_btn_area.y1 ) &&
-				( y <= stepup_btn_area.y2 ) &&
-				( x > stepup_btn_area.x1 ) &&
-				( x <= stepup_btn_area.x2 )
-			){
-				int cur_frame = ( int )cvGetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES );
-				//printf( "Frame val : %d\n", cur_frame );
-				if( cur_frame + 1 + step_val - 1 < sldr_maxval ){
-					for( int i=0; i < ( step_val - 1 ); i++ ){
-						cvQueryFrame( vid );
-					}
-					frame = cvQueryFrame( vid );
-					if( frame ){
-						cvCopy( frame, old_frame );
-					}
-				}
-				if( !playing ){
-					sprintf( status_line, "Stepped Up" );
-					change_status();
-				}
-				//printf( "Stepup pressed \n" );
+		}
+	}
+}
+
+//Function to fill an image with a colour
+/*!
+ * Used for the backgrounds of the control pannel, the slider and the fields.
+ * 
+ * \param image : The image or sub-image.
+ * \param color : The colour, in the range of the samples of \a image.
+ * \sa PIXEL_DISPATCH, fill_k().
+ * */
+void fill_image( IplImage* image, CvScalar color ){
+	PIXEL_DISPATCH( image, fill_k, ( image, color ) );
+}
+
+//Function to get the histogram bin of a sample
+inline int sample_bin( uchar v, int /*shift*/ ){
+	return( v );
+}
+
+//Function to get the histogram bin of a high bit depth sample
+/*!
+ * The sample is scaled down to 8 bits by \a shift; samples beyond the declared bit depth fall in the last bin.
+ * */
+inline int sample_bin( ushort v, int shift ){
+	return( MIN( v>>shift, 255 ) );
+}
+
+//Function template to count one pixel in the histograms
+/*!
+ * The blue, green, red and luma bins of the pixel \a px are incremented. A gray pixel counts in all four with its own value.
+ * */
+template< typename T, int CN > inline void hist_add( unsigned int bins[][ 256 ], const T* px, int shift ){
+	int b = sample_bin( px[0], shift );
+	int g = ( CN>1 ) ? sample_bin( px[ CN>1 ? 1 : 0 ], shift ) : b;
+	int r = ( CN>2 ) ? sample_bin( px[ CN>2 ? 2 : 0 ], shift ) : b;
+	bins[0][ b ]++;
+	bins[1][ g ]++;
+	bins[2][ r ]++;
+	bins[3][ ( CN>1 ) ? ( 29*b + 150*g + 77*r )>>8 : b ]++;
+}
+
+//Function template to count the pixels of an image in the histograms
+/*!
+ * See compute_histogram().
+ * */
+template< typename T, int CN > void histogram_k( const IplImage* img, int stride, unsigned int bins[][ 256 ], unsigned int bins2[][ 256 ], int shift ){
+	int cols = ( img->width + stride - 1 )/stride;
+	int rows = ( img->height + stride - 1 )/stride;
+	int step = CN*stride;
+	for( int row=0; row<rows; row++ ){
+		const T* ptr = ( const T* )( img->imageData + row*stride*img->widthStep );
+		int col = 0;
+		for( ; col + 1<cols; col += 2, ptr += 2*step ){
+			hist_add< T, CN >( bins, ptr, shift );
+			hist_add< T, CN >( bins2, ptr + step, shift );
+		}
+		if( col<cols ){
+			hist_add< T, CN >( bins, ptr, shift );
+		}
+	}
+}
+
+//Function template to map an image through the window / level table
+/*!
+ * Writes the BGR display image \a dst, of the size of \a src, with the entry of \a lut of every sample of \a src. A gray image gives gray pixels.
+ * */
+template< typename T, int CN > void window_level_k( const IplImage* src, IplImage* dst, const uchar* lut ){
+	for( int row=0; row<src->height; row++ ){
+		const T* s = ( const T* )( src->imageData + row*src->widthStep );
+		uchar* d = ( uchar* )( dst->imageData + row*dst->widthStep );
+		for( int col=0; col<src->width; col++, s += CN, d += 3 ){
+			d[0] = lut[ s[0] ];
+			d[1] = lut[ s[ CN>1 ? 1 : 0 ] ];
+			d[2] = lut[ s[ CN>2 ? 2 : 0 ] ];
+		}
+	}
+}
+
+//Function template to find the lowest and the highest sample of an image
+template< typename T, int CN > void minmax_k( const IplImage* img, int* lo, int* hi ){
+	T mn = ( ( const T* )img->imageData )[0], mx = mn;
+	for( int row=0; row<img->height; row++ ){
+		const T* s = ( const T* )( img->imageData + row*img->widthStep );
+		for( int i=0; i<img->width*CN; i++ ){
+			mn = ( s[i]<mn ) ? s[i] : mn;
+			mx = ( s[i]>mx ) ? s[i] : mx;
+		}
+	}
+	*lo = mn;
+	*hi = mx;
+}
+
+//Function to build the window / level table
+/*!
+ * The samples from \f$ level - window/2 \f$ to \f$ level + window/2 \f$ are spread linearly over the 256 display levels; samples outside the window are shown black or white. Without <em>--window</em> and <em>--level</em> the window is the whole range of \a native_bits, which leaves 8-bit frames unchanged and shows the most significant bits of deeper ones.
+ * */
+void build_wl_lut(){
+	double range = ( double )( 1<<native_bits );
+	double window = ( wl_window>0 ) ? wl_window : range;
+	double level = ( wl_level>=0 ) ? wl_level : range/2;
+	double lo = level - window/2;
+	for( int v=0; v<65536; v++ ){
+		double out = ( v - lo )*256/window;
+		wl_lut[v] = ( uchar )MIN( MAX( out, 0.0 ), 255.0 );
+	}
+	wl_identity = ( native_bits==8 && window==256 && lo==0 );
+	//the filtered frames were mapped with the previous table
+	filters.epoch++;
+}
+
+//Function to map a frame to the display
+/*!
+ * \param src : An 8-bit or 16-bit frame, gray or colour.
+ * \param dst : A BGR image of the same size.
+ * \sa build_wl_lut(), window_level_k().
+ * */
+void window_level( const IplImage* src, IplImage* dst ){
+	PIXEL_DISPATCH( src, window_level_k, ( src, dst, wl_lut ) );
+}
+
+//Function to change the window / level
+/*!
+ * <ul>
+ * <li><b>v</b> : fits the window to the lowest and highest samples of the current frame.</li>
+ * <li><b>V</b> : goes back to the whole range.</li>
+ * <li><b>&lt;</b> / <b>&gt;</b> : narrows / widens the window by a factor 2.</li>
+ * <li><b>{</b> / <b>}</b> : lowers / raises the level by an eighth of the window.</li>
+ * </ul>
+ * 
+ * \param c : The key.
+ * \return false when \a c is not a window / level key.
+ * */
+bool adjust_window_level( char c ){
+	double range = ( double )( 1<<native_bits );
+	double window = ( wl_window>0 ) ? wl_window : range;
+	double level = ( wl_level>=0 ) ? wl_level : range/2;
+	if( c=='v' && old_frame ){
+		int lo = 0, hi = 0;
+		PIXEL_DISPATCH( old_frame, minmax_k, ( old_frame, &lo, &hi ) );
+		window = MAX( hi - lo + 1, 2 );
+		level = ( lo + hi + 1 )/2.0;
+	}
+	else if( c=='V' ){
+		window = range;
+		level = range/2;
+	}
+	else if( c=='<' || c=='>' ){
+		window = MIN( MAX( c=='<' ? window/2 : window*2, 2.0 ), 2*range );
+	}
+	else if( c=='{' || c=='}' ){
+		level = MIN( MAX( level + ( c=='{' ? -window/8 : window/8 ), 0.0 ), range );
+	}
+	else{
+		return( false );
+	}
+	wl_window = window;
+	wl_level = level;
+	build_wl_lut();
+	snprintf( status_line, sizeof( status_line ), "W%.0f L%.0f", window, level );
+	change_status();
+	return( true );
+}
+
+//Function to read the integer value of a command line option
+/*!
+ * The value is read once and brought within [ \a lo, \a hi ]; anything but a whole number is refused.
+ * 
+ * \param name : The option, for the error message.
+ * \param arg : The argument following it.
+ * \param lo : Smallest value.
+ * \param hi : Largest value.
+ * \param value : Receives the value.
+ * \return false, after printing an error, when \a arg is not a number.
+ * */
+bool option_int( const char* name, const char* arg, int lo, int hi, int* value ){
+	char* end;
+	long v = strtol( arg, &end, 10 );
+	if( end==arg || *end ){
+		printf( "Invalid value for %s : %s\n", name, arg );
+		return( false );
+	}
+	*value = ( int )MIN( MAX( v, ( long )lo ), ( long )hi );
+	return( true );
+}
+
+//Function to read the real value of a command line option
+/*!
+ * As option_int(), for a real number.
+ * 
+ * \return false, after printing an error, when \a arg is not a number.
+ * */
+bool option_real( const char* name, const char* arg, double lo, double hi, double* value ){
+	char* end;
+	double v = strtod( arg, &end );
+	if( end==arg || *end || v!=v ){
+		printf( "Invalid value for %s : %s\n", name, arg );
+		return( false );
+	}
+	*value = MIN( MAX( v, lo ), hi );
+	return( true );
+}
+
+//Function to parse a pixel format
+/*!
+ * Accepts the names of ffmpeg ( <em>gray</em>, <em>gray10le</em>, <em>yuv420p</em>, <em>yuv420p16le</em>, ... ) and the Y4M colour spaces ( <em>mono</em>, <em>mono12</em>, <em>420jpeg</em>, <em>420p10</em>, ... ). Samples of more than 8 bits take two bytes, little-endian.
+ * 
+ * \param name : The name.
+ * \param chroma : Set to STREAM_I420 or STREAM_MONO.
+ * \param bits : Set to the number of significant bits of a sample, 8 to 16.
+ * \return false when the format is not supported.
+ * */
+bool parse_pix_fmt( const char* name, int* chroma, int* bits ){
+	static const char* prefixes[] = { "gray", "mono", "yuv420p", "i420", "420p", "420" };
+	static const char* aliases[] = { "420jpeg", "420mpeg2", "420paldv" };
+	*chroma = STREAM_I420;
+	*bits = 8;
+	for( int i=0; i<3; i++ ){
+		if( !strcmp( name, aliases[i] ) ){
+			return( true );
+		}
+	}
+	const char* rest = NULL;
+	for( int i=0; i<6 && !rest; i++ ){
+		if( !strncmp( name, prefixes[i], strlen( prefixes[i] ) ) ){
+			rest = name + strlen( prefixes[i] );
+			*chroma = ( i<2 ) ? STREAM_MONO : STREAM_I420;
+		}
+	}
+	if( !rest ){
+		return( false );
+	}
+	if( *rest>='0' && *rest<='9' ){
+		char* end;
+		*bits = ( int )strtol( rest, &end, 10 );
+		rest = end;
+	}
+	return( *bits>=8 && *bits<=16 && ( !*rest || !strcmp( rest, "le" ) ) );
+}
+
+//Function to convert high bit depth I420 planes to BGR
+/*!
+ * The same BT.601 conversion as <em>CV_YUV2BGR_I420</em>, in fixed point, for samples of \a bits bits; the BGR samples keep \a bits bits.
+ * 
+ * \param planes : The Y, U and V planes.
+ * \param dst : The 16-bit BGR image, whose size is that of the frame.
+ * \param bits : Number of significant bits of a sample.
+ * */
+void i420_to_bgr16( const ushort* planes, IplImage* dst, int bits ){
+	int w = dst->width, h = dst->height;
+	const ushort* u_plane = planes + w*h;
+	const ushort* v_plane = u_plane + ( w/2 )*( h/2 );
+	int sh = bits - 8, top = ( 1<<bits ) - 1;
+	for( int row=0; row<h; row++ ){
+		const ushort* y = planes + row*w;
+		const ushort* u = u_plane + ( row/2 )*( w/2 );
+		const ushort* v = v_plane + ( row/2 )*( w/2 );
+		ushort* d = ( ushort* )( dst->imageData + row*dst->widthStep );
+		for( int col=0; col<w; col++, d += 3 ){
+			int c = 1192*( y[ col ] - ( 16<<sh ) ), du = u[ col/2 ] - ( 128<<sh ), dv = v[ col/2 ] - ( 128<<sh );
+			int bgr[ 3 ] = { ( c + 2066*du )>>10, ( c - 400*du - 833*dv )>>10, ( c + 1634*dv )>>10 };
+			for( int chl=0; chl<3; chl++ ){
+				d[ chl ] = ( ushort )MIN( MAX( bgr[ chl ], 0 ), top );
 			}
-			// mouse on stepdown button
-			if(
-				( y > stepdown_btn_area.y1 ) &&
-				( y <= stepdown_btn_area.y2 ) &&
-				( x > stepdown_btn_area.x1 ) &&
-				( x <= stepdown_btn_area.x2 )
-			){
-				processing = true;
-				int cur_frame = ( int )cvGetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES );
-				//printf( "Frame val : %d\n", cur_frame );
-				if( cur_frame - 1 - ( step_val - 1 ) >= sldr_start ){
-					moveSlider( ( cur_frame - 1 - ( step_val - 1 ) ), OTHER_CALLS );
-					cvSetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES, ( double )( cur_frame - 1 - ( step_val - 1 ) ) );
-					cvQueryFrame( vid );
-					cvCopy( cvQueryFrame( vid ), old_frame );
-					//printf( "New Frame val : %d\n", ( int )cvGetCaptureProperty( vid, CV_CAP_PROP_POS_FRAMES ) );
-				}
-				if( !playing ){
-					sprintf( status_line, "Stepped Down" );
-					change_status();
-				}
-				processing = false;
-				//printf( "Stepdown pressed \n" );
+		}
+	}
+}
+
+//Function to compare two markers, for qsort()
+/*!
+ * Orders the markers by first frame, then by last frame, then by label.
+ * */
+int compare_marker( const void* a, const void* b ){
+	const Marker* x = ( const Marker* )a;
+	const Marker* y = ( const Marker* )b;
+	if( x->first!=y->first ){
+		return( ( x->first>y->first ) - ( x->first<y->first ) );
+	}
+	if( x->last!=y->last ){
+		return( ( x->last>y->last ) - ( x->last<y->last ) );
+	}
+	return( ( x->label>y->label ) - ( x->label<y->label ) );
+}
+
+//Function to get the index of a marker label
+/*!
+ * Labels are stored once, the markers only hold their index. A label longer than #MARKER_LABEL_LEN - 1 characters is cut.
+ * 
+ * \param label : The label, NULL or empty for none.
+ * \return The index of the label, -1 when there are #MARKER_LABELS labels already.
+ * */
+int marker_label( const char* label ){
+	if( !markers.nlabels ){
+		markers.labels = ( char** )malloc( sizeof( char* ) );
+		markers.labels[ markers.nlabels++ ] = strdup( "" );
+	}
+	if( !label || !label[0] ){
+		return( 0 );
+	}
+	char name[ MARKER_LABEL_LEN ];
+	snprintf( name, sizeof( name ), "%s", label );
+	for( int i=1; i<markers.nlabels; i++ ){
+		if( !strcmp( markers.labels[i], name ) ){
+			return( i );
+		}
+	}
+	if( markers.nlabels==MARKER_LABELS ){
+		return( -1 );
+	}
+	markers.labels = ( char** )realloc( markers.labels, ( markers.nlabels + 1 )*sizeof( char* ) );
+	markers.labels[ markers.nlabels ] = strdup( name );
+	return( markers.nlabels++ );
+}
+
+//Function to add a marker
+/*!
+ * Appends the marker after the sorted ones; marker_sort() puts it in place before the next lookup.
+ * 
+ * \param first : First frame.
+ * \param last : Last frame, \a first for a single frame.
+ * \param label : Index of the label, see marker_label().
+ * \return false for an empty range.
+ * */
+bool marker_add( int first, int last, int label ){
+	if( first<0 || last<first || label<0 ){
+		return( false );
+	}
+	if( markers.count==markers.capacity ){
+		markers.capacity = MAX( 2*markers.capacity, 1024 );
+		markers.items = ( Marker* )realloc( markers.items, markers.capacity*sizeof( Marker ) );
+	}
+	Marker* m = &markers.items[ markers.count++ ];
+	m->first = first;
+	m->last = last;
+	m->label = ( unsigned short )label;
+	markers.max_len = MAX( markers.max_len, last - first );
+	markers.version++;
+	markers.modified = true;
+	return( true );
+}
+
+//Function to sort the markers
+/*!
+ * Sorts the markers added since the last call and merges them with the sorted ones, from the end of the array backwards so that only the new markers need a copy. A marker added twice is kept once.
+ * */
+void marker_sort(){
+	if( markers.sorted==markers.count ){
+		return;
+	}
+	Marker* tail = markers.items + markers.sorted;
+	int ntail = markers.count - markers.sorted;
+	qsort( tail, ntail, sizeof( Marker ), compare_marker );
+	if( markers.sorted>0 && compare_marker( tail - 1, tail )>0 ){
+		Marker* added = ( Marker* )malloc( ntail*sizeof( Marker ) );
+		memcpy( added, tail, ntail*sizeof( Marker ) );
+		int i = markers.sorted - 1, j = ntail - 1, k = markers.count - 1;
+		while( j>=0 ){
+			if( i>=0 && compare_marker( &markers.items[i], &added[j] )>0 ){
+				markers.items[ k-- ] = markers.items[ i-- ];
 			}
-			// mouse on step_edit field
-			if(
-				( y > step_edit_area.y1 ) &&
-				( y <= step_edit_area.y2 ) &&
-				( x > step_edit_area.x1 ) &&
-				( x <= step_edit_area.x2 )
-			){
-				sprintf( edit_text, "" );
-				typing_step = true;
+			else{
+				markers.items[ k-- ] = added[ j-- ];
 			}
 		}
-		break;
+		free( added );
+	}
+	int kept = 1;
+	for( int i=1; i<markers.count; i++ ){
+		if( compare_marker( &markers.items[ kept - 1 ], &markers.items[i] ) ){
+			markers.items[ kept++ ] = markers.items[i];
+		}
+	}
+	markers.count = markers.sorted = kept;
+}
+
+//Function to find the first marker starting at or after a frame
+/*!
+ * A binary search of the sorted markers, marker_sort() must have been called.
+ * 
+ * \return The index of the marker, \a markers.count if there is none.
+ * */
+int marker_lower( int frame ){
+	int lo = 0, hi = markers.count;
+	while( lo<hi ){
+		int mid = lo + ( hi - lo )/2;
+		if( markers.items[ mid ].first<frame ){
+			lo = mid + 1;
+		}
+		else{
+			hi = mid;
+		}
+	}
+	return( lo );
+}
+
+//Function to find the next or the previous marker
+/*!
+ * \param frame : The frame searched from, usually the current frame.
+ * \param dir : 1 for the first marker starting after \a frame, -1 for the last one starting before it.
+ * \return The first frame of the marker, -1 if there is none.
+ * */
+int marker_find( int frame, int dir ){
+	marker_sort();
+	markers.lookups++;
+	int i = ( dir>0 ) ? marker_lower( frame + 1 ) : marker_lower( frame ) - 1;
+	return( ( i>=0 && i<markers.count ) ? markers.items[i].first : -1 );
+}
+
+//Function to remove the markers over a frame
+/*!
+ * Removes the single frames and the ranges covering \a frame.
+ * 
+ * \return The number of markers removed.
+ * */
+int marker_remove( int frame ){
+	marker_sort();
+	int kept = marker_lower( frame - markers.max_len );
+	int end = marker_lower( frame + 1 );
+	for( int i=kept; i<end; i++ ){
+		if( markers.items[i].last<frame ){
+			markers.items[ kept++ ] = markers.items[i];
+		}
+	}
+	int removed = end - kept;
+	if( removed ){
+		memmove( markers.items + kept, markers.items + end, ( markers.count - end )*sizeof( Marker ) );
+		markers.count -= removed;
+		markers.sorted = markers.count;
+		markers.version++;
+		markers.modified = true;
+	}
+	return( removed );
+}
+
+//Function to go to the next or the previous marker
+/*!
+ * Goes to the first frame of the marker found by marker_find() from the current frame through show_frame(), and shows it in the status field.
+ * 
+ * \param dir : 1 for the next marker, -1 for the previous one.
+ * \return false when there is no such marker.
+ * */
+bool marker_jump( int dir ){
+	int f = marker_find( get_frame_pos(), dir );
+	if( f<0 ){
+		sprintf( status_line, "No marker" );
+		change_status();
+		return( false );
+	}
+	show_frame( f );
+	snprintf( status_line, sizeof( status_line ), "Marker %d", f );
+	change_status();
+	return( true );
+}
+
+//Function to count the markers over every column of the slider
+/*!
+ * The columns are those of moveSlider(): frame \a f is at \f$ \lceil scale( f - first ) \rceil + sldr\_btn\_width/2 \f$. Each marker adds 1 at its first column and -1 after its last one, and a prefix sum gives the counts, so that a long range costs as much as a single frame. The counts are kept until the markers or the part of the video spanned by the slider change.
+ * 
+ * \param first : First frame spanned by the slider, see tl_window().
+ * \param span : Number of frames spanned by the slider.
+ * \return The counts, one per column of the slider.
+ * */
+const int* marker_bins( int first, int span ){
+	if( !markers.bins ){
+		markers.bins = ( int* )malloc( ( p_width + 1 )*sizeof( int ) );
+		markers.bins_version = -1;
+	}
+	if( markers.bins_version==markers.version && markers.bins_first==first && markers.bins_span==span ){
+		return( markers.bins );
+	}
+	int64 start = cvGetTickCount();
+	marker_sort();
+	memset( markers.bins, 0, ( p_width + 1 )*sizeof( int ) );
+	float scale = ( p_width - sldr_btn_width )/( float )( span );
+	int half = sldr_btn_width/2;
+	for( int i = marker_lower( first - markers.max_len ); i<markers.count && markers.items[i].first<=first + span; i++ ){
+		const Marker* m = &markers.items[i];
+		if( m->last<first ){
+			continue;
+		}
+		int x0 = cvCeil( scale*( MAX( m->first, first ) - first ) ) + half;
+		int x1 = cvCeil( scale*( MIN( m->last, first + span ) - first ) ) + half;
+		markers.bins[ MIN( x0, p_width ) ]++;
+		markers.bins[ MIN( x1 + 1, p_width ) ]--;
+	}
+	for( int x=1; x<p_width; x++ ){
+		markers.bins[x] += markers.bins[ x - 1 ];
+	}
+	markers.bins_version = markers.version;
+	markers.bins_first = first;
+	markers.bins_span = span;
+	markers.bins_ms = ( cvGetTickCount() - start )/( cvGetTickFrequency()*1e3 );
+	return( markers.bins );
+}
+
+//Function to write an unsigned LEB128 number
+/*!
+ * Seven bits per byte, the lowest first, the high bit set on every byte but the last.
+ * */
+bool put_varint( FILE* fp, unsigned int v ){
+	while( v>=0x80 ){
+		putc( ( int )( ( v & 0x7f ) | 0x80 ), fp );
+		v >>= 7;
+	}
+	return( putc( ( int )v, fp )!=EOF );
+}
+
+//Function to read an unsigned LEB128 number
 /*!
-			Case3, event = CV_EVENT_LBUTTONUP i.e. mouse's left button is released after earlier press. Only the slider-button depends on this event it can be dragged along the slider-strip. Therefore, on this event the slider movement is stopped.
-		 */
-		case CV_EVENT_LBUTTONUP: {
-			sldr_moving = false;
+ * \return false at the end of the file or for a number of more than 32 bits.
+ * */
+bool get_varint( FILE* fp, unsigned int* v ){
+	*v = 0;
+	for( int shift=0; shift<35; shift += 7 ){
+		int c = getc( fp );
+		if( c==EOF ){
+			return( false );
+		}
+		*v |= ( unsigned int )( c & 0x7f )<<shift;
+		if( !( c & 0x80 ) ){
+			return( shift<28 || c<16 );
 		}
-		break;
 	}
-/*!
-	\sa <a href="http://opencv.willowgarage.com/documentation/c/highgui_user_interface.html?highlight=setmousecallback#cvSetMouseCallback" target="_blank"><b>cvSetMouseCallback()</b></a> function
-	 * for \param event
-	 * \param x
-	 * \param y
-	 * \param flags
-	 * \param param
-*/
+	return( false );
 }
 
-
-//Function to reset any field
+//Function to add the markers of a file
 /*!
- * This function will reset a text-field ( a textbox or a static text). The text-field is nothing but a sub-image. Therefore all the pixel values are to be reset to the original values of the respecitve text fields (white with black border for EDIT_TEXT and Control Pannel's color with black border for STATIC_TEXT).
+ * The file starts with "VPMARKS1", then holds LEB128 numbers ( see put_varint() ): the number of labels, every label as its length and its characters, the number of markers, and for every marker in order the difference of its first frame with that of the previous marker, its length and its label. A marked frame thus usually takes 3 bytes. The markers of the file are added to those already set; nothing is added from a malformed file.
  * 
- * Whenever the value in the text-field is changed, the text-field being an image, the new value is overwritten over the old value. Therefore, every time a new value is to be written, the respective field need to be reset.
- * 
- * \param image : The sub-image (i.e. the text-field) to be reset.
- * \param text_type : Either STATIC_TEXT or EDIT_TEXT.
- * \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#iplimage" target="_blank"><b>IplImage</b></a> 
+ * \param path : The file.
+ * \return The number of markers read, -1 if the file cannot be read or is malformed.
  * */
-void resetField( IplImage* image, int text_type ){
-	if( text_type == STATIC_TEXT ){
-		for( int row=0; row<image->height; row++ ){
-			uchar *ptr = ( uchar* )( image->imageData + row*image->widthStep );
-			for( int col=0; col<image->width; col++  ){
-				ptr[ col*image->nChannels + 0 ] = 226;
-				ptr[ col*image->nChannels + 1 ] = 235;
-				ptr[ col*image->nChannels + 2 ] = 240;
-			}
+int marker_read( const char* path ){
+	FILE* fp = fopen( path, "rb" );
+	if( !fp ){
+		return( -1 );
+	}
+	char magic[ 8 ];
+	unsigned int nlabels = 0, count = 0, len, delta, length, label;
+	bool ok = ( fread( magic, 1, 8, fp )==8 && !memcmp( magic, "VPMARKS1", 8 ) && get_varint( fp, &nlabels ) && nlabels<MARKER_LABELS );
+	//the number of labels is checked before sizing the map with it
+	int* map = ok ? ( int* )malloc( ( nlabels + 1 )*sizeof( int ) ) : NULL;
+	ok = ok && map;
+	char name[ MARKER_LABEL_LEN ];
+	int old_nlabels = markers.nlabels;
+	if( ok ){
+		map[0] = 0;
+	}
+	for( unsigned int i=1; ok && i<=nlabels; i++ ){
+		ok = ( get_varint( fp, &len ) && len<MARKER_LABEL_LEN && fread( name, 1, len, fp )==len );
+		if( ok ){
+			name[ len ] = '\0';
+			ok = ( ( map[i] = marker_label( name ) )>=0 );
 		}
 	}
-	else{
-		for( int row=0; row<image->height; row++ ){
-			uchar *ptr = ( uchar* )( image->imageData + row*image->widthStep );
-			for( int col=0; col<image->width; col++  ){
-				if( row==0 || row==image->height-1 || col==0 || col==image->width-1 ){
-					ptr[ col*image->nChannels + 0 ] = 0;
-					ptr[ col*image->nChannels + 1 ] = 0;
-					ptr[ col*image->nChannels + 2 ] = 0;
-				}
-				else
-				{
-					ptr[ col*image->nChannels + 0 ] = 255;
-					ptr[ col*image->nChannels + 1 ] = 255;
-					ptr[ col*image->nChannels + 2 ] = 255;
-				}	
-			}
+	int old_count = markers.count;
+	int64 first = 0;
+	ok = ok && get_varint( fp, &count );
+	for( unsigned int i=0; ok && i<count; i++ ){
+		ok = ( get_varint( fp, &delta ) && get_varint( fp, &length ) && get_varint( fp, &label ) && label<=nlabels &&
+			( first += delta ) + length<=INT_MAX && marker_add( ( int )first, ( int )( first + length ), map[ label ] ) );
+	}
+	fclose( fp );
+	free( map );
+	if( !ok ){
+		//nothing of a bad file is kept, neither its markers nor its labels
+		markers.count = old_count;
+		while( markers.nlabels>old_nlabels ){
+			free( markers.labels[ --markers.nlabels ] );
 		}
+		if( !markers.nlabels ){
+			free( markers.labels );
+			markers.labels = NULL;
+		}
+		markers.version++;
+		return( -1 );
 	}
+	return( ( int )count );
 }
 
-//Function to get new buttons
+//Function to write the markers to a file
 /*!
- * Function to get the desired control button, say play, pause, stop, stepup, stepdown. The buttons are nothing but sub-images.
- * \param image : This is the sub-image for the desired button.
- * \param btn_type : Can be any of the following viz. PLAY_BTN, PAUSE_BTN, STOP_BTN, STEPUP_BTN, STEPDOWN_BTN.
- * \param btn_state : Can be either BTN_ACTIVE or BTN_INACTIVE. For the time being, only BTN_ACTIVE is used and it is meaningless to pass BTN_INACTIVE.
- * \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#iplimage" target="_blank"><b>IplImage</b></a>
+ * \return false if the file cannot be written.
+ * \sa marker_read().
  * */
-void getButton( IplImage* image, int btn_type, int btn_state ){
-	getSpectrumVert( image, voilet, black );
-	if( btn_type==PLAY_BTN ){
-		draw_triangle( image, green );
+bool marker_write( const char* path ){
+	marker_sort();
+	FILE* fp = fopen( path, "wb" );
+	if( !fp ){
+		return( false );
 	}
-	if( btn_type==STOP_BTN ){
-		draw_square( image, green );
-	}
-	if( btn_type==PAUSE_BTN ){
-		draw_pause( image, green );
-	}
-	if( btn_type==STEPUP_BTN ){
-		draw_stepup( image, green );
+	bool ok = ( fwrite( "VPMARKS1", 1, 8, fp )==8 && put_varint( fp, MAX( markers.nlabels - 1, 0 ) ) );
+	for( int i=1; ok && i<markers.nlabels; i++ ){
+		size_t len = strlen( markers.labels[i] );
+		ok = ( put_varint( fp, len ) && fwrite( markers.labels[i], 1, len, fp )==len );
 	}
-	if( btn_type==STEPDOWN_BTN ){
-		draw_stepdown( image, green );
+	ok = ok && put_varint( fp, markers.count );
+	int prev = 0;
+	for( int i=0; ok && i<markers.count; i++ ){
+		const Marker* m = &markers.items[i];
+		ok = ( put_varint( fp, m->first - prev ) && put_varint( fp, m->last - m->first ) && put_varint( fp, m->label ) );
+		prev = m->first;
 	}
+	return( fclose( fp )==0 && ok );
 }
 
-//Function to vertically color a button
+//Function to load the markers of a video
 /*!
- * This function is nothing by an implementation of linear interploation vertically i.e. The <i>color1</i> is the color of the topmost row of the sub-image (<i>image</i>) and <i>color2</i> is the color of the bottom most row of the sub-image. The intermediate colors are calculated using the following formula.
- * 
- * <center>
- * \f$ X = \frac{B-A}{L} \times l + A \f$
- * </center>
- * where,<br>
- * X : color of the pixel to be determined.<br>
- * B : Color of the bottommost row.<br>
- * A : Color of the topmost row.<br>
- * l : Distance of the current pixel from the top (i.e. row number).<br>
- * L : Total number of rows.<br>
+ * The markers of a CvCapture are read from its sidecar file <em>video.markers</em>, if there is one. A streamed or live input has no sidecar file; its markers only live as long as the player.
  * 
- * \param image : The input sub-image for the button to be colored.
- * \param color1 : Color of the topmost row.
- * \param color2 : Color of the bottommost row.
- * \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#iplimage" target="_blank"><b>IplImage</b></a>
+ * \param video : Path of the video.
  * */
-void getSpectrumVert( IplImage* image, CvScalar color1, CvScalar color2 ){
-	for( int row=0; row<image->height; row++ ){
-		//If topmost row is selected
-		if( row==0 ){
-			uchar *ptr = ( uchar* )( image->imageData + row*image->widthStep );
-			for( int col=0; col<image->width; col++ ){
-				for( int chl=0; chl<image->nChannels; chl++ ){
-					ptr[ col*image->nChannels + chl] = color1.val[chl];
-				}
-			}
-		}
-		//If bottommost row is selected
-		if( row==image->height-1 ){
-			uchar *ptr = ( uchar* )( image->imageData + row*image->widthStep );
-			for( int col=0; col<image->width; col++ ){
-				for( int chl=0; chl<image->nChannels; chl++ ){
-					ptr[ col*image->nChannels + chl] = color2.val[chl];
-				}
-			}
-		}
+void markers_open( const char* video ){
+	markers.path[0] = '\0';
+	if( vid ){
+		snprintf( markers.path, sizeof( markers.path ), "%s.markers", video );
+		marker_read( markers.path );
 	}
-	
-	//Interpolation is applied
-	//b_a_L => (B-A)/L... (X-A)/l = (B-A)/L :: => X = (((B-A)/L)*l + A)
-	for( int row=1; row<image->height-1; row++ ){
-		uchar *ptr = ( uchar* )( image->imageData );
-		for( int col=0; col<image->width; col++ ){
-			for( int chl=0; chl<image->nChannels; chl++ ){
-				ptr[ row*image->widthStep + col*image->nChannels + chl  ] = (
-					ptr[ ( image->height-1 )*image->widthStep + col*image->nChannels + chl ] - ptr[ col*image->nChannels + chl ] )*(
-						row/( float )image->height ) + ptr[ col*image->nChannels + chl ];
-			}
-		}
+	markers.modified = false;
+}
+
+//Function to release the markers
+/*!
+ * Saves the markers to the sidecar file first, if they were changed.
+ * */
+void markers_close(){
+	if( markers.modified && markers.path[0] && !marker_write( markers.path ) ){
+		printf( "Cannot write %s\n", markers.path );
 	}
+	for( int i=0; i<markers.nlabels; i++ ){
+		free( markers.labels[i] );
+	}
+	free( markers.labels );
+	free( markers.items );
+	markers.labels = NULL;
+	markers.items = NULL;
+	markers.nlabels = markers.count = markers.capacity = markers.sorted = markers.max_len = 0;
+	markers.modified = false;
+	markers.version++;
 }
 
-//Function to get the horizontal spectrum
+//Function to get the size of the markers
+size_t marker_usage(){
+	return( markers.capacity*sizeof( Marker ) + markers.nlabels*( sizeof( char* ) + MARKER_LABEL_LEN ) + ( markers.bins ? ( p_width + 1 )*sizeof( int ) : 0 ) );
+}
+
+//Function to write the state of the markers
 /*!
- * This function is nothing by an implementation of linear interploation horizontally i.e. The <i>color1</i> is the color of the leftmost row of the sub-image (<i>image</i>) and <i>color2</i> is the color of the rightmost row of the sub-image. The intermediate colors are calculated using the following formula.
+ * \a markers_bins_ms is the time taken to count the markers over the columns of the slider last.
  * 
- * <center>
- * \f$ X = \frac{B-A}{L} \times l + A \f$
- * </center>
- * where,<br>
- * X : color of the pixel to be determined.<br>
- * B : Color of the rightmost row.<br>
- * A : Color of the leftmost row.<br>
- * l : Distance of the current pixel from the left (i.e. column number).<br>
- * L : Total number of columns.<br>
+ * \return The number of characters written.
+ * */
+int marker_metrics( char* buf, int size ){
+	marker_sort();
+	int len = snprintf( buf, size, "\"markers\":%d,\"marker_labels\":%d,\"markers_modified\":%s,\"marker_lookups\":%ld,\"markers_bins_ms\":%.3f",
+		markers.count, MAX( markers.nlabels - 1, 0 ), markers.modified ? "true" : "false", markers.lookups, markers.bins_ms );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to decode the next frame of the video file
+/*!
+ * Decodes the frame chosen with vp_seek(), or the next one, with the VP_Player \a vid. The frame is not copied: the returned image is the header \a decoded over the pixels of the player, valid until the next call.
  * 
- * \param image : The input sub-image for the button to be colored.
- * \param color1 : Color of the leftmost row.
- * \param color2 : Color of the rightmost row.
- * \sa <a href="http://opencv.willowgarage.com/documentation/c/basic_structures.html#iplimage" target="_blank"><b>IplImage</b></a>
+ * \return The frame, or NULL past the last frame.
+ * \sa decode_player().
  * */
-void getSpectrumHorz( IplImage* image, CvScalar color1, CvScalar color2 ){
-	//Color the leftmost and rightmost pixels of each row with with color1 and color2 respectively
-	for( int row=0; row<image->height; row++ ){
-		uchar *ptr = ( uchar* )( image->imageData + row*image->widthStep );
-		for( int chl=0; chl<image->nChannels; chl++ ){
-			ptr[chl] = color1.val[chl];
-			ptr[ ( image->width-1 )*image->nChannels + chl ] = color2.val[ chl ];
-		}
+IplImage* decode_vid(){
+	return( decode_player( vid, &decoded ) );
+}
+
+//Function to decode the next frame of a VP_Player without copying it
+/*!
+ * \param v : The player.
+ * \param header : Image header set over the pixels of the player, created when NULL and replaced when the size of the frames changes.
+ * \return \a *header, valid until the next call, or NULL past the last frame.
+ * \sa vp_next_frame(), vp_peek_frame().
+ * */
+IplImage* decode_player( VP_Player* v, IplImage** header ){
+	const unsigned char* data;
+	int stride;
+	if( vp_next_frame( v, NULL, 0 )<=0 || vp_peek_frame( v, &data, &stride )<=0 ){
+		return( NULL );
 	}
-	//Interploation applied here
-	//b_a_L => (B-A)/L... (X-A)/l = (B-A)/L :: => X = (((B-A)/L)*l + A)
-	for( int row=0; row<image->height; row++ ){
-		uchar *ptr = ( uchar* )( image->imageData + row*image->widthStep );
-		for( int col=0; col<image->width; col++ ){
-			for( int chl=0; chl<image->nChannels; chl++ ){
-				ptr[ col*image->nChannels + chl  ] =  ( ptr[ ( image->width - 1 )*image->nChannels + chl ] - ptr[ chl ] )*( col/( float )image->width ) + ptr[ chl ];
-			}
-		}
+	VP_Properties props;
+	vp_get_properties( v, &props );
+	//the files of a playlist differ in size
+	if( *header && ( ( *header )->width!=props.width || ( *header )->height!=props.height ) ){
+		cvReleaseImageHeader( header );
+	}
+	if( !*header ){
+		*header = cvCreateImageHeader( cvSize( props.width, props.height ), IPL_DEPTH_8U, props.channels );
 	}
+	cvSetData( *header, ( void* )data, stride );
+	return( *header );
 }
 
-//Function to initialize the control pannel...adding text & buttons
+//Function to set the stages of the filter pipeline
 /*!
- * This function is for initializing the control pannel, adding textfields, text and buttons to it. One may learn how to create a sub-image from an existing IplImage. Each sub-image can act as an independent image. The advantage of using sub-image over ROI is that multiple parts of an image can be worked upon simultaneously. You will come to know the importance of sub-image in the following where you will see how text-boxes and buttons are created with the use of sub-images. Lets's start.
- * 
- * In the initial lines you will come across the <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=cvputtext#cvPutText" target="_blank"><b>cvPutText()</b></a> function. This is used to place text at various parts of the control pannel sub-image. Next you come across are the <i>row</i> and <i>col</i>. These are the starting coordinates where you want to place the textfields or buttons. To create such fields and buttons (which are nothing but sub-images of the control pannel, which is again a sub-image of the video-player), declare the IplImage header using <a href="http://opencv.willowgarage.com/documentation/c/core_operations_on_arrays.html?highlight=createimageheader#cvCreateImageHeader" target="_blank"><b>cvCreateImageHeader()</b></a> using the required dimensions. This will only create the image header and no data is assigned to it. To use this as a sub-image we need to need to make the following assignments.
- * <ol>
- * 	<li>sub_image->origin = parent_image->origin.</li>
- * 	<li>sub_image->widthStep = parent_image->widthStep.</li>
- * 	<li>sub_image->imageData = parent_image->imageData + row*sub_image->widthStep + col*sub_image->nChannels.</li>
- * </ol>
- * 
- * Now the sub-image can be used as if it were an independent image. Further, for a few operations we need to keep a track of the coordinates of this newly created image. We store them in Field_Area structure of the respective button or text-field using the naming convention as <i>sub_image_area</i>. If the sub-image is a text-field then resetField() function is called. If the sub-image is a button then getButton() function is called.
- * 
- * \param filename : The absolute path of the video file to be played.
+ * The stages are separated by commas and run in that order, e.g. <em>gray,blur:7,edges</em>; see the FILTER_ aliases for their names. <em>off</em> ( or an empty \a spec ) removes all of them. The frames kept from the previous stages are invalidated.
  * 
- * \sa <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=cvputtext#cvPutText" target="_blank"><b>cvPutText()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_basic_structures.html?highlight=cvpoint#CvPoint" target="_blank"><b>cvPoint()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_operations_on_arrays.html?highlight=createimageheader#cvCreateImageHeader" target="_blank"><b>cvCreateImageHeader()</b></a>, resetField(), getButton().
- * */
-void initialize_pnl( char *filename ){
-	int row, col;
-	cvPutText( pnl, "Step : ", cvPoint( 3, 60 ), &font, black );
-	cvPutText( pnl, "File : ", cvPoint( 3, 140 ), &font, black );
-	cvPutText( pnl, filename, cvPoint( 65, 140 ), &font, black );
-	cvPutText( pnl, "Control Pannel", cvPoint( 3, 15 ), &font_bold_italic, black );
-	cvPutText( pnl, "FPS : ", cvPoint( 700, 100 ), &font, black );
-	cvPutText( pnl, "Current Frame : ", cvPoint( 3, 100 ), &font, black );
-	cvPutText( pnl, "Total Frames : ", cvPoint( 300, 100 ), &font, black );
-	cvPutText( pnl, "FOURCC : ", cvPoint( 668, 60 ), &font, black );
-	cvPutText( pnl, "Status : ", cvPoint( 325, 30 ), &font, black );
-	//Current Frame field
-	row = 88;
-	col = 150;
-	cur_frame_no = cvCreateImageHeader( cvSize( 120, 18), IPL_DEPTH_8U, 3 );
-	cur_frame_no->origin = pnl->origin;
-	cur_frame_no->widthStep = pnl->widthStep;
-	cur_frame_no->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	resetField( cur_frame_no, STATIC_TEXT );
-	//number of frames field
-	row = 88;
-	col = 430;
-	numFrames = cvCreateImageHeader( cvSize( 120, 18), IPL_DEPTH_8U, 3 );
-	numFrames->origin = pnl->origin;
-	numFrames->widthStep = pnl->widthStep;
-	numFrames->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	resetField( numFrames, STATIC_TEXT );
-	//Step field
-	row = 48;
-	col = 65;
-	step_edit = cvCreateImageHeader( cvSize( 50, 18), IPL_DEPTH_8U, 3 );
-	step_edit->origin = pnl->origin;
-	step_edit->widthStep = pnl->widthStep;
-	step_edit->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	resetField( step_edit, EDIT_TEXT );
-	step_edit_area.x1 = col;
-	step_edit_area.x2 = col + step_edit->width;
-	step_edit_area.y1 = p_height - ctrl_pnl_height + row;
-	step_edit_area.y2 = p_height - ctrl_pnl_height + step_edit->height + row;
-	sprintf( line, "%d", step_val );
-	cvPutText( step_edit, line, cvPoint( 3, step_edit->height - 4 ), &font, black );
-	//FPS field
-	row = 88;
-	col = 755;
-	fps_edit = cvCreateImageHeader( cvSize( 50, 18), IPL_DEPTH_8U, 3 );
-	fps_edit->origin = pnl->origin;
-	fps_edit->widthStep = pnl->widthStep;
-	fps_edit->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	resetField( fps_edit, STATIC_TEXT );
-	fps_edit_area.x1 = col;
-	fps_edit_area.x2 = col + fps_edit->width;
-	fps_edit_area.y1 = p_height - ctrl_pnl_height + row;
-	fps_edit_area.y2 = p_height - ctrl_pnl_height + fps_edit->height + row;
-	//FOURCC field
-	row = 48;
-	col = 755;
-	four_cc_edit = cvCreateImageHeader( cvSize( 50, 22), IPL_DEPTH_8U, 3 );
-	four_cc_edit->origin = pnl->origin;
-	four_cc_edit->widthStep = pnl->widthStep;
-	four_cc_edit->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	resetField( four_cc_edit, STATIC_TEXT );
-	four_cc_edit_area.x1 = col;
-	four_cc_edit_area.x2 = col + four_cc_edit->width;
-	four_cc_edit_area.y1 = p_height - ctrl_pnl_height + row;
-	four_cc_edit_area.y2 = p_height - ctrl_pnl_height + four_cc_edit->height + row;
-	//Play/Pause button
-	row = 48;
-	col = 350;
-	play_pause_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
-	play_pause_btn->origin = pnl->origin;
-	play_pause_btn->widthStep = pnl->widthStep;
-	play_pause_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	getButton( play_pause_btn, PLAY_BTN, BTN_ACTIVE );
-	play_pause_btn_area.x1 = col;
-	play_pause_btn_area.x2 = col + play_pause_btn->width;
-	play_pause_btn_area.y1 = p_height - ctrl_pnl_height + row;
-	play_pause_btn_area.y2 = p_height - ctrl_pnl_height + play_pause_btn->height + row;
-	//Stop button
-	row = 48;
-	col = 415;
-	stop_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
-	stop_btn->origin = pnl->origin;
-	stop_btn->widthStep = pnl->widthStep;
-	stop_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	getButton( stop_btn, STOP_BTN, BTN_ACTIVE );
-	stop_btn_area.x1 = col;
-	stop_btn_area.x2 = col + stop_btn->width;
-	stop_btn_area.y1 = p_height - ctrl_pnl_height + row;
-	stop_btn_area.y2 = p_height - ctrl_pnl_height + stop_btn->height + row;
-	//Stepup button
-	row = 48;
-	col = 480;
-	stepup_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
-	stepup_btn->origin = pnl->origin;
-	stepup_btn->widthStep = pnl->widthStep;
-	stepup_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	getButton( stepup_btn, STEPUP_BTN, BTN_ACTIVE );
-	stepup_btn_area.x1 = col;
-	stepup_btn_area.x2 = col + stepup_btn->width;
-	stepup_btn_area.y1 = p_height - ctrl_pnl_height + row;
-	stepup_btn_area.y2 = p_height - ctrl_pnl_height + stepup_btn->height + row;
-	//Stepdown button
-	row = 48;
-	col = 285;
-	stepdown_btn = cvCreateImageHeader( cvSize( 60, 18), IPL_DEPTH_8U, 3 );
-	stepdown_btn->origin = pnl->origin;
-	stepdown_btn->widthStep = pnl->widthStep;
-	stepdown_btn->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	getButton( stepdown_btn, STEPDOWN_BTN, BTN_ACTIVE );
-	stepdown_btn_area.x1 = col;
-	stepdown_btn_area.x2 = col + stepdown_btn->width;
-	stepdown_btn_area.y1 = p_height - ctrl_pnl_height + row;
-	stepdown_btn_area.y2 = p_height - ctrl_pnl_height + stepdown_btn->height + row;
-	//Status Field
-	row = 18;
-	col = 395;
-	status_edit = cvCreateImageHeader( cvSize( 130, 22), IPL_DEPTH_8U, 3 );
-	status_edit->origin = pnl->origin;
-	status_edit->widthStep = pnl->widthStep;
-	status_edit->imageData = pnl->imageData + row*pnl->widthStep + col*pnl->nChannels;
-	resetField( status_edit, STATIC_TEXT );
-	status_edit_area.x1 = col;
-	status_edit_area.x2 = col + status_edit->width;
-	status_edit_area.y1 = p_height - ctrl_pnl_height + row;
-	status_edit_area.y2 = p_height - ctrl_pnl_height + status_edit->height + row;
-	sprintf( status_line, "Stopped" );
-	change_status();
+ * \param spec : The stages.
+ * \return false when a stage is unknown or has an invalid parameter; the pipeline is then left unchanged.
+ * */
+bool parse_filters( const char* spec ){
+	Filter_Stage stages[ FILTER_STAGES ];
+	int count = 0;
+	char buf[ sizeof( filters.spec ) ];
+	snprintf( buf, sizeof( buf ), "%s", strcmp( spec, "off" ) ? spec : "" );
+	for( char* tok = strtok( buf, "," ); tok; tok = strtok( NULL, "," ) ){
+		if( count==FILTER_STAGES ){
+			return( false );
+		}
+		Filter_Stage* s = &stages[ count++ ];
+		char name[ 16 ] = "";
+		int param = -1;
+		sscanf( tok, "%15[^:]:%d", name, &param );
+		snprintf( s->name, sizeof( s->name ), "%s", tok );
+		s->code = -1;
+		s->us = 0;
+		if( !strcmp( name, "gray" ) ){
+			s->type = FILTER_GRAY;
+		}
+		else if( !strcmp( name, "edges" ) ){
+			s->type = FILTER_EDGES;
+		}
+		else if( !strcmp( name, "blur" ) ){
+			s->type = FILTER_BLUR;
+			if( param<0 ){
+				param = 5;
+			}
+			if( param<3 || param>31 || param%2==0 ){
+				return( false );
+			}
+		}
+		else if( !strcmp( name, "threshold" ) ){
+			s->type = FILTER_THRESHOLD;
+			if( param<0 ){
+				param = 128;
+			}
+			if( param>255 ){
+				return( false );
+			}
+		}
+		else if( !strcmp( name, "bgr" ) || !strcmp( name, "hsv" ) || !strcmp( name, "ycrcb" ) ){
+			s->type = FILTER_CHANNEL;
+			if( name[0]=='h' ){
+				s->code = CV_BGR2HSV;
+			}
+			if( name[0]=='y' ){
+				s->code = CV_BGR2YCrCb;
+			}
+			if( param<0 || param>2 ){
+				return( false );
+			}
+		}
+		else{
+			return( false );
+		}
+		s->param = param;
+	}
+	memcpy( filters.stages, stages, count*sizeof( Filter_Stage ) );
+	filters.count = count;
+	snprintf( filters.spec, sizeof( filters.spec ), "%s", count ? spec : "" );
+	filters.enabled = true;
+	filters.epoch++;
+	return( true );
 }
 
-//Draw triangle in the image
+//Function to find a filtered frame among the frames kept
 /*!
- * Function to draw a triangle for the play button. We pass the sub-image where we want to create the play button and also pass the color which we desire of the button. We first define 3 points for the triangle whose coordinates are stored in pt1, pt2 and pt3. Now we simply draw segments to connect these points and finally fill up the triangle with the desired color.
- * 
- * \param image : The image where we want to place the play-triangle
- * \param color : The desired color
- * 
- * \sa <a href="http://opencv.willowgarage.com/documentation/c/core_basic_structures.html?highlight=point#CvPoint" target="_blank"><b>cvPoint()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=line#cvLine" target="_blank"><b>cvLine()</b></a>, fill_color.
- * 
+ * \param frame_no : Number of the frame.
+ * \param dst : Receives the filtered frame, if found.
+ * \return true if the frame was kept with the current stages and the region \a view_rect.
  * */
-void draw_triangle( IplImage* image, CvScalar color ){
-	CvPoint pt1, pt2, pt3;
-	pt1.x = image->width/3;
-	pt1.y = 3;
-	pt2.x = pt1.x;
-	pt2.y = image->height - pt1.y;
-	pt3.x = 2*pt1.x;
-	pt3.y = image->height/2;
-	cvLine( image, pt1, pt2, color );
-	cvLine( image, pt3, pt2, color );
-	cvLine( image, pt1, pt3, color );
-	fill_color( image, color );
+bool filter_lookup( int frame_no, IplImage* dst ){
+	for( int i=0; i<FILTER_CACHE; i++ ){
+		Filter_Entry* e = &filters.cache[i];
+		if( e->buf && e->frame_no==frame_no && e->epoch==filters.epoch &&
+			e->view.x==view_rect.x && e->view.y==view_rect.y && e->view.width==view_rect.width && e->view.height==view_rect.height ){
+			cvCopy( e->buf->img, dst );
+			e->used = ++filters.uses;
+			filters.hits++;
+			return( true );
+		}
+	}
+	return( false );
 }
 
-//Draw square in the image
+//Function to filter the visible region of the current frame into the display image
 /*!
- * Function to draw a square for the stop button. We pass the sub-image where we want to create the stop button and also pass the color which we desire of the button. We first define 4 points for the square whose coordinates are stored in pt1, pt2, pt3 and pt4. Now we simply draw segments to connect these points and finally fill up the square with the desired color.
- * 
- * \param image : The image where we want to place the stop-square
- * \param color : The desired color
- * 
- * \sa <a href="http://opencv.willowgarage.com/documentation/c/core_basic_structures.html?highlight=point#CvPoint" target="_blank"><b>cvPoint()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=rectangle#cvRectangle" target="_blank"><b>cvRectangle</b></a>, fill_color.
+ * Starts the filter threads the first time. The stages are run one after the other by filter_stage(), alternating between two buffers of the frame pool so that the last one writes into the buffer which is kept; the frame filtered is then kept in place of the least recently shown one.
  * 
+ * \param frame_no : Number of the frame.
+ * \param full : The 8-bit BGR frame, to filter its region \a view_rect at its own resolution and then resize it into \a dst; NULL to filter \a dst, which already holds the region at display resolution.
+ * \param dst : The display image.
+ * \param pixel_level : True to resize with nearest-neighbour interpolation, see render_frame().
  * */
-void draw_square( IplImage* image, CvScalar color ){
-	CvPoint pt1, pt2;
-	pt1.x = 3*image->width/8;
-	pt1.y = 3;
-	pt2.x = 5*image->width/8;
-	pt2.y = image->height - pt1.y;
-	cvRectangle( image, pt1, pt2, color );
-	fill_color( image, color );
+void filter_frame( int frame_no, IplImage* full, IplImage* dst, bool pixel_level ){
+	int64 start = cvGetTickCount();
+	if( !filters.nworkers ){
+		filters.nworkers = threads_take( FILTER_JOBS );
+		for( int i=0; i<filters.nworkers; i++ ){
+			pthread_create( &filters.workers[i], NULL, filter_worker, NULL );
+		}
+	}
+	CvMat in;
+	if( full ){
+		cvGetSubRect( full, &in, view_rect );
+	}
+	else{
+		cvGetSubRect( dst, &in, cvRect( 0, 0, dst->width, dst->height ) );
+	}
+	CvSize size = cvSize( in.cols, in.rows );
+	Frame_Buf* bufs[ 2 ] = { pool_get( size, IPL_DEPTH_8U, 3, false ), NULL };
+	if( filters.count>1 ){
+		bufs[1] = pool_get( size, IPL_DEPTH_8U, 3, false );
+	}
+	CvMat mats[ 2 ];
+	const CvMat* cur = &in;
+	for( int i=0; i<filters.count; i++ ){
+		//the last stage writes into the first buffer
+		int k = ( filters.count - 1 - i )%2;
+		cvGetSubRect( bufs[k]->img, &mats[k], cvRect( 0, 0, size.width, size.height ) );
+		filter_stage( &filters.stages[i], cur, &mats[k] );
+		cur = &mats[k];
+	}
+	frame_unref( bufs[1] );
+	Frame_Buf* keep = bufs[0];
+	if( full ){
+		cvResize( keep->img, dst, pixel_level ? CV_INTER_NN : CV_INTER_LINEAR );
+		if( !wl_identity ){
+			window_level( dst, dst );
+		}
+		frame_unref( keep );
+		//only kept if the pool can spare a buffer
+		if( ( keep = pool_get( cvGetSize( dst ), IPL_DEPTH_8U, 3, true ) ) ){
+			cvCopy( dst, keep->img );
+		}
+	}
+	else{
+		cvCopy( keep->img, dst );
+	}
+	if( keep ){
+		Filter_Entry* e = &filters.cache[0];
+		for( int i=1; i<FILTER_CACHE && e->buf; i++ ){
+			if( !filters.cache[i].buf || filters.cache[i].used<e->used ){
+				e = &filters.cache[i];
+			}
+		}
+		frame_unref( e->buf );
+		e->buf = keep;
+		e->frame_no = frame_no;
+		e->view = view_rect;
+		e->epoch = filters.epoch;
+		e->used = ++filters.uses;
+		size_t bytes = 0;
+		for( int i=0; i<FILTER_CACHE; i++ ){
+			bytes += filters.cache[i].buf ? filters.cache[i].buf->bytes : 0;
+		}
+		__atomic_store_n( &filters.bytes, bytes, __ATOMIC_RELAXED );
+	}
+	filters.last_ms = ( cvGetTickCount() - start )/( cvGetTickFrequency()*1e3 );
 }
 
-//Draw pause symbol in the image
+//Function to run a stage of the filter pipeline on the filter threads
 /*!
- * Function to draw a two parallel rectangles for the pause button. We pass the sub-image where we want to create the pause button and also pass the color which we desire of the button. We first define 2 points for the first rectangle whose coordinates are stored in pt1 and pt2 and a line between these points would be a vertical line. Now we simply draw 5 lines parallel to this line for the first rectangle and also 5 parallel lines for the second rectangle
- * 
- * \param image : The image where we want to place the pause-rectangles
- * \param color : The desired color
- * 
- * \sa <a href="http://opencv.willowgarage.com/documentation/c/core_basic_structures.html?highlight=point#CvPoint" target="_blank"><b>cvPoint()</b></a>, <a href="http://opencv.willowgarage.com/documentation/c/core_drawing_functions.html?highlight=line#cvLine" target="_blank"><b>cvLine()</b></a>.
+ * Hands the tiles of \a src to the filter threads and waits until all of them are written to \a dst; the time taken is added to the running average of the stage.
  * 
+ * \param s : The stage.
+ * \param src : The input, 8-bit BGR.
+ * \param dst : The output, of the same size; it must not overlap \a src.
  * */
-void draw_pause( IplImage* image, CvScalar color ){
-	int y_start = 3;
-	int y_end = image->height - y_start;
-	int dist = 3;
-	CvPoint pt1, pt2, tmp1, tmp2;
-	pt1.x = image->width/2;
-	pt1.y = y_start;
-	pt2.x = pt1.x;
-	pt2.y = y_end;
-	for( int col=0; col<5; col++  ){
-		tmp1.x = pt1.x + dist + col;
-		tmp1.y = pt1.y;
-		tmp2.x = pt2.x + dist + col;
-		tmp2.y = pt2.y;
-		cvLine( image, tmp1, tmp2, color );
-		tmp1.x = pt1.x - dist - col;
-		tmp1.y = pt1.y;
-		tmp2.x = pt2.x - dist - col;
-		tmp2.y = pt2.y;
-		cvLine( image, tmp1, tmp2, color );
+void filter_stage( Filter_Stage* s, const CvMat* src, const CvMat* dst ){
+	int64 start = cvGetTickCount();
+	pthread_mutex_lock( &filters.lock );
+	filters.stage = s;
+	filters.src = *src;
+	filters.dst = *dst;
+	filters.ntiles = ( dst->rows + FILTER_TILE - 1 )/FILTER_TILE;
+	filters.next_tile = 0;
+	filters.pending = filters.ntiles;
+	pthread_cond_broadcast( &filters.work );
+	while( filters.pending>0 ){
+		pthread_cond_wait( &filters.done, &filters.lock );
 	}
+	pthread_mutex_unlock( &filters.lock );
+	note_decode( &s->us, start );
 }
 
+//The threads filtering the tiles of a stage
+/*!
+ * Every thread takes the next tile not filtered yet until none is left; the last one to finish wakes up filter_stage(). The rows a tile is filtered with are converted into a scratch buffer owned by the thread.
+ * */
+void* filter_worker( void* arg ){
+	uchar* scratch = NULL;
+	size_t scratch_size = 0;
+	pthread_mutex_lock( &filters.lock );
+	while( !filters.quit ){
+		if( filters.pending<=0 || filters.next_tile>=filters.ntiles ){
+			pthread_cond_wait( &filters.work, &filters.lock );
+			continue;
+		}
+		int tile = filters.next_tile++;
+		const Filter_Stage* s = filters.stage;
+		CvMat src = filters.src, dst = filters.dst;
+		pthread_mutex_unlock( &filters.lock );
+		//the tile and the rows around it, in 3 channels
+		int halo = ( s->type==FILTER_BLUR ) ? s->param/2 : 1;
+		size_t size = ( size_t )( FILTER_TILE + 2*halo )*dst.cols*3;
+		if( size>scratch_size ){
+			free( scratch );
+			scratch = ( uchar* )malloc( size );
+			scratch_size = size;
+		}
+		filter_tile( s, &src, &dst, tile*FILTER_TILE, MIN( FILTER_TILE, dst.rows - tile*FILTER_TILE ), scratch );
+		pthread_mutex_lock( &filters.lock );
+		if( --filters.pending==0 ){
+			pthread_cond_signal( &filters.done );
+		}
+	}
+	pthread_mutex_unlock( &filters.lock );
+	free( scratch );
+	return( NULL );
+}
 
-
-//Function to fill color in the area bounded by the given color
-void fill_color( IplImage* image, CvScalar color ){
-	bool start_fill = false;
-	for( int row=0; row<image->height; row++ ){
-		uchar *ptr = ( uchar* )( image->imageData + row*image->widthStep );
-		for( int col=0; col<image->width; col++ ){
-			if(
-				( ptr[ col*image->nChannels + 0 ] == color.val[0] ) &&
-				( ptr[ col*image->nChannels + 1 ] == color.val[1] ) &&
-				( ptr[ col*image->nChannels + 2 ] == color.val[2] )
-			){
-				if( !start_fill ){
-					start_fill = true;
-				}
-				else{
-					start_fill = false;
-					break;
-				}
+//Function to filter a tile of rows
+/*!
+ * A neighbourhood filter reads the rows of \a src around the tile as well, replicating the first and last rows of the frame, so the tiles give the same result as filtering the frame at once. The gray results are written to the three channels of \a dst, so that every stage reads and writes BGR. The luma is computed as in split_bgr_u8().
+ * 
+ * \param s : The stage.
+ * \param src : The input.
+ * \param dst : The output.
+ * \param y0 : First row of the tile.
+ * \param rows : Number of rows of the tile.
+ * \param scratch : Room for \a rows + 2 x ( \a param / 2 ) rows of \a dst for a blur, \a rows + 2 rows otherwise.
+ * */
+void filter_tile( const Filter_Stage* s, const CvMat* src, const CvMat* dst, int y0, int rows, uchar* scratch ){
+	int cols = dst->cols;
+	CvMat in, out;
+	if( s->type==FILTER_GRAY ){
+		for( int y=y0; y<y0 + rows; y++ ){
+			const uchar* p = src->data.ptr + y*src->step;
+			uchar* d = dst->data.ptr + y*dst->step;
+			for( int x=0; x<cols; x++, p+=3, d+=3 ){
+				d[0] = d[1] = d[2] = ( uchar )( ( 29*p[0] + 150*p[1] + 77*p[2] + 128 )>>8 );
 			}
-			if( start_fill ){
-				ptr[ col*image->nChannels + 0 ] = color.val[0];
-				ptr[ col*image->nChannels + 1 ] = color.val[1];
-				ptr[ col*image->nChannels + 2 ] = color.val[2];
+		}
+	}
+	if( s->type==FILTER_THRESHOLD ){
+		cvGetSubRect( src, &in, cvRect( 0, y0, cols, rows ) );
+		cvGetSubRect( dst, &out, cvRect( 0, y0, cols, rows ) );
+		cvThreshold( &in, &out, s->param, 255, CV_THRESH_BINARY );
+	}
+	if( s->type==FILTER_BLUR ){
+		//the rows around the tile are blurred along with it, then dropped
+		int halo = s->param/2;
+		int a0 = MAX( y0 - halo, 0 ), a1 = MIN( y0 + rows + halo, src->rows );
+		CvMat band = cvMat( a1 - a0, cols, CV_8UC3, scratch );
+		cvGetSubRect( src, &in, cvRect( 0, a0, cols, a1 - a0 ) );
+		cvSmooth( &in, &band, CV_GAUSSIAN, s->param, s->param );
+		for( int y=y0; y<y0 + rows; y++ ){
+			memcpy( dst->data.ptr + y*dst->step, band.data.ptr + ( y - a0 )*band.step, cols*3 );
+		}
+	}
+	if( s->type==FILTER_EDGES ){
+		//the luma of the tile and of the rows above and below it
+		int a0 = MAX( y0 - 1, 0 ), a1 = MIN( y0 + rows + 1, src->rows );
+		for( int y=a0; y<a1; y++ ){
+			const uchar* p = src->data.ptr + y*src->step;
+			uchar* l = scratch + ( y - a0 )*cols;
+			for( int x=0; x<cols; x++, p+=3 ){
+				l[x] = ( uchar )( ( 29*p[0] + 150*p[1] + 77*p[2] + 128 )>>8 );
+			}
+		}
+		for( int y=y0; y<y0 + rows; y++ ){
+			const uchar* up = scratch + ( MAX( y - 1, a0 ) - a0 )*cols;
+			const uchar* mid = scratch + ( y - a0 )*cols;
+			const uchar* down = scratch + ( MIN( y + 1, a1 - 1 ) - a0 )*cols;
+			uchar* d = dst->data.ptr + y*dst->step;
+			for( int x=0; x<cols; x++, d+=3 ){
+				int l = MAX( x - 1, 0 ), r = MIN( x + 1, cols - 1 );
+				int gx = up[r] + 2*mid[r] + down[r] - up[l] - 2*mid[l] - down[l];
+				int gy = down[l] + 2*down[x] + down[r] - up[l] - 2*up[x] - up[r];
+				int m = abs( gx ) + abs( gy );
+				d[0] = d[1] = d[2] = ( uchar )MIN( m, 255 );
+			}
+		}
+	}
+	if( s->type==FILTER_CHANNEL ){
+		const uchar* base = src->data.ptr + y0*src->step;
+		int step = src->step;
+		if( s->code>=0 ){
+			CvMat band = cvMat( rows, cols, CV_8UC3, scratch );
+			cvGetSubRect( src, &in, cvRect( 0, y0, cols, rows ) );
+			cvCvtColor( &in, &band, s->code );
+			base = band.data.ptr;
+			step = band.step;
+		}
+		for( int y=0; y<rows; y++ ){
+			const uchar* p = base + y*step + s->param;
+			uchar* d = dst->data.ptr + ( y0 + y )*dst->step;
+			for( int x=0; x<cols; x++, p+=3, d+=3 ){
+				d[0] = d[1] = d[2] = *p;
 			}
 		}
 	}
 }
 
-//Draw stepup symbol
-void draw_stepup( IplImage* image, CvScalar color ){
-	CvPoint pt1, pt2, pt3, pt4;
-	pt1.x = 2*image->width/8;
-	pt2.x = 4*image->width/8;
-	pt3.x = pt1.x;
-	pt4.x = pt2.x;
-	int y_start = 3;
-	int y_end = image->height/2 ;
-	for( int row=y_start; row<=y_end; row++ ){
-		pt1.x = pt1.x + row - y_start;
-		pt2.x = pt2.x + row - y_start;
-		pt1.y = row;
-		pt2.y = row;
-		pt3.x = pt1.x;
-		pt4.x = pt2.x;
-		pt3.y = image->height - row;
-		pt4.y = pt3.y;
-		cvLine( image, pt1, pt2, color );
-		cvLine( image, pt3, pt4, color );
+//Function to drop the filtered frames kept
+/*!
+ * Called when the frames would no longer match, e.g. when switching to another video of the playlist, whose frames have the same numbers.
+ * */
+void filter_flush(){
+	for( int i=0; i<FILTER_CACHE; i++ ){
+		frame_unref( filters.cache[i].buf );
+		filters.cache[i].buf = NULL;
 	}
+	__atomic_store_n( &filters.bytes, ( size_t )0, __ATOMIC_RELAXED );
+	filters.epoch++;
 }
 
-//Draw stepdown_symbol
-void draw_stepdown( IplImage* image, CvScalar color ){
-	CvPoint pt1, pt2, pt3, pt4;
-	pt1.x = 4*image->width/8;
-	pt2.x = 6*image->width/8;
-	pt3.x = pt1.x;
-	pt4.x = pt2.x;
-	int y_start = 3;
-	int y_end = image->height/2 ;
-	for( int row=y_start; row<=y_end; row++ ){
-		pt1.x = pt1.x - row + y_start;
-		pt2.x = pt2.x - row + y_start;
-		pt1.y = row;
-		pt2.y = row;
-		pt3.x = pt1.x;
-		pt4.x = pt2.x;
-		pt3.y = image->height - row;
-		pt4.y = pt3.y;
-		cvLine( image, pt1, pt2, color );
-		cvLine( image, pt3, pt4, color );
+//Function to stop the filter threads and release the frames kept
+void filter_stop(){
+	pthread_mutex_lock( &filters.lock );
+	filters.quit = true;
+	pthread_cond_broadcast( &filters.work );
+	pthread_mutex_unlock( &filters.lock );
+	for( int i=0; i<filters.nworkers; i++ ){
+		pthread_join( filters.workers[i], NULL );
 	}
+	threads_release( filters.nworkers );
+	filters.nworkers = 0;
+	filter_flush();
 }
 
-//Function to change the status
-void change_status(){
-	resetField( status_edit, STATIC_TEXT );
-	cvPutText( status_edit, status_line, cvPoint( 3, status_edit->height - 8 ), &font, black );
+//Function to get the size of the filtered frames kept
+size_t filter_usage(){
+	return( __atomic_load_n( &filters.bytes, __ATOMIC_RELAXED ) );
 }
 
-//Function for editing the step_edit field
-void type_step( char c, int frame_val ){
-	resetField( step_edit, EDIT_TEXT );
-	char temp_text[ 20 ];
-	int cur_frame;
-	sprintf( temp_text, "" );
-	if( blinking ){
-		if( blink_count<blink_max ){
-			blink_count++;
-		}
-		else{
-			blinking = false;
-			blink_char = ' ';
-			blink_count = 0;
-		}
-		//printf( "Blinking...\n" );
+//Function to write the state of the filter pipeline as JSON
+/*!
+ * Writes the stages, the frames found among the frames kept and the time taken by every stage as comma separated JSON members.
+ * 
+ * \return The number of characters written.
+ * */
+int filter_metrics( char* buf, int size ){
+	int len = snprintf( buf, size, "\"filters\":\"%s\",\"filters_on\":%s,\"filter_full\":%s,\"filter_frames\":%ld,\"filter_hits\":%ld,\"filter_ms\":%.3f,\"filter_stage_ms\":[",
+		filters.spec, ( filters.count && filters.enabled ) ? "true" : "false", filters.full ? "true" : "false", filters.uses, filters.hits, filters.last_ms );
+	for( int i=0; i<filters.count && len<size; i++ ){
+		len += snprintf( buf + len, size - len, "%s%.3f", i ? "," : "", filters.stages[i].us/1e3 );
 	}
-	else{
-		if( blink_count<blink_max ){
-			blink_count++;
+	len = MIN( len, size - 1 );
+	len += snprintf( buf + len, size - len, "]" );
+	return( MIN( len, size - 1 ) );
+}
+
+//Function to get the timestamp of a frame
+/*!
+ * For a video file the timestamp is the one reported by the capture with the frame, kept with the frame when it was decoded ahead by the prefetcher, or the one known to the engine. A frame not decoded yet gets a timestamp estimated from the frame rate. The FFmpeg capture of OpenCV 2.x reports the frame number over the nominal frame rate rather than the PTS, so a file whose frame rate varies falls back to nominal timing. The frames of a streamed or a live input are taken to be evenly spaced.
+ * 
+ * \param frame_no : Number of the frame.
+ * \param ms : Receives the timestamp in milliseconds.
+ * \return true if the timestamp is exact, false if it is estimated.
+ * */
+bool get_frame_time( int frame_no, double* ms ){
+	if( vid ){
+		if( fetched_buf && fetched_buf->frame_no==frame_no && fetched_buf->pts_ms>=0 ){
+			*ms = fetched_buf->pts_ms;
+			return( true );
 		}
-		else{
-			blinking = true;
-			blink_char = '|';
-			blink_count = 0;
+		if( frame_no<1 ){
+			*ms = 0;
+			return( false );
 		}
-		//printf( "Not blinking...\n" );
+		return( vp_frame_time( vid, frame_no, ms )==VP_OK );
 	}
-	//valid number
-	if( c>=48 && c<=57 ){
-		sprintf( temp_text, "%s%c", edit_text, c );
-		if( ( frame_val + atoi( temp_text ) )>=0 && ( frame_val + atoi( temp_text ) )<=sldr_maxval && ( atoi( temp_text )!=0 ) ){
-			sprintf( edit_text, "%s", temp_text );
+	*ms = MAX( frame_no - sldr_start, 0 )*1e3/( ( fps>0 ) ? fps : 25 );
+	return( true );
+}
+
+//Function to write a time as an SMPTE timecode
+/*!
+ * Writes HH:MM:SS:FF, the frames FF being counted at the nominal frame rate, i.e. \a fps rounded. In a file whose frame rate varies, FF is thus the time elapsed within the second rather than the number of frames actually shown in it.
+ * 
+ * \param ms : The time in milliseconds.
+ * \param text : Receives the timecode.
+ * \param size : Size of \a text.
+ * */
+void format_timecode( double ms, char* text, int size ){
+	int nominal = MAX( cvRound( fps ), 1 );
+	long frames = ( long )floor( MAX( ms, 0 )*nominal/1e3 + 1e-6 );
+	long secs = frames/nominal;
+	snprintf( text, size, "%02ld:%02ld:%02ld:%02ld", secs/3600, ( secs/60 )%60, secs%60, frames%nominal );
+}
+
+//Function to read a time given as a timecode or in seconds
+/*!
+ * Reads an SMPTE timecode, HH:MM:SS:FF ( or HH:MM:SS;FF ) with FF less than the nominal frame rate, or a time in seconds, [[HH:]MM:]SS[.fraction], e.g. 01:02:03.04, 1:30 or 0.5.
+ * 
+ * \param text : The text to be read.
+ * \param ms : Receives the time in milliseconds.
+ * \return false if \a text is not a valid time.
+ * */
+bool parse_time( const char* text, double* ms ){
+	int nominal = MAX( cvRound( fps ), 1 );
+	int hh, mm, ss, ff;
+	char sep, end;
+	if( sscanf( text, "%d:%d:%d%c%d%c", &hh, &mm, &ss, &sep, &ff, &end )==5 && ( sep==':' || sep==';' ) ){
+		if( hh<0 || mm<0 || mm>59 || ss<0 || ss>59 || ff<0 || ff>=nominal ){
+			return( false );
 		}
+		*ms = ( ( hh*60.0 + mm )*60 + ss )*1e3 + ff*1e3/nominal;
+		return( true );
 	}
-	//backspace
-	if( c==8 ){
-		if( strcmp( edit_text, "" )!=0 ){
-			for( int count=0; count<( strlen( edit_text )-1 ); count++ ){
-				sprintf( temp_text, "%s%c", temp_text, edit_text[ count ] );
-			}
-			sprintf( edit_text, "%s", temp_text );
+	//up to three fields separated by ':', the last one with a fraction
+	double secs = 0;
+	const char* p = text;
+	for( int field=0; field<3; field++ ){
+		char* stop;
+		if( *p<'0' || *p>'9' ){
+			return( false );
 		}
+		double value = strtod( p, &stop );
+		if( *stop==':' && field<2 && value==floor( value ) ){
+			secs = ( secs + value )*60;
+			p = stop + 1;
+			continue;
+		}
+		if( *stop!='\0' ){
+			return( false );
+		}
+		*ms = ( secs + value )*1e3;
+		return( true );
 	}
-	sprintf( temp_text, "%s%c", edit_text, blink_char );
-	cvPutText( step_edit, temp_text, cvPoint( 3, step_edit->height - 4 ), &font, black );
-	if( c==10 ){
-		resetField( step_edit, EDIT_TEXT );
-		cvPutText( step_edit, edit_text, cvPoint( 3, step_edit->height - 4 ), &font, black );
-		step_val = atoi( edit_text );
-		//printf( "Step : %d\n", step );
-		typing_step = false;
-	}
+	return( false );
 }
 
-//Function to reset all edit fields after mouse-left-click is performed
-void resetAllEdits(){
-	resetField( step_edit, EDIT_TEXT );
-	sprintf( edit_text, "%d", step_val );
-	cvPutText( step_edit, edit_text, cvPoint( 3, step_edit->height - 4 ), &font, black );
-	typing_step = false;
+//Function to go to the frame shown at a given time
+/*!
+ * The frame shown at \a ms is the last one whose timestamp is not after it ( see get_frame_time() ). For a video file it is found by the engine from the timestamps reported by the capture ( see vp_seek_time() ), which are nominal with the FFmpeg capture of OpenCV 2.x; the frames of a streamed or a live input are taken to be evenly spaced. The frame is shown through show_frame().
+ * 
+ * \param ms : The time in milliseconds.
+ * \return The number of the frame reached, -1 when the engine cannot find it; the frame shown is kept then.
+ * */
+int seek_time( double ms ){
+	if( vid ){
+		int f = vp_seek_time( vid, ms );
+		if( f<=0 ){
+			return( -1 );
+		}
+		show_frame( f );
+	}
+	else{
+		show_frame( sldr_start + ( int )floor( ms*( ( fps>0 ) ? fps : 25 )/1e3 + 1e-6 ) );
+	}
+	return( get_frame_pos() );
 }
@@ -0,0 +1,410 @@
+/*!
+    \file videoplayer.c Source code of libvideoplayer, the engine of the video player.
+
+    The library is built from this file alone, e.g.
+    \code
+    g++ -shared -fPIC videoplayer.c -o libvideoplayer.so `pkg-config --cflags --libs opencv`
+    \endcode
+    and used through videoplayer.h. It has no global state: everything lives in the VP_Player handles.
+ */
+#include<highgui.h>
+#include<cv.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+#include<limits.h>
+#include "videoplayer.h"
+
+//! Largest number of frames decoded and dropped to reach a frame ahead, rather than seeking to it.
+/*!
+  Seeking a CvCapture costs about as much as decoding from the previous key frame, so a frame a few frames ahead is reached faster by decoding the frames in between.
+  \sa vp_next_frame().
+ */
+#define VP_SKIP_AHEAD	8
+
+//! Largest difference between two timestamps of the same frame, in milliseconds.
+#define VP_TIME_TOLERANCE	0.5
+
+//! Largest number of guesses made by vp_seek_time() to find the frame shown at a time.
+/*!
+  Every guess decodes at most one frame; a guess is only wrong where the frame rate varies, and the next one starts from the timestamp found.
+ */
+#define VP_TIME_TRIES	16
+
+//! A player.
+/*!
+  A CvCapture along with the number of the frame decoded last and the number of the frame to be decoded next; the capture is only repositioned when these do not follow each other. The player counts the frames it decodes instead of asking the capture for its position, and keeps the timestamp reported by the capture for every frame decoded, by frame number: after a seek, the frame reached is recognised by its timestamp when it was decoded before, and the timestamps map times to frames. With the FFmpeg capture of OpenCV 2.x these timestamps are derived from the frame number and the nominal frame rate, not the PTS, so a file whose frame rate varies is timed nominally.
+  \sa vp_open().
+  */
+struct VP_Player{
+	CvCapture* cap;//!< The capture.
+	VP_Properties props;//!< Properties of the video, read when it is opened.
+	int pos;//!< Number of the frame decoded last; \a props.start before the first frame.
+	int next;//!< Number of the frame to be decoded next.
+	IplImage* last;//!< The frame decoded last, owned by the capture; NULL when there is none.
+	VP_Stats stats;//!< The counters.
+	double* pts;//!< Timestamp of every frame decoded so far in milliseconds, by frame number; negative when not known.
+	int npts;//!< Number of entries of \a pts.
+};
+
+//Function to record the timestamp of a frame
+static void note_time( VP_Player* p, int frame_no, double ms ){
+	if( frame_no<0 ){
+		return;
+	}
+	if( frame_no>=p->npts ){
+		int n = MAX( frame_no + 1, MAX( 2*p->npts, p->props.frames + 2 ) );
+		p->pts = ( double* )realloc( p->pts, n*sizeof( double ) );
+		for( int i=p->npts; i<n; i++ ){
+			p->pts[i] = -1;
+		}
+		p->npts = n;
+	}
+	p->pts[ frame_no ] = ms;
+}
+
+//Function to recognise a frame by its timestamp
+/*!
+ * \param p : The player.
+ * \param ms : Timestamp of the frame.
+ * \param guess : Number the frame is thought to have.
+ * \return The frame decoded before with the timestamp \a ms, the nearest to \a guess if there are several; \a guess when there is none.
+ * */
+static int find_time( const VP_Player* p, double ms, int guess ){
+	for( int d=0; d<p->npts; d++ ){
+		if( guess - d>=0 && guess - d<p->npts && p->pts[ guess - d ]>=0 && fabs( p->pts[ guess - d ] - ms )<VP_TIME_TOLERANCE ){
+			return( guess - d );
+		}
+		if( d && guess + d>=0 && guess + d<p->npts && p->pts[ guess + d ]>=0 && fabs( p->pts[ guess + d ] - ms )<VP_TIME_TOLERANCE ){
+			return( guess + d );
+		}
+	}
+	return( guess );
+}
+
+//Function to get the version of the library
+/*!
+ * A caller built against videoplayer.h can compare this with #VP_API_VERSION to check that it runs with a compatible library.
+ *
+ * \return #VP_API_VERSION of the library.
+ * */
+int vp_api_version( void ){
+	return( VP_API_VERSION );
+}
+
+//Function to open a video
+/*!
+ * Opens \a path with <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html#capturefromfile" target="_blank"><b>cvCaptureFromFile()</b></a> and reads its properties. No frame is decoded yet.
+ *
+ * \param path : Path of the video.
+ * \return The player, NULL if the file cannot be opened.
+ * \sa vp_close().
+ * */
+VP_Player* vp_open( const char* path ){
+	if( !path ){
+		return( NULL );
+	}
+	CvCapture* cap = cvCaptureFromFile( path );
+	if( !cap ){
+		return( NULL );
+	}
+	VP_Player* p = ( VP_Player* )calloc( 1, sizeof( VP_Player ) );
+	p->cap = cap;
+	p->props.width = ( int )cvGetCaptureProperty( cap, CV_CAP_PROP_FRAME_WIDTH );
+	p->props.height = ( int )cvGetCaptureProperty( cap, CV_CAP_PROP_FRAME_HEIGHT );
+	p->props.channels = 3;
+	p->props.frame_bytes = p->props.width*p->props.height*p->props.channels;
+	p->props.frames = ( int )cvGetCaptureProperty( cap, CV_CAP_PROP_FRAME_COUNT );
+	p->props.start = ( int )cvGetCaptureProperty( cap, CV_CAP_PROP_POS_FRAMES );
+	p->props.fps = cvGetCaptureProperty( cap, CV_CAP_PROP_FPS );
+	long code = ( long )cvGetCaptureProperty( cap, CV_CAP_PROP_FOURCC );
+	char* c = ( char* )( &code );
+	sprintf( p->props.fourcc, "%c%c%c%c", c[0], c[1], c[2], c[3] );
+	cvSetCaptureProperty( cap, CV_CAP_PROP_POS_FRAMES, p->props.start );
+	p->pos = p->props.start;
+	p->next = p->pos + 1;
+	return( p );
+}
+
+//Function to close a video
+/*!
+ * Releases the capture and the player. \a p may be NULL.
+ * */
+void vp_close( VP_Player* p ){
+	if( !p ){
+		return;
+	}
+	cvReleaseCapture( &p->cap );
+	free( p->pts );
+	free( p );
+}
+
+//Function to get the properties of a video
+/*!
+ * \param p : The player.
+ * \param props : Receives the properties.
+ * \return #VP_OK, or #VP_ERR_ARG.
+ * */
+int vp_get_properties( const VP_Player* p, VP_Properties* props ){
+	if( !p || !props ){
+		return( VP_ERR_ARG );
+	}
+	*props = p->props;
+	return( VP_OK );
+}
+
+//Function to get the number of the frame decoded last
+/*!
+ * The frames are counted from the last seek, where the position is read from the capture once and checked against the timestamps of the frames decoded before; the position of the capture is never asked for while playing.
+ *
+ * \return The number of the frame decoded last, which is \a start of VP_Properties before the first one; #VP_ERR_ARG for a NULL player.
+ * */
+int vp_position( const VP_Player* p ){
+	return( p ? p->pos : VP_ERR_ARG );
+}
+
+//Function to choose the next frame to be decoded
+/*!
+ * Nothing is decoded here; the capture is only repositioned by the next vp_next_frame(), if needed. A frame after the last one can be asked for, vp_next_frame() then returns #VP_END.
+ *
+ * \param p : The player.
+ * \param frame_no : Number of the frame, from 1.
+ * \return #VP_OK, #VP_ERR_ARG or #VP_ERR_RANGE.
+ * */
+int vp_seek( VP_Player* p, int frame_no ){
+	if( !p ){
+		return( VP_ERR_ARG );
+	}
+	if( frame_no<1 ){
+		return( VP_ERR_RANGE );
+	}
+	p->next = frame_no;
+	return( VP_OK );
+}
+
+//Function to move the next frame to be decoded relative to the current one
+/*!
+ * The next vp_next_frame() decodes the frame \a k frames after the frame decoded last ( before it, for a negative \a k ). A step of 1 plays the video.
+ *
+ * \return #VP_OK, #VP_ERR_ARG or #VP_ERR_RANGE.
+ * \sa vp_seek().
+ * */
+int vp_step( VP_Player* p, int k ){
+	if( !p ){
+		return( VP_ERR_ARG );
+	}
+	return( vp_seek( p, p->pos + k ) );
+}
+
+//Function to decode the next frame
+/*!
+ * Decodes the frame chosen by vp_seek() or vp_step(), or else the frame following the one decoded last. A frame at most #VP_SKIP_AHEAD frames ahead is reached by decoding the frames in between. Otherwise the capture is repositioned; as in the player, a CvCapture positioned at \a n returns the frame \a n + 2 from its second <a href="http://opencv.willowgarage.com/documentation/c/reading_and_writing_images_and_video.html?highlight=cvqueryframe#cvQueryFrame" target="_blank"><b>cvQueryFrame()</b></a>, hence the frame before the one asked for is decoded first. The timestamp of every frame decoded, <em>CV_CAP_PROP_POS_MSEC</em> of the capture, is recorded for vp_frame_time().
+ *
+ * \param p : The player.
+ * \param data : Receives the frame, \a height rows of \a width x 3 bytes; may be NULL to decode only, see vp_peek_frame().
+ * \param stride : Distance between the rows of \a data, in bytes.
+ * \return The number of the frame decoded, #VP_END past the last frame, or #VP_ERR_ARG.
+ * */
+int vp_next_frame( VP_Player* p, unsigned char* data, int stride ){
+	if( !p || ( data && stride<p->props.width*p->props.channels ) ){
+		return( VP_ERR_ARG );
+	}
+	int64 start = cvGetTickCount();
+	int ahead = p->next - ( p->pos + 1 );
+	bool moved = false;
+	if( ahead>0 && ahead<=VP_SKIP_AHEAD ){
+		for( ; ahead>0 && cvQueryFrame( p->cap ); ahead-- ){
+			note_time( p, ++p->pos, cvGetCaptureProperty( p->cap, CV_CAP_PROP_POS_MSEC ) );
+			p->stats.decoded++;
+			p->stats.skipped++;
+		}
+	}
+	else if( ahead ){
+		cvSetCaptureProperty( p->cap, CV_CAP_PROP_POS_FRAMES, ( double )MAX( p->next - 2, 0 ) );
+		if( p->next>=2 && cvQueryFrame( p->cap ) ){
+			p->stats.decoded++;
+		}
+		p->stats.seeks++;
+		moved = true;
+	}
+	p->last = cvQueryFrame( p->cap );
+	if( p->last ){
+		double ms = cvGetCaptureProperty( p->cap, CV_CAP_PROP_POS_MSEC );
+		if( moved ){
+			//the position is read once after a seek, some backends report it negative
+			int f = ( int )cvGetCaptureProperty( p->cap, CV_CAP_PROP_POS_FRAMES );
+			p->pos = find_time( p, ms, ( f>0 ) ? f : p->next );
+		}
+		else{
+			p->pos++;
+		}
+		note_time( p, p->pos, ms );
+	}
+	else if( moved ){
+		p->pos = p->next - 1;
+	}
+	p->next = p->pos + 1;
+	p->stats.last_ms = ( cvGetTickCount() - start )/( cvGetTickFrequency()*1e3 );
+	p->stats.decode_ms += p->stats.last_ms;
+	if( !p->last ){
+		return( VP_END );
+	}
+	p->stats.decoded++;
+	p->stats.returned++;
+	if( data ){
+		int rows = MIN( p->props.height, p->last->height );
+		int bytes = MIN( p->props.width, p->last->width )*p->props.channels;
+		for( int row=0; row<rows; row++ ){
+			memcpy( data + row*stride, p->last->imageData + row*p->last->widthStep, bytes );
+		}
+	}
+	return( p->pos );
+}
+
+//Function to get the pixels of the frame decoded last
+/*!
+ * Gives access to the frame decoded last by vp_next_frame() without copying it. The pixels belong to the player and only stay valid until its next call.
+ *
+ * \param p : The player.
+ * \param data : Receives the address of the first row.
+ * \param stride : Receives the distance between the rows, in bytes.
+ * \return The number of the frame, #VP_END when there is none, or #VP_ERR_ARG.
+ * */
+int vp_peek_frame( const VP_Player* p, const unsigned char** data, int* stride ){
+	if( !p || !data || !stride ){
+		return( VP_ERR_ARG );
+	}
+	if( !p->last ){
+		return( VP_END );
+	}
+	*data = ( const unsigned char* )p->last->imageData;
+	*stride = p->last->widthStep;
+	return( p->pos );
+}
+
+//Function to get the timestamp of a frame
+/*!
+ * The timestamp of a frame decoded before is exact. Otherwise it is estimated from the nearest frame decoded before it, at the frame rate of the video, or from the start of the video when there is none.
+ *
+ * \param p : The player.
+ * \param frame_no : Number of the frame, from 1.
+ * \param ms : Receives the timestamp in milliseconds.
+ * \return #VP_OK for an exact timestamp, #VP_ESTIMATE, #VP_ERR_ARG or #VP_ERR_RANGE.
+ * */
+int vp_frame_time( const VP_Player* p, int frame_no, double* ms ){
+	if( !p || !ms ){
+		return( VP_ERR_ARG );
+	}
+	if( frame_no<1 ){
+		return( VP_ERR_RANGE );
+	}
+	double step = 1e3/( ( p->props.fps>0 ) ? p->props.fps : 25 );
+	for( int f=MIN( frame_no, p->npts - 1 ); f>=1; f-- ){
+		if( p->pts[f]>=0 ){
+			*ms = p->pts[f] + ( frame_no - f )*step;
+			return( ( f==frame_no ) ? VP_OK : VP_ESTIMATE );
+		}
+	}
+	*ms = ( frame_no - p->props.start - 1 )*step;
+	return( VP_ESTIMATE );
+}
+
+//Function to choose the next frame to be decoded by its timestamp
+/*!
+ * Finds the frame shown at the time \a ms, i.e. the last frame whose timestamp is not after it, and makes it the next frame to be decoded. The frame is first guessed from the timestamps known and the frame rate. Every guess is decoded, if not decoded before, and narrows the range of frames left between the last frame found at or before \a ms and the first one found after it; the next guess is made from its timestamp, or halfway through the range when that falls outside of it. With a constant frame rate, or timestamps computed from it as the FFmpeg capture of OpenCV 2.x does, the first two guesses are right; a capture reporting the real timestamps of a file whose frame rate varies needs a few more, at most #VP_TIME_TRIES.
+ *
+ * \param p : The player.
+ * \param ms : The time in milliseconds.
+ * \return The number of the frame, #VP_ERR_ARG, #VP_ERR_RANGE, or #VP_ERR_TIME when the frame is not found within #VP_TIME_TRIES guesses; the next frame to be decoded is left unchanged on error.
+ * */
+int vp_seek_time( VP_Player* p, double ms ){
+	if( !p ){
+		return( VP_ERR_ARG );
+	}
+	if( ms<0 ){
+		return( VP_ERR_RANGE );
+	}
+	double step = 1e3/( ( p->props.fps>0 ) ? p->props.fps : 25 );
+	int next = p->next;
+	//from the latest frame known not to be after ms
+	int f = p->props.start + 1 + ( int )floor( ms/step + 1e-9 );
+	for( int k=MIN( p->npts - 1, f + VP_SKIP_AHEAD ); k>=1; k-- ){
+		if( p->pts[k]>=0 && p->pts[k]<=ms ){
+			f = k + ( int )floor( ( ms - p->pts[k] )/step + 1e-9 );
+			break;
+		}
+	}
+	if( p->props.frames>0 ){
+		f = MIN( f, p->props.frames );
+	}
+	//the frames known to be shown at or before ms ( lo ) and after it ( hi )
+	int lo = 0, hi = ( p->props.frames>0 ) ? p->props.frames + 1 : INT_MAX;
+	for( int tries=0; tries<VP_TIME_TRIES && hi - lo>1; tries++ ){
+		//a guess outside of the frames left is replaced by the one halfway
+		if( f<=lo || f>=hi ){
+			f = ( hi==INT_MAX ) ? lo + 1 : lo + ( hi - lo )/2;
+		}
+		double t;
+		if( vp_frame_time( p, f, &t )!=VP_OK ){
+			vp_seek( p, f );
+			int got = vp_next_frame( p, NULL, 0 );
+			if( got<=0 ){
+				//past the end
+				hi = f;
+				continue;
+			}
+			//the frame reached, which is not f if the capture landed elsewhere
+			f = got;
+			vp_frame_time( p, f, &t );
+		}
+		if( t>ms + 1e-3 ){
+			hi = MIN( hi, f );
+			f -= MAX( ( int )ceil( ( t - ms )/step - 1e-9 ), 1 );
+		}
+		else{
+			lo = MAX( lo, f );
+			f += MAX( ( int )floor( ( ms - t )/step + 1e-9 ), 1 );
+		}
+	}
+	if( hi - lo>1 ){
+		//out of guesses, a frame of the range left would only be a guess
+		p->next = next;
+		return( VP_ERR_TIME );
+	}
+	//before the first frame, the first frame is shown
+	f = MAX( lo, 1 );
+	vp_seek( p, f );
+	return( f );
+}
+
+//Function to get the counters of a player
+/*!
+ * \param p : The player.
+ * \param stats : Receives the counters.
+ * \return #VP_OK, or #VP_ERR_ARG.
+ * */
+int vp_get_stats( const VP_Player* p, VP_Stats* stats ){
+	if( !p || !stats ){
+		return( VP_ERR_ARG );
+	}
+	*stats = p->stats;
+	return( VP_OK );
+}
+
+//Function to describe a result code
+const char* vp_strerror( int code ){
+	switch( code ){
+		case VP_END:
+			return( "no more frames" );
+		case VP_ERR_ARG:
+			return( "invalid argument" );
+		case VP_ERR_RANGE:
+			return( "no such frame" );
+		case VP_ERR_TIME:
+			return( "no frame found at that time" );
+		case VP_ESTIMATE:
+			return( "estimated" );
+	}
+	return( code>=0 ? "success" : "unknown error" );
+}
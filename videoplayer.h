@@ -0,0 +1,125 @@
+/*!
+    \file videoplayer.h Interface of libvideoplayer, the engine of the video player.
+
+    The library opens a video file, seeks in it, steps through it and decodes its frames into buffers of the caller, without any window. All its state lives in a VP_Player handle: several players may be used at the same time, each on its own thread. A handle itself must only be used by one thread at a time.
+
+    The frames are numbered from 1, the way the player shows them. The frames are 8-bit BGR, \a width x \a height x 3 bytes, rows \a stride bytes apart. Every frame also has a timestamp in milliseconds, the <em>CV_CAP_PROP_POS_MSEC</em> of the capture; see vp_frame_time() and vp_seek_time(). The FFmpeg capture of OpenCV 2.x computes it from the frame number and the nominal frame rate rather than reading the PTS of the frame, so a file whose frame rate varies falls back to nominal timing. A capture reporting the real PTS would have its frames mapped to times right as well.
+
+    \code
+    VP_Player* p = vp_open( "video.avi" );
+    VP_Properties props;
+    vp_get_properties( p, &props );
+    unsigned char* buf = ( unsigned char* )malloc( props.frame_bytes );
+    vp_seek( p, 100 );
+    for( int f; ( f = vp_next_frame( p, buf, props.width*props.channels ) )>0 && f<200; ){
+        //use frame f
+    }
+    vp_close( p );
+    \endcode
+
+    The player uses the library for its main video, the files of its playlist, the export and the quality comparison; its other background threads ( prefetch, hashing, timeline, thumbnails, comparison ) decode with captures of their own. batch.c is an example client, decoding several videos at once.
+ */
+#ifndef VIDEOPLAYER_H
+#define VIDEOPLAYER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! Version of this interface, see vp_api_version().
+/*!
+  Incremented whenever a function or a structure of this file changes in a way that breaks the callers built against an older version.
+ */
+#define VP_API_VERSION	1
+
+//! Result of a successful call.
+#define VP_OK		0
+//! There is no frame left to decode.
+#define VP_END		-1
+//! An argument is invalid, e.g. a NULL handle.
+#define VP_ERR_ARG	-2
+//! The frame asked for is not in the video.
+#define VP_ERR_RANGE	-3
+//! The frame shown at a time could not be found, see vp_seek_time().
+#define VP_ERR_TIME	-4
+//! A timestamp is estimated from the frame rate, the frame not having been decoded yet.
+#define VP_ESTIMATE	1
+
+//! A player, opaque to the callers.
+/*!
+  \sa vp_open(), vp_close().
+ */
+typedef struct VP_Player VP_Player;
+
+//! Properties of a video.
+/*!
+  \sa vp_get_properties().
+ */
+typedef struct{
+	int width;//!< Width of the frames.
+	int height;//!< Height of the frames.
+	int channels;//!< Number of channels of the frames, always 3 ( BGR ).
+	int frame_bytes;//!< Size of a frame without padding, \a width x \a height x \a channels.
+	int frames;//!< Number of frames, as reported by the container.
+	int start;//!< Position of the capture before the first frame, usually 0.
+	double fps;//!< Frame rate, 0 when the container does not report it.
+	char fourcc[ 5 ];//!< FOURCC of the codec.
+} VP_Properties;
+
+//! Counters of a player.
+/*!
+  \sa vp_get_stats().
+ */
+typedef struct{
+	long decoded;//!< Number of frames decoded.
+	long returned;//!< Number of frames returned by vp_next_frame().
+	long skipped;//!< Number of frames decoded and dropped to reach a frame shortly ahead instead of seeking.
+	long seeks;//!< Number of times the capture was repositioned.
+	double decode_ms;//!< Total time spent decoding and seeking.
+	double last_ms;//!< Time taken by the last vp_next_frame().
+} VP_Stats;
+
+//! Function to get the version of the library.
+int vp_api_version( void );
+
+//! Function to open a video.
+VP_Player* vp_open( const char* path );
+
+//! Function to close a video.
+void vp_close( VP_Player* p );
+
+//! Function to get the properties of a video.
+int vp_get_properties( const VP_Player* p, VP_Properties* props );
+
+//! Function to get the number of the frame decoded last.
+int vp_position( const VP_Player* p );
+
+//! Function to choose the next frame to be decoded.
+int vp_seek( VP_Player* p, int frame_no );
+
+//! Function to move the next frame to be decoded relative to the current one.
+int vp_step( VP_Player* p, int k );
+
+//! Function to decode the next frame into a buffer.
+int vp_next_frame( VP_Player* p, unsigned char* data, int stride );
+
+//! Function to get the pixels of the frame decoded last, without copying them.
+int vp_peek_frame( const VP_Player* p, const unsigned char** data, int* stride );
+
+//! Function to get the timestamp of a frame.
+int vp_frame_time( const VP_Player* p, int frame_no, double* ms );
+
+//! Function to choose the next frame to be decoded by its timestamp.
+int vp_seek_time( VP_Player* p, double ms );
+
+//! Function to get the counters of a player.
+int vp_get_stats( const VP_Player* p, VP_Stats* stats );
+
+//! Function to describe a result code.
+const char* vp_strerror( int code );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif